@@ -77,4 +77,8 @@ enum {
 #define TCP_REPAIR_OFF 0
 #define TCP_REPAIR_OFF_NO_WP -1
 
+#define SHUT_RD 0    // Further receptions disallowed
+#define SHUT_WR 1    // Further transmissions disallowed
+#define SHUT_RDWR 2  // Both disallowed
+
 #endif
@@ -0,0 +1,18 @@
+#ifndef NOSTR_LINUX_X86_64_SHUTDOWN_H_
+#define NOSTR_LINUX_X86_64_SHUTDOWN_H_
+
+#include "../errno.h"
+#include "./asm.h"
+
+static inline int32_t linux_x8664_shutdown(const int32_t sock_fd, const int32_t how)
+{
+  int32_t ret = linux_x8664_asm_syscall2(
+    __NR_shutdown,
+    sock_fd,
+    how);
+
+  SYSCALL_EARLY_RETURN(ret);
+  return ret;
+}
+
+#endif
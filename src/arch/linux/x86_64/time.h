@@ -0,0 +1,18 @@
+#ifndef NOSTR_LINUX_X86_64_TIME_H_
+#define NOSTR_LINUX_X86_64_TIME_H_
+
+#include "../../../util/types.h"
+#include "../errno.h"
+#include "./asm.h"
+
+static inline int64_t linux_x8664_time(void)
+{
+  int64_t ret = linux_x8664_asm_syscall1(
+    __NR_time,
+    NULL);
+
+  SYSCALL_EARLY_RETURN(ret);
+  return ret;
+}
+
+#endif
@@ -0,0 +1,13 @@
+#ifndef NOSTR_INTERNAL_SHUTDOWN_H_
+#define NOSTR_INTERNAL_SHUTDOWN_H_
+
+#include "../util/types.h"
+#include "linux/sockoption.h"
+#include "linux/x86_64/shutdown.h"
+
+static inline int32_t internal_shutdown(const int32_t sock_fd, const int32_t how)
+{
+  return linux_x8664_shutdown(sock_fd, how);
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef NOSTR_INTERNAL_TIME_H_
+#define NOSTR_INTERNAL_TIME_H_
+
+#include "linux/x86_64/time.h"
+
+static inline int64_t internal_time(void)
+{
+  return linux_x8664_time();
+}
+
+#endif
@@ -2,9 +2,11 @@
 #include "nostr/db/db.h"
 #include "nostr/db/query/db_query.h"
 #include "nostr/db/query/db_query_types.h"
+#include "nostr/event/nostr_verified_cache.h"
 #include "nostr/nostr_func.h"
 #include "nostr/response/nostr_response.h"
 #include "nostr/subscription/nostr_close.h"
+#include "nostr/subscription/nostr_fanout.h"
 #include "nostr/subscription/nostr_filter.h"
 #include "nostr/subscription/nostr_req.h"
 #include "nostr/subscription/nostr_subscription.h"
@@ -16,22 +18,82 @@
 // Global state
 // ============================================================================
 static NostrDB*                 g_db                   = NULL;
-static NostrSubscriptionManager g_subscription_manager = {NULL, 0};
+static NostrSubscriptionManager g_subscription_manager = {0};
 static bool                     g_db_initialized       = false;
+static NostrVerifiedCache       g_verified_cache;
+static NostrFanoutQueue         g_fanout;
+
+// ============================================================================
+// Relay configuration
+// ============================================================================
+static NostrRelayConfig g_relay_config = {
+  .verified_cache_entries    = NOSTR_VERIFIED_CACHE_DEFAULT_ENTRIES,
+  .max_total_subscriptions   = NOSTR_DEFAULT_MAX_TOTAL_SUBSCRIPTIONS,
+  .fanout_budget             = NOSTR_FANOUT_DEFAULT_BUDGET,
+  .req_budget                = NOSTR_DEFAULT_REQ_BUDGET,
+  .fanout_deliveries         = NOSTR_FANOUT_DEFAULT_DELIVERIES,
+  .fanout_arena_bytes        = NOSTR_FANOUT_DEFAULT_ARENA_BYTES,
+  .max_queued_per_connection = NOSTR_DEFAULT_MAX_QUEUED_PER_CONNECTION,
+  .slow_consumer_policy      = NOSTR_SLOW_CONSUMER_DROP_OLDEST,
+  .store_event_json          = false,
+  .query_cache_entries       = NOSTR_DEFAULT_QUERY_CACHE_ENTRIES,
+  .limits = {
+    .max_message_length = NOSTR_DEFAULT_MAX_MESSAGE_LENGTH,
+    .max_subscriptions  = NOSTR_DEFAULT_MAX_SUBSCRIPTIONS,
+    .max_filters        = NOSTR_DEFAULT_MAX_FILTERS,
+    .max_subid_length   = NOSTR_DEFAULT_MAX_SUBID_LENGTH,
+    .max_event_tags     = NOSTR_DEFAULT_MAX_EVENT_TAGS,
+  },
+};
 
 // ============================================================================
 // Response buffer for sending messages
 // ============================================================================
 #define RESPONSE_BUFFER_SIZE 65536
 static char g_response_buffer[RESPONSE_BUFFER_SIZE];
+static char g_event_json_buffer[RESPONSE_BUFFER_SIZE];     // Event object being queued for fan-out
+static char g_fanout_packet_buffer[RESPONSE_BUFFER_SIZE];  // Fan-out frame being written (possibly in parts)
+
+// Binary view of the event being broadcast (too large for the stack)
+static NostrMatchEvent g_match_event;
+
+// Stored-event frames: the EVENT message is serialized at the header offset and
+// the header is written in front of it, so the frame goes out without a copy
+#define FRAME_HEADER_MAX 10
+static char g_stored_frame_buffer[FRAME_HEADER_MAX + RESPONSE_BUFFER_SIZE];
+
+// A REQ's filters, converted for the database and executed together
+static NostrDBFilter g_req_db_filters[NOSTR_REQ_MAX_FILTERS];
+
+// REQs whose stored events are still being sent, a budget per loop iteration
+#define REQ_STREAMS_MAX 256
+
+// Events sent live to a streaming REQ, so the stored copy is not sent again
+// (a ring: only the newest are remembered)
+#define REQ_STREAM_LIVE_IDS 64
+
+typedef struct {
+  NostrDBCursor* cursor;      // NULL if the slot is free
+  int32_t        client_sock;
+  bool           finished;    // Cursor exhausted, EOSE not sent yet
+  bool           cancelled;   // Replaced while mid-frame; dropped once the frame is out
+  uint32_t       resume;      // Bytes of the current stored-event frame already written
+  uint32_t       live_count;  // Live events recorded in live_ids (ring position)
+  uint8_t        resume_event_id[32];
+  uint8_t        live_ids[REQ_STREAM_LIVE_IDS][32];
+  char           subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+} ReqStream;
+
+static ReqStream g_req_streams[REQ_STREAMS_MAX];
+static size_t    g_req_streams_next = 0;  // Slot served first by the next tick
 
 // ============================================================================
-// Helper: Send WebSocket text message
+// Helper: Frame a WebSocket text message
+// Returns packet size, 0 if it does not fit
 // ============================================================================
-static bool send_websocket_message(int32_t client_sock, const char* message, size_t message_len)
+static size_t build_websocket_message(const char* message, size_t message_len, char* packet_buffer, size_t capacity)
 {
   WebSocketEntity response_entity;
-  char            packet_buffer[RESPONSE_BUFFER_SIZE];
 
   internal_memset(&response_entity, 0, sizeof(WebSocketEntity));
   response_entity.fin     = 1;
@@ -50,25 +112,21 @@ static bool send_websocket_message(int32_t client_sock, const char* message, siz
     response_entity.ext_payload_len = message_len;
   }
 
-  size_t packet_size = to_websocket_packet(&response_entity, sizeof(packet_buffer), packet_buffer);
-  if (packet_size == 0) {
-    log_error("Failed to create websocket packet.\n");
-    return false;
-  }
-
-  websocket_send(client_sock, packet_size, packet_buffer);
-  return true;
+  return to_websocket_packet(&response_entity, capacity, packet_buffer);
 }
 
 // ============================================================================
-// Helper: Send OK response
+// Helper: Whether a stored-event frame to the connection is half written
 // ============================================================================
-static void send_ok_response(int32_t client_sock, const char* event_id, bool ok, const char* message)
+static bool req_stream_in_flight(int32_t client_sock)
 {
-  if (nostr_response_ok(event_id, ok, message, g_response_buffer, RESPONSE_BUFFER_SIZE)) {
-    size_t len = strlen(g_response_buffer);
-    send_websocket_message(client_sock, g_response_buffer, len);
+  for (size_t i = 0; i < REQ_STREAMS_MAX; i++) {
+    const ReqStream* stream = &g_req_streams[i];
+    if (stream->cursor != NULL && stream->client_sock == client_sock && stream->resume > 0) {
+      return true;
+    }
   }
+  return false;
 }
 
 // ============================================================================
@@ -171,11 +229,17 @@ static void convert_filter_to_db_filter(const NostrFilter* src, NostrDBFilter* d
   // Copy tag filters
   dst->tags_count = src->tags_count;
   for (size_t i = 0; i < src->tags_count && i < NOSTR_DB_FILTER_MAX_TAGS; i++) {
-    dst->tags[i].name         = src->tags[i].name;
-    dst->tags[i].values_count = src->tags[i].values_count;
-    for (size_t j = 0; j < src->tags[i].values_count && j < NOSTR_DB_FILTER_MAX_TAG_VALUES; j++) {
-      internal_memcpy(dst->tags[i].values[j], src->tags[i].values[j], 32);
+    const NostrFilterTag* tag = &src->tags[i];
+    size_t                count = 0;
+    dst->tags[i].name           = tag->name;
+    for (size_t j = 0; j < tag->values_count && count < NOSTR_DB_FILTER_MAX_TAG_VALUES; j++) {
+      internal_memcpy(dst->tags[i].values[count++], tag->values[j], 32);
     }
+    // The tag index keys values by their first 32 bytes
+    for (size_t j = 0; j < tag->long_values_count && count < NOSTR_DB_FILTER_MAX_TAG_VALUES; j++) {
+      internal_memcpy(dst->tags[i].values[count++], tag->long_values[j].value, 32);
+    }
+    dst->tags[i].values_count = count;
   }
 
   // Copy time range and limit
@@ -188,16 +252,238 @@ static void convert_filter_to_db_filter(const NostrFilter* src, NostrDBFilter* d
   }
 }
 
+// ============================================================================
+// Helper: Write one queued frame, resuming after a short write
+// EVENT frames whose subscription is gone (CLOSE or disconnect) are skipped
+// ============================================================================
+static NostrFanoutSendResult fanout_send(
+  int32_t              client_fd,
+  NostrFanoutFrameType type,
+  const char*          subscription_id,
+  const char*          event_json,
+  size_t               event_json_len,
+  uint32_t*            resume,
+  void*                user_data)
+{
+  if (type == NOSTR_FANOUT_FRAME_EVENT && *resume == 0 &&
+      nostr_subscription_find(&g_subscription_manager, client_fd, subscription_id) == NULL) {
+    return NOSTR_FANOUT_SKIPPED;
+  }
+
+  // A stored-event frame is half written: wait until it is out
+  if (*resume == 0 && req_stream_in_flight(client_fd)) {
+    return NOSTR_FANOUT_BLOCKED;
+  }
+
+  const char* message     = g_response_buffer;
+  size_t      message_len = 0;
+  bool        built       = false;
+  if (type == NOSTR_FANOUT_FRAME_REPLY) {
+    message     = event_json;
+    message_len = event_json_len;
+    built       = true;
+  } else if (type == NOSTR_FANOUT_FRAME_EVENT) {
+    built = nostr_response_event_raw(subscription_id, event_json, event_json_len, g_response_buffer, RESPONSE_BUFFER_SIZE);
+  } else if (type == NOSTR_FANOUT_FRAME_NOTICE) {
+    built = nostr_response_notice("rate-limited: slow consumer, live events were dropped", g_response_buffer, RESPONSE_BUFFER_SIZE);
+  } else {
+    built = nostr_response_closed(subscription_id, "rate-limited: slow consumer", g_response_buffer, RESPONSE_BUFFER_SIZE);
+  }
+  if (!built) {
+    return NOSTR_FANOUT_SKIPPED;
+  }
+  if (type != NOSTR_FANOUT_FRAME_REPLY) {
+    message_len = strlen(g_response_buffer);
+  }
+
+  size_t packet_size = build_websocket_message(message, message_len, g_fanout_packet_buffer, sizeof(g_fanout_packet_buffer));
+  if (packet_size <= *resume) {
+    return NOSTR_FANOUT_SKIPPED;
+  }
+
+  ssize_t written = websocket_send_partial(client_fd, packet_size - *resume, g_fanout_packet_buffer + *resume);
+  if (written == WEBSOCKET_ERRORCODE_CONTINUABLE_ERROR) {
+    return NOSTR_FANOUT_BLOCKED;
+  }
+  if (written < 0) {
+    return NOSTR_FANOUT_SKIPPED;  // Socket is going away; the loop reports the disconnect
+  }
+
+  *resume += (uint32_t)written;
+  return *resume == packet_size ? NOSTR_FANOUT_SENT : NOSTR_FANOUT_BLOCKED;
+}
+
+// ============================================================================
+// Helper: Carry out a slow-consumer action returned by the fan-out queue
+// ============================================================================
+static void fanout_action(NostrFanoutPushResult action, int32_t client_fd, const char* subscription_id, void* user_data)
+{
+  if (action == NOSTR_FANOUT_CLOSE) {
+    log_info("[Fanout] Slow consumer, subscription closed\n");
+    nostr_subscription_remove(&g_subscription_manager, client_fd, subscription_id);
+  } else if (action == NOSTR_FANOUT_DISCONNECT) {
+    // The loop sees the hangup, closes the socket and runs the disconnect callback
+    log_info("[Fanout] Slow consumer, disconnecting\n");
+    websocket_shutdown(client_fd);
+  }
+}
+
+// ============================================================================
+// Helper: Queue a reply behind the connection's pending frames
+// written bytes of it already went out directly. A reply that finds the
+// queue full is a slow-consumer event: make room as broadcast does, and
+// drop the connection if even that fails.
+// ============================================================================
+static bool queue_websocket_message(int32_t client_sock, const char* message, size_t message_len, uint32_t written)
+{
+  NostrFanoutPushResult result = nostr_fanout_push_reply(&g_fanout, client_sock, message, message_len, written);
+  if (result == NOSTR_FANOUT_FULL) {
+    // Draining builds frames in g_response_buffer, which may hold the message
+    static char reply[RESPONSE_BUFFER_SIZE];
+    internal_memcpy(reply, message, message_len);
+
+    nostr_fanout_drain(&g_fanout, 0, fanout_send, NULL);
+    while ((result = nostr_fanout_push_reply(&g_fanout, client_sock, reply, message_len, written)) == NOSTR_FANOUT_FULL) {
+      if (!nostr_fanout_shed_oldest(&g_fanout, fanout_action, NULL)) {
+        break;
+      }
+    }
+  }
+
+  if (result == NOSTR_FANOUT_FULL) {
+    log_error("[Fanout] Reply does not fit the fan-out queue, disconnecting\n");
+    websocket_shutdown(client_sock);
+    return false;
+  }
+  if (result == NOSTR_FANOUT_DISCONNECT) {
+    fanout_action(result, client_sock, "", NULL);
+  }
+  return result == NOSTR_FANOUT_QUEUED;
+}
+
+// ============================================================================
+// Helper: Send WebSocket text message
+// Goes out now when the connection is idle; otherwise (or on a short write)
+// it is queued behind the frames already pending for the connection
+// ============================================================================
+static bool send_websocket_message(int32_t client_sock, const char* message, size_t message_len)
+{
+  if (nostr_fanout_pending(&g_fanout, client_sock) || req_stream_in_flight(client_sock)) {
+    return queue_websocket_message(client_sock, message, message_len, 0);
+  }
+
+  char   packet_buffer[RESPONSE_BUFFER_SIZE];
+  size_t packet_size = build_websocket_message(message, message_len, packet_buffer, sizeof(packet_buffer));
+  if (packet_size == 0) {
+    log_error("Failed to create websocket packet.\n");
+    return false;
+  }
+
+  ssize_t written = websocket_send_partial(client_sock, packet_size, packet_buffer);
+  if (written == WEBSOCKET_ERRORCODE_CONTINUABLE_ERROR) {
+    written = 0;
+  } else if (written < 0) {
+    return false;  // Socket is going away; the loop reports the disconnect
+  }
+
+  if ((size_t)written == packet_size) {
+    return true;
+  }
+  return queue_websocket_message(client_sock, message, message_len, (uint32_t)written);
+}
+
+// ============================================================================
+// Helper: Send OK response
+// ============================================================================
+static void send_ok_response(int32_t client_sock, const char* event_id, bool ok, const char* message)
+{
+  if (nostr_response_ok(event_id, ok, message, g_response_buffer, RESPONSE_BUFFER_SIZE)) {
+    size_t len = strlen(g_response_buffer);
+    send_websocket_message(client_sock, g_response_buffer, len);
+  }
+}
+
+// ============================================================================
+// Helper: Send CLOSED response
+// ============================================================================
+static void send_closed_response(int32_t client_sock, const char* subscription_id, const char* message)
+{
+  if (nostr_response_closed(subscription_id, message, g_response_buffer, RESPONSE_BUFFER_SIZE)) {
+    size_t len = strlen(g_response_buffer);
+    send_websocket_message(client_sock, g_response_buffer, len);
+  }
+}
+
+// ============================================================================
+// Helper: Send NOTICE response
+// ============================================================================
+static void send_notice_response(int32_t client_sock, const char* message)
+{
+  if (nostr_response_notice(message, g_response_buffer, RESPONSE_BUFFER_SIZE)) {
+    size_t len = strlen(g_response_buffer);
+    send_websocket_message(client_sock, g_response_buffer, len);
+  }
+}
+
 // ============================================================================
 // Callback context for broadcast
 // ============================================================================
+#define BROADCAST_MAX_CLOSES 64
+
 typedef struct {
-  const NostrEventEntity* event;
-  int32_t                 source_client;  // Client that sent the event (don't echo back)
+  int32_t        source_client;  // Client that sent the event (don't echo back)
+  int32_t        dummy;
+  const uint8_t* stored_id;      // Id of a stored event, NULL for an ephemeral one
+  size_t         close_count;    // Subscriptions to close once matching is done
+  struct {
+    int32_t client_fd;
+    char    subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+  } closes[BROADCAST_MAX_CLOSES];
+  size_t     streams_count;  // REQs still sending stored events
+  ReqStream* streams[REQ_STREAMS_MAX];
 } BroadcastContext;
 
 // ============================================================================
-// Helper: Broadcast callback for subscription matching
+// Helper: Remember a stored event sent live to a subscription whose REQ is
+// still sending stored events; its scan may find the event as well
+// ============================================================================
+static void broadcast_note_live(const BroadcastContext* ctx, const NostrSubscription* subscription)
+{
+  for (size_t i = 0; i < ctx->streams_count; i++) {
+    ReqStream* stream = ctx->streams[i];
+    if (stream->client_sock == subscription->client_fd &&
+        str_equal(stream->subscription_id, subscription->subscription_id)) {
+      internal_memcpy(stream->live_ids[stream->live_count % REQ_STREAM_LIVE_IDS], ctx->stored_id, 32);
+      stream->live_count++;
+      return;
+    }
+  }
+}
+
+// ============================================================================
+// Helper: Slow-consumer action raised while subscriptions are being matched
+// The subscription index is being walked, so closes wait until matching is done
+// ============================================================================
+static void broadcast_action(NostrFanoutPushResult action, int32_t client_fd, const char* subscription_id, void* user_data)
+{
+  BroadcastContext* ctx = (BroadcastContext*)user_data;
+
+  if (action == NOSTR_FANOUT_CLOSE && ctx->close_count >= BROADCAST_MAX_CLOSES) {
+    action = NOSTR_FANOUT_DISCONNECT;
+  }
+
+  if (action == NOSTR_FANOUT_CLOSE) {
+    ctx->closes[ctx->close_count].client_fd = client_fd;
+    internal_memcpy(ctx->closes[ctx->close_count].subscription_id, subscription_id, strlen(subscription_id) + 1);
+    ctx->close_count++;
+    return;
+  }
+
+  fanout_action(action, client_fd, subscription_id, NULL);
+}
+
+// ============================================================================
+// Helper: Queue the open fan-out event for a matching subscription
 // ============================================================================
 static void broadcast_to_subscription(const NostrSubscription* subscription, void* user_data)
 {
@@ -208,10 +494,61 @@ static void broadcast_to_subscription(const NostrSubscription* subscription, voi
     return;
   }
 
-  // Generate EVENT response
-  if (nostr_response_event(subscription->subscription_id, ctx->event, g_response_buffer, RESPONSE_BUFFER_SIZE)) {
-    size_t len = strlen(g_response_buffer);
-    send_websocket_message(subscription->client_fd, g_response_buffer, len);
+  NostrFanoutPushResult result = nostr_fanout_push(&g_fanout, subscription->client_fd, subscription->subscription_id);
+  if (result == NOSTR_FANOUT_FULL) {
+    // Queue full: send one slice now to make room, shed a stalled event if that was not enough
+    nostr_fanout_drain(&g_fanout, g_relay_config.fanout_budget, fanout_send, NULL);
+    result = nostr_fanout_push(&g_fanout, subscription->client_fd, subscription->subscription_id);
+    if (result == NOSTR_FANOUT_FULL && nostr_fanout_shed_oldest(&g_fanout, broadcast_action, ctx)) {
+      result = nostr_fanout_push(&g_fanout, subscription->client_fd, subscription->subscription_id);
+    }
+  }
+
+  if (result == NOSTR_FANOUT_QUEUED && ctx->streams_count > 0) {
+    broadcast_note_live(ctx, subscription);
+  } else if (result == NOSTR_FANOUT_CLOSE || result == NOSTR_FANOUT_DISCONNECT) {
+    broadcast_action(result, subscription->client_fd, subscription->subscription_id, ctx);
+  }
+}
+
+// ============================================================================
+// Helper: Queue a serialized event for all matching subscriptions
+// Sending happens from the event loop tick, a budget at a time
+// ============================================================================
+static void broadcast_event(
+  int32_t                source_client,
+  const NostrMatchEvent* match_event,
+  bool                   stored,
+  const char*            event_json,
+  size_t                 event_json_len)
+{
+  if (!nostr_fanout_begin(&g_fanout, event_json, event_json_len)) {
+    // Arena or event ring full: flush what can be sent, then shed stalled events until it fits
+    nostr_fanout_drain(&g_fanout, 0, fanout_send, NULL);
+    while (!nostr_fanout_begin(&g_fanout, event_json, event_json_len)) {
+      if (!nostr_fanout_shed_oldest(&g_fanout, fanout_action, NULL)) {
+        log_error("[Fanout] Event does not fit the fan-out queue\n");
+        return;
+      }
+    }
+  }
+
+  static BroadcastContext ctx;
+  ctx.source_client = source_client;
+  ctx.stored_id     = stored ? match_event->id : NULL;
+  ctx.close_count   = 0;
+  ctx.streams_count = 0;
+  for (size_t i = 0; stored && i < REQ_STREAMS_MAX; i++) {
+    if (g_req_streams[i].cursor != NULL && !g_req_streams[i].finished) {
+      ctx.streams[ctx.streams_count++] = &g_req_streams[i];
+    }
+  }
+  nostr_subscription_find_matching_binary(&g_subscription_manager, match_event, broadcast_to_subscription, &ctx);
+
+  nostr_fanout_end(&g_fanout);
+
+  for (size_t i = 0; i < ctx.close_count; i++) {
+    fanout_action(NOSTR_FANOUT_CLOSE, ctx.closes[i].client_fd, ctx.closes[i].subscription_id, NULL);
   }
 }
 
@@ -223,12 +560,17 @@ static bool store_and_broadcast(int32_t client_sock, const NostrEventEntity* eve
   NostrDBError err = nostr_db_write_event(g_db, event);
 
   if (err == NOSTR_DB_OK) {
+    nostr_verified_cache_insert(&g_verified_cache, event->id, event->sig);
     send_ok_response(client_sock, event->id, true, "");
 
-    BroadcastContext ctx;
-    ctx.event         = event;
-    ctx.source_client = client_sock;
-    nostr_subscription_find_matching(&g_subscription_manager, event, broadcast_to_subscription, &ctx);
+    // Most events match no live subscription: skip serializing those
+    nostr_match_event_init(&g_match_event, event);
+    if (nostr_subscription_may_match(&g_subscription_manager, &g_match_event)) {
+      size_t json_len = nostr_response_event_object(event, g_event_json_buffer, RESPONSE_BUFFER_SIZE);
+      if (json_len > 0) {
+        broadcast_event(client_sock, &g_match_event, true, g_event_json_buffer, json_len);
+      }
+    }
     return true;
   } else if (err == NOSTR_DB_ERROR_DUPLICATE) {
     send_ok_response(client_sock, event->id, true, "duplicate:");
@@ -562,6 +904,11 @@ static bool handle_event_message(int32_t client_sock, const NostrEventEntity* ev
     return false;
   }
 
+  // Already verified and accepted: skip the pre-checks, the write reports duplicate
+  if (nostr_verified_cache_contains(&g_verified_cache, event->id, event->sig)) {
+    return store_and_broadcast(client_sock, event);
+  }
+
   // Handle deletion events (kind 5)
   if (event->kind == 5) {
     if (!process_deletion_event(client_sock, event)) {
@@ -589,19 +936,207 @@ static bool handle_event_message(int32_t client_sock, const NostrEventEntity* ev
   return store_and_broadcast(client_sock, event);
 }
 
+// ============================================================================
+// Handle ephemeral EVENT message (kinds 20000-29999): broadcast, never store
+// ============================================================================
+static bool handle_ephemeral_message(int32_t client_sock, const NostrEphemeralEvent* event)
+{
+  if (nostr_subscription_may_match(&g_subscription_manager, &event->match)) {
+    broadcast_event(client_sock, &event->match, false, event->json, event->json_len);
+  }
+
+  send_ok_response(client_sock, event->id, true, "");
+  return true;
+}
+
+// ============================================================================
+// Helper: Whether a stored event (a record starts with its id) already went
+// out live to the REQ's subscription
+// ============================================================================
+static bool req_stream_sent_live(const ReqStream* stream, const uint8_t* record)
+{
+  uint32_t count = stream->live_count < REQ_STREAM_LIVE_IDS ? stream->live_count : REQ_STREAM_LIVE_IDS;
+  for (uint32_t i = 0; i < count; i++) {
+    if (internal_memcmp(stream->live_ids[i], record, 32) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ============================================================================
+// Helper: Send one stored event of a REQ as it is visited in its pinned page
+// A short write keeps the event unconsumed: the cursor visits it again and
+// the rebuilt frame continues from stream->resume, as fanout_send does.
+// ============================================================================
+static bool send_stored_event(const uint8_t* record, uint16_t length, void* ctx)
+{
+  ReqStream* stream  = (ReqStream*)ctx;
+  char*      payload = g_stored_frame_buffer + FRAME_HEADER_MAX;
+
+  // Another frame is half written: anything sent now would land inside it
+  if (stream->resume == 0 &&
+      (nostr_fanout_in_flight(&g_fanout, stream->client_sock) || req_stream_in_flight(stream->client_sock))) {
+    log_debug("[Fanout] Stored events skipped, connection is mid-frame\n");
+    return false;
+  }
+
+  // Sent live while the REQ was being scanned
+  if (stream->resume == 0 && req_stream_sent_live(stream, record)) {
+    return true;
+  }
+
+  // The rest of a half-written frame must be the same event (a record starts
+  // with its id); one deleted in between leaves the frame torn
+  if (stream->resume > 0 && internal_memcmp(record, stream->resume_event_id, sizeof(stream->resume_event_id)) != 0) {
+    log_info("[REQ] Stored event gone mid-frame, disconnecting\n");
+    websocket_shutdown(stream->client_sock);
+    stream->resume    = 0;
+    stream->cancelled = true;
+    return false;
+  }
+
+  size_t payload_len = nostr_response_event_record(stream->subscription_id, record, length, payload, RESPONSE_BUFFER_SIZE);
+  if (payload_len == 0) {
+    return true;  // Does not fit in one frame: skip it, keep streaming
+  }
+
+  char   header[FRAME_HEADER_MAX];
+  size_t header_len = websocket_frame_header_encode(WEBSOCKET_OP_CODE_TEXT, payload_len, sizeof(header), header);
+  char*  frame      = payload - header_len;
+  size_t frame_len  = header_len + payload_len;
+  internal_memcpy(frame, header, header_len);
+
+  ssize_t written = websocket_send_partial(stream->client_sock, frame_len - stream->resume, frame + stream->resume);
+  if (written < 0) {
+    return false;  // EAGAIN: retried next tick; otherwise the loop reports the disconnect
+  }
+
+  if (stream->resume == 0) {
+    internal_memcpy(stream->resume_event_id, record, sizeof(stream->resume_event_id));
+  }
+  stream->resume += (uint32_t)written;
+  if (stream->resume < frame_len) {
+    return false;
+  }
+  stream->resume = 0;
+  return true;
+}
+
+// ============================================================================
+// Helper: Send EOSE; false if it could be neither sent nor queued
+// ============================================================================
+static bool send_eose_response(int32_t client_sock, const char* subscription_id)
+{
+  if (!nostr_response_eose(subscription_id, g_response_buffer, RESPONSE_BUFFER_SIZE)) {
+    return true;
+  }
+  return send_websocket_message(client_sock, g_response_buffer, strlen(g_response_buffer));
+}
+
+// ============================================================================
+// Helper: Drop unfinished REQ streams of a connection
+// (one subscription, or all of them when subscription_id is NULL)
+// ============================================================================
+static void req_stream_cancel(int32_t client_sock, const char* subscription_id)
+{
+  for (size_t i = 0; i < REQ_STREAMS_MAX; i++) {
+    ReqStream* stream = &g_req_streams[i];
+    if (stream->cursor == NULL || stream->client_sock != client_sock) {
+      continue;
+    }
+    if (subscription_id != NULL && !str_equal(stream->subscription_id, subscription_id)) {
+      continue;
+    }
+    // A half-written frame still has to go out whole (unless the socket is closing)
+    if (subscription_id != NULL && stream->resume > 0) {
+      stream->cancelled = true;
+      continue;
+    }
+    nostr_db_cursor_close(stream->cursor);
+    stream->cursor = NULL;
+  }
+}
+
+// ============================================================================
+// Helper: Send up to budget more stored events of a REQ, then its EOSE
+// A frame that cannot go out yet (socket full, or another frame mid-write)
+// waits for the next tick; a stream whose subscription was closed or replaced
+// finishes its half-written frame, then is dropped.
+// ============================================================================
+static void req_stream_advance(ReqStream* stream, uint32_t budget)
+{
+  bool closed = stream->cancelled ||
+                nostr_subscription_find(&g_subscription_manager, stream->client_sock, stream->subscription_id) == NULL;
+
+  if (!stream->finished && (!closed || stream->resume > 0)) {
+    stream->finished = nostr_db_cursor_step(stream->cursor, closed ? 1 : budget, send_stored_event, stream);
+  }
+
+  // The half-written event was deleted and was the last one: the frame cannot be completed
+  if (stream->finished && stream->resume > 0) {
+    log_info("[REQ] Stored event gone mid-frame, disconnecting\n");
+    websocket_shutdown(stream->client_sock);
+    stream->resume = 0;
+    closed         = true;
+  }
+
+  if (closed ? stream->resume == 0
+             : stream->finished && send_eose_response(stream->client_sock, stream->subscription_id)) {
+    nostr_db_cursor_close(stream->cursor);
+    stream->cursor = NULL;
+  }
+}
+
+// ============================================================================
+// Helper: Advance every streaming REQ, req_budget reads in total, starting
+// where the previous tick stopped
+// ============================================================================
+static void req_streams_drain(void)
+{
+  size_t active = 0;
+  for (size_t i = 0; i < REQ_STREAMS_MAX; i++) {
+    active += g_req_streams[i].cursor != NULL;
+  }
+  if (active == 0) {
+    return;
+  }
+
+  // req_budget 0: every stream runs until its socket blocks
+  size_t   budget = g_relay_config.req_budget;
+  uint32_t slice  = budget == 0 ? 0 : budget / active > 0 ? (uint32_t)(budget / active) : 1;
+  size_t   spent  = 0;
+  for (size_t n = 0; n < REQ_STREAMS_MAX && (budget == 0 || spent < budget); n++) {
+    size_t     slot   = (g_req_streams_next + n) % REQ_STREAMS_MAX;
+    ReqStream* stream = &g_req_streams[slot];
+    if (stream->cursor == NULL) {
+      continue;
+    }
+    req_stream_advance(stream, slice);
+    spent += slice;
+    g_req_streams_next = (slot + 1) % REQ_STREAMS_MAX;
+  }
+}
+
 // ============================================================================
 // Handle REQ message
 // ============================================================================
 static bool handle_req_message(int32_t client_sock, const NostrReqMessage* req)
 {
+  // Per-connection cap; replacing an existing subscription is always allowed
+  size_t max_subscriptions = g_relay_config.limits.max_subscriptions;
+  if (max_subscriptions > 0 &&
+      nostr_subscription_find(&g_subscription_manager, client_sock, req->subscription_id) == NULL &&
+      nostr_subscription_count_client(&g_subscription_manager, client_sock) >= max_subscriptions) {
+    send_closed_response(client_sock, req->subscription_id, "blocked: too many subscriptions");
+    return true;
+  }
+
   // Add subscription
   NostrSubscription* sub = nostr_subscription_add(&g_subscription_manager, client_sock, req);
   if (sub == NULL) {
     // Send CLOSED response if subscription limit reached
-    if (nostr_response_closed(req->subscription_id, "error: subscription limit reached", g_response_buffer, RESPONSE_BUFFER_SIZE)) {
-      size_t len = strlen(g_response_buffer);
-      send_websocket_message(client_sock, g_response_buffer, len);
-    }
+    send_closed_response(client_sock, req->subscription_id, "error: subscription limit reached");
     return false;
   }
 
@@ -609,42 +1144,45 @@ static bool handle_req_message(int32_t client_sock, const NostrReqMessage* req)
   log_info(req->subscription_id);
   log_info("\n");
 
-  // Query database for matching events
+  // A replaced subscription stops sending the old REQ's stored events
+  req_stream_cancel(client_sock, req->subscription_id);
+
+  // Query database for matching events, streamed straight into frames
   if (g_db_initialized && g_db != NULL) {
     for (size_t filter_idx = 0; filter_idx < req->filters_count; filter_idx++) {
-      NostrDBFilter db_filter;
-      convert_filter_to_db_filter(&req->filters[filter_idx], &db_filter);
-
-      NostrDBResultSet* result = nostr_db_result_create(0);
-      if (is_null(result)) continue;
+      convert_filter_to_db_filter(&req->filters[filter_idx], &g_req_db_filters[filter_idx]);
+    }
 
-      NostrDBError err = nostr_db_query_execute(g_db, &db_filter, result);
-      if (err == NOSTR_DB_OK && result->count > 0) {
-        // Allocate event on heap to avoid stack overflow
-        NostrEventEntity* event = (NostrEventEntity*)internal_mmap(
-          NULL, sizeof(NostrEventEntity), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-        if (event != MAP_FAILED) {
-          for (uint32_t i = 0; i < result->count; i++) {
-            if (nostr_db_get_event_at_offset(g_db, result->offsets[i], event) == NOSTR_DB_OK) {
-              if (nostr_response_event(req->subscription_id, event, g_response_buffer, RESPONSE_BUFFER_SIZE)) {
-                size_t len = strlen(g_response_buffer);
-                send_websocket_message(client_sock, g_response_buffer, len);
-              }
-            }
-          }
-          internal_munmap(event, sizeof(NostrEventEntity));
-        }
+    // Large results continue from the event loop tick, a budget at a time;
+    // the first slice (often everything) goes out now
+    ReqStream* stream = NULL;
+    for (size_t i = 0; i < REQ_STREAMS_MAX && stream == NULL; i++) {
+      if (g_req_streams[i].cursor == NULL) {
+        stream = &g_req_streams[i];
       }
-
-      nostr_db_result_free(result);
     }
+    if (stream == NULL) {
+      nostr_subscription_remove(&g_subscription_manager, client_sock, req->subscription_id);
+      send_closed_response(client_sock, req->subscription_id, "rate-limited: too many REQs in progress, try again");
+      return true;
+    }
+    if (nostr_db_cursor_open(g_db, g_req_db_filters, req->filters_count, &stream->cursor) != NOSTR_DB_OK) {
+      nostr_subscription_remove(&g_subscription_manager, client_sock, req->subscription_id);
+      send_closed_response(client_sock, req->subscription_id, "error: could not query stored events");
+      return true;
+    }
+    stream->client_sock = client_sock;
+    stream->finished    = false;
+    stream->cancelled   = false;
+    stream->resume      = 0;
+    stream->live_count  = 0;
+    internal_memcpy(stream->subscription_id, req->subscription_id, strlen(req->subscription_id) + 1);
+    req_stream_advance(stream, (uint32_t)g_relay_config.req_budget);
+    return true;
   }
 
   // Send EOSE (End of Stored Events)
-  if (nostr_response_eose(req->subscription_id, g_response_buffer, RESPONSE_BUFFER_SIZE)) {
-    size_t len = strlen(g_response_buffer);
-    send_websocket_message(client_sock, g_response_buffer, len);
-  }
+  send_eose_response(client_sock, req->subscription_id);
 
   return true;
 }
@@ -681,6 +1219,14 @@ static bool nostr_event_callback(const NostrEventEntity* event)
   return handle_event_message(g_current_client_sock, event);
 }
 
+// ============================================================================
+// Nostr protocol callback - ephemeral EVENT
+// ============================================================================
+static bool nostr_ephemeral_callback(const NostrEphemeralEvent* event)
+{
+  return handle_ephemeral_message(g_current_client_sock, event);
+}
+
 // ============================================================================
 // Nostr protocol callback - REQ
 // ============================================================================
@@ -697,6 +1243,18 @@ static bool nostr_close_callback(const NostrCloseMessage* close_msg)
   return handle_close_message(g_current_client_sock, close_msg);
 }
 
+// ============================================================================
+// Nostr protocol callback - admission limit exceeded
+// ============================================================================
+static void nostr_limit_callback(const NostrLimitViolation* violation)
+{
+  if (violation->subscription_id != NULL) {
+    send_closed_response(g_current_client_sock, violation->subscription_id, violation->reason);
+  } else {
+    send_notice_response(g_current_client_sock, violation->reason);
+  }
+}
+
 // ============================================================================
 // WebSocket receive callback
 // ============================================================================
@@ -727,21 +1285,47 @@ bool websocket_receive_callback(
 
   // Parse Nostr message
   NostrFuncs nostr_funcs;
-  nostr_funcs.event = nostr_event_callback;
-  nostr_funcs.req   = nostr_req_callback;
-  nostr_funcs.close = nostr_close_callback;
+  nostr_funcs.event          = nostr_event_callback;
+  nostr_funcs.req            = nostr_req_callback;
+  nostr_funcs.close          = nostr_close_callback;
+  nostr_funcs.ephemeral      = nostr_ephemeral_callback;
+  nostr_funcs.limits         = &g_relay_config.limits;
+  nostr_funcs.limit_exceeded = nostr_limit_callback;
 
   if (!nostr_event_handler(payload, &nostr_funcs)) {
     // Send NOTICE for parse errors
-    if (nostr_response_notice("error: invalid message format", g_response_buffer, RESPONSE_BUFFER_SIZE)) {
-      size_t len = strlen(g_response_buffer);
-      send_websocket_message(client_sock, g_response_buffer, len);
-    }
+    send_notice_response(client_sock, "error: invalid message format");
   }
 
   return true;
 }
 
+// ============================================================================
+// WebSocket oversize callback: frame header exceeded max_message_length
+// ============================================================================
+void websocket_oversize_callback(
+  const int32_t  client_sock,
+  const uint64_t payload_length,
+  const size_t   buffer_capacity,
+  char*          response_buffer)
+{
+  (void)payload_length;
+  (void)buffer_capacity;
+  (void)response_buffer;
+
+  log_info("[Limit] Message too large, closing connection\n");
+  send_notice_response(client_sock, "invalid: message too large");
+}
+
+// ============================================================================
+// WebSocket tick callback: send one slice of queued fan-out and stored events
+// ============================================================================
+void websocket_tick_callback(void)
+{
+  nostr_fanout_drain(&g_fanout, g_relay_config.fanout_budget, fanout_send, NULL);
+  req_streams_drain();
+}
+
 // ============================================================================
 // WebSocket connect callback
 // ============================================================================
@@ -757,6 +1341,10 @@ void websocket_disconnect_callback(int client_sock)
 {
   log_info("[Disconnect] Client disconnected\n");
 
+  // Forget queued frames; the fd number may be reused by the next client
+  nostr_fanout_remove_connection(&g_fanout, client_sock);
+  req_stream_cancel(client_sock, NULL);
+
   // Remove all subscriptions for this client
   size_t removed = nostr_subscription_remove_client(&g_subscription_manager, client_sock);
   if (removed > 0) {
@@ -787,6 +1375,7 @@ bool websocket_handshake_callback(
   info.software       = "https://github.com/hakkadaikon/libelay";
   info.version        = "0.1.0";
   info.supported_nips = supported_nips;
+  info.limitation     = &g_relay_config.limits;
 
   if (!nostr_nip11_response(&info, buffer_capacity, response_buffer)) {
     log_error("Failed to generate NIP-11 response\n");
@@ -803,15 +1392,38 @@ bool websocket_handshake_callback(
 int main()
 {
   // Initialize subscription manager
-  if (!nostr_subscription_manager_init(&g_subscription_manager)) {
+  if (!nostr_subscription_manager_init_with_limits(
+        &g_subscription_manager,
+        g_relay_config.max_total_subscriptions,
+        g_relay_config.limits.max_subscriptions)) {
     log_error("[Subscription] Failed to initialize subscription manager\n");
     return 1;
   }
 
+  // Initialize verified event cache
+  if (!nostr_verified_cache_init(&g_verified_cache, g_relay_config.verified_cache_entries)) {
+    log_error("[Cache] Failed to initialize verified event cache\n");
+    nostr_subscription_manager_destroy(&g_subscription_manager);
+    return 1;
+  }
+
+  // Initialize fan-out queue
+  if (!nostr_fanout_init(&g_fanout, g_relay_config.fanout_deliveries, g_relay_config.fanout_arena_bytes)) {
+    log_error("[Fanout] Failed to initialize fan-out queue\n");
+    nostr_verified_cache_destroy(&g_verified_cache);
+    nostr_subscription_manager_destroy(&g_subscription_manager);
+    return 1;
+  }
+  nostr_fanout_set_policy(&g_fanout, g_relay_config.slow_consumer_policy, g_relay_config.max_queued_per_connection);
+
   // Initialize database
   NostrDBError db_err = nostr_db_init(&g_db, "./data");
   if (db_err == NOSTR_DB_OK) {
     g_db_initialized = true;
+    nostr_db_set_event_json(g_db, g_relay_config.store_event_json);
+    if (nostr_db_set_query_cache(g_db, g_relay_config.query_cache_entries) != NOSTR_DB_OK) {
+      log_error("[DB] Failed to allocate the query cache, running without it\n");
+    }
     log_info("[DB] Database initialized successfully\n");
   } else {
     log_error("[DB] Failed to initialize database, running without persistence\n");
@@ -843,7 +1455,15 @@ int main()
   loop_args.callbacks.connect_callback    = websocket_connect_callback;
   loop_args.callbacks.disconnect_callback = websocket_disconnect_callback;
   loop_args.callbacks.handshake_callback  = websocket_handshake_callback;
+  loop_args.callbacks.oversize_callback   = websocket_oversize_callback;
+  loop_args.callbacks.tick_callback       = websocket_tick_callback;
   loop_args.buffer_capacity               = 65536;
+  loop_args.max_message_length            = g_relay_config.limits.max_message_length;
+
+  // A frame at the advertised limit must still fit the receive buffer
+  if (loop_args.max_message_length + WEBSOCKET_FRAME_HEADER_MAX_LENGTH > loop_args.buffer_capacity) {
+    loop_args.buffer_capacity = loop_args.max_message_length + WEBSOCKET_FRAME_HEADER_MAX_LENGTH;
+  }
 
   // Run server loop (blocks until signal)
   websocket_server_loop(&loop_args);
@@ -857,7 +1477,9 @@ int main()
     g_db = NULL;
   }
 
+  nostr_fanout_destroy(&g_fanout);
   nostr_subscription_manager_destroy(&g_subscription_manager);
+  nostr_verified_cache_destroy(&g_verified_cache);
 
   log_info("[Server] Nostr relay stopped\n");
   return 0;
@@ -63,6 +63,21 @@ NostrDBError btree_range_scan(BTree* tree, const void* min_key,
                               const void*       max_key,
                               BTreeScanCallback callback, void* user_data);
 
+/**
+ * @brief Position a cursor at the first key >= min_key (NULL = beginning)
+ * @param max_key Inclusive upper bound (NULL = none); must outlive the cursor
+ */
+NostrDBError btree_cursor_open(BTreeCursor* cursor, BTree* tree,
+                               const void* min_key, const void* max_key);
+
+/**
+ * @brief Copy out the next entry and advance
+ * @param key_out Receives key_size bytes (may be NULL)
+ * @param value_out Receives value_size bytes (may be NULL)
+ * @return false once the cursor passes max_key or the last leaf
+ */
+bool btree_cursor_next(BTreeCursor* cursor, void* key_out, void* value_out);
+
 // ============================================================================
 // Duplicate key operations (for non-unique indexes)
 // Values are stored in overflow page chains; the B+ tree value is the
@@ -136,6 +151,7 @@ int32_t btree_compare_composite_pk_kind(const void* a, const void* b,
                                         uint16_t key_size);
 int32_t btree_compare_composite_tag(const void* a, const void* b,
                                     uint16_t key_size);
+int32_t btree_compare_memcmp(const void* a, const void* b, uint16_t key_size);
 
 /**
  * @brief Get the comparison function for a key type
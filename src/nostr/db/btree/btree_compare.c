@@ -77,6 +77,14 @@ int32_t btree_compare_composite_tag(const void* a, const void* b,
   return internal_memcmp(pa + 1, pb + 1, 32);
 }
 
+// ============================================================================
+// btree_compare_memcmp: Compare two keys byte-wise over the full key size
+// ============================================================================
+int32_t btree_compare_memcmp(const void* a, const void* b, uint16_t key_size)
+{
+  return internal_memcmp(a, b, key_size);
+}
+
 // ============================================================================
 // btree_get_comparator: Return the comparison function for a key type
 // ============================================================================
@@ -93,6 +101,8 @@ BTreeKeyCompare btree_get_comparator(BTreeKeyType key_type)
       return btree_compare_composite_pk_kind;
     case BTREE_KEY_COMPOSITE_TAG:
       return btree_compare_composite_tag;
+    case BTREE_KEY_MEMCMP:
+      return btree_compare_memcmp;
     default:
       return btree_compare_bytes32;
   }
@@ -183,3 +183,96 @@ NostrDBError btree_range_scan(BTree* tree, const void* min_key,
 
   return NOSTR_DB_OK;
 }
+
+// ============================================================================
+// btree_cursor_open
+// ============================================================================
+NostrDBError btree_cursor_open(BTreeCursor* cursor, BTree* tree,
+                               const void* min_key, const void* max_key)
+{
+  require_not_null(cursor, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(tree, NOSTR_DB_ERROR_NULL_PARAM);
+
+  cursor->tree    = tree;
+  cursor->max_key = max_key;
+  cursor->pos     = 0;
+  cursor->dummy   = 0;
+
+  if (tree->meta.root_page == PAGE_ID_NULL) {
+    cursor->leaf = PAGE_ID_NULL;
+    return NOSTR_DB_OK;
+  }
+
+  if (is_null(min_key)) {
+    cursor->leaf = find_leftmost_leaf(tree);
+    return NOSTR_DB_OK;
+  }
+
+  cursor->leaf = find_leaf(tree, min_key);
+  if (cursor->leaf == PAGE_ID_NULL) return NOSTR_DB_OK;
+
+  PageData* page = buffer_pool_pin(tree->pool, cursor->leaf);
+  if (is_null(page)) {
+    cursor->leaf = PAGE_ID_NULL;
+    return NOSTR_DB_ERROR_NOT_FOUND;
+  }
+  cursor->pos = btree_node_search_key(page, min_key, tree->meta.key_size,
+                                      tree->compare);
+  buffer_pool_unpin(tree->pool, cursor->leaf);
+
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// btree_cursor_next
+// ============================================================================
+bool btree_cursor_next(BTreeCursor* cursor, void* key_out, void* value_out)
+{
+  require_not_null(cursor, false);
+
+  BTree*   tree       = cursor->tree;
+  uint16_t key_size   = tree->meta.key_size;
+  uint16_t value_size = tree->meta.value_size;
+  uint16_t max_leaf   = BTREE_LEAF_MAX_KEYS(key_size, value_size);
+
+  while (cursor->leaf != PAGE_ID_NULL) {
+    PageData* page = buffer_pool_pin(tree->pool, cursor->leaf);
+    if (is_null(page)) {
+      cursor->leaf = PAGE_ID_NULL;
+      return false;
+    }
+
+    const BTreeNodeHeader* node =
+      (const BTreeNodeHeader*)(page->data + BTREE_NODE_HEADER_OFFSET);
+
+    if (cursor->pos < node->key_count) {
+      const void* k = btree_node_key_at(page, cursor->pos, key_size);
+
+      if (!is_null(cursor->max_key) &&
+          tree->compare(k, cursor->max_key, key_size) > 0) {
+        buffer_pool_unpin(tree->pool, cursor->leaf);
+        cursor->leaf = PAGE_ID_NULL;
+        return false;
+      }
+
+      if (!is_null(key_out)) internal_memcpy(key_out, k, key_size);
+      if (!is_null(value_out)) {
+        const void* v = btree_node_value_at(page, cursor->pos, key_size,
+                                            value_size, max_leaf);
+        internal_memcpy(value_out, v, value_size);
+      }
+
+      cursor->pos++;
+      buffer_pool_unpin(tree->pool, cursor->leaf);
+      return true;
+    }
+
+    // Leaf done: continue from the start of its right sibling
+    page_id_t next = node->right_sibling;
+    buffer_pool_unpin(tree->pool, cursor->leaf);
+    cursor->leaf = next;
+    cursor->pos  = 0;
+  }
+
+  return false;
+}
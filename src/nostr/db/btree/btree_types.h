@@ -20,6 +20,7 @@ typedef enum {
   BTREE_KEY_UINT32        = 2,  // uint32_t (kind)
   BTREE_KEY_COMPOSITE     = 3,  // Composite key (pubkey[32]+kind[4])
   BTREE_KEY_COMPOSITE_TAG = 4,  // Composite key (tag_name[1]+tag_value[32])
+  BTREE_KEY_MEMCMP        = 5,  // Byte-wise over key_size (posting keys)
 } BTreeKeyType;
 
 // ============================================================================
@@ -110,6 +111,19 @@ typedef struct {
   uint16_t  depth;
 } BTreePath;
 
+// ============================================================================
+// Forward cursor over [min_key, max_key]
+// No page stays pinned between steps, so any number of cursors can be open
+// at once; the tree must not be modified while they are in use.
+// ============================================================================
+typedef struct {
+  BTree*      tree;
+  const void* max_key;  // Inclusive upper bound (NULL = none), owned by caller
+  page_id_t   leaf;     // Current leaf (PAGE_ID_NULL = exhausted)
+  uint16_t    pos;      // Next entry within the leaf
+  uint16_t    dummy;
+} BTreeCursor;
+
 // ============================================================================
 // Duplicate key overflow page header
 // Stored at the beginning of an overflow page for duplicate keys
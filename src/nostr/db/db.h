@@ -22,6 +22,31 @@ struct NostrFilter;
  */
 NostrDBError nostr_db_init(NostrDB** db, const char* data_dir);
 
+/**
+ * @brief Keep the serialized JSON of newly written events in their records
+ *
+ * Reads then copy the stored bytes instead of rebuilding JSON from the
+ * binary fields, at the cost of roughly doubling the record size. Applies
+ * to events written from now on; records are self-describing, so files may
+ * mix both forms.
+ *
+ * @param db NostrDB handle
+ * @param enabled true to store JSON
+ */
+void nostr_db_set_event_json(NostrDB* db, bool enabled);
+
+/**
+ * @brief Cache the results of recent REQ filters
+ *
+ * Entries are keyed by canonical filter and dropped by the writes that could
+ * change them; hit and miss counts are reported by nostr_db_get_stats.
+ *
+ * @param db NostrDB handle
+ * @param entries Filters remembered (0 disables the cache)
+ * @return NOSTR_DB_OK on success, error code on failure
+ */
+NostrDBError nostr_db_set_query_cache(NostrDB* db, size_t entries);
+
 /**
  * @brief Shutdown the database
  * @param db NostrDB handle
@@ -2,6 +2,7 @@
 #include "../../util/string.h"
 #include "db.h"
 #include "db_internal.h"
+#include "record/event_json.h"
 #include "record/event_serializer.h"
 #include "record/record_manager.h"
 
@@ -22,6 +23,17 @@ NostrDBError nostr_db_write_event(NostrDB* db, const NostrEventEntity* event)
 
   EventRecord* rec = (EventRecord*)buf;
 
+  // Append the JSON rendered from the record itself, so the stored bytes are
+  // exactly what a read would have built (events that do not fit go without)
+  if (db->store_event_json) {
+    size_t json_len = event_json_write(buf, (uint16_t)size, (char*)buf + size,
+                                       sizeof(buf) - (size_t)size);
+    if (json_len > 0) {
+      rec->flags |= NOSTR_DB_EVENT_FLAG_JSON;
+      size += (int32_t)json_len;
+    }
+  }
+
   // Check if event ID already exists (duplicate or previously deleted)
   RecordId     existing_rid;
   NostrDBError lookup_err =
@@ -61,6 +73,8 @@ NostrDBError nostr_db_write_event(NostrDB* db, const NostrEventEntity* event)
     return err;
   }
 
+  query_cache_invalidate(db->query_cache, buf);
+
   db->event_count++;
   return NOSTR_DB_OK;
 }
@@ -175,9 +189,14 @@ NostrDBError nostr_db_delete_event(NostrDB* db, const uint8_t* id)
   // (resubmission of deleted events should be rejected)
   index_id_insert(&db->indexes.id_index, rec->id, rid);
 
-  // Mark record as deleted by setting flag
+  // Mark record as deleted by setting flag; its JSON is never served again
+  if (rec->flags & NOSTR_DB_EVENT_FLAG_JSON) {
+    length = (uint16_t)(sizeof(EventRecord) + rec->content_length + tags_length);
+    rec->flags &= ~NOSTR_DB_EVENT_FLAG_JSON;
+  }
   rec->flags |= NOSTR_DB_EVENT_FLAG_DELETED;
   record_update(&db->buffer_pool, &rid, buf, length);
+  query_cache_invalidate(db->query_cache, buf);
 
   db->deleted_count++;
   return NOSTR_DB_OK;
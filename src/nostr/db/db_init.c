@@ -106,6 +106,9 @@ static NostrDBError write_meta_page(NostrDB* db)
   meta->kind_index_meta     = db->indexes.kind_index.meta_page;
   meta->pk_kind_index_meta  = db->indexes.pubkey_kind_index.meta_page;
   meta->tag_index_meta      = db->indexes.tag_index.meta_page;
+  meta->index_stats_meta    = is_null(db->indexes.stats)
+                                ? PAGE_ID_NULL
+                                : db->indexes.stats->pages[0];
 
   buffer_pool_mark_dirty(&db->buffer_pool, DB_META_PAGE_ID, 0);
   buffer_pool_unpin(&db->buffer_pool, DB_META_PAGE_ID);
@@ -225,7 +228,8 @@ NostrDBError nostr_db_init(NostrDB** db, const char* data_dir)
     err = index_manager_open(
       &pdb->indexes, &pdb->buffer_pool, meta->id_index_meta,
       meta->timeline_index_meta, meta->pubkey_index_meta,
-      meta->kind_index_meta, meta->pk_kind_index_meta, meta->tag_index_meta);
+      meta->kind_index_meta, meta->pk_kind_index_meta, meta->tag_index_meta,
+      meta->index_stats_meta);
 
     buffer_pool_unpin(&pdb->buffer_pool, DB_META_PAGE_ID);
 
@@ -240,6 +244,30 @@ NostrDBError nostr_db_init(NostrDB** db, const char* data_dir)
   return NOSTR_DB_OK;
 }
 
+// ============================================================================
+// nostr_db_set_event_json
+// ============================================================================
+void nostr_db_set_event_json(NostrDB* db, bool enabled)
+{
+  if (is_null(db)) return;
+  db->store_event_json = enabled;
+}
+
+// ============================================================================
+// nostr_db_set_query_cache
+// ============================================================================
+NostrDBError nostr_db_set_query_cache(NostrDB* db, size_t entries)
+{
+  require_not_null(db, NOSTR_DB_ERROR_NULL_PARAM);
+
+  query_cache_destroy(db->query_cache);
+  db->query_cache = NULL;
+  if (entries == 0) {
+    return NOSTR_DB_OK;
+  }
+  return query_cache_create(entries, &db->query_cache);
+}
+
 // ============================================================================
 // nostr_db_shutdown
 // ============================================================================
@@ -250,7 +278,8 @@ void nostr_db_shutdown(NostrDB* db)
   }
 
   if (db->initialized) {
-    // Write metadata page before shutting down
+    // Write index statistics and the metadata page before shutting down
+    index_manager_flush(&db->indexes);
     write_meta_page(db);
 
     // Checkpoint WAL
@@ -261,6 +290,9 @@ void nostr_db_shutdown(NostrDB* db)
   }
 
   // Shutdown in reverse order of initialization
+  query_cache_destroy(db->query_cache);
+  db->query_cache = NULL;
+  index_manager_close(&db->indexes);
   wal_shutdown(&db->wal);
   buffer_pool_shutdown(&db->buffer_pool);
   disk_manager_close(&db->disk);
@@ -285,5 +317,11 @@ NostrDBError nostr_db_get_stats(NostrDB* db, NostrDBStats* stats)
   stats->tag_index_entries      = db->indexes.tag_index.meta.entry_count;
   stats->timeline_index_entries = db->indexes.timeline_index.meta.entry_count;
 
+  const QueryCache* cache          = db->query_cache;
+  stats->query_cache_hits          = is_null(cache) ? 0 : cache->hits;
+  stats->query_cache_misses        = is_null(cache) ? 0 : cache->misses;
+  stats->query_cache_invalidations = is_null(cache) ? 0 : cache->invalidations;
+  stats->query_cache_evictions     = is_null(cache) ? 0 : cache->evictions;
+
   return NOSTR_DB_OK;
 }
@@ -7,6 +7,7 @@
 #include "db_types.h"
 #include "disk/disk_manager.h"
 #include "index/index_manager.h"
+#include "query/query_cache.h"
 #include "wal/wal_manager.h"
 
 // ============================================================================
@@ -18,7 +19,7 @@
 
 typedef struct {
   char     magic[8];  // "NDBMETA\0"
-  uint32_t version;   // DB_FILE_VERSION (2)
+  uint32_t version;   // DB_FILE_VERSION (4)
   uint32_t reserved0;
 
   // Event counters
@@ -37,7 +38,11 @@ typedef struct {
   page_id_t first_record_page;
   page_id_t last_record_page;
 
-  uint8_t reserved[DB_PAGE_SIZE - 64];
+  // Planner statistics page chain (PAGE_ID_NULL in files written before it)
+  page_id_t index_stats_meta;
+  uint32_t  reserved1;
+
+  uint8_t reserved[DB_PAGE_SIZE - 72];
 } DBMetaPage;
 
 _Static_assert(sizeof(DBMetaPage) == DB_PAGE_SIZE, "DBMetaPage must be one page");
@@ -60,6 +65,12 @@ struct NostrDB {
 
   // Initialization flag
   bool initialized;
+
+  // Append each new event's serialized JSON to its record
+  bool store_event_json;
+
+  // Recent REQ results (NULL = disabled)
+  QueryCache* query_cache;
 };
 
 // ============================================================================
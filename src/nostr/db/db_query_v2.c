@@ -2,8 +2,10 @@
 #include "../../arch/mmap.h"
 #include "db.h"
 #include "db_internal.h"
+#include "query/db_query.h"
 #include "query/db_query_types.h"
 #include "query/query_engine.h"
+#include "record/record_manager.h"
 
 // ============================================================================
 // nostr_db_filter_init
@@ -220,3 +222,348 @@ NostrDBError nostr_db_query_execute(NostrDB* db, const NostrDBFilter* filter,
   query_result_free(rs);
   return NOSTR_DB_OK;
 }
+
+// ============================================================================
+// Helper: Filters that select the same events (they may differ in limit)
+// ============================================================================
+static bool filter_same_predicates(const NostrDBFilter* a,
+                                   const NostrDBFilter* b)
+{
+  if (a->ids_count != b->ids_count || a->authors_count != b->authors_count ||
+      a->kinds_count != b->kinds_count || a->tags_count != b->tags_count ||
+      a->since != b->since || a->until != b->until) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a->ids_count; i++) {
+    if (a->ids[i].prefix_len != b->ids[i].prefix_len ||
+        internal_memcmp(a->ids[i].value, b->ids[i].value, 32) != 0) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < a->authors_count; i++) {
+    if (a->authors[i].prefix_len != b->authors[i].prefix_len ||
+        internal_memcmp(a->authors[i].value, b->authors[i].value, 32) != 0) {
+      return false;
+    }
+  }
+  if (a->kinds_count > 0 &&
+      internal_memcmp(a->kinds, b->kinds, a->kinds_count * sizeof(uint32_t)) != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < a->tags_count; i++) {
+    const NostrDBFilterTag* ta = &a->tags[i];
+    const NostrDBFilterTag* tb = &b->tags[i];
+    if (ta->name != tb->name || ta->values_count != tb->values_count ||
+        (ta->values_count > 0 &&
+         internal_memcmp(ta->values, tb->values, ta->values_count * 32) != 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static inline uint32_t filter_limit(const NostrDBFilter* filter)
+{
+  return filter->limit > 0 ? filter->limit : NOSTR_DB_QUERY_DEFAULT_LIMIT;
+}
+
+// ============================================================================
+// Helper: Copy the used entries of a filter into a zeroed one (most of a
+// filter is empty value slots)
+// ============================================================================
+static inline size_t min_count(size_t count, size_t max)
+{
+  return count < max ? count : max;
+}
+
+static void filter_copy(NostrDBFilter* dst, const NostrDBFilter* src)
+{
+  internal_memcpy(dst->ids, src->ids,
+                  min_count(src->ids_count, NOSTR_DB_FILTER_MAX_IDS) *
+                    sizeof(NostrDBFilterId));
+  internal_memcpy(dst->authors, src->authors,
+                  min_count(src->authors_count, NOSTR_DB_FILTER_MAX_AUTHORS) *
+                    sizeof(NostrDBFilterPubkey));
+  internal_memcpy(dst->kinds, src->kinds,
+                  min_count(src->kinds_count, NOSTR_DB_FILTER_MAX_KINDS) *
+                    sizeof(uint32_t));
+  for (size_t t = 0; t < min_count(src->tags_count, NOSTR_DB_FILTER_MAX_TAGS);
+       t++) {
+    dst->tags[t].name         = src->tags[t].name;
+    dst->tags[t].values_count = src->tags[t].values_count;
+    internal_memcpy(dst->tags[t].values, src->tags[t].values,
+                    min_count(src->tags[t].values_count,
+                              NOSTR_DB_FILTER_MAX_TAG_VALUES) * 32);
+  }
+  dst->ids_count     = src->ids_count;
+  dst->authors_count = src->authors_count;
+  dst->kinds_count   = src->kinds_count;
+  dst->tags_count    = src->tags_count;
+  dst->since         = src->since;
+  dst->until         = src->until;
+  dst->limit         = src->limit;
+}
+
+// ============================================================================
+// NostrDBCursor: a planned set of filters, executed and visited a slice at a
+// time
+//
+// Filters that differ only in limit share one execution (the largest limit;
+// the others' results are its prefix). Executions are stepwise scans that
+// run, one after another, within the same budget as the record reads; each
+// finishes sorted newest first with ties in record id order, so the k-way
+// merge over them sees an event selected by several filters as consecutive
+// equal heads and emits it once. The cursor holds record ids, not pins: a
+// record deleted (or whose slot was reused) between slices is skipped when
+// it is reached.
+// ============================================================================
+struct NostrDBCursor {
+  NostrDB*        db;
+  NostrDBFilter*  filters;  // Run filters (the caller's may be reused)
+  size_t          filters_count;
+  QueryResultSet* lanes[NOSTR_DB_QUERY_MAX_FILTERS];
+  QueryScan*      scans[NOSTR_DB_QUERY_MAX_FILTERS];  // NULL = lane complete
+  QueryCacheKey   keys[NOSTR_DB_QUERY_MAX_FILTERS];
+  bool            cacheable[NOSTR_DB_QUERY_MAX_FILTERS];
+  uint32_t        heads[NOSTR_DB_QUERY_MAX_FILTERS];
+  size_t          lane_count;
+  size_t          scanned;       // Lanes before this one are complete
+  uint64_t        cache_writes;  // Cache writes seen at open
+  RecordId        last;          // Last record emitted, for dedup
+  bool            emitted;       // last is valid
+  bool            done;
+};
+
+// ============================================================================
+// Helper: Lane whose head comes next (newest, then lowest record id),
+// or lane_count when every lane is exhausted
+// ============================================================================
+static size_t cursor_next_lane(const NostrDBCursor* cursor)
+{
+  size_t best = cursor->lane_count;
+  for (size_t r = 0; r < cursor->lane_count; r++) {
+    const QueryResultSet* lane = cursor->lanes[r];
+    uint32_t              head = cursor->heads[r];
+    if (head >= lane->count) continue;
+    if (best == cursor->lane_count) {
+      best = r;
+      continue;
+    }
+    const QueryResultSet* other = cursor->lanes[best];
+    uint32_t              oh    = cursor->heads[best];
+    if (lane->created_at[head] > other->created_at[oh] ||
+        (lane->created_at[head] == other->created_at[oh] &&
+         query_rid_before(lane->rids[head], other->rids[oh]))) {
+      best = r;
+    }
+  }
+  return best;
+}
+
+// ============================================================================
+// nostr_db_cursor_open: Plan the filters of one REQ (nothing is read yet)
+// ============================================================================
+NostrDBError nostr_db_cursor_open(NostrDB* db, const NostrDBFilter* filters,
+                                  size_t count, NostrDBCursor** out)
+{
+  require_not_null(db, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filters, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(out, NOSTR_DB_ERROR_NULL_PARAM);
+  require(count <= NOSTR_DB_QUERY_MAX_FILTERS, NOSTR_DB_ERROR_NULL_PARAM);
+
+  *out = NULL;
+
+  // Plan: one execution per distinct predicate set, run with the largest limit
+  const NostrDBFilter* runs[NOSTR_DB_QUERY_MAX_FILTERS];
+  size_t               run_count = 0;
+  for (size_t i = 0; i < count; i++) {
+    size_t r = 0;
+    while (r < run_count && !filter_same_predicates(runs[r], &filters[i])) {
+      r++;
+    }
+    if (r == run_count) {
+      runs[run_count++] = &filters[i];
+    } else if (filter_limit(&filters[i]) > filter_limit(runs[r])) {
+      runs[r] = &filters[i];
+    }
+  }
+
+  NostrDBCursor* cursor = (NostrDBCursor*)rs_alloc(sizeof(NostrDBCursor));
+  if (is_null(cursor)) return NOSTR_DB_ERROR_MMAP_FAILED;
+  cursor->db = db;
+  if (run_count > 0) {
+    cursor->filters =
+      (NostrDBFilter*)rs_alloc(run_count * sizeof(NostrDBFilter));
+    if (is_null(cursor->filters)) {
+      nostr_db_cursor_close(cursor);
+      return NOSTR_DB_ERROR_MMAP_FAILED;
+    }
+    cursor->filters_count = run_count;
+  }
+  if (!is_null(db->query_cache)) {
+    cursor->cache_writes = db->query_cache->writes;
+  }
+
+  for (size_t r = 0; r < run_count; r++) {
+    NostrDBFilter* filter = &cursor->filters[r];
+    filter_copy(filter, runs[r]);
+
+    QueryResultSet* lane = query_result_create(0);
+    if (is_null(lane)) {
+      nostr_db_cursor_close(cursor);
+      return NOSTR_DB_ERROR_MMAP_FAILED;
+    }
+    cursor->lanes[cursor->lane_count++] = lane;
+
+    // Repeated filters are answered from the result cache
+    cursor->cacheable[r] = !is_null(db->query_cache) &&
+                           query_cache_key(filter, &cursor->keys[r]);
+    if (cursor->cacheable[r] &&
+        query_cache_lookup(db->query_cache, &cursor->keys[r], lane)) {
+      continue;
+    }
+
+    NostrDBError err = query_scan_open(&db->indexes, &db->buffer_pool, filter,
+                                       lane, &cursor->scans[r]);
+    if (err != NOSTR_DB_OK) {
+      nostr_db_cursor_close(cursor);
+      return err;
+    }
+  }
+
+  *out = cursor;
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// Helper: A lane's scan is complete: cache its result (unless the database
+// changed while it ran) and free the scan
+// ============================================================================
+static void cursor_scan_done(NostrDBCursor* cursor, size_t r)
+{
+  QueryCache* cache = cursor->db->query_cache;
+  if (query_scan_error(cursor->scans[r]) == NOSTR_DB_OK &&
+      cursor->cacheable[r] && !is_null(cache) &&
+      cache->writes == cursor->cache_writes) {
+    query_cache_store(cache, &cursor->keys[r], cursor->lanes[r]);
+  }
+  query_scan_close(cursor->scans[r]);
+  cursor->scans[r] = NULL;
+}
+
+// ============================================================================
+// nostr_db_cursor_step: Spend up to budget units (0 = no bound) on the index
+// scans, then on record reads, visiting the live records. Only spanned
+// records are copied (into scratch); the rest are visited in their pinned
+// page.
+// ============================================================================
+bool nostr_db_cursor_step(NostrDBCursor* cursor, uint32_t budget,
+                          NostrDBRecordVisitor visit, void* ctx)
+{
+  require_not_null(cursor, true);
+  require_not_null(visit, true);
+
+  // Every lane is complete before the first record goes out
+  uint32_t reads = 0;
+  while (cursor->scanned < cursor->lane_count) {
+    if (budget > 0 && reads >= budget) return false;
+
+    size_t r = cursor->scanned;
+    if (!is_null(cursor->scans[r])) {
+      uint32_t spent    = 0;
+      bool     finished = query_scan_step(
+        cursor->scans[r], budget == 0 ? 0 : budget - reads, &spent);
+      reads += spent;
+      if (!finished) return false;
+      cursor_scan_done(cursor, r);
+    }
+    cursor->scanned++;
+  }
+
+  NostrDB* db = cursor->db;
+  uint8_t  scratch[8192];
+  while (!cursor->done && (budget == 0 || reads < budget)) {
+    size_t best = cursor_next_lane(cursor);
+    if (best == cursor->lane_count) {
+      cursor->done = true;
+      break;
+    }
+
+    const QueryResultSet* lane = cursor->lanes[best];
+    uint32_t              head = cursor->heads[best];
+    RecordId              rid  = lane->rids[head];
+    if (cursor->emitted && rid.page_id == cursor->last.page_id &&
+        rid.slot_index == cursor->last.slot_index) {
+      cursor->heads[best]++;
+      continue;
+    }
+
+    const uint8_t* record;
+    uint16_t       length;
+    reads++;
+    if (record_view(&db->buffer_pool, rid, scratch, sizeof(scratch), &record,
+                    &length) != NOSTR_DB_OK) {
+      cursor->heads[best]++;
+      continue;
+    }
+
+    // Still the event that was selected: live, and as old as when indexed
+    const EventRecord* rec   = (const EventRecord*)record;
+    bool               taken = true;
+    if (length >= sizeof(EventRecord) &&
+        !(rec->flags & NOSTR_DB_EVENT_FLAG_DELETED) &&
+        rec->created_at == lane->created_at[head]) {
+      taken = visit(record, length, ctx);
+    }
+    record_release(&db->buffer_pool, rid);
+    if (!taken) break;
+
+    cursor->heads[best]++;
+    cursor->last    = rid;
+    cursor->emitted = true;
+  }
+  return cursor->done;
+}
+
+// ============================================================================
+// nostr_db_cursor_close: Free a cursor (finished or not)
+// ============================================================================
+void nostr_db_cursor_close(NostrDBCursor* cursor)
+{
+  if (is_null(cursor)) return;
+  for (size_t r = 0; r < cursor->lane_count; r++) {
+    query_scan_close(cursor->scans[r]);
+    query_result_free(cursor->lanes[r]);
+  }
+  rs_free(cursor->filters, cursor->filters_count * sizeof(NostrDBFilter));
+  rs_free(cursor, sizeof(NostrDBCursor));
+}
+
+// ============================================================================
+// nostr_db_query_visit_all: Execute the filters of one REQ and visit the
+// merged result in one go; the visitor returning false stops the scan
+// ============================================================================
+NostrDBError nostr_db_query_visit_all(NostrDB* db, const NostrDBFilter* filters,
+                                      size_t count, NostrDBRecordVisitor visit,
+                                      void* ctx)
+{
+  require_not_null(visit, NOSTR_DB_ERROR_NULL_PARAM);
+
+  NostrDBCursor* cursor;
+  NostrDBError   err = nostr_db_cursor_open(db, filters, count, &cursor);
+  if (err != NOSTR_DB_OK) return err;
+
+  nostr_db_cursor_step(cursor, 0, visit, ctx);
+  nostr_db_cursor_close(cursor);
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// nostr_db_query_visit: Execute query and stream matching records in place
+// ============================================================================
+NostrDBError nostr_db_query_visit(NostrDB* db, const NostrDBFilter* filter,
+                                  NostrDBRecordVisitor visit, void* ctx)
+{
+  return nostr_db_query_visit_all(db, filter, 1, visit, ctx);
+}
@@ -59,6 +59,7 @@ typedef enum {
 // Event flags
 // ============================================================================
 #define NOSTR_DB_EVENT_FLAG_DELETED (1 << 0)
+#define NOSTR_DB_EVENT_FLAG_JSON (1 << 1)  // Serialized event JSON follows the tags
 
 // ============================================================================
 // Index entry states
@@ -79,6 +80,10 @@ typedef struct {
   uint64_t kind_index_entries;
   uint64_t tag_index_entries;
   uint64_t timeline_index_entries;
+  uint64_t query_cache_hits;
+  uint64_t query_cache_misses;
+  uint64_t query_cache_invalidations;
+  uint64_t query_cache_evictions;
 } NostrDBStats;
 
 #endif
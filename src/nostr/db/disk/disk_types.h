@@ -54,7 +54,7 @@ typedef struct {
 // ============================================================================
 #define DB_FILE_MAGIC "NOSTRDB2"
 #define DB_FILE_MAGIC_SIZE 8
-#define DB_FILE_VERSION 2
+#define DB_FILE_VERSION 4
 
 // ============================================================================
 // Disk manager
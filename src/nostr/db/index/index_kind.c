@@ -2,21 +2,39 @@
 #include "index_manager.h"
 
 // ============================================================================
-// index_kind_insert: Insert kind -> RecordId (duplicate key)
+// Internal: Build posting key be32(kind) + suffix = 18 bytes
 // ============================================================================
-NostrDBError index_kind_insert(BTree* tree, uint32_t kind, RecordId rid)
+static void build_kind_key(uint32_t kind, int64_t created_at, RecordId rid,
+                           uint8_t out[INDEX_KIND_KEY_SIZE])
+{
+  index_put_be32(out, kind);
+  index_posting_put_suffix(out + 4, created_at, rid);
+}
+
+// ============================================================================
+// index_kind_insert: Insert kind posting -> IndexPosting
+// ============================================================================
+NostrDBError index_kind_insert(BTree* tree, uint32_t kind, int64_t created_at,
+                               const IndexPosting* posting)
 {
   require_not_null(tree, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(posting, NOSTR_DB_ERROR_NULL_PARAM);
 
-  return btree_insert_dup(tree, &kind, rid);
+  uint8_t key[INDEX_KIND_KEY_SIZE];
+  build_kind_key(kind, created_at, posting->rid, key);
+  return btree_insert(tree, key, posting);
 }
 
 // ============================================================================
-// index_kind_delete: Delete kind -> RecordId from index
+// index_kind_delete: Delete kind posting from index
 // ============================================================================
-NostrDBError index_kind_delete(BTree* tree, uint32_t kind, RecordId rid)
+NostrDBError index_kind_delete(BTree* tree, uint32_t kind, int64_t created_at,
+                               const IndexPosting* posting)
 {
   require_not_null(tree, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(posting, NOSTR_DB_ERROR_NULL_PARAM);
 
-  return btree_delete_dup(tree, &kind, rid);
+  uint8_t key[INDEX_KIND_KEY_SIZE];
+  build_kind_key(kind, created_at, posting->rid, key);
+  return btree_delete(tree, key);
 }
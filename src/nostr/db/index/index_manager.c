@@ -42,13 +42,17 @@ static bool hex_to_32bytes(const uint8_t* hex, size_t hex_len, uint8_t out[32])
 //       [value_len: uint16_t][value: bytes]
 //
 // Indexable tags: single-character name with first value being 64-char hex
+// Each posting is also counted in the statistics (delta +1 / -1).
 // ============================================================================
 typedef NostrDBError (*TagIndexOp)(BTree* tree, uint8_t tag_name,
-                                   const uint8_t tag_value[32], RecordId rid);
-
-static NostrDBError process_tags(BTree* tree, const uint8_t* tags_data,
-                                 uint16_t tags_length, RecordId rid,
-                                 TagIndexOp op)
+                                   const uint8_t tag_value[32],
+                                   int64_t created_at,
+                                   const IndexPosting* posting);
+
+static NostrDBError process_tags(IndexManager* im, const uint8_t* tags_data,
+                                 uint16_t tags_length, int64_t created_at,
+                                 const IndexPosting* posting, TagIndexOp op,
+                                 int32_t delta)
 {
   if (is_null(tags_data) || tags_length < 2) return NOSTR_DB_OK;
 
@@ -85,8 +89,10 @@ static NostrDBError process_tags(BTree* tree, const uint8_t* tags_data,
           size_t copy_len = value_len > 32 ? 32 : value_len;
           internal_memcpy(raw_value, ptr, copy_len);
         }
-        NostrDBError err = op(tree, tag_name, raw_value, rid);
-        if (err != NOSTR_DB_OK) return err;
+        NostrDBError err =
+          op(&im->tag_index, tag_name, raw_value, created_at, posting);
+        if (err != NOSTR_DB_OK && err != NOSTR_DB_ERROR_NOT_FOUND) return err;
+        index_stats_count_tag(im->stats, tag_name, raw_value, delta);
       }
 
       ptr += value_len;
@@ -116,24 +122,28 @@ NostrDBError index_manager_create(IndexManager* im, BufferPool* pool)
                      sizeof(page_id_t), BTREE_KEY_INT64);
   if (err != NOSTR_DB_OK) return err;
 
-  // Pubkey index: key=32 bytes, value=page_id_t (4 bytes), dup
-  err = btree_create(&im->pubkey_index, pool, 32, sizeof(page_id_t),
-                     BTREE_KEY_BYTES32);
+  // Pubkey index: key=pubkey[32]+posting suffix, value=IndexPosting, unique
+  err = btree_create(&im->pubkey_index, pool, INDEX_PUBKEY_KEY_SIZE,
+                     sizeof(IndexPosting), BTREE_KEY_MEMCMP);
+  if (err != NOSTR_DB_OK) return err;
+
+  // Kind index: key=be32 kind+posting suffix, value=IndexPosting, unique
+  err = btree_create(&im->kind_index, pool, INDEX_KIND_KEY_SIZE,
+                     sizeof(IndexPosting), BTREE_KEY_MEMCMP);
   if (err != NOSTR_DB_OK) return err;
 
-  // Kind index: key=uint32 (4 bytes), value=page_id_t (4 bytes), dup
-  err = btree_create(&im->kind_index, pool, sizeof(uint32_t),
-                     sizeof(page_id_t), BTREE_KEY_UINT32);
+  // Pubkey+Kind index: key=pubkey[32]+be32 kind+posting suffix, unique
+  err = btree_create(&im->pubkey_kind_index, pool, INDEX_PK_KIND_KEY_SIZE,
+                     sizeof(IndexPosting), BTREE_KEY_MEMCMP);
   if (err != NOSTR_DB_OK) return err;
 
-  // Pubkey+Kind index: key=36 bytes, value=page_id_t (4 bytes), dup
-  err = btree_create(&im->pubkey_kind_index, pool, 36, sizeof(page_id_t),
-                     BTREE_KEY_COMPOSITE);
+  // Tag index: key=tag_name[1]+tag_value[32]+posting suffix, unique
+  err = btree_create(&im->tag_index, pool, INDEX_TAG_KEY_SIZE,
+                     sizeof(IndexPosting), BTREE_KEY_MEMCMP);
   if (err != NOSTR_DB_OK) return err;
 
-  // Tag index: key=33 bytes (tag_name[1]+tag_value[32]), value=page_id_t, dup
-  err = btree_create(&im->tag_index, pool, 33, sizeof(page_id_t),
-                     BTREE_KEY_COMPOSITE_TAG);
+  // Planner statistics
+  err = index_stats_create(pool, &im->stats);
   if (err != NOSTR_DB_OK) return err;
 
   return NOSTR_DB_OK;
@@ -145,7 +155,8 @@ NostrDBError index_manager_create(IndexManager* im, BufferPool* pool)
 NostrDBError index_manager_open(IndexManager* im, BufferPool* pool,
                                 page_id_t id_meta, page_id_t timeline_meta,
                                 page_id_t pubkey_meta, page_id_t kind_meta,
-                                page_id_t pk_kind_meta, page_id_t tag_meta)
+                                page_id_t pk_kind_meta, page_id_t tag_meta,
+                                page_id_t stats_meta)
 {
   require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
   require_not_null(pool, NOSTR_DB_ERROR_NULL_PARAM);
@@ -170,6 +181,9 @@ NostrDBError index_manager_open(IndexManager* im, BufferPool* pool,
   err = btree_open(&im->tag_index, pool, tag_meta);
   if (err != NOSTR_DB_OK) return err;
 
+  err = index_stats_open(pool, stats_meta, &im->stats);
+  if (err != NOSTR_DB_OK) return err;
+
   return NOSTR_DB_OK;
 }
 
@@ -198,9 +212,25 @@ NostrDBError index_manager_flush(IndexManager* im)
   err = btree_flush_meta(&im->tag_index);
   if (err != NOSTR_DB_OK) return err;
 
+  if (!is_null(im->stats)) {
+    err = index_stats_flush(im->stats);
+    if (err != NOSTR_DB_OK) return err;
+  }
+
   return NOSTR_DB_OK;
 }
 
+// ============================================================================
+// index_manager_close: Release in-memory index state
+// ============================================================================
+void index_manager_close(IndexManager* im)
+{
+  if (is_null(im)) return;
+
+  index_stats_close(im->stats);
+  im->stats = NULL;
+}
+
 // ============================================================================
 // index_manager_insert_event: Insert event into all indexes
 // ============================================================================
@@ -220,24 +250,30 @@ NostrDBError index_manager_insert_event(IndexManager* im, RecordId rid,
   err = index_timeline_insert(&im->timeline_index, record->created_at, rid);
   if (err != NOSTR_DB_OK) return err;
 
-  // 3. Pubkey index (dup)
-  err = index_pubkey_insert(&im->pubkey_index, record->pubkey, rid);
+  IndexPosting posting;
+  index_posting_init(&posting, rid, record->kind, record->pubkey);
+
+  // 3. Pubkey index (time-ordered postings)
+  err = index_pubkey_insert(&im->pubkey_index, record->pubkey,
+                            record->created_at, &posting);
   if (err != NOSTR_DB_OK) return err;
 
-  // 4. Kind index (dup)
-  err = index_kind_insert(&im->kind_index, record->kind, rid);
+  // 4. Kind index (time-ordered postings)
+  err = index_kind_insert(&im->kind_index, record->kind, record->created_at,
+                          &posting);
   if (err != NOSTR_DB_OK) return err;
 
-  // 5. Pubkey+Kind index (dup)
+  // 5. Pubkey+Kind index (time-ordered postings)
   err = index_pk_kind_insert(&im->pubkey_kind_index, record->pubkey,
-                             record->kind, rid);
+                             record->kind, record->created_at, &posting);
   if (err != NOSTR_DB_OK) return err;
 
-  // 6. Tag index (dup) — parse serialized tags
-  err = process_tags(&im->tag_index, tags_data, tags_length, rid,
-                     index_tag_insert);
+  // 6. Tag index (time-ordered postings) — parse serialized tags
+  err = process_tags(im, tags_data, tags_length, record->created_at, &posting,
+                     index_tag_insert, 1);
   if (err != NOSTR_DB_OK) return err;
 
+  index_stats_count_event(im->stats, record, 1);
   return NOSTR_DB_OK;
 }
 
@@ -261,23 +297,29 @@ NostrDBError index_manager_delete_event(IndexManager* im, RecordId rid,
     index_timeline_delete(&im->timeline_index, record->created_at, rid);
   if (err != NOSTR_DB_OK && err != NOSTR_DB_ERROR_NOT_FOUND) return err;
 
+  IndexPosting posting;
+  index_posting_init(&posting, rid, record->kind, record->pubkey);
+
   // 3. Pubkey index
-  err = index_pubkey_delete(&im->pubkey_index, record->pubkey, rid);
+  err = index_pubkey_delete(&im->pubkey_index, record->pubkey,
+                            record->created_at, &posting);
   if (err != NOSTR_DB_OK && err != NOSTR_DB_ERROR_NOT_FOUND) return err;
 
   // 4. Kind index
-  err = index_kind_delete(&im->kind_index, record->kind, rid);
+  err = index_kind_delete(&im->kind_index, record->kind, record->created_at,
+                          &posting);
   if (err != NOSTR_DB_OK && err != NOSTR_DB_ERROR_NOT_FOUND) return err;
 
   // 5. Pubkey+Kind index
   err = index_pk_kind_delete(&im->pubkey_kind_index, record->pubkey,
-                             record->kind, rid);
+                             record->kind, record->created_at, &posting);
   if (err != NOSTR_DB_OK && err != NOSTR_DB_ERROR_NOT_FOUND) return err;
 
   // 6. Tag index
-  err = process_tags(&im->tag_index, tags_data, tags_length, rid,
-                     index_tag_delete);
-  if (err != NOSTR_DB_OK && err != NOSTR_DB_ERROR_NOT_FOUND) return err;
+  err = process_tags(im, tags_data, tags_length, record->created_at, &posting,
+                     index_tag_delete, -1);
+  if (err != NOSTR_DB_OK) return err;
 
+  index_stats_count_event(im->stats, record, -1);
   return NOSTR_DB_OK;
 }
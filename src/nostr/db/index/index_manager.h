@@ -7,6 +7,7 @@
 #include "../buffer/buffer_pool.h"
 #include "../db_types.h"
 #include "../record/record_types.h"
+#include "index_stats.h"
 
 // ============================================================================
 // IndexManager: unified management of all Nostr indexes
@@ -14,10 +15,11 @@
 typedef struct {
   BTree       id_index;           // Unique: id[32] -> RecordId
   BTree       timeline_index;     // Dup: INT64_MAX - created_at -> overflow
-  BTree       pubkey_index;       // Dup: pubkey[32] -> overflow
-  BTree       kind_index;         // Dup: kind (uint32) -> overflow
-  BTree       pubkey_kind_index;  // Dup: pubkey[32]+kind[4] -> overflow
-  BTree       tag_index;          // Dup: tag_name[1]+tag_value[32] -> overflow
+  BTree       pubkey_index;       // Posting: pubkey[32] + suffix -> IndexPosting
+  BTree       kind_index;         // Posting: be32 kind + suffix -> IndexPosting
+  BTree       pubkey_kind_index;  // Posting: pubkey[32]+be32 kind + suffix -> IndexPosting
+  BTree       tag_index;          // Posting: tag_name[1]+tag_value[32] + suffix -> IndexPosting
+  IndexStats* stats;              // Planner statistics (page chain)
   BufferPool* pool;
 } IndexManager;
 
@@ -36,13 +38,19 @@ NostrDBError index_manager_create(IndexManager* im, BufferPool* pool);
 NostrDBError index_manager_open(IndexManager* im, BufferPool* pool,
                                 page_id_t id_meta, page_id_t timeline_meta,
                                 page_id_t pubkey_meta, page_id_t kind_meta,
-                                page_id_t pk_kind_meta, page_id_t tag_meta);
+                                page_id_t pk_kind_meta, page_id_t tag_meta,
+                                page_id_t stats_meta);
 
 /**
- * @brief Flush all index metadata to disk
+ * @brief Flush all index metadata and statistics to disk
  */
 NostrDBError index_manager_flush(IndexManager* im);
 
+/**
+ * @brief Release in-memory index state (does not flush)
+ */
+void index_manager_close(IndexManager* im);
+
 // ============================================================================
 // Bulk operations (insert/delete event across all indexes)
 // ============================================================================
@@ -100,37 +108,148 @@ NostrDBError index_timeline_delete(BTree* tree, int64_t created_at,
                                    RecordId rid);
 
 // ============================================================================
-// Pubkey index operations (duplicate key)
+// Time-ordered posting keys (pubkey, kind, pubkey+kind and tag indexes)
+//
+// Each posting is its own unique key:
+//   prefix || be64(INT64_MAX - created_at) || be32(page_id) || be16(slot)
+// compared with memcmp, so a range scan over one prefix returns its events
+// newest first and can stop as soon as the caller has enough of them.
+//
+// The leaf value covers the fields most filters test, so candidates are
+// pruned without reading the record page.
+// ============================================================================
+#define INDEX_POSTING_SUFFIX_SIZE 14
+#define INDEX_POSTING_PUBKEY_PREFIX_SIZE 8
+#define INDEX_PUBKEY_KEY_SIZE (32 + INDEX_POSTING_SUFFIX_SIZE)
+#define INDEX_KIND_KEY_SIZE (4 + INDEX_POSTING_SUFFIX_SIZE)
+#define INDEX_PK_KIND_KEY_SIZE (36 + INDEX_POSTING_SUFFIX_SIZE)
+#define INDEX_TAG_KEY_SIZE (33 + INDEX_POSTING_SUFFIX_SIZE)
+#define INDEX_POSTING_MAX_KEY_SIZE INDEX_PK_KIND_KEY_SIZE
+
+typedef struct {
+  RecordId rid;
+  uint32_t kind;
+  uint8_t  pubkey_prefix[INDEX_POSTING_PUBKEY_PREFIX_SIZE];  // Not unique: verify on the record
+} IndexPosting;
+
+static inline void index_put_be32(uint8_t* out, uint32_t v)
+{
+  out[0] = (uint8_t)(v >> 24);
+  out[1] = (uint8_t)(v >> 16);
+  out[2] = (uint8_t)(v >> 8);
+  out[3] = (uint8_t)v;
+}
+
+static inline uint32_t index_get_be32(const uint8_t* in)
+{
+  return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) |
+         ((uint32_t)in[2] << 8) | (uint32_t)in[3];
+}
+
+/**
+ * @brief Encode created_at as 8 bytes sorting newest first
+ * Equals be64(INT64_MAX - created_at) for created_at >= 0, and stays
+ * ordered (without overflow) for negative timestamps.
+ */
+static inline void index_posting_put_time(uint8_t out[8], int64_t created_at)
+{
+  uint64_t v = ~((uint64_t)created_at ^ 0x8000000000000000ULL);
+  index_put_be32(out, (uint32_t)(v >> 32));
+  index_put_be32(out + 4, (uint32_t)v);
+}
+
+static inline int64_t index_posting_get_time(const uint8_t in[8])
+{
+  uint64_t v = ((uint64_t)index_get_be32(in) << 32) | index_get_be32(in + 4);
+  return (int64_t)(~v ^ 0x8000000000000000ULL);
+}
+
+/**
+ * @brief Write the posting suffix after a prefix
+ */
+static inline void index_posting_put_suffix(uint8_t out[INDEX_POSTING_SUFFIX_SIZE],
+                                            int64_t created_at, RecordId rid)
+{
+  index_posting_put_time(out, created_at);
+  index_put_be32(out + 8, rid.page_id);
+  out[12] = (uint8_t)(rid.slot_index >> 8);
+  out[13] = (uint8_t)rid.slot_index;
+}
+
+/**
+ * @brief Build the scan bounds of one prefix for a [since, until] window
+ * (0 = unbounded): min is the newest possible posting, max the oldest
+ */
+static inline void index_posting_bounds(uint8_t* min_key, uint8_t* max_key,
+                                        const uint8_t* prefix,
+                                        uint16_t prefix_size, int64_t since,
+                                        int64_t until)
+{
+  for (uint16_t i = 0; i < prefix_size; i++) {
+    min_key[i] = prefix[i];
+    max_key[i] = prefix[i];
+  }
+  for (uint16_t i = 0; i < INDEX_POSTING_SUFFIX_SIZE; i++) {
+    min_key[prefix_size + i] = 0x00;
+    max_key[prefix_size + i] = 0xFF;
+  }
+  if (until > 0) index_posting_put_time(min_key + prefix_size, until);
+  if (since > 0) index_posting_put_time(max_key + prefix_size, since);
+}
+
+// ============================================================================
+// Pubkey index operations (time-ordered postings)
 // ============================================================================
 
+/**
+ * @brief Fill the covering value of an event's postings
+ */
+static inline void index_posting_init(IndexPosting* posting, RecordId rid,
+                                      uint32_t kind, const uint8_t pubkey[32])
+{
+  posting->rid  = rid;
+  posting->kind = kind;
+  for (uint16_t i = 0; i < INDEX_POSTING_PUBKEY_PREFIX_SIZE; i++) {
+    posting->pubkey_prefix[i] = pubkey[i];
+  }
+}
+
 NostrDBError index_pubkey_insert(BTree* tree, const uint8_t pubkey[32],
-                                 RecordId rid);
+                                 int64_t created_at,
+                                 const IndexPosting* posting);
 NostrDBError index_pubkey_delete(BTree* tree, const uint8_t pubkey[32],
-                                 RecordId rid);
+                                 int64_t created_at,
+                                 const IndexPosting* posting);
 
 // ============================================================================
-// Kind index operations (duplicate key)
+// Kind index operations (time-ordered postings)
 // ============================================================================
 
-NostrDBError index_kind_insert(BTree* tree, uint32_t kind, RecordId rid);
-NostrDBError index_kind_delete(BTree* tree, uint32_t kind, RecordId rid);
+NostrDBError index_kind_insert(BTree* tree, uint32_t kind, int64_t created_at,
+                               const IndexPosting* posting);
+NostrDBError index_kind_delete(BTree* tree, uint32_t kind, int64_t created_at,
+                               const IndexPosting* posting);
 
 // ============================================================================
-// Pubkey+Kind composite index operations (duplicate key)
+// Pubkey+Kind composite index operations (time-ordered postings)
 // ============================================================================
 
 NostrDBError index_pk_kind_insert(BTree* tree, const uint8_t pubkey[32],
-                                  uint32_t kind, RecordId rid);
+                                  uint32_t kind, int64_t created_at,
+                                  const IndexPosting* posting);
 NostrDBError index_pk_kind_delete(BTree* tree, const uint8_t pubkey[32],
-                                  uint32_t kind, RecordId rid);
+                                  uint32_t kind, int64_t created_at,
+                                  const IndexPosting* posting);
 
 // ============================================================================
-// Tag index operations (duplicate key)
+// Tag index operations (time-ordered postings)
 // ============================================================================
 
 NostrDBError index_tag_insert(BTree* tree, uint8_t tag_name,
-                              const uint8_t tag_value[32], RecordId rid);
+                              const uint8_t tag_value[32], int64_t created_at,
+                              const IndexPosting* posting);
 NostrDBError index_tag_delete(BTree* tree, uint8_t tag_name,
-                              const uint8_t tag_value[32], RecordId rid);
+                              const uint8_t tag_value[32], int64_t created_at,
+                              const IndexPosting* posting);
 
 #endif
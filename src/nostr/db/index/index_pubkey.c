@@ -2,25 +2,41 @@
 #include "index_manager.h"
 
 // ============================================================================
-// index_pubkey_insert: Insert pubkey -> RecordId (duplicate key)
+// Internal: Build posting key pubkey[32] + suffix = 46 bytes
+// ============================================================================
+static void build_pubkey_key(const uint8_t pubkey[32], int64_t created_at,
+                             RecordId rid, uint8_t out[INDEX_PUBKEY_KEY_SIZE])
+{
+  internal_memcpy(out, pubkey, 32);
+  index_posting_put_suffix(out + 32, created_at, rid);
+}
+
+// ============================================================================
+// index_pubkey_insert: Insert pubkey posting -> IndexPosting
 // ============================================================================
 NostrDBError index_pubkey_insert(BTree* tree, const uint8_t pubkey[32],
-                                 RecordId rid)
+                                 int64_t created_at, const IndexPosting* posting)
 {
   require_not_null(tree, NOSTR_DB_ERROR_NULL_PARAM);
   require_not_null(pubkey, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(posting, NOSTR_DB_ERROR_NULL_PARAM);
 
-  return btree_insert_dup(tree, pubkey, rid);
+  uint8_t key[INDEX_PUBKEY_KEY_SIZE];
+  build_pubkey_key(pubkey, created_at, posting->rid, key);
+  return btree_insert(tree, key, posting);
 }
 
 // ============================================================================
-// index_pubkey_delete: Delete pubkey -> RecordId from index
+// index_pubkey_delete: Delete pubkey posting from index
 // ============================================================================
 NostrDBError index_pubkey_delete(BTree* tree, const uint8_t pubkey[32],
-                                 RecordId rid)
+                                 int64_t created_at, const IndexPosting* posting)
 {
   require_not_null(tree, NOSTR_DB_ERROR_NULL_PARAM);
   require_not_null(pubkey, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(posting, NOSTR_DB_ERROR_NULL_PARAM);
 
-  return btree_delete_dup(tree, pubkey, rid);
+  uint8_t key[INDEX_PUBKEY_KEY_SIZE];
+  build_pubkey_key(pubkey, created_at, posting->rid, key);
+  return btree_delete(tree, key);
 }
@@ -2,39 +2,45 @@
 #include "index_manager.h"
 
 // ============================================================================
-// Internal: Build composite key pubkey[32] + kind[4] = 36 bytes
+// Internal: Build posting key pubkey[32] + be32(kind) + suffix = 50 bytes
 // ============================================================================
 static void build_pk_kind_key(const uint8_t pubkey[32], uint32_t kind,
-                              uint8_t out[36])
+                              int64_t created_at, RecordId rid,
+                              uint8_t out[INDEX_PK_KIND_KEY_SIZE])
 {
   internal_memcpy(out, pubkey, 32);
-  internal_memcpy(out + 32, &kind, sizeof(uint32_t));
+  index_put_be32(out + 32, kind);
+  index_posting_put_suffix(out + 36, created_at, rid);
 }
 
 // ============================================================================
-// index_pk_kind_insert: Insert pubkey+kind -> RecordId (duplicate key)
+// index_pk_kind_insert: Insert pubkey+kind posting -> IndexPosting
 // ============================================================================
 NostrDBError index_pk_kind_insert(BTree* tree, const uint8_t pubkey[32],
-                                  uint32_t kind, RecordId rid)
+                                  uint32_t kind, int64_t created_at,
+                                  const IndexPosting* posting)
 {
   require_not_null(tree, NOSTR_DB_ERROR_NULL_PARAM);
   require_not_null(pubkey, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(posting, NOSTR_DB_ERROR_NULL_PARAM);
 
-  uint8_t key[36];
-  build_pk_kind_key(pubkey, kind, key);
-  return btree_insert_dup(tree, key, rid);
+  uint8_t key[INDEX_PK_KIND_KEY_SIZE];
+  build_pk_kind_key(pubkey, kind, created_at, posting->rid, key);
+  return btree_insert(tree, key, posting);
 }
 
 // ============================================================================
-// index_pk_kind_delete: Delete pubkey+kind -> RecordId from index
+// index_pk_kind_delete: Delete pubkey+kind posting from index
 // ============================================================================
 NostrDBError index_pk_kind_delete(BTree* tree, const uint8_t pubkey[32],
-                                  uint32_t kind, RecordId rid)
+                                  uint32_t kind, int64_t created_at,
+                                  const IndexPosting* posting)
 {
   require_not_null(tree, NOSTR_DB_ERROR_NULL_PARAM);
   require_not_null(pubkey, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(posting, NOSTR_DB_ERROR_NULL_PARAM);
 
-  uint8_t key[36];
-  build_pk_kind_key(pubkey, kind, key);
-  return btree_delete_dup(tree, key, rid);
+  uint8_t key[INDEX_PK_KIND_KEY_SIZE];
+  build_pk_kind_key(pubkey, kind, created_at, posting->rid, key);
+  return btree_delete(tree, key);
 }
@@ -0,0 +1,374 @@
+#include "index_stats.h"
+
+#include "../../../arch/memory.h"
+#include "../../../arch/mmap.h"
+#include "../../../arch/time.h"
+#include "index_manager.h"
+
+// ============================================================================
+// Internal: Hash a key prefix (FNV-1a, then mixed so low bits are usable)
+// ============================================================================
+static uint64_t stats_hash(const uint8_t* prefix, uint16_t prefix_size)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (uint16_t i = 0; i < prefix_size; i++) {
+    hash ^= prefix[i];
+    hash *= 0x100000001b3ULL;
+  }
+  hash ^= hash >> 33;
+  hash *= 0x9E3779B97F4A7C15ULL;
+  hash ^= hash >> 29;
+  return hash;
+}
+
+static inline uint32_t sketch_slot(uint64_t hash, uint32_t row)
+{
+  return (uint32_t)(hash >> (row * 32)) & (INDEX_STATS_SKETCH_WIDTH - 1);
+}
+
+// ============================================================================
+// Internal: Add a hash to the k-minimum-values sketch (kept ascending)
+// ============================================================================
+static void kmv_add(IndexKeyStats* ks, uint64_t hash)
+{
+  uint32_t count = ks->kmv_count;
+  if (count == INDEX_STATS_KMV_SIZE && hash >= ks->kmv[count - 1]) return;
+
+  uint32_t lo = 0, hi = count;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (ks->kmv[mid] < hash) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < count && ks->kmv[lo] == hash) return;
+
+  if (count == INDEX_STATS_KMV_SIZE) count--;
+  for (uint32_t i = count; i > lo; i--) {
+    ks->kmv[i] = ks->kmv[i - 1];
+  }
+  ks->kmv[lo]   = hash;
+  ks->kmv_count = count + 1;
+}
+
+// ============================================================================
+// Internal: Count one posting under a prefix
+// ============================================================================
+static void count_key(IndexStats* stats, IndexStatsKey key,
+                      const uint8_t* prefix, uint16_t prefix_size,
+                      int32_t delta)
+{
+  IndexKeyStats* ks   = &stats->data.keys[key];
+  uint64_t       hash = stats_hash(prefix, prefix_size);
+
+  for (uint32_t row = 0; row < INDEX_STATS_SKETCH_DEPTH; row++) {
+    uint32_t* counter = &ks->sketch[row][sketch_slot(hash, row)];
+    if (delta > 0) {
+      (*counter)++;
+    } else if (*counter > 0) {
+      (*counter)--;
+    }
+  }
+
+  if (delta > 0) {
+    ks->entries++;
+    kmv_add(ks, hash);
+  } else if (ks->entries > 0) {
+    ks->entries--;
+  }
+}
+
+// ============================================================================
+// Internal: Sliding time histogram
+// Buckets cover 2^SHIFT seconds each; a newer event slides the window
+// forward, folding the oldest buckets into time[0]. Events dated past now +
+// INDEX_STATS_TIME_SLACK count as that time, so one far-future created_at
+// cannot slide the whole history into time[0].
+// ============================================================================
+static inline int64_t time_bucket(int64_t created_at)
+{
+  return created_at >> INDEX_STATS_TIME_SHIFT;
+}
+
+static void count_time(IndexStatsData* data, int64_t created_at,
+                       int32_t delta)
+{
+  int64_t bucket = time_bucket(created_at);
+
+  // The clock is read only for an event past the window (or the first one)
+  if (data->events == 0 ||
+      bucket > data->time_origin + INDEX_STATS_TIME_BUCKETS - 1) {
+    int64_t now = internal_time();
+    if (now > 0 && bucket > time_bucket(now + INDEX_STATS_TIME_SLACK)) {
+      bucket = time_bucket(now + INDEX_STATS_TIME_SLACK);
+    }
+  }
+
+  if (delta > 0) {
+    if (data->events == 0) {
+      internal_memset(data->time, 0, sizeof(data->time));
+      data->time_origin = bucket - (INDEX_STATS_TIME_BUCKETS - 1);
+    }
+
+    int64_t shift = bucket - (data->time_origin + INDEX_STATS_TIME_BUCKETS - 1);
+    if (shift > 0) {
+      for (int64_t i = 1; i < INDEX_STATS_TIME_BUCKETS; i++) {
+        int64_t to = i - shift;
+        if (to <= 0) {
+          data->time[0] += data->time[i];
+        } else {
+          data->time[to] = data->time[i];
+        }
+        data->time[i] = 0;
+      }
+      data->time_origin += shift;
+    }
+  }
+
+  int64_t index = bucket - data->time_origin;
+  if (index < 0) index = 0;
+  if (index >= INDEX_STATS_TIME_BUCKETS) index = INDEX_STATS_TIME_BUCKETS - 1;
+
+  if (delta > 0) {
+    data->time[index]++;
+    data->events++;
+  } else {
+    if (data->time[index] > 0) data->time[index]--;
+    if (data->events > 0) data->events--;
+  }
+}
+
+// ============================================================================
+// Internal: Allocate / free the in-memory statistics
+// ============================================================================
+static IndexStats* stats_alloc(BufferPool* pool)
+{
+  void* ptr = internal_mmap(NULL, sizeof(IndexStats), PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) return NULL;
+
+  IndexStats* stats = (IndexStats*)ptr;
+  stats->pool       = pool;
+  return stats;
+}
+
+// ============================================================================
+// index_stats_create: Allocate empty statistics and their page chain
+// ============================================================================
+NostrDBError index_stats_create(BufferPool* pool, IndexStats** out)
+{
+  require_not_null(pool, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(out, NOSTR_DB_ERROR_NULL_PARAM);
+
+  IndexStats* stats = stats_alloc(pool);
+  if (is_null(stats)) return NOSTR_DB_ERROR_MMAP_FAILED;
+
+  for (size_t i = 0; i < INDEX_STATS_PAGES; i++) {
+    PageData* page = NULL;
+    stats->pages[i] = buffer_pool_alloc_page(pool, &page);
+    if (stats->pages[i] == PAGE_ID_NULL) {
+      index_stats_close(stats);
+      return NOSTR_DB_ERROR_FULL;
+    }
+    buffer_pool_unpin(pool, stats->pages[i]);
+  }
+
+  NostrDBError err = index_stats_flush(stats);
+  if (err != NOSTR_DB_OK) {
+    index_stats_close(stats);
+    return err;
+  }
+
+  *out = stats;
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// index_stats_open: Load statistics from their page chain
+// ============================================================================
+NostrDBError index_stats_open(BufferPool* pool, page_id_t first_page,
+                              IndexStats** out)
+{
+  require_not_null(pool, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(out, NOSTR_DB_ERROR_NULL_PARAM);
+
+  if (first_page == PAGE_ID_NULL) {
+    return index_stats_create(pool, out);
+  }
+
+  IndexStats* stats = stats_alloc(pool);
+  if (is_null(stats)) return NOSTR_DB_ERROR_MMAP_FAILED;
+
+  uint8_t*  dst       = (uint8_t*)&stats->data;
+  size_t    remaining = sizeof(IndexStatsData);
+  page_id_t pid       = first_page;
+
+  for (size_t i = 0; i < INDEX_STATS_PAGES; i++) {
+    PageData* page = pid != PAGE_ID_NULL ? buffer_pool_pin(pool, pid) : NULL;
+    if (is_null(page)) {
+      index_stats_close(stats);
+      return NOSTR_DB_ERROR_INDEX_CORRUPT;
+    }
+
+    size_t chunk = remaining < INDEX_STATS_PAGE_PAYLOAD
+                     ? remaining
+                     : INDEX_STATS_PAGE_PAYLOAD;
+    internal_memcpy(dst, page->data + sizeof(page_id_t), chunk);
+    dst += chunk;
+    remaining -= chunk;
+
+    stats->pages[i] = pid;
+    internal_memcpy(&pid, page->data, sizeof(page_id_t));
+    buffer_pool_unpin(pool, stats->pages[i]);
+  }
+
+  *out = stats;
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// index_stats_flush: Write statistics to their page chain
+// ============================================================================
+NostrDBError index_stats_flush(IndexStats* stats)
+{
+  require_not_null(stats, NOSTR_DB_ERROR_NULL_PARAM);
+
+  const uint8_t* src       = (const uint8_t*)&stats->data;
+  size_t         remaining = sizeof(IndexStatsData);
+
+  for (size_t i = 0; i < INDEX_STATS_PAGES; i++) {
+    PageData* page = buffer_pool_pin(stats->pool, stats->pages[i]);
+    if (is_null(page)) return NOSTR_DB_ERROR_NOT_FOUND;
+
+    page_id_t next  = i + 1 < INDEX_STATS_PAGES ? stats->pages[i + 1]
+                                                : PAGE_ID_NULL;
+    size_t    chunk = remaining < INDEX_STATS_PAGE_PAYLOAD
+                        ? remaining
+                        : INDEX_STATS_PAGE_PAYLOAD;
+    internal_memcpy(page->data, &next, sizeof(page_id_t));
+    internal_memcpy(page->data + sizeof(page_id_t), src, chunk);
+    src += chunk;
+    remaining -= chunk;
+
+    buffer_pool_mark_dirty(stats->pool, stats->pages[i], 0);
+    buffer_pool_unpin(stats->pool, stats->pages[i]);
+  }
+
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// index_stats_close: Free the in-memory statistics
+// ============================================================================
+void index_stats_close(IndexStats* stats)
+{
+  if (!is_null(stats)) {
+    internal_munmap(stats, sizeof(IndexStats));
+  }
+}
+
+// ============================================================================
+// index_stats_count_event: Count an event's non-tag index entries
+// ============================================================================
+void index_stats_count_event(IndexStats* stats, const EventRecord* record,
+                             int32_t delta)
+{
+  if (is_null(stats) || is_null(record)) return;
+
+  count_time(&stats->data, record->created_at, delta);
+
+  uint8_t prefix[36];
+  internal_memcpy(prefix, record->pubkey, 32);
+  index_put_be32(prefix + 32, record->kind);
+
+  count_key(stats, INDEX_STATS_PUBKEY, prefix, 32, delta);
+  count_key(stats, INDEX_STATS_KIND, prefix + 32, 4, delta);
+  count_key(stats, INDEX_STATS_PUBKEY_KIND, prefix, 36, delta);
+}
+
+// ============================================================================
+// index_stats_count_tag: Count one tag posting
+// ============================================================================
+void index_stats_count_tag(IndexStats* stats, uint8_t tag_name,
+                           const uint8_t tag_value[32], int32_t delta)
+{
+  if (is_null(stats) || is_null(tag_value)) return;
+
+  uint8_t prefix[33];
+  prefix[0] = tag_name;
+  internal_memcpy(prefix + 1, tag_value, 32);
+  count_key(stats, INDEX_STATS_TAG, prefix, 33, delta);
+}
+
+// ============================================================================
+// index_stats_key_count: Count-min estimate of the postings under a prefix
+// ============================================================================
+uint64_t index_stats_key_count(const IndexStats* stats, IndexStatsKey key,
+                               const uint8_t* prefix, uint16_t prefix_size)
+{
+  if (is_null(stats) || is_null(prefix) || key >= INDEX_STATS_KEYS) return 0;
+
+  const IndexKeyStats* ks   = &stats->data.keys[key];
+  uint64_t             hash = stats_hash(prefix, prefix_size);
+
+  uint64_t count = ks->entries;
+  for (uint32_t row = 0; row < INDEX_STATS_SKETCH_DEPTH; row++) {
+    uint32_t c = ks->sketch[row][sketch_slot(hash, row)];
+    if (c < count) count = c;
+  }
+  return count;
+}
+
+// ============================================================================
+// index_stats_distinct: Distinct prefixes from the k-th smallest hash
+// ============================================================================
+uint64_t index_stats_distinct(const IndexStats* stats, IndexStatsKey key)
+{
+  if (is_null(stats) || key >= INDEX_STATS_KEYS) return 0;
+
+  const IndexKeyStats* ks = &stats->data.keys[key];
+  if (ks->kmv_count < INDEX_STATS_KMV_SIZE) return ks->kmv_count;
+
+  uint64_t kth = ks->kmv[INDEX_STATS_KMV_SIZE - 1];
+  if (kth == 0) return ks->entries;
+  return (UINT64_MAX / kth) * (INDEX_STATS_KMV_SIZE - 1);
+}
+
+// ============================================================================
+// index_stats_time_count: Events in [since, until], interpolating linearly
+// within the buckets the window cuts
+// ============================================================================
+uint64_t index_stats_time_count(const IndexStats* stats, int64_t since,
+                                int64_t until)
+{
+  if (is_null(stats)) return 0;
+
+  const IndexStatsData* data = &stats->data;
+  if (since <= 0 && until <= 0) return data->events;
+
+  const int64_t width = (int64_t)1 << INDEX_STATS_TIME_SHIFT;
+  uint64_t      count = 0;
+
+  for (int64_t i = 0; i < INDEX_STATS_TIME_BUCKETS; i++) {
+    if (data->time[i] == 0) continue;
+
+    int64_t lo = (data->time_origin + i) << INDEX_STATS_TIME_SHIFT;
+    int64_t hi = lo + width;  // Exclusive
+
+    // time[0] also holds events older than its span
+    if (i == 0 && until > 0 && until < lo) {
+      count += data->time[0];
+      continue;
+    }
+
+    if (since > 0 && since > lo) lo = since;
+    if (until > 0 && until < hi - 1) hi = until + 1;
+    if (lo >= hi) continue;
+
+    count += (uint64_t)data->time[i] * (uint64_t)(hi - lo) / (uint64_t)width;
+  }
+
+  return count;
+}
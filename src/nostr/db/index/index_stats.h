@@ -0,0 +1,127 @@
+#ifndef NOSTR_DB_INDEX_STATS_H_
+#define NOSTR_DB_INDEX_STATS_H_
+
+#include "../../../util/types.h"
+#include "../buffer/buffer_pool.h"
+#include "../db_types.h"
+#include "../record/record_types.h"
+
+// ============================================================================
+// Index statistics for query planning
+//
+// Maintained by the index manager on every insert / delete:
+//   - events per time bucket (a sliding histogram of created_at)
+//   - per posting index: entries, a count-min sketch of postings per key
+//     prefix, and a k-minimum-values sketch of the distinct prefixes
+// Estimates only: counts can be high under hash collisions, distinct keys
+// are never decremented, and updates since the last flush are lost on a
+// crash. Kept in memory and written to a page chain on flush.
+// ============================================================================
+#define INDEX_STATS_SKETCH_DEPTH 2
+#define INDEX_STATS_SKETCH_WIDTH 512  // Power of two
+#define INDEX_STATS_KMV_SIZE 64
+#define INDEX_STATS_TIME_BUCKETS 128
+#define INDEX_STATS_TIME_SHIFT 15  // Bucket width 2^15 s (about 9 hours)
+#define INDEX_STATS_TIME_SLACK 3600  // Future created_at counted at most this far ahead
+
+typedef enum {
+  INDEX_STATS_PUBKEY = 0,   // pubkey[32]
+  INDEX_STATS_KIND,         // be32 kind
+  INDEX_STATS_PUBKEY_KIND,  // pubkey[32] + be32 kind
+  INDEX_STATS_TAG,          // tag_name[1] + tag_value[32]
+  INDEX_STATS_KEYS,
+} IndexStatsKey;
+
+typedef struct {
+  uint64_t entries;                    // Postings in the index
+  uint64_t kmv[INDEX_STATS_KMV_SIZE];  // Smallest prefix hashes, ascending
+  uint32_t kmv_count;
+  uint32_t dummy;
+  uint32_t sketch[INDEX_STATS_SKETCH_DEPTH][INDEX_STATS_SKETCH_WIDTH];
+} IndexKeyStats;
+
+typedef struct {
+  uint64_t      events;                          // Timeline entries
+  int64_t       time_origin;                     // Bucket number of time[0]
+  uint32_t      time[INDEX_STATS_TIME_BUCKETS];  // time[0] also holds anything older
+  IndexKeyStats keys[INDEX_STATS_KEYS];
+} IndexStatsData;
+
+// ============================================================================
+// Page chain layout: each page links to the next, data fills the rest
+// ============================================================================
+#define INDEX_STATS_PAGE_PAYLOAD (DB_PAGE_SIZE - sizeof(page_id_t))
+#define INDEX_STATS_PAGES \
+  ((sizeof(IndexStatsData) + INDEX_STATS_PAGE_PAYLOAD - 1) / INDEX_STATS_PAGE_PAYLOAD)
+
+typedef struct {
+  IndexStatsData data;
+  BufferPool*    pool;
+  page_id_t      pages[INDEX_STATS_PAGES];  // pages[0] is recorded in the DB meta page
+} IndexStats;
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+/**
+ * @brief Allocate empty statistics and their page chain
+ */
+NostrDBError index_stats_create(BufferPool* pool, IndexStats** out);
+
+/**
+ * @brief Load statistics from their page chain
+ * A NULL first_page (a file written before statistics existed) creates
+ * empty statistics instead.
+ */
+NostrDBError index_stats_open(BufferPool* pool, page_id_t first_page,
+                              IndexStats** out);
+
+/**
+ * @brief Write statistics to their page chain
+ */
+NostrDBError index_stats_flush(IndexStats* stats);
+
+/**
+ * @brief Free the in-memory statistics (does not flush)
+ */
+void index_stats_close(IndexStats* stats);
+
+// ============================================================================
+// Maintenance (delta = +1 on insert, -1 on delete)
+// ============================================================================
+
+/**
+ * @brief Count an event's timeline, pubkey, kind and pubkey+kind entries
+ */
+void index_stats_count_event(IndexStats* stats, const EventRecord* record,
+                             int32_t delta);
+
+/**
+ * @brief Count one tag posting
+ */
+void index_stats_count_tag(IndexStats* stats, uint8_t tag_name,
+                           const uint8_t tag_value[32], int32_t delta);
+
+// ============================================================================
+// Estimates
+// ============================================================================
+
+/**
+ * @brief Postings under one key prefix (in the index's key byte order)
+ */
+uint64_t index_stats_key_count(const IndexStats* stats, IndexStatsKey key,
+                               const uint8_t* prefix, uint16_t prefix_size);
+
+/**
+ * @brief Distinct key prefixes in an index
+ */
+uint64_t index_stats_distinct(const IndexStats* stats, IndexStatsKey key);
+
+/**
+ * @brief Events with created_at in [since, until] (0 = unbounded)
+ */
+uint64_t index_stats_time_count(const IndexStats* stats, int64_t since,
+                                int64_t until);
+
+#endif
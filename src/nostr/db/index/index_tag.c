@@ -2,39 +2,48 @@
 #include "index_manager.h"
 
 // ============================================================================
-// Internal: Build composite key tag_name[1] + tag_value[32] = 33 bytes
+// Internal: Build posting key tag_name[1] + tag_value[32] + suffix = 47 bytes
 // ============================================================================
 static void build_tag_key(uint8_t tag_name, const uint8_t tag_value[32],
-                          uint8_t out[33])
+                          int64_t created_at, RecordId rid,
+                          uint8_t out[INDEX_TAG_KEY_SIZE])
 {
   out[0] = tag_name;
   internal_memcpy(out + 1, tag_value, 32);
+  index_posting_put_suffix(out + 33, created_at, rid);
 }
 
 // ============================================================================
-// index_tag_insert: Insert tag_name+tag_value -> RecordId (duplicate key)
+// index_tag_insert: Insert tag_name+tag_value posting -> IndexPosting
+// An event repeating the same tag value is indexed once.
 // ============================================================================
 NostrDBError index_tag_insert(BTree* tree, uint8_t tag_name,
-                              const uint8_t tag_value[32], RecordId rid)
+                              const uint8_t tag_value[32], int64_t created_at,
+                              const IndexPosting* posting)
 {
   require_not_null(tree, NOSTR_DB_ERROR_NULL_PARAM);
   require_not_null(tag_value, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(posting, NOSTR_DB_ERROR_NULL_PARAM);
 
-  uint8_t key[33];
-  build_tag_key(tag_name, tag_value, key);
-  return btree_insert_dup(tree, key, rid);
+  uint8_t key[INDEX_TAG_KEY_SIZE];
+  build_tag_key(tag_name, tag_value, created_at, posting->rid, key);
+
+  NostrDBError err = btree_insert(tree, key, posting);
+  return err == NOSTR_DB_ERROR_DUPLICATE ? NOSTR_DB_OK : err;
 }
 
 // ============================================================================
-// index_tag_delete: Delete tag_name+tag_value -> RecordId from index
+// index_tag_delete: Delete tag_name+tag_value posting from index
 // ============================================================================
 NostrDBError index_tag_delete(BTree* tree, uint8_t tag_name,
-                              const uint8_t tag_value[32], RecordId rid)
+                              const uint8_t tag_value[32], int64_t created_at,
+                              const IndexPosting* posting)
 {
   require_not_null(tree, NOSTR_DB_ERROR_NULL_PARAM);
   require_not_null(tag_value, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(posting, NOSTR_DB_ERROR_NULL_PARAM);
 
-  uint8_t key[33];
-  build_tag_key(tag_name, tag_value, key);
-  return btree_delete_dup(tree, key, rid);
+  uint8_t key[INDEX_TAG_KEY_SIZE];
+  build_tag_key(tag_name, tag_value, created_at, posting->rid, key);
+  return btree_delete(tree, key);
 }
@@ -28,4 +28,33 @@ void              nostr_db_result_free(NostrDBResultSet* result);
 NostrDBError nostr_db_query_execute(NostrDB* db, const NostrDBFilter* filter,
                                     NostrDBResultSet* result);
 
+// Visitor over matching records, newest first. record is the stored event
+// (EventRecord + content + tags) and is only valid during the call; return
+// false to stop the scan.
+typedef bool (*NostrDBRecordVisitor)(const uint8_t* record, uint16_t length,
+                                     void* ctx);
+
+// Query execution without materializing results: each live match is handed
+// to visit while its page is pinned, so callers can serialize in place
+NostrDBError nostr_db_query_visit(NostrDB* db, const NostrDBFilter* filter,
+                                  NostrDBRecordVisitor visit, void* ctx);
+
+// Visit the union of several filters (one REQ) newest first: each event is
+// visited once, and each filter contributes at most its own limit
+NostrDBError nostr_db_query_visit_all(NostrDB* db, const NostrDBFilter* filters,
+                                      size_t count, NostrDBRecordVisitor visit,
+                                      void* ctx);
+
+// Resumable form of nostr_db_query_visit_all. Opening runs the index phase;
+// each step then reads at most budget records (0 = no bound) and returns true
+// once the result is exhausted. A visitor returning false ends the step
+// without consuming the record, which is offered again by the next step.
+typedef struct NostrDBCursor NostrDBCursor;
+
+NostrDBError nostr_db_cursor_open(NostrDB* db, const NostrDBFilter* filters,
+                                  size_t count, NostrDBCursor** out);
+bool         nostr_db_cursor_step(NostrDBCursor* cursor, uint32_t budget,
+                                  NostrDBRecordVisitor visit, void* ctx);
+void         nostr_db_cursor_close(NostrDBCursor* cursor);
+
 #endif
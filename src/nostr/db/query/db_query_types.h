@@ -13,6 +13,7 @@
 #define NOSTR_DB_FILTER_MAX_TAG_VALUES 256
 #define NOSTR_DB_RESULT_DEFAULT_CAPACITY 100
 #define NOSTR_DB_QUERY_DEFAULT_LIMIT 500
+#define NOSTR_DB_QUERY_MAX_FILTERS 16  // Filters executed together (one REQ)
 
 // ============================================================================
 // Filter ID/Pubkey (32 bytes binary)
@@ -84,6 +85,8 @@ typedef enum {
   NOSTR_DB_QUERY_STRATEGY_BY_KIND,         // kinds only
   NOSTR_DB_QUERY_STRATEGY_BY_TAG,          // tag search
   NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN,   // fallback
+  NOSTR_DB_QUERY_STRATEGY_INTERSECT,       // two selective indexes joined
+  NOSTR_DB_QUERY_STRATEGY_COUNT,
 } NostrDBQueryStrategy;
 
 #endif
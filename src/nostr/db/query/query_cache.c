@@ -0,0 +1,493 @@
+#include "query_cache.h"
+
+#include "../../../arch/memory.h"
+#include "../../../arch/mmap.h"
+
+// ============================================================================
+// Internal: Allocate / free memory via anonymous mmap (zeroed)
+// ============================================================================
+static void* qc_alloc(size_t size)
+{
+  if (size == 0) return NULL;
+  void* ptr = internal_mmap(NULL, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) return NULL;
+  return ptr;
+}
+
+static void qc_free(void* ptr, size_t size)
+{
+  if (!is_null(ptr) && size > 0) {
+    internal_munmap(ptr, size);
+  }
+}
+
+// ============================================================================
+// query_cache_create
+// ============================================================================
+NostrDBError query_cache_create(size_t capacity, QueryCache** out)
+{
+  require_not_null(out, NOSTR_DB_ERROR_NULL_PARAM);
+  require(capacity > 0, NOSTR_DB_ERROR_NULL_PARAM);
+
+  *out = NULL;
+
+  size_t sets = 1;
+  while (sets * QUERY_CACHE_WAYS < capacity) {
+    sets <<= 1;
+  }
+  size_t entries = sets * QUERY_CACHE_WAYS;
+  require(entries * QUERY_CACHE_MAX_VALUES < QUERY_CACHE_NIL,
+          NOSTR_DB_ERROR_NULL_PARAM);
+
+  QueryCache* cache = (QueryCache*)qc_alloc(sizeof(QueryCache));
+  if (is_null(cache)) return NOSTR_DB_ERROR_MMAP_FAILED;
+
+  cache->sets            = sets;
+  cache->probes_capacity = entries * 2;
+  cache->entries = (QueryCacheEntry*)qc_alloc(sizeof(QueryCacheEntry) * entries);
+  cache->probes  = (uint32_t*)qc_alloc(sizeof(uint32_t) * cache->probes_capacity);
+  if (is_null(cache->entries) || is_null(cache->probes)) {
+    query_cache_destroy(cache);
+    return NOSTR_DB_ERROR_MMAP_FAILED;
+  }
+
+  for (size_t i = 0; i < cache->probes_capacity; i++) {
+    cache->probes[i] = QUERY_CACHE_NIL;
+  }
+
+  *out = cache;
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// query_cache_destroy
+// ============================================================================
+void query_cache_destroy(QueryCache* cache)
+{
+  if (is_null(cache)) return;
+  qc_free(cache->entries,
+          sizeof(QueryCacheEntry) * cache->sets * QUERY_CACHE_WAYS);
+  qc_free(cache->probes, sizeof(uint32_t) * cache->probes_capacity);
+  qc_free(cache, sizeof(QueryCache));
+}
+
+// ============================================================================
+// Internal: Insert item into a sorted array of count items (bytewise order),
+// skipping duplicates; returns the new count
+// ============================================================================
+static uint8_t insert_sorted(uint8_t* base, uint8_t count, const void* item,
+                             size_t size)
+{
+  uint8_t pos = 0;
+  while (pos < count) {
+    int32_t cmp = internal_memcmp(base + pos * size, item, size);
+    if (cmp == 0) return count;
+    if (cmp > 0) break;
+    pos++;
+  }
+
+  for (uint8_t i = count; i > pos; i--) {
+    internal_memcpy(base + i * size, base + (i - 1) * size, size);
+  }
+  internal_memcpy(base + pos * size, item, size);
+  return (uint8_t)(count + 1);
+}
+
+// ============================================================================
+// Internal: 0 and 32 (the whole key, as the relay's parser sets it) both mean
+// an exact id / pubkey
+// ============================================================================
+static inline bool exact_prefix(size_t prefix_len)
+{
+  return prefix_len == 0 || prefix_len == 32;
+}
+
+// ============================================================================
+// query_cache_key: Canonical key of a filter
+// ============================================================================
+bool query_cache_key(const NostrDBFilter* filter, QueryCacheKey* key)
+{
+  require_not_null(filter, false);
+  require_not_null(key, false);
+
+  // limit 0 always yields nothing; larger limits do not fit an entry
+  if (filter->limit == 0 || filter->limit > QUERY_CACHE_MAX_RESULTS ||
+      filter->ids_count > QUERY_CACHE_MAX_VALUES ||
+      filter->authors_count > QUERY_CACHE_MAX_VALUES ||
+      filter->kinds_count > QUERY_CACHE_MAX_VALUES ||
+      filter->tags_count > QUERY_CACHE_MAX_TAGS) {
+    return false;
+  }
+
+  internal_memset(key, 0, sizeof(QueryCacheKey));
+  key->since = filter->since;
+  key->until = filter->until;
+  key->limit = filter->limit;
+
+  for (size_t i = 0; i < filter->ids_count; i++) {
+    if (!exact_prefix(filter->ids[i].prefix_len)) return false;
+    key->ids_count = insert_sorted(&key->ids[0][0], key->ids_count,
+                                   filter->ids[i].value, 32);
+  }
+  for (size_t i = 0; i < filter->authors_count; i++) {
+    if (!exact_prefix(filter->authors[i].prefix_len)) return false;
+    key->authors_count = insert_sorted(&key->authors[0][0], key->authors_count,
+                                       filter->authors[i].value, 32);
+  }
+  for (size_t i = 0; i < filter->kinds_count; i++) {
+    key->kinds_count = insert_sorted((uint8_t*)key->kinds, key->kinds_count,
+                                     &filter->kinds[i], sizeof(uint32_t));
+  }
+
+  for (size_t i = 0; i < filter->tags_count; i++) {
+    const NostrDBFilterTag* ftag = &filter->tags[i];
+    if (ftag->values_count > QUERY_CACHE_MAX_VALUES) return false;
+
+    QueryCacheTag tag;
+    internal_memset(&tag, 0, sizeof(tag));
+    tag.name = ftag->name;
+    for (size_t v = 0; v < ftag->values_count; v++) {
+      tag.values_count = insert_sorted(&tag.values[0][0], tag.values_count,
+                                       ftag->values[v], 32);
+    }
+    key->tags_count = insert_sorted((uint8_t*)key->tags, key->tags_count,
+                                    &tag, sizeof(QueryCacheTag));
+  }
+
+  return true;
+}
+
+// ============================================================================
+// Internal: FNV-1a
+// ============================================================================
+static uint64_t fnv_update(uint64_t hash, const void* data, size_t size)
+{
+  const uint8_t* p = (const uint8_t*)data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static inline uint64_t key_hash(const QueryCacheKey* key)
+{
+  return fnv_update(14695981039346656037ULL, key, sizeof(QueryCacheKey));
+}
+
+// ============================================================================
+// Internal: The set a key hashes to; the live entry equal to key, or NULL
+// ============================================================================
+static inline QueryCacheEntry* set_for(const QueryCache* cache, uint64_t hash)
+{
+  return &cache->entries[(hash & (cache->sets - 1)) * QUERY_CACHE_WAYS];
+}
+
+static QueryCacheEntry* find_entry(QueryCache* cache, const QueryCacheKey* key,
+                                   uint64_t hash)
+{
+  QueryCacheEntry* set = set_for(cache, hash);
+  for (size_t way = 0; way < QUERY_CACHE_WAYS; way++) {
+    QueryCacheEntry* entry = &set[way];
+    if (entry->live && entry->hash == hash &&
+        internal_memcmp(&entry->key, key, sizeof(QueryCacheKey)) == 0) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+// ============================================================================
+// Internal: Probe values (what a write is looked up by)
+// ============================================================================
+typedef enum {
+  PROBE_ANY = 0,  // Filters without ids, authors, tags or kinds
+  PROBE_ID,
+  PROBE_AUTHOR,
+  PROBE_KIND,
+  PROBE_TAG,  // Tag name + first value in filter form (binary e / p, padded text)
+} ProbeType;
+
+static uint32_t probe_bucket(const QueryCache* cache, ProbeType type,
+                             char name, const void* value, size_t size)
+{
+  uint8_t  head[2] = {(uint8_t)type, (uint8_t)name};
+  uint64_t hash    = fnv_update(14695981039346656037ULL, head, sizeof(head));
+  hash             = fnv_update(hash, value, size);
+  return (uint32_t)(hash & (cache->probes_capacity - 1));
+}
+
+static inline uint32_t entry_index(const QueryCache* cache,
+                                   const QueryCacheEntry* entry)
+{
+  return (uint32_t)(entry - cache->entries);
+}
+
+static inline QueryCacheLink* link_at(QueryCache* cache, uint32_t link)
+{
+  return &cache->entries[link / QUERY_CACHE_MAX_VALUES]
+            .links[link % QUERY_CACHE_MAX_VALUES];
+}
+
+static void link_push(QueryCache* cache, QueryCacheEntry* entry,
+                      uint32_t bucket)
+{
+  uint32_t        id   = entry_index(cache, entry) * QUERY_CACHE_MAX_VALUES +
+                         entry->links_count;
+  QueryCacheLink* link = &entry->links[entry->links_count++];
+
+  link->bucket = bucket;
+  link->prev   = QUERY_CACHE_NIL;
+  link->next   = cache->probes[bucket];
+  if (link->next != QUERY_CACHE_NIL) {
+    link_at(cache, link->next)->prev = id;
+  }
+  cache->probes[bucket] = id;
+}
+
+static void links_clear(QueryCache* cache, QueryCacheEntry* entry)
+{
+  for (uint32_t i = 0; i < entry->links_count; i++) {
+    QueryCacheLink* link = &entry->links[i];
+    if (link->prev != QUERY_CACHE_NIL) {
+      link_at(cache, link->prev)->next = link->next;
+    } else {
+      cache->probes[link->bucket] = link->next;
+    }
+    if (link->next != QUERY_CACHE_NIL) {
+      link_at(cache, link->next)->prev = link->prev;
+    }
+  }
+  entry->links_count = 0;
+}
+
+// Link an entry under the values of its most selective predicate: a
+// matching event must carry one of them
+static void links_add(QueryCache* cache, QueryCacheEntry* entry)
+{
+  const QueryCacheKey* key = &entry->key;
+  if (key->ids_count > 0) {
+    for (uint8_t i = 0; i < key->ids_count; i++) {
+      link_push(cache, entry,
+                probe_bucket(cache, PROBE_ID, 0, key->ids[i], 32));
+    }
+  } else if (key->authors_count > 0) {
+    for (uint8_t i = 0; i < key->authors_count; i++) {
+      link_push(cache, entry,
+                probe_bucket(cache, PROBE_AUTHOR, 0, key->authors[i], 32));
+    }
+  } else if (key->tags_count > 0) {
+    const QueryCacheTag* tag = &key->tags[0];
+    for (uint8_t i = 0; i < tag->values_count; i++) {
+      link_push(cache, entry, probe_bucket(cache, PROBE_TAG, tag->name,
+                                           tag->values[i], 32));
+    }
+  } else if (key->kinds_count > 0) {
+    for (uint8_t i = 0; i < key->kinds_count; i++) {
+      link_push(cache, entry, probe_bucket(cache, PROBE_KIND, 0,
+                                           &key->kinds[i], sizeof(uint32_t)));
+    }
+  } else {
+    link_push(cache, entry, probe_bucket(cache, PROBE_ANY, 0, NULL, 0));
+  }
+}
+
+// ============================================================================
+// query_cache_lookup
+// ============================================================================
+bool query_cache_lookup(QueryCache* cache, const QueryCacheKey* key,
+                        QueryResultSet* rs)
+{
+  require_not_null(cache, false);
+  require_not_null(key, false);
+  require_not_null(rs, false);
+
+  QueryCacheEntry* entry = find_entry(cache, key, key_hash(key));
+  if (is_null(entry)) {
+    cache->misses++;
+    return false;
+  }
+
+  for (uint32_t i = 0; i < entry->count; i++) {
+    query_result_add(rs, entry->rids[i], entry->created_at[i]);
+  }
+  entry->used = ++cache->clock;
+  cache->hits++;
+  return true;
+}
+
+// ============================================================================
+// query_cache_store
+// ============================================================================
+void query_cache_store(QueryCache* cache, const QueryCacheKey* key,
+                       const QueryResultSet* rs)
+{
+  if (is_null(cache) || is_null(key) || is_null(rs)) return;
+  if (rs->count > QUERY_CACHE_MAX_RESULTS) return;
+
+  uint64_t         hash  = key_hash(key);
+  QueryCacheEntry* entry = find_entry(cache, key, hash);
+
+  // A free way of the set, else its least recently used one
+  QueryCacheEntry* set = set_for(cache, hash);
+  for (size_t way = 0; is_null(entry) && way < QUERY_CACHE_WAYS; way++) {
+    if (!set[way].live) entry = &set[way];
+  }
+  if (is_null(entry)) {
+    entry = &set[0];
+    for (size_t way = 1; way < QUERY_CACHE_WAYS; way++) {
+      if (set[way].used < entry->used) entry = &set[way];
+    }
+    cache->evictions++;
+  }
+
+  links_clear(cache, entry);
+  internal_memcpy(&entry->key, key, sizeof(QueryCacheKey));
+  entry->hash  = hash;
+  entry->used  = ++cache->clock;
+  entry->count = rs->count;
+  entry->live  = true;
+  internal_memcpy(entry->rids, rs->rids, rs->count * sizeof(RecordId));
+  internal_memcpy(entry->created_at, rs->created_at,
+                  rs->count * sizeof(int64_t));
+  links_add(cache, entry);
+}
+
+// ============================================================================
+// Internal: Whether an event satisfies every predicate of a key (the same
+// tests the query engine verifies records with)
+// ============================================================================
+static bool key_matches(const QueryCacheKey* key, const EventRecord* rec,
+                        const uint8_t* tags_data)
+{
+  if (key->since > 0 && rec->created_at < key->since) return false;
+  if (key->until > 0 && rec->created_at > key->until) return false;
+
+  if (key->kinds_count > 0) {
+    bool match = false;
+    for (uint8_t k = 0; k < key->kinds_count && !match; k++) {
+      match = rec->kind == key->kinds[k];
+    }
+    if (!match) return false;
+  }
+
+  if (key->authors_count > 0) {
+    bool match = false;
+    for (uint8_t k = 0; k < key->authors_count && !match; k++) {
+      match = internal_memcmp(rec->pubkey, key->authors[k], 32) == 0;
+    }
+    if (!match) return false;
+  }
+
+  if (key->ids_count > 0) {
+    bool match = false;
+    for (uint8_t k = 0; k < key->ids_count && !match; k++) {
+      match = internal_memcmp(rec->id, key->ids[k], 32) == 0;
+    }
+    if (!match) return false;
+  }
+
+  for (uint8_t t = 0; t < key->tags_count; t++) {
+    const QueryCacheTag* tag = &key->tags[t];
+    if (!query_tags_match(tags_data, rec->tags_length, tag->name, tag->values,
+                          tag->values_count)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// ============================================================================
+// Internal: Drop the live entries in one probe chain that the event changes
+// Invalidated entries stay linked until their slot is reused.
+// ============================================================================
+static void invalidate_chain(QueryCache* cache, uint32_t bucket,
+                             const EventRecord* rec, const uint8_t* tags_data)
+{
+  for (uint32_t id = cache->probes[bucket]; id != QUERY_CACHE_NIL;
+       id = link_at(cache, id)->next) {
+    QueryCacheEntry* entry = &cache->entries[id / QUERY_CACHE_MAX_VALUES];
+    if (!entry->live || !key_matches(&entry->key, rec, tags_data)) continue;
+
+    // A full result only changes for events that rank within it
+    if (entry->count >= entry->key.limit &&
+        rec->created_at < entry->created_at[entry->count - 1]) {
+      continue;
+    }
+
+    entry->live = false;
+    cache->invalidations++;
+  }
+}
+
+// ============================================================================
+// Internal: Probe the chain of each single-letter tag's first value, in the
+// form filters hold it (see query_tags_match)
+// ============================================================================
+static void invalidate_tags(QueryCache* cache, const EventRecord* rec,
+                            const uint8_t* tags_data)
+{
+  uint16_t tags_length = rec->tags_length;
+  if (tags_length < 2) return;
+
+  const uint8_t* ptr       = tags_data;
+  const uint8_t* end       = tags_data + tags_length;
+  uint16_t       tag_count = (uint16_t)(ptr[0] | (ptr[1] << 8));
+  ptr += 2;
+
+  for (uint16_t i = 0; i < tag_count && ptr + 2 <= end; i++) {
+    uint8_t value_count = *ptr++;
+    uint8_t name_len    = *ptr++;
+    if (ptr + name_len > end) return;
+    char name = name_len == 1 ? (char)ptr[0] : 0;
+    ptr += name_len;
+
+    for (uint8_t j = 0; j < value_count && ptr + 2 <= end; j++) {
+      uint16_t value_len = (uint16_t)(ptr[0] | (ptr[1] << 8));
+      ptr += 2;
+      if (ptr + value_len > end) return;
+
+      uint8_t value[32] = {0};
+      bool    probe     = false;
+      if (name != 0 && j == 0) {
+        if (name == 'e' || name == 'p') {
+          probe = value_len == 64 && query_hex_decode(ptr, value, 32);
+        } else if (value_len <= 32) {
+          internal_memcpy(value, ptr, value_len);
+          probe = true;
+        }
+      }
+      if (probe) {
+        invalidate_chain(cache,
+                         probe_bucket(cache, PROBE_TAG, name, value, 32),
+                         rec, tags_data);
+      }
+      ptr += value_len;
+    }
+  }
+}
+
+// ============================================================================
+// query_cache_invalidate
+// ============================================================================
+void query_cache_invalidate(QueryCache* cache, const uint8_t* record)
+{
+  if (is_null(cache) || is_null(record)) return;
+  cache->writes++;
+
+  const EventRecord* rec       = (const EventRecord*)record;
+  const uint8_t*     tags_data = record + sizeof(EventRecord) + rec->content_length;
+
+  invalidate_chain(cache, probe_bucket(cache, PROBE_ANY, 0, NULL, 0), rec,
+                   tags_data);
+  invalidate_chain(cache, probe_bucket(cache, PROBE_ID, 0, rec->id, 32), rec,
+                   tags_data);
+  invalidate_chain(cache, probe_bucket(cache, PROBE_AUTHOR, 0, rec->pubkey, 32),
+                   rec, tags_data);
+  invalidate_chain(cache,
+                   probe_bucket(cache, PROBE_KIND, 0, &rec->kind, sizeof(uint32_t)),
+                   rec, tags_data);
+  invalidate_tags(cache, rec, tags_data);
+}
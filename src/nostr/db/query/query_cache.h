@@ -0,0 +1,138 @@
+#ifndef NOSTR_DB_QUERY_CACHE_H_
+#define NOSTR_DB_QUERY_CACHE_H_
+
+#include "../../../util/types.h"
+#include "../db_types.h"
+#include "../record/record_types.h"
+#include "db_query_types.h"
+#include "query_engine.h"
+
+// ============================================================================
+// Query result cache
+//
+// Results of recent queries (record ids, newest first), keyed by the
+// canonical form of their filter: ids, authors, kinds, tags and tag values
+// sorted and deduplicated, so equal questions asked in any order share an
+// entry. Only small exact filters are cached (the profile, relay list and
+// feed-head lookups clients repeat on connect).
+//
+// Entries live in QUERY_CACHE_WAYS-way sets chosen by key hash, LRU within
+// a set. Each entry is also linked under the values of its most selective
+// predicate (its ids, else authors, else first tag, else kinds; a filter
+// with none of them under a catch-all probe). A write probes those chains
+// with the event's own id, pubkey, kind and tag values, confirms each
+// candidate with the query engine's record predicates, and drops it only if
+// the event could rank within its limit, so hits are always exact. Results
+// computed across a write (stepwise scans) are not stored.
+// ============================================================================
+#define QUERY_CACHE_MAX_VALUES 8  // Per ids / authors / kinds / tag filter
+#define QUERY_CACHE_MAX_TAGS 2
+#define QUERY_CACHE_MAX_RESULTS NOSTR_DB_QUERY_DEFAULT_LIMIT
+#define QUERY_CACHE_WAYS 4
+#define QUERY_CACHE_NIL 0xFFFFFFFFu
+
+typedef struct {
+  char    name;
+  uint8_t values_count;
+  uint8_t dummy[6];
+  uint8_t values[QUERY_CACHE_MAX_VALUES][32];  // Ascending
+} QueryCacheTag;
+
+// Canonical filter; fully zeroed before filling, so keys compare bytewise
+typedef struct {
+  int64_t       since;
+  int64_t       until;
+  uint32_t      limit;
+  uint8_t       ids_count;
+  uint8_t       authors_count;
+  uint8_t       kinds_count;
+  uint8_t       tags_count;
+  uint8_t       ids[QUERY_CACHE_MAX_VALUES][32];      // Ascending
+  uint8_t       authors[QUERY_CACHE_MAX_VALUES][32];  // Ascending
+  uint32_t      kinds[QUERY_CACHE_MAX_VALUES];        // Ascending
+  QueryCacheTag tags[QUERY_CACHE_MAX_TAGS];           // By name
+} QueryCacheKey;
+
+// One probe value of an entry, in a probe bucket chain
+// Link id = entry index * QUERY_CACHE_MAX_VALUES + value index
+typedef struct {
+  uint32_t bucket;
+  uint32_t prev;  // QUERY_CACHE_NIL = bucket head
+  uint32_t next;  // QUERY_CACHE_NIL = end
+} QueryCacheLink;
+
+typedef struct {
+  QueryCacheKey  key;
+  uint64_t       hash;
+  uint64_t       used;         // Clock at the last hit or store (LRU)
+  uint32_t       count;        // Cached results
+  bool           live;
+  uint32_t       links_count;  // Linked probe values (kept after invalidation)
+  QueryCacheLink links[QUERY_CACHE_MAX_VALUES];
+  RecordId       rids[QUERY_CACHE_MAX_RESULTS];
+  int64_t        created_at[QUERY_CACHE_MAX_RESULTS];
+} QueryCacheEntry;
+
+typedef struct {
+  QueryCacheEntry* entries;          // sets * QUERY_CACHE_WAYS
+  size_t           sets;             // Power of two
+  uint32_t*        probes;           // Probe bucket heads (link ids)
+  size_t           probes_capacity;  // Power of two
+  uint64_t         clock;
+  uint64_t         writes;           // Invalidation calls (one per write)
+  uint64_t         hits;
+  uint64_t         misses;           // Cacheable lookups that had to execute
+  uint64_t         invalidations;    // Entries dropped by writes
+  uint64_t         evictions;        // Entries dropped for space
+} QueryCache;
+
+// ============================================================================
+// Lifecycle
+// ============================================================================
+
+/**
+ * @brief Allocate a cache of at least capacity entries (rounded up to whole
+ * power-of-two sets)
+ */
+NostrDBError query_cache_create(size_t capacity, QueryCache** out);
+
+/**
+ * @brief Free the cache
+ */
+void query_cache_destroy(QueryCache* cache);
+
+// ============================================================================
+// Lookup and store
+// ============================================================================
+
+/**
+ * @brief Build the canonical key of a filter
+ * @return false if the filter is too large (or not exact) to cache
+ */
+bool query_cache_key(const NostrDBFilter* filter, QueryCacheKey* key);
+
+/**
+ * @brief Append the cached results for key to rs (sorted, limited)
+ * @return true on a hit
+ */
+bool query_cache_lookup(QueryCache* cache, const QueryCacheKey* key,
+                        QueryResultSet* rs);
+
+/**
+ * @brief Remember the executed results for key, evicting the least
+ * recently used entry of its set when full
+ */
+void query_cache_store(QueryCache* cache, const QueryCacheKey* key,
+                       const QueryResultSet* rs);
+
+// ============================================================================
+// Invalidation
+// ============================================================================
+
+/**
+ * @brief Drop the entries an inserted or deleted event could change
+ * @param record The event's record (EventRecord + content + tags)
+ */
+void query_cache_invalidate(QueryCache* cache, const uint8_t* record);
+
+#endif
@@ -1,332 +1,128 @@
 #include "query_engine.h"
 
 #include "../../../arch/memory.h"
+#include "../../../arch/mmap.h"
 #include "../../../util/string.h"
 #include "../record/record_manager.h"
 
 // ============================================================================
-// Callback context for collecting RecordIds from overflow chain scans
+// Work allowed in one scan step: each index entry, tree descent, overflow
+// page and record read costs a unit (limit 0 = unbounded)
 // ============================================================================
 typedef struct {
-  QueryResultSet* rs;
-  uint32_t        limit;
-  int64_t         since;
-  int64_t         until;
-  BufferPool*     pool;  // For reading created_at from records
-} ScanCtx;
+  uint32_t limit;
+  uint32_t spent;
+} QueryBudget;
 
-// ============================================================================
-// Internal: Read created_at from an EventRecord via RecordId
-// ============================================================================
-static int64_t read_created_at(BufferPool* pool, RecordId rid)
-{
-  if (is_null(pool)) return 0;
-
-  PageData* page = buffer_pool_pin(pool, rid.page_id);
-  if (is_null(page)) return 0;
-
-  // Read the slot entry to get offset
-  SlotPageHeader* hdr  = (SlotPageHeader*)page->data;
-  SlotEntry*      slot = (SlotEntry*)(page->data + SLOT_PAGE_HEADER_SIZE);
-
-  if (rid.slot_index >= hdr->slot_count) {
-    buffer_pool_unpin(pool, rid.page_id);
-    return 0;
-  }
-
-  uint16_t offset = slot[rid.slot_index].offset;
-  if (offset == 0) {
-    buffer_pool_unpin(pool, rid.page_id);
-    return 0;
-  }
-
-  // EventRecord starts at the offset within the page
-  EventRecord* rec = (EventRecord*)(page->data + offset);
-  int64_t      ts  = rec->created_at;
-  buffer_pool_unpin(pool, rid.page_id);
-  return ts;
-}
-
-// ============================================================================
-// Callback for btree_scan_key: collect RecordIds with time filtering
-// ============================================================================
-static bool scan_collect_cb(const void* key, const void* value, void* ud)
-{
-  (void)key;
-  ScanCtx*        ctx = (ScanCtx*)ud;
-  const RecordId* rid = (const RecordId*)value;
-
-  if (ctx->limit > 0 && ctx->rs->count >= ctx->limit) return false;
-
-  // Read created_at for time filtering
-  int64_t ts = 0;
-  if (!is_null(ctx->pool)) {
-    ts = read_created_at(ctx->pool, *rid);
-  }
-
-  // Apply time filters
-  if (ctx->since > 0 && ts < ctx->since) return true;  // skip, continue
-  if (ctx->until > 0 && ts > ctx->until) return true;  // skip, continue
-
-  query_result_add(ctx->rs, *rid, ts);
-
-  if (ctx->limit > 0 && ctx->rs->count >= ctx->limit) return false;
-  return true;
-}
-
-// ============================================================================
-// query_by_ids: Look up each ID in the unique ID index
-// ============================================================================
-NostrDBError query_by_ids(IndexManager* im, BufferPool* pool,
-                          const NostrDBFilter* filter, QueryResultSet* rs)
+static inline bool budget_exhausted(const QueryBudget* budget)
 {
-  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
-
-  uint32_t limit = filter->limit > 0 ? filter->limit
-                                     : NOSTR_DB_QUERY_DEFAULT_LIMIT;
-
-  for (size_t i = 0; i < filter->ids_count && rs->count < limit; i++) {
-    RecordId     rid;
-    NostrDBError err =
-      index_id_lookup(&im->id_index, filter->ids[i].value, &rid);
-    if (err != NOSTR_DB_OK) continue;
-
-    int64_t ts = read_created_at(pool, rid);
-
-    // Apply time filters
-    if (filter->since > 0 && ts < filter->since) continue;
-    if (filter->until > 0 && ts > filter->until) continue;
-
-    query_result_add(rs, rid, ts);
-  }
-
-  return NOSTR_DB_OK;
+  return !is_null(budget) && budget->limit > 0 &&
+         budget->spent >= budget->limit;
 }
 
-// ============================================================================
-// query_by_pubkey: Scan pubkey index for each author
-// ============================================================================
-NostrDBError query_by_pubkey(IndexManager* im, const NostrDBFilter* filter,
-                             QueryResultSet* rs)
+static inline void budget_charge(QueryBudget* budget, uint32_t units)
 {
-  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
-
-  uint32_t limit = filter->limit > 0 ? filter->limit
-                                     : NOSTR_DB_QUERY_DEFAULT_LIMIT;
-  ScanCtx  ctx   = {rs, limit, filter->since, filter->until, im->pool};
-
-  for (size_t i = 0; i < filter->authors_count && rs->count < limit; i++) {
-    ctx.limit = limit - rs->count;
-    btree_scan_key(&im->pubkey_index, filter->authors[i].value,
-                   scan_collect_cb, &ctx);
-  }
-
-  return NOSTR_DB_OK;
+  if (!is_null(budget)) budget->spent += units;
 }
 
 // ============================================================================
-// query_by_kind: Scan kind index for each kind
+// One input of a posting merge: a cursor over one prefix and its head entry
 // ============================================================================
-NostrDBError query_by_kind(IndexManager* im, const NostrDBFilter* filter,
-                           QueryResultSet* rs)
-{
-  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
-
-  uint32_t limit = filter->limit > 0 ? filter->limit
-                                     : NOSTR_DB_QUERY_DEFAULT_LIMIT;
-  ScanCtx  ctx   = {rs, limit, filter->since, filter->until, im->pool};
-
-  for (size_t i = 0; i < filter->kinds_count && rs->count < limit; i++) {
-    ctx.limit = limit - rs->count;
-    btree_scan_key(&im->kind_index, &filter->kinds[i], scan_collect_cb, &ctx);
-  }
-
-  return NOSTR_DB_OK;
-}
+typedef struct {
+  BTreeCursor  cursor;
+  uint8_t      max_key[INDEX_POSTING_MAX_KEY_SIZE];  // Cursor bound
+  uint8_t      key[INDEX_POSTING_MAX_KEY_SIZE];      // Head key
+  IndexPosting posting;                              // Head value
+  int64_t      created_at;                           // Head time
+  uint32_t     epoch;                                // Merge epoch of cursor
+} MergeLane;
 
 // ============================================================================
-// query_by_pubkey_kind: Scan composite pubkey+kind index
+// K-way merge over the newest-first postings of several prefixes
+// A heap on the head key suffix (created_at descending, then RecordId) yields
+// postings globally newest first, in the same total order for every index,
+// so merges over different indexes can be intersected in lockstep.
+// The tree may change between scan steps: each step bumps the epoch, and a
+// lane whose cursor is older is repositioned at its head key before it moves.
 // ============================================================================
-NostrDBError query_by_pubkey_kind(IndexManager*        im,
-                                  const NostrDBFilter* filter,
-                                  QueryResultSet*      rs)
-{
-  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
-
-  uint32_t limit = filter->limit > 0 ? filter->limit
-                                     : NOSTR_DB_QUERY_DEFAULT_LIMIT;
-  ScanCtx  ctx   = {rs, limit, filter->since, filter->until, im->pool};
-
-  for (size_t i = 0; i < filter->authors_count && rs->count < limit; i++) {
-    for (size_t j = 0; j < filter->kinds_count && rs->count < limit; j++) {
-      uint8_t key[36];
-      internal_memcpy(key, filter->authors[i].value, 32);
-      internal_memcpy(key + 32, &filter->kinds[j], sizeof(uint32_t));
-
-      ctx.limit = limit - rs->count;
-      btree_scan_key(&im->pubkey_kind_index, key, scan_collect_cb, &ctx);
-    }
-  }
-
-  return NOSTR_DB_OK;
-}
+typedef struct {
+  BTree*       tree;
+  uint16_t     prefix_size;
+  uint16_t     dummy;
+  uint32_t     epoch;
+  QueryBudget* budget;  // NULL = not metered
+  MergeLane*   lanes;
+  uint32_t*    heap;  // Lane indexes
+  size_t       lanes_count;
+  size_t       lanes_capacity;
+  size_t       heap_count;
+} PostingMerge;
 
 // ============================================================================
-// query_by_tag: Scan tag index for each tag name+value combination
+// Internal: Check the covered fields of a posting against the filter
+// Kinds are exact; authors are matched on the pubkey prefix only.
 // ============================================================================
-NostrDBError query_by_tag(IndexManager* im, const NostrDBFilter* filter,
-                          QueryResultSet* rs)
+static bool posting_matches(const NostrDBFilter* filter,
+                            const IndexPosting*  posting)
 {
-  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
-
-  // Collect more results than needed since multiple tag values may match
-  // different events. The final limit is applied after sort in query_execute.
-  uint32_t collect_limit = filter->limit > 0
-                             ? filter->limit * (uint32_t)filter->tags[0].values_count
-                             : NOSTR_DB_QUERY_DEFAULT_LIMIT;
-  if (collect_limit < NOSTR_DB_QUERY_DEFAULT_LIMIT) {
-    collect_limit = NOSTR_DB_QUERY_DEFAULT_LIMIT;
-  }
-  ScanCtx ctx = {rs, collect_limit, filter->since, filter->until, im->pool};
-
-  for (size_t i = 0; i < filter->tags_count; i++) {
-    const NostrDBFilterTag* tag = &filter->tags[i];
-
-    for (size_t j = 0; j < tag->values_count; j++) {
-      uint8_t key[33];
-      key[0] = (uint8_t)tag->name;
-      internal_memcpy(key + 1, tag->values[j], 32);
-
-      ctx.limit = collect_limit - rs->count;
-      if (ctx.limit == 0) break;
-      btree_scan_key(&im->tag_index, key, scan_collect_cb, &ctx);
+  if (filter->kinds_count > 0) {
+    bool match = false;
+    for (size_t k = 0; k < filter->kinds_count; k++) {
+      if (posting->kind == filter->kinds[k]) {
+        match = true;
+        break;
+      }
     }
+    if (!match) return false;
   }
 
-  return NOSTR_DB_OK;
-}
-
-// ============================================================================
-// Callback for timeline range scan (btree_range_scan)
-// The value in timeline B+ tree leaf is page_id_t (overflow chain head)
-// We need to walk the overflow chain for each key
-// ============================================================================
-typedef struct {
-  QueryResultSet* rs;
-  uint32_t        limit;
-  IndexManager*   im;
-} TimelineScanCtx;
-
-static bool timeline_range_cb(const void* key, const void* value, void* ud)
-{
-  TimelineScanCtx* ctx = (TimelineScanCtx*)ud;
-  if (ctx->limit > 0 && ctx->rs->count >= ctx->limit) return false;
-
-  int64_t encoded;
-  internal_memcpy(&encoded, key, sizeof(int64_t));
-  int64_t ts = timeline_key_decode(encoded);
-
-  // value is page_id_t (overflow chain head)
-  page_id_t chain_head;
-  internal_memcpy(&chain_head, value, sizeof(page_id_t));
-
-  if (chain_head == PAGE_ID_NULL) return true;
-
-  // Walk overflow chain
-  page_id_t pid = chain_head;
-  while (pid != PAGE_ID_NULL) {
-    PageData* page = buffer_pool_pin(ctx->im->pool, pid);
-    if (is_null(page)) break;
-
-    const BTreeOverflowHeader* hdr =
-      (const BTreeOverflowHeader*)page->data;
-
-    for (uint16_t i = 0; i < hdr->entry_count; i++) {
-      const uint8_t* base =
-        page->data + sizeof(BTreeOverflowHeader);
-      RecordId rid;
-      internal_memcpy(&rid, base + (uint32_t)i * sizeof(RecordId),
-                      sizeof(RecordId));
-
-      query_result_add(ctx->rs, rid, ts);
-
-      if (ctx->limit > 0 && ctx->rs->count >= ctx->limit) {
-        buffer_pool_unpin(ctx->im->pool, pid);
-        return false;
+  if (filter->authors_count > 0) {
+    bool match = false;
+    for (size_t k = 0; k < filter->authors_count; k++) {
+      if (internal_memcmp(posting->pubkey_prefix, filter->authors[k].value,
+                          INDEX_POSTING_PUBKEY_PREFIX_SIZE) == 0) {
+        match = true;
+        break;
       }
     }
-
-    page_id_t next = hdr->next_page;
-    buffer_pool_unpin(ctx->im->pool, pid);
-    pid = next;
+    if (!match) return false;
   }
 
   return true;
 }
 
 // ============================================================================
-// query_timeline_scan: Range scan over timeline index (descending order)
+// Internal: Convert hex char to value
 // ============================================================================
-NostrDBError query_timeline_scan(IndexManager* im, const NostrDBFilter* filter,
-                                 QueryResultSet* rs)
+static int32_t hex_val(uint8_t c)
 {
-  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
-
-  uint32_t limit = filter->limit > 0 ? filter->limit
-                                     : NOSTR_DB_QUERY_DEFAULT_LIMIT;
-
-  // Encode time range for descending B+ tree
-  // since=oldest, until=newest
-  // Encoded: INT64_MAX - ts, so newer = smaller key
-  // min_key = INT64_MAX - until (newest first)
-  // max_key = INT64_MAX - since (oldest last)
-  int64_t* min_key_ptr = NULL;
-  int64_t* max_key_ptr = NULL;
-  int64_t  min_key, max_key;
-
-  if (filter->until > 0) {
-    min_key     = timeline_key_encode(filter->until);
-    min_key_ptr = &min_key;
-  }
-  if (filter->since > 0) {
-    max_key     = timeline_key_encode(filter->since);
-    max_key_ptr = &max_key;
-  }
-
-  TimelineScanCtx ctx = {rs, limit, im};
-  return btree_range_scan(&im->timeline_index, min_key_ptr, max_key_ptr,
-                          timeline_range_cb, &ctx);
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
 }
 
 // ============================================================================
-// Internal: Convert hex char to value (for tag post-filter)
+// query_hex_decode: Hex text to bytes (tag values of 'e' / 'p')
 // ============================================================================
-static int32_t pf_hex_val(uint8_t c)
+bool query_hex_decode(const uint8_t* hex, uint8_t* out, size_t out_len)
 {
-  if (c >= '0' && c <= '9') return c - '0';
-  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
-  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
-  return -1;
+  for (size_t b = 0; b < out_len; b++) {
+    int32_t h = hex_val(hex[b * 2]);
+    int32_t l = hex_val(hex[b * 2 + 1]);
+    if (h < 0 || l < 0) return false;
+    out[b] = (uint8_t)((h << 4) | l);
+  }
+  return true;
 }
 
 // ============================================================================
-// Internal: Check if serialized tags match a single filter tag requirement
-// Returns true if the event's tags contain a match for the filter tag
+// query_tags_match: Check if serialized tags match a single tag requirement
+// Returns true if the event's tags contain a match for one of the values
 // ============================================================================
-static bool tags_match_filter_tag(const uint8_t* tags_data, uint16_t tags_length,
-                                  const NostrDBFilterTag* ftag)
+bool query_tags_match(const uint8_t* tags_data, uint16_t tags_length,
+                      char name, const uint8_t (*values)[32],
+                      size_t values_count)
 {
   if (is_null(tags_data) || tags_length < 2) return false;
 
@@ -343,7 +139,7 @@ static bool tags_match_filter_tag(const uint8_t* tags_data, uint16_t tags_length
     if (ptr + name_len > end) break;
 
     // Check if this tag name matches the filter tag name
-    bool name_matches = (name_len == 1 && ptr[0] == (uint8_t)ftag->name);
+    bool name_matches = (name_len == 1 && ptr[0] == (uint8_t)name);
     ptr += name_len;
 
     // Process values
@@ -356,34 +152,22 @@ static bool tags_match_filter_tag(const uint8_t* tags_data, uint16_t tags_length
       // Only check first value (index only indexes first value)
       if (name_matches && j == 0) {
         // Check against all filter values
-        for (size_t fvi = 0; fvi < ftag->values_count; fvi++) {
-          if (ftag->name == 'e' || ftag->name == 'p') {
+        for (size_t fvi = 0; fvi < values_count; fvi++) {
+          if (name == 'e' || name == 'p') {
             // Hex comparison: convert serialized value to binary
-            if (value_len == 64) {
-              uint8_t bin[32];
-              bool    valid = true;
-              for (size_t b = 0; b < 32; b++) {
-                int32_t h = pf_hex_val(ptr[b * 2]);
-                int32_t l = pf_hex_val(ptr[b * 2 + 1]);
-                if (h < 0 || l < 0) {
-                  valid = false;
-                  break;
-                }
-                bin[b] = (uint8_t)((h << 4) | l);
-              }
-              if (valid &&
-                  internal_memcmp(bin, ftag->values[fvi], 32) == 0) {
-                return true;
-              }
+            uint8_t bin[32];
+            if (value_len == 64 && query_hex_decode(ptr, bin, 32) &&
+                internal_memcmp(bin, values[fvi], 32) == 0) {
+              return true;
             }
           } else {
             // String comparison: filter value is zero-padded to 32 bytes
             size_t fval_len = 0;
-            while (fval_len < 32 && ftag->values[fvi][fval_len] != 0) {
+            while (fval_len < 32 && values[fvi][fval_len] != 0) {
               fval_len++;
             }
             if (value_len == fval_len &&
-                internal_memcmp(ptr, ftag->values[fvi], fval_len) == 0) {
+                internal_memcmp(ptr, values[fvi], fval_len) == 0) {
               return true;
             }
           }
@@ -398,185 +182,1447 @@ static bool tags_match_filter_tag(const uint8_t* tags_data, uint16_t tags_length
 }
 
 // ============================================================================
-// query_post_filter: Read EventRecord and verify against full filter
+// Internal: Verify a stored event (EventRecord + content + tags, len bytes)
+// against the filter; tags are checked only when check_tags is set
 // ============================================================================
-NostrDBError query_post_filter(BufferPool* pool, QueryResultSet* rs,
-                               const NostrDBFilter* filter)
+static bool record_matches(const uint8_t* buf, uint16_t len,
+                           const NostrDBFilter* filter, bool check_tags)
 {
-  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
-
-  uint32_t write = 0;
-  uint8_t  buf[4096];
-
-  for (uint32_t i = 0; i < rs->count; i++) {
-    uint16_t     len = sizeof(buf);
-    NostrDBError err = record_read(pool, rs->rids[i], buf, &len);
-    if (err != NOSTR_DB_OK || len < sizeof(EventRecord)) continue;
+  if (len < sizeof(EventRecord)) return false;
+  const EventRecord* rec = (const EventRecord*)buf;
 
-    EventRecord* rec = (EventRecord*)buf;
+  // Content and tags must lie within the record
+  if (sizeof(EventRecord) + (size_t)rec->content_length + rec->tags_length >
+      len) {
+    return false;
+  }
 
-    // Check deleted flag
-    if ((rec->flags & NOSTR_DB_EVENT_FLAG_DELETED) != 0) continue;
+  // Check deleted flag
+  if ((rec->flags & NOSTR_DB_EVENT_FLAG_DELETED) != 0) return false;
 
-    // Check time range
-    if (filter->since > 0 && rec->created_at < filter->since) continue;
-    if (filter->until > 0 && rec->created_at > filter->until) continue;
+  // Check time range
+  if (filter->since > 0 && rec->created_at < filter->since) return false;
+  if (filter->until > 0 && rec->created_at > filter->until) return false;
 
-    // Check kinds filter
-    if (filter->kinds_count > 0) {
-      bool match = false;
-      for (size_t k = 0; k < filter->kinds_count; k++) {
-        if (rec->kind == filter->kinds[k]) {
-          match = true;
-          break;
-        }
+  // Check kinds filter
+  if (filter->kinds_count > 0) {
+    bool match = false;
+    for (size_t k = 0; k < filter->kinds_count; k++) {
+      if (rec->kind == filter->kinds[k]) {
+        match = true;
+        break;
       }
-      if (!match) continue;
     }
+    if (!match) return false;
+  }
 
-    // Check authors filter
-    if (filter->authors_count > 0) {
-      bool match = false;
-      for (size_t k = 0; k < filter->authors_count; k++) {
-        if (internal_memcmp(rec->pubkey, filter->authors[k].value, 32) == 0) {
-          match = true;
-          break;
-        }
+  // Check authors filter
+  if (filter->authors_count > 0) {
+    bool match = false;
+    for (size_t k = 0; k < filter->authors_count; k++) {
+      if (internal_memcmp(rec->pubkey, filter->authors[k].value, 32) == 0) {
+        match = true;
+        break;
       }
-      if (!match) continue;
     }
+    if (!match) return false;
+  }
 
-    // Check IDs filter
-    if (filter->ids_count > 0) {
-      bool match = false;
-      for (size_t k = 0; k < filter->ids_count; k++) {
-        if (internal_memcmp(rec->id, filter->ids[k].value, 32) == 0) {
-          match = true;
-          break;
-        }
+  // Check IDs filter
+  if (filter->ids_count > 0) {
+    bool match = false;
+    for (size_t k = 0; k < filter->ids_count; k++) {
+      if (internal_memcmp(rec->id, filter->ids[k].value, 32) == 0) {
+        match = true;
+        break;
       }
-      if (!match) continue;
     }
+    if (!match) return false;
+  }
 
-    // Check tag filters (all tag filters must match - AND across different tags)
-    // Only apply when there are multiple DIFFERENT tag types (e.g., #e AND #t)
-    // When there's only one tag type with multiple values (e.g., #t:["a","b"]),
-    // the tag index scan already handles the OR correctly
-    if (filter->tags_count > 1) {
-      const uint8_t* tags_data   = buf + sizeof(EventRecord) + rec->content_length;
-      uint16_t       tags_length = rec->tags_length;
-
-      bool all_tags_match = true;
-      for (size_t ti = 0; ti < filter->tags_count; ti++) {
-        if (!tags_match_filter_tag(tags_data, tags_length, &filter->tags[ti])) {
-          all_tags_match = false;
-          break;
-        }
-      }
-      if (!all_tags_match) continue;
-    }
+  // Check tag filters (all tag filters must match - AND across different tags)
+  if (check_tags && filter->tags_count > 0) {
+    const uint8_t* tags_data   = buf + sizeof(EventRecord) + rec->content_length;
+    uint16_t       tags_length = rec->tags_length;
 
-    // Keep this result
-    if (write != i) {
-      rs->rids[write]       = rs->rids[i];
-      rs->created_at[write] = rs->created_at[i];
+    for (size_t ti = 0; ti < filter->tags_count; ti++) {
+      const NostrDBFilterTag* ftag = &filter->tags[ti];
+      if (!query_tags_match(tags_data, tags_length, ftag->name, ftag->values,
+                            ftag->values_count)) {
+        return false;
+      }
     }
-    write++;
   }
 
-  rs->count = write;
-  return NOSTR_DB_OK;
+  return true;
 }
 
 // ============================================================================
-// Internal: Validate filter for query execution
+// Internal: Read a record and verify it against the whole filter
+// created_at (optional) receives its timestamp
 // ============================================================================
-static bool filter_validate(const NostrDBFilter* filter)
+static bool record_verify(BufferPool* pool, RecordId rid,
+                          const NostrDBFilter* filter, int64_t* created_at)
 {
-  if (is_null(filter)) return false;
-  if (filter->ids_count > NOSTR_DB_FILTER_MAX_IDS) return false;
-  if (filter->authors_count > NOSTR_DB_FILTER_MAX_AUTHORS) return false;
-  if (filter->kinds_count > NOSTR_DB_FILTER_MAX_KINDS) return false;
-  if (filter->tags_count > NOSTR_DB_FILTER_MAX_TAGS) return false;
-  if (filter->since > 0 && filter->until > 0 && filter->since > filter->until)
+  uint8_t        scratch[8192];  // Spanned records are assembled here
+  const uint8_t* record;
+  uint16_t       len;
+  if (record_view(pool, rid, scratch, sizeof(scratch), &record, &len) !=
+      NOSTR_DB_OK) {
     return false;
-  return true;
+  }
+
+  bool match = record_matches(record, len, filter, true);
+  if (match && !is_null(created_at)) {
+    *created_at = ((const EventRecord*)record)->created_at;
+  }
+  record_release(pool, rid);
+  return match;
 }
 
 // ============================================================================
-// Internal: Select optimal query strategy
+// Internal: Read a candidate's record and verify it against the whole filter
+// (the predicates its index entry does not cover)
 // ============================================================================
-static NostrDBQueryStrategy select_strategy(const NostrDBFilter* filter)
+static bool residual_matches(IndexManager* im, RecordId rid,
+                             const NostrDBFilter* filter, QueryBudget* budget)
 {
-  if (filter->ids_count > 0) return NOSTR_DB_QUERY_STRATEGY_BY_ID;
-  if (filter->tags_count > 0) return NOSTR_DB_QUERY_STRATEGY_BY_TAG;
-  if (filter->authors_count > 0 && filter->kinds_count > 0)
-    return NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY_KIND;
-  if (filter->authors_count > 0) return NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY;
-  if (filter->kinds_count > 0) return NOSTR_DB_QUERY_STRATEGY_BY_KIND;
-  return NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN;
+  budget_charge(budget, 1);
+  return record_verify(im->pool, rid, filter, NULL);
 }
 
 // ============================================================================
-// query_execute: Select strategy and execute
+// Internal: Allocate / free merge state via anonymous mmap
 // ============================================================================
-NostrDBError query_execute(IndexManager* im, BufferPool* pool,
-                           const NostrDBFilter* filter, QueryResultSet* rs)
+static void* merge_alloc(size_t size)
 {
-  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
-  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+  void* ptr = internal_mmap(NULL, size, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return ptr == MAP_FAILED ? NULL : ptr;
+}
 
-  if (!filter_validate(filter)) {
-    return NOSTR_DB_ERROR_INVALID_EVENT;
+static void merge_free(void* ptr, size_t size)
+{
+  if (!is_null(ptr)) {
+    internal_munmap(ptr, size);
   }
+}
 
-  // If limit is explicitly 0, return empty result immediately
-  if (filter->limit == 0) {
-    return NOSTR_DB_OK;
+static NostrDBError merge_init(PostingMerge* m, BTree* tree,
+                               uint16_t prefix_size, size_t capacity)
+{
+  internal_memset(m, 0, sizeof(PostingMerge));
+  m->tree           = tree;
+  m->prefix_size    = prefix_size;
+  m->lanes_capacity = capacity > 0 ? capacity : 1;
+  m->lanes = (MergeLane*)merge_alloc(m->lanes_capacity * sizeof(MergeLane));
+  m->heap  = (uint32_t*)merge_alloc(m->lanes_capacity * sizeof(uint32_t));
+  if (is_null(m->lanes) || is_null(m->heap)) {
+    merge_free(m->lanes, m->lanes_capacity * sizeof(MergeLane));
+    merge_free(m->heap, m->lanes_capacity * sizeof(uint32_t));
+    return NOSTR_DB_ERROR_MMAP_FAILED;
   }
+  return NOSTR_DB_OK;
+}
 
-  NostrDBQueryStrategy strategy = select_strategy(filter);
-  NostrDBError         err      = NOSTR_DB_OK;
+static void merge_destroy(PostingMerge* m)
+{
+  merge_free(m->lanes, m->lanes_capacity * sizeof(MergeLane));
+  merge_free(m->heap, m->lanes_capacity * sizeof(uint32_t));
+  internal_memset(m, 0, sizeof(PostingMerge));
+}
 
-  switch (strategy) {
-    case NOSTR_DB_QUERY_STRATEGY_BY_ID:
-      err = query_by_ids(im, pool, filter, rs);
-      break;
-    case NOSTR_DB_QUERY_STRATEGY_BY_TAG:
-      err = query_by_tag(im, filter, rs);
-      break;
-    case NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY_KIND:
-      err = query_by_pubkey_kind(im, filter, rs);
-      break;
-    case NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY:
-      err = query_by_pubkey(im, filter, rs);
-      break;
-    case NOSTR_DB_QUERY_STRATEGY_BY_KIND:
-      err = query_by_kind(im, filter, rs);
-      break;
-    case NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN:
-    default:
-      err = query_timeline_scan(im, filter, rs);
-      break;
-  }
+// ============================================================================
+// Internal: Heap of lanes, earliest head suffix on top
+// ============================================================================
+static inline const uint8_t* merge_suffix(const PostingMerge* m,
+                                          const MergeLane*    lane)
+{
+  return lane->key + m->prefix_size;
+}
 
-  if (err != NOSTR_DB_OK) return err;
+static inline bool merge_before(const PostingMerge* m, size_t a, size_t b)
+{
+  const MergeLane* la = &m->lanes[m->heap[a]];
+  const MergeLane* lb = &m->lanes[m->heap[b]];
+  if (la->created_at != lb->created_at) return la->created_at > lb->created_at;
+  return internal_memcmp(merge_suffix(m, la) + 8, merge_suffix(m, lb) + 8,
+                         INDEX_POSTING_SUFFIX_SIZE - 8) < 0;
+}
 
-  // Post-filter if pool is available
-  if (!is_null(pool)) {
-    err = query_post_filter(pool, rs, filter);
-    if (err != NOSTR_DB_OK) return err;
+static void merge_sift_up(PostingMerge* m, size_t pos)
+{
+  while (pos > 0) {
+    size_t parent = (pos - 1) / 2;
+    if (!merge_before(m, pos, parent)) break;
+    uint32_t tmp    = m->heap[parent];
+    m->heap[parent] = m->heap[pos];
+    m->heap[pos]    = tmp;
+    pos             = parent;
   }
+}
 
-  // Sort by created_at (newest first)
-  query_result_sort(rs);
+static void merge_sift_down(PostingMerge* m, size_t pos)
+{
+  for (;;) {
+    size_t left  = pos * 2 + 1;
+    size_t right = left + 1;
+    size_t first = pos;
+    if (left < m->heap_count && merge_before(m, left, first)) {
+      first = left;
+    }
+    if (right < m->heap_count && merge_before(m, right, first)) {
+      first = right;
+    }
+    if (first == pos) break;
+    uint32_t tmp   = m->heap[first];
+    m->heap[first] = m->heap[pos];
+    m->heap[pos]   = tmp;
+    pos            = first;
+  }
+}
+
+// ============================================================================
+// Internal: Load the next posting of a lane as its head
+// A cursor from an earlier step is reopened at the head key first; if the
+// head is gone by then, the posting that took its place is the next one.
+// ============================================================================
+static bool merge_lane_advance(PostingMerge* m, MergeLane* lane)
+{
+  uint8_t key[INDEX_POSTING_MAX_KEY_SIZE];
+  size_t  key_size = m->prefix_size + INDEX_POSTING_SUFFIX_SIZE;
+
+  if (lane->epoch != m->epoch) {
+    lane->epoch = m->epoch;
+    budget_charge(m->budget, 1);
+    IndexPosting posting;
+    if (btree_cursor_open(&lane->cursor, m->tree, lane->key, lane->max_key) !=
+          NOSTR_DB_OK ||
+        !btree_cursor_next(&lane->cursor, key, &posting)) {
+      return false;
+    }
+    if (internal_memcmp(key, lane->key, key_size) != 0) {
+      internal_memcpy(lane->key, key, key_size);
+      lane->posting    = posting;
+      lane->created_at = index_posting_get_time(lane->key + m->prefix_size);
+      return true;
+    }
+  }
+
+  budget_charge(m->budget, 1);
+  if (!btree_cursor_next(&lane->cursor, lane->key, &lane->posting)) {
+    return false;
+  }
+  lane->created_at = index_posting_get_time(lane->key + m->prefix_size);
+  return true;
+}
+
+// ============================================================================
+// Internal: Advance the top lane by one posting
+// ============================================================================
+static void merge_next(PostingMerge* m)
+{
+  MergeLane* lane = &m->lanes[m->heap[0]];
+  if (!merge_lane_advance(m, lane)) {
+    m->heap[0] = m->heap[--m->heap_count];
+  }
+  merge_sift_down(m, 0);
+}
+
+// ============================================================================
+// Internal: Advance every lane to its first posting at or after the target
+// suffix (strictly after it with past set)
+// A lane just behind the target takes one step; one further behind reopens
+// its cursor at the target, so a sparse side skips a dense one in O(log n)
+// per jump instead of reading every posting in between.
+// ============================================================================
+static void merge_seek(PostingMerge* m, const uint8_t* target, bool past,
+                       QueryResultSet* rs)
+{
+  int32_t bound = past ? 1 : 0;
+  while (m->heap_count > 0) {
+    MergeLane* lane = &m->lanes[m->heap[0]];
+    if (internal_memcmp(merge_suffix(m, lane), target,
+                        INDEX_POSTING_SUFFIX_SIZE) >= bound) {
+      break;
+    }
+
+    rs->examined++;
+    bool more = merge_lane_advance(m, lane);
+    if (more && internal_memcmp(merge_suffix(m, lane), target,
+                                INDEX_POSTING_SUFFIX_SIZE) < 0) {
+      uint8_t min_key[INDEX_POSTING_MAX_KEY_SIZE];
+      internal_memcpy(min_key, lane->key, m->prefix_size);
+      internal_memcpy(min_key + m->prefix_size, target,
+                      INDEX_POSTING_SUFFIX_SIZE);
+      rs->examined++;
+      budget_charge(m->budget, 1);
+      more = btree_cursor_open(&lane->cursor, m->tree, min_key,
+                               lane->max_key) == NOSTR_DB_OK &&
+             merge_lane_advance(m, lane);
+    }
+
+    if (!more) m->heap[0] = m->heap[--m->heap_count];
+    merge_sift_down(m, 0);
+  }
+}
+
+// ============================================================================
+// Internal: Open a lane over one prefix within the [since, until] window
+// ============================================================================
+static void merge_add(PostingMerge* m, const uint8_t* prefix,
+                      const NostrDBFilter* filter)
+{
+  if (m->lanes_count >= m->lanes_capacity) return;
+
+  uint32_t   index = (uint32_t)m->lanes_count;
+  MergeLane* lane  = &m->lanes[index];
+
+  uint8_t min_key[INDEX_POSTING_MAX_KEY_SIZE];
+  index_posting_bounds(min_key, lane->max_key, prefix, m->prefix_size,
+                       filter->since, filter->until);
+  budget_charge(m->budget, 1);
+  if (btree_cursor_open(&lane->cursor, m->tree, min_key, lane->max_key) !=
+      NOSTR_DB_OK) {
+    return;
+  }
+  lane->epoch = m->epoch;
+  m->lanes_count++;
+
+  if (merge_lane_advance(m, lane)) {
+    m->heap[m->heap_count++] = index;
+    merge_sift_up(m, m->heap_count - 1);
+  }
+}
+
+// ============================================================================
+// Internal: Drain the merge into the result set, newest first
+// The [since, until] window is already applied by the lane bounds, created_at
+// comes from the key and kind / author from the covering value, so no record
+// page is touched unless residual is set. Heads come out in global time
+// order, so once one cannot beat the k-th newest result the merge is done:
+// a query reads about top_k + lanes postings however many events the
+// prefixes hold. Returns false if the budget ran out first.
+// ============================================================================
+static bool merge_collect(PostingMerge* m, IndexManager* im,
+                          const NostrDBFilter* filter, bool residual,
+                          QueryResultSet* rs)
+{
+  while (m->heap_count > 0) {
+    if (budget_exhausted(m->budget)) return false;
+
+    MergeLane* lane = &m->lanes[m->heap[0]];
+
+    rs->examined++;
+    if (!query_result_accepts(rs, lane->created_at)) break;
+
+    if (posting_matches(filter, &lane->posting) &&
+        (!residual ||
+         residual_matches(im, lane->posting.rid, filter, m->budget))) {
+      query_result_add(rs, lane->posting.rid, lane->created_at);
+    }
+
+    merge_next(m);
+  }
+  return true;
+}
+
+// ============================================================================
+// Internal: Drain the intersection of several merges into the result set
+// Leapfrog join: the input whose head is furthest along names the target,
+// the others seek to it, and when every head agrees the event is in all of
+// them. The inputs share one total order, so the join is newest first and
+// stops like merge_collect once the target cannot enter the top k. Postings
+// repeated within an input (an event carrying two of a tag's values) are
+// skipped past after a match. Returns false if the budget ran out first.
+// ============================================================================
+static bool intersect_collect(PostingMerge* inputs, size_t count,
+                              IndexManager* im, const NostrDBFilter* filter,
+                              bool residual, QueryResultSet* rs)
+{
+  uint8_t target[INDEX_POSTING_SUFFIX_SIZE];
+
+  for (;;) {
+    if (budget_exhausted(inputs[0].budget)) return false;
+
+    const MergeLane* lead = NULL;
+    for (size_t i = 0; i < count; i++) {
+      PostingMerge* m = &inputs[i];
+      if (m->heap_count == 0) return true;
+      const MergeLane* head = &m->lanes[m->heap[0]];
+      if (is_null(lead) ||
+          internal_memcmp(merge_suffix(m, head), target,
+                          INDEX_POSTING_SUFFIX_SIZE) > 0) {
+        lead = head;
+        internal_memcpy(target, merge_suffix(m, head),
+                        INDEX_POSTING_SUFFIX_SIZE);
+      }
+    }
+    if (!query_result_accepts(rs, lead->created_at)) return true;
+
+    bool aligned = true;
+    for (size_t i = 0; i < count; i++) {
+      PostingMerge* m = &inputs[i];
+      merge_seek(m, target, false, rs);
+      if (m->heap_count == 0) return true;
+      if (internal_memcmp(merge_suffix(m, &m->lanes[m->heap[0]]), target,
+                          INDEX_POSTING_SUFFIX_SIZE) != 0) {
+        aligned = false;
+      }
+    }
+    if (!aligned) continue;
+
+    // Every input holds this event; any one posting covers kind / author
+    const MergeLane* lane = &inputs[0].lanes[inputs[0].heap[0]];
+    rs->examined++;
+    if (posting_matches(filter, &lane->posting) &&
+        (!residual ||
+         residual_matches(im, lane->posting.rid, filter, inputs[0].budget))) {
+      query_result_add(rs, lane->posting.rid, lane->created_at);
+    }
+    merge_seek(&inputs[0], target, true, rs);
+  }
+}
+
+// ============================================================================
+// Internal: True if candidates of a strategy must be verified on their
+// records while scanning, so the top k only ever holds real matches
+// Postings enforce since/until and kinds exactly, and authors by prefix; the
+// timeline enforces since/until only. Deleted events are removed from every
+// index except the ID index, whose results are post-filtered instead.
+// ============================================================================
+static bool needs_residual(NostrDBQueryStrategy strategy,
+                           const NostrDBFilter* filter)
+{
+  switch (strategy) {
+    case NOSTR_DB_QUERY_STRATEGY_BY_ID:
+      return false;
+    case NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY:
+    case NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY_KIND:
+      return filter->tags_count > 0;
+    case NOSTR_DB_QUERY_STRATEGY_BY_KIND:
+      return filter->tags_count > 0 || filter->authors_count > 0;
+    case NOSTR_DB_QUERY_STRATEGY_BY_TAG:
+      return filter->tags_count > 1 || filter->authors_count > 0;
+    case NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN:
+    default:
+      return filter->kinds_count > 0 || filter->authors_count > 0 ||
+             filter->tags_count > 0;
+  }
+}
+
+// ============================================================================
+// Internal: needs_residual for an intersection: predicates none of the joined
+// families covers exactly (tag filters left out, authors without an author
+// family) are verified on the records
+// ============================================================================
+static bool intersect_needs_residual(const NostrDBFilter* filter,
+                                     uint32_t             inputs)
+{
+  if (filter->authors_count > 0 &&
+      (inputs & (NOSTR_DB_QUERY_INPUT_PUBKEY |
+                 NOSTR_DB_QUERY_INPUT_PUBKEY_KIND)) == 0) {
+    return true;
+  }
+  for (size_t i = 0; i < filter->tags_count; i++) {
+    if ((inputs & NOSTR_DB_QUERY_INPUT_TAG(i)) == 0) return true;
+  }
+  return false;
+}
+
+// ============================================================================
+// Internal: Estimated postings under the values of one tag filter
+// ============================================================================
+static uint64_t tag_postings(const IndexStats* stats,
+                             const NostrDBFilterTag* tag)
+{
+  uint64_t count = 0;
+  for (size_t j = 0; j < tag->values_count; j++) {
+    uint8_t prefix[33];
+    prefix[0] = (uint8_t)tag->name;
+    internal_memcpy(prefix + 1, tag->values[j], 32);
+    count += index_stats_key_count(stats, INDEX_STATS_TAG, prefix, 33);
+  }
+  return count;
+}
+
+// ============================================================================
+// Internal: The tag filter with the fewest postings (the first one without
+// statistics); the others are verified on the records
+// ============================================================================
+static size_t cheapest_tag(const IndexManager* im, const NostrDBFilter* filter)
+{
+  size_t   best       = 0;
+  uint64_t best_count = UINT64_MAX;
+  if (is_null(im->stats) || im->stats->data.events == 0) return best;
+
+  for (size_t i = 0; i < filter->tags_count; i++) {
+    uint64_t count = tag_postings(im->stats, &filter->tags[i]);
+    if (count < best_count) {
+      best       = i;
+      best_count = count;
+    }
+  }
+  return best;
+}
+
+// ============================================================================
+// Internal: The index, prefix size and prefix count of one merge input
+// (NOSTR_DB_QUERY_INPUT_*); NULL for a tag input the filter does not have
+// ============================================================================
+static BTree* input_index(IndexManager* im, const NostrDBFilter* filter,
+                          uint32_t input, uint16_t* prefix_size,
+                          size_t* prefixes)
+{
+  if (input == NOSTR_DB_QUERY_INPUT_PUBKEY) {
+    *prefix_size = 32;
+    *prefixes    = filter->authors_count;
+    return &im->pubkey_index;
+  }
+  if (input == NOSTR_DB_QUERY_INPUT_KIND) {
+    *prefix_size = 4;
+    *prefixes    = filter->kinds_count;
+    return &im->kind_index;
+  }
+  if (input == NOSTR_DB_QUERY_INPUT_PUBKEY_KIND) {
+    *prefix_size = 36;
+    *prefixes    = filter->authors_count * filter->kinds_count;
+    return &im->pubkey_kind_index;
+  }
+  for (size_t t = 0; t < filter->tags_count; t++) {
+    if (input != NOSTR_DB_QUERY_INPUT_TAG(t)) continue;
+    *prefix_size = 33;
+    *prefixes    = filter->tags[t].values_count;
+    return &im->tag_index;
+  }
+  return NULL;
+}
+
+// ============================================================================
+// Internal: Prefix i of one merge input (every kind of an author in turn for
+// pubkey+kind)
+// ============================================================================
+static void input_prefix(const NostrDBFilter* filter, uint32_t input,
+                         size_t i, uint8_t* prefix)
+{
+  if (input == NOSTR_DB_QUERY_INPUT_PUBKEY) {
+    internal_memcpy(prefix, filter->authors[i].value, 32);
+    return;
+  }
+  if (input == NOSTR_DB_QUERY_INPUT_KIND) {
+    index_put_be32(prefix, filter->kinds[i]);
+    return;
+  }
+  if (input == NOSTR_DB_QUERY_INPUT_PUBKEY_KIND) {
+    internal_memcpy(prefix, filter->authors[i / filter->kinds_count].value, 32);
+    index_put_be32(prefix + 32, filter->kinds[i % filter->kinds_count]);
+    return;
+  }
+  for (size_t t = 0; t < filter->tags_count; t++) {
+    if (input != NOSTR_DB_QUERY_INPUT_TAG(t)) continue;
+    prefix[0] = (uint8_t)filter->tags[t].name;
+    internal_memcpy(prefix + 1, filter->tags[t].values[i], 32);
+    return;
+  }
+}
+
+// ============================================================================
+// QueryScan: one filter's access path, run a budget at a time
+// Between steps the merge lanes keep their head keys, the timeline scan its
+// next key and the result set the partial top k; no page stays pinned.
+// ============================================================================
+#define QUERY_INTERSECT_MAX_INPUTS (3 + NOSTR_DB_FILTER_MAX_TAGS)
+
+struct QueryScan {
+  IndexManager*        im;
+  BufferPool*          pool;
+  const NostrDBFilter* filter;
+  QueryResultSet*      rs;
+  NostrDBQueryStrategy strategy;
+  NostrDBError         err;  // First failure; the scan stops there
+  uint32_t             inputs[QUERY_INTERSECT_MAX_INPUTS];  // Merged families
+  PostingMerge         merges[QUERY_INTERSECT_MAX_INPUTS];
+  size_t               inputs_count;
+  size_t               opened;    // Merges with every lane open
+  size_t               prefixes;  // Lanes of merges[opened] open so far
+  size_t               next_id;   // BY_ID: next id to look up
+  int64_t              next_key;  // TIMELINE_SCAN: first key left to read
+  int64_t              max_key;   // TIMELINE_SCAN: last key (since)
+  bool                 has_next_key;
+  bool                 has_max_key;
+  bool                 residual;  // Verify candidates on their records
+  bool                 finish;    // Post-filter, sort and limit once done
+  bool                 done;
+  QueryBudget          budget;
+};
+
+// ============================================================================
+// Internal: Prepare a scan of one strategy (inputs: INTERSECT families)
+// ============================================================================
+static void scan_init(QueryScan* scan, IndexManager* im, BufferPool* pool,
+                      const NostrDBFilter* filter, QueryResultSet* rs,
+                      NostrDBQueryStrategy strategy, uint32_t inputs)
+{
+  internal_memset(scan, 0, sizeof(QueryScan));
+  scan->im       = im;
+  scan->pool     = pool;
+  scan->filter   = filter;
+  scan->rs       = rs;
+  scan->strategy = strategy;
 
-  // Apply limit
   uint32_t limit = filter->limit > 0 ? filter->limit
                                      : NOSTR_DB_QUERY_DEFAULT_LIMIT;
-  query_result_apply_limit(rs, limit);
+  query_result_set_top_k(rs, limit);
 
-  return NOSTR_DB_OK;
+  switch (strategy) {
+    case NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY:
+      inputs = NOSTR_DB_QUERY_INPUT_PUBKEY;
+      break;
+    case NOSTR_DB_QUERY_STRATEGY_BY_KIND:
+      inputs = NOSTR_DB_QUERY_INPUT_KIND;
+      break;
+    case NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY_KIND:
+      inputs = NOSTR_DB_QUERY_INPUT_PUBKEY_KIND;
+      break;
+    case NOSTR_DB_QUERY_STRATEGY_BY_TAG:
+      // The most selective tag filter; any others are verified on the records
+      inputs = filter->tags_count > 0
+                 ? NOSTR_DB_QUERY_INPUT_TAG(cheapest_tag(im, filter))
+                 : 0;
+      break;
+    case NOSTR_DB_QUERY_STRATEGY_INTERSECT:
+      break;
+    default:
+      inputs = 0;
+      break;
+  }
+  for (uint32_t bit = 0; bit < QUERY_INTERSECT_MAX_INPUTS; bit++) {
+    if (inputs & (1u << bit)) scan->inputs[scan->inputs_count++] = 1u << bit;
+  }
+  scan->residual = strategy == NOSTR_DB_QUERY_STRATEGY_INTERSECT
+                     ? intersect_needs_residual(filter, inputs)
+                     : needs_residual(strategy, filter);
+
+  // Timeline keys are INT64_MAX - ts, so until bounds the start (newest
+  // first) and since the end
+  if (filter->until > 0) {
+    scan->next_key     = timeline_key_encode(filter->until);
+    scan->has_next_key = true;
+  }
+  if (filter->since > 0) {
+    scan->max_key     = timeline_key_encode(filter->since);
+    scan->has_max_key = true;
+  }
+}
+
+static void scan_release(QueryScan* scan)
+{
+  for (size_t i = 0; i < scan->inputs_count; i++) {
+    merge_destroy(&scan->merges[i]);
+  }
+}
+
+// ============================================================================
+// Internal: Look up each ID in the unique ID index
+// ============================================================================
+static bool scan_ids(QueryScan* scan)
+{
+  const NostrDBFilter* filter = scan->filter;
+
+  for (; scan->next_id < filter->ids_count; scan->next_id++) {
+    if (budget_exhausted(&scan->budget)) return false;
+
+    RecordId rid;
+    budget_charge(&scan->budget, 1);
+    NostrDBError err =
+      index_id_lookup(&scan->im->id_index, filter->ids[scan->next_id].value,
+                      &rid);
+    if (err != NOSTR_DB_OK) continue;
+    scan->rs->examined++;
+
+    // The whole filter is verified before the candidate takes a top-k place
+    budget_charge(&scan->budget, 1);
+    int64_t ts;
+    if (!record_verify(scan->pool, rid, filter, &ts)) continue;
+
+    query_result_add(scan->rs, rid, ts);
+  }
+  return true;
+}
+
+// ============================================================================
+// Internal: Open the lanes of every merge input, then drain the merge (one
+// input) or their intersection (several)
+// ============================================================================
+static bool scan_merges(QueryScan* scan)
+{
+  while (scan->opened < scan->inputs_count) {
+    PostingMerge* m     = &scan->merges[scan->opened];
+    uint32_t      input = scan->inputs[scan->opened];
+    uint16_t      prefix_size;
+    size_t        prefixes;
+    BTree*        tree =
+      input_index(scan->im, scan->filter, input, &prefix_size, &prefixes);
+    if (is_null(tree)) {
+      scan->err = NOSTR_DB_ERROR_INVALID_EVENT;
+      return true;
+    }
+
+    if (is_null(m->lanes)) {
+      scan->err = merge_init(m, tree, prefix_size, prefixes);
+      if (scan->err != NOSTR_DB_OK) return true;
+      m->budget = &scan->budget;
+    }
+    for (; scan->prefixes < prefixes; scan->prefixes++) {
+      if (budget_exhausted(&scan->budget)) return false;
+      uint8_t prefix[INDEX_POSTING_MAX_KEY_SIZE];
+      input_prefix(scan->filter, input, scan->prefixes, prefix);
+      merge_add(m, prefix, scan->filter);
+    }
+
+    scan->opened++;
+    scan->prefixes = 0;
+  }
+
+  if (scan->inputs_count == 0) return true;
+  if (scan->inputs_count == 1) {
+    return merge_collect(&scan->merges[0], scan->im, scan->filter,
+                         scan->residual, scan->rs);
+  }
+  return intersect_collect(scan->merges, scan->inputs_count, scan->im,
+                           scan->filter, scan->residual, scan->rs);
+}
+
+// ============================================================================
+// Internal: Collect the events of one timeline key
+// The value in timeline B+ tree leaf is page_id_t (overflow chain head)
+// We need to walk the overflow chain for each key
+// ============================================================================
+typedef struct {
+  QueryResultSet*      rs;
+  IndexManager*        im;
+  const NostrDBFilter* filter;
+  bool                 residual;  // Verify each entry on its record
+  QueryBudget*         budget;
+} TimelineScanCtx;
+
+static bool timeline_collect(TimelineScanCtx* ctx, int64_t encoded,
+                             page_id_t chain_head)
+{
+  int64_t ts = timeline_key_decode(encoded);
+
+  // Keys ascend as INT64_MAX - ts, i.e. newest first: once this key cannot
+  // beat the k-th newest result, no later key can either
+  if (!query_result_accepts(ctx->rs, ts)) return false;
+
+  if (chain_head == PAGE_ID_NULL) return true;
+
+  // Walk overflow chain
+  page_id_t pid = chain_head;
+  while (pid != PAGE_ID_NULL) {
+    budget_charge(ctx->budget, 1);
+    PageData* page = buffer_pool_pin(ctx->im->pool, pid);
+    if (is_null(page)) break;
+
+    const BTreeOverflowHeader* hdr =
+      (const BTreeOverflowHeader*)page->data;
+
+    for (uint16_t i = 0; i < hdr->entry_count; i++) {
+      const uint8_t* base =
+        page->data + sizeof(BTreeOverflowHeader);
+      RecordId rid;
+      internal_memcpy(&rid, base + (uint32_t)i * sizeof(RecordId),
+                      sizeof(RecordId));
+
+      ctx->rs->examined++;
+      budget_charge(ctx->budget, 1);
+      if (!ctx->residual ||
+          residual_matches(ctx->im, rid, ctx->filter, ctx->budget)) {
+        query_result_add(ctx->rs, rid, ts);
+      }
+
+      if (!query_result_accepts(ctx->rs, ts)) {
+        buffer_pool_unpin(ctx->im->pool, pid);
+        return false;
+      }
+    }
+
+    page_id_t next = hdr->next_page;
+    buffer_pool_unpin(ctx->im->pool, pid);
+    pid = next;
+  }
+
+  return true;
+}
+
+// ============================================================================
+// Internal: Walk the timeline index newest first, a whole key (one second of
+// events) at a time, from the first key not read yet
+// ============================================================================
+static bool scan_timeline(QueryScan* scan)
+{
+  BTreeCursor cursor;
+  budget_charge(&scan->budget, 1);
+  scan->err = btree_cursor_open(&cursor, &scan->im->timeline_index,
+                                scan->has_next_key ? &scan->next_key : NULL,
+                                scan->has_max_key ? &scan->max_key : NULL);
+  if (scan->err != NOSTR_DB_OK) return true;
+
+  TimelineScanCtx ctx = {scan->rs, scan->im, scan->filter, scan->residual,
+                         &scan->budget};
+  while (!budget_exhausted(&scan->budget)) {
+    int64_t   key;
+    page_id_t chain_head;
+    if (!btree_cursor_next(&cursor, &key, &chain_head) ||
+        !timeline_collect(&ctx, key, chain_head) || key == INT64_MAX) {
+      return true;
+    }
+    scan->next_key     = key + 1;
+    scan->has_next_key = true;
+  }
+  return false;
+}
+
+// ============================================================================
+// Internal: Run a scan for up to budget units; true once it is complete
+// ============================================================================
+static bool scan_step(QueryScan* scan, uint32_t budget)
+{
+  scan->budget.limit = budget;
+  scan->budget.spent = 0;
+  if (scan->done) return true;
+
+  // Lane cursors positioned in earlier steps may be stale
+  for (size_t i = 0; i < scan->inputs_count; i++) {
+    scan->merges[i].epoch++;
+  }
+
+  bool done;
+  switch (scan->strategy) {
+    case NOSTR_DB_QUERY_STRATEGY_BY_ID:
+      done = scan_ids(scan);
+      break;
+    case NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN:
+      done = scan_timeline(scan);
+      break;
+    default:
+      done = scan_merges(scan);
+      break;
+  }
+  if (!done) return false;
+  scan->done = true;
+
+  if (scan->err != NOSTR_DB_OK || !scan->finish) return true;
+
+  // Every path only collected candidates that match the whole filter
+  // Sort by created_at (newest first)
+  query_result_sort(scan->rs);
+
+  // Apply limit
+  uint32_t limit = scan->filter->limit > 0 ? scan->filter->limit
+                                           : NOSTR_DB_QUERY_DEFAULT_LIMIT;
+  query_result_apply_limit(scan->rs, limit);
+  return true;
+}
+
+// ============================================================================
+// Internal: Run one strategy to completion, unsorted
+// ============================================================================
+static NostrDBError scan_run(IndexManager* im, BufferPool* pool,
+                             const NostrDBFilter* filter,
+                             NostrDBQueryStrategy strategy, uint32_t inputs,
+                             QueryResultSet* rs)
+{
+  QueryScan scan;
+  scan_init(&scan, im, pool, filter, rs, strategy, inputs);
+  scan_step(&scan, 0);
+  scan_release(&scan);
+  return scan.err;
+}
+
+// ============================================================================
+// query_by_ids: Look up each ID in the unique ID index
+// ============================================================================
+NostrDBError query_by_ids(IndexManager* im, BufferPool* pool,
+                          const NostrDBFilter* filter, QueryResultSet* rs)
+{
+  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+
+  return scan_run(im, pool, filter, NOSTR_DB_QUERY_STRATEGY_BY_ID, 0, rs);
+}
+
+// ============================================================================
+// query_by_pubkey: Merge the pubkey postings of every author
+// ============================================================================
+NostrDBError query_by_pubkey(IndexManager* im, const NostrDBFilter* filter,
+                             QueryResultSet* rs)
+{
+  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+
+  return scan_run(im, NULL, filter, NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY, 0, rs);
+}
+
+// ============================================================================
+// query_by_kind: Merge the kind postings of every kind
+// ============================================================================
+NostrDBError query_by_kind(IndexManager* im, const NostrDBFilter* filter,
+                           QueryResultSet* rs)
+{
+  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+
+  return scan_run(im, NULL, filter, NOSTR_DB_QUERY_STRATEGY_BY_KIND, 0, rs);
+}
+
+// ============================================================================
+// query_by_pubkey_kind: Merge the pubkey+kind postings of every pair
+// (a follow feed: one newest-first lane per author and kind)
+// ============================================================================
+NostrDBError query_by_pubkey_kind(IndexManager*        im,
+                                  const NostrDBFilter* filter,
+                                  QueryResultSet*      rs)
+{
+  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+
+  return scan_run(im, NULL, filter, NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY_KIND, 0,
+                  rs);
+}
+
+// ============================================================================
+// query_by_tag: Merge the tag postings of every value of one tag filter
+// (the most selective one; any other tag filters are verified on the records)
+// ============================================================================
+NostrDBError query_by_tag(IndexManager* im, const NostrDBFilter* filter,
+                          QueryResultSet* rs)
+{
+  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+
+  return scan_run(im, NULL, filter, NOSTR_DB_QUERY_STRATEGY_BY_TAG, 0, rs);
+}
+
+// ============================================================================
+// query_intersect: Join the postings of the given families
+// ============================================================================
+NostrDBError query_intersect(IndexManager* im, const NostrDBFilter* filter,
+                             uint32_t inputs, QueryResultSet* rs)
+{
+  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+
+  return scan_run(im, NULL, filter, NOSTR_DB_QUERY_STRATEGY_INTERSECT, inputs,
+                  rs);
+}
+
+// ============================================================================
+// query_timeline_scan: Range scan over timeline index (descending order)
+// ============================================================================
+NostrDBError query_timeline_scan(IndexManager* im, const NostrDBFilter* filter,
+                                 QueryResultSet* rs)
+{
+  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+
+  return scan_run(im, NULL, filter, NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN, 0,
+                  rs);
+}
+
+// ============================================================================
+// Post-filter batches: the fixed EventRecord fields of up to
+// QUERY_FILTER_BATCH candidates, one column per field
+// The predicate passes are branch-free loops over whole columns, which the
+// compiler vectorizes; a candidate's record is read in full only when it
+// survives them.
+// ============================================================================
+#define QUERY_FILTER_BATCH 128
+
+typedef struct {
+  int64_t  created_at[QUERY_FILTER_BATCH];
+  uint64_t author[QUERY_FILTER_BATCH];  // First 8 pubkey bytes
+  uint32_t kind[QUERY_FILTER_BATCH];
+  uint8_t  keep[QUERY_FILTER_BATCH];  // 1 = still a candidate
+  uint8_t  hit[QUERY_FILTER_BATCH];   // Scratch for set membership
+} FilterBatch;
+
+// ============================================================================
+// Internal: Read the EventRecord headers of rids[0..n) into the columns
+// Missing and deleted records are dropped here.
+// ============================================================================
+static void batch_gather(BufferPool* pool, const RecordId* rids, size_t n,
+                         FilterBatch* b)
+{
+  for (size_t i = 0; i < n; i++) {
+    EventRecord  hdr;
+    uint16_t     len = sizeof(EventRecord);
+    NostrDBError err = record_read(pool, rids[i], &hdr, &len);
+    if (err != NOSTR_DB_OK || len < sizeof(EventRecord)) {
+      internal_memset(&hdr, 0, sizeof(EventRecord));
+      hdr.flags = NOSTR_DB_EVENT_FLAG_DELETED;
+    }
+
+    b->created_at[i] = hdr.created_at;
+    b->kind[i]       = hdr.kind;
+    b->keep[i]       = (uint8_t)((hdr.flags & NOSTR_DB_EVENT_FLAG_DELETED) == 0);
+    internal_memcpy(&b->author[i], hdr.pubkey, sizeof(uint64_t));
+  }
+}
+
+// ============================================================================
+// Internal: Apply the time range, kinds and author prefixes to the columns
+// ============================================================================
+static void batch_filter(FilterBatch* b, size_t n, const NostrDBFilter* filter)
+{
+  int64_t since = filter->since > 0 ? filter->since : -INT64_MAX - 1;
+  int64_t until = filter->until > 0 ? filter->until : INT64_MAX;
+  for (size_t i = 0; i < n; i++) {
+    b->keep[i] &= (uint8_t)((b->created_at[i] >= since) &
+                            (b->created_at[i] <= until));
+  }
+
+  if (filter->kinds_count > 0) {
+    internal_memset(b->hit, 0, n);
+    for (size_t k = 0; k < filter->kinds_count; k++) {
+      uint32_t kind = filter->kinds[k];
+      for (size_t i = 0; i < n; i++) {
+        b->hit[i] |= (uint8_t)(b->kind[i] == kind);
+      }
+    }
+    for (size_t i = 0; i < n; i++) {
+      b->keep[i] &= b->hit[i];
+    }
+  }
+
+  if (filter->authors_count > 0) {
+    internal_memset(b->hit, 0, n);
+    for (size_t k = 0; k < filter->authors_count; k++) {
+      uint64_t author;
+      internal_memcpy(&author, filter->authors[k].value, sizeof(uint64_t));
+      for (size_t i = 0; i < n; i++) {
+        b->hit[i] |= (uint8_t)(b->author[i] == author);
+      }
+    }
+    for (size_t i = 0; i < n; i++) {
+      b->keep[i] &= b->hit[i];
+    }
+  }
+}
+
+// ============================================================================
+// query_post_filter: Verify results against the full filter, a batch at a time
+// Survivors of the column passes are read once more to check what the
+// columns cannot: full pubkeys, ids, and (the whole record) tags.
+// ============================================================================
+NostrDBError query_post_filter(BufferPool* pool, QueryResultSet* rs,
+                               const NostrDBFilter* filter)
+{
+  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
+
+  uint32_t    write = 0;
+  uint8_t     scratch[8192];  // Spanned records are assembled here
+  FilterBatch batch;
+
+  // Post-filtered results come from ID lookups: no tag filter is covered by an index
+  bool check_tags = filter->tags_count > 0;
+
+  for (uint32_t base = 0; base < rs->count; base += QUERY_FILTER_BATCH) {
+    size_t n = rs->count - base;
+    if (n > QUERY_FILTER_BATCH) n = QUERY_FILTER_BATCH;
+
+    batch_gather(pool, rs->rids + base, n, &batch);
+    batch_filter(&batch, n, filter);
+
+    for (size_t i = 0; i < n; i++) {
+      if (!batch.keep[i]) continue;
+
+      uint32_t       src = base + (uint32_t)i;
+      const uint8_t* record;
+      uint16_t       len;
+      if (record_view(pool, rs->rids[src], scratch, sizeof(scratch), &record,
+                      &len) != NOSTR_DB_OK) {
+        continue;
+      }
+      bool match = record_matches(record, len, filter, check_tags);
+      record_release(pool, rs->rids[src]);
+      if (!match) continue;
+
+      // Keep this result
+      if (write != src) {
+        rs->rids[write]       = rs->rids[src];
+        rs->created_at[write] = rs->created_at[src];
+      }
+      write++;
+    }
+  }
+
+  rs->count = write;
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// Internal: Validate filter for query execution
+// ============================================================================
+static bool filter_validate(const NostrDBFilter* filter)
+{
+  if (is_null(filter)) return false;
+  if (filter->ids_count > NOSTR_DB_FILTER_MAX_IDS) return false;
+  if (filter->authors_count > NOSTR_DB_FILTER_MAX_AUTHORS) return false;
+  if (filter->kinds_count > NOSTR_DB_FILTER_MAX_KINDS) return false;
+  if (filter->tags_count > NOSTR_DB_FILTER_MAX_TAGS) return false;
+  if (filter->since > 0 && filter->until > 0 && filter->since > filter->until)
+    return false;
+  return true;
+}
+
+// ============================================================================
+// Internal: Select optimal query strategy
+// ============================================================================
+static NostrDBQueryStrategy select_strategy(const NostrDBFilter* filter)
+{
+  if (filter->ids_count > 0) return NOSTR_DB_QUERY_STRATEGY_BY_ID;
+  if (filter->tags_count > 0) return NOSTR_DB_QUERY_STRATEGY_BY_TAG;
+  if (filter->authors_count > 0 && filter->kinds_count > 0)
+    return NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY_KIND;
+  if (filter->authors_count > 0) return NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY;
+  if (filter->kinds_count > 0) return NOSTR_DB_QUERY_STRATEGY_BY_KIND;
+  return NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN;
+}
+
+// ============================================================================
+// Internal: x * num / den (0 when den is 0)
+// ============================================================================
+static inline uint64_t plan_scale(uint64_t x, uint64_t num, uint64_t den)
+{
+  return den == 0 ? 0 : x * num / den;
+}
+
+// ============================================================================
+// Internal: Cost of a path whose lanes hold `scanned` entries in the window,
+// `covered` of which pass the predicates the entries themselves carry
+// Reading newest first stops after about limit * scanned / matches entries;
+// with residual set the covered ones among them are read from their records.
+// ============================================================================
+static uint64_t plan_path_cost(uint64_t scanned, uint64_t covered,
+                               uint64_t matches, uint64_t limit,
+                               uint64_t lanes, bool residual)
+{
+  uint64_t reads = scanned;
+  if (matches >= limit && matches > 0) {
+    reads = plan_scale(limit, scanned, matches);
+    if (reads > scanned) reads = scanned;
+  }
+
+  uint64_t cost = reads + lanes * NOSTR_DB_QUERY_COST_LANE;
+  if (residual) {
+    cost += plan_scale(reads, covered, scanned) * NOSTR_DB_QUERY_COST_RECORD;
+  }
+  return cost;
+}
+
+// ============================================================================
+// Internal: One posting family as an intersection input
+// ============================================================================
+typedef struct {
+  uint32_t input;     // NOSTR_DB_QUERY_INPUT_* bit, 0 = none
+  uint32_t dummy;
+  uint64_t postings;  // Entries in the window
+  uint64_t lanes;
+} PlanInput;
+
+// Keep the two inputs with the fewest postings, first <= second
+static void plan_offer_input(PlanInput* first, PlanInput* second,
+                             uint32_t input, uint64_t postings, uint64_t lanes)
+{
+  PlanInput offered = {input, 0, postings, lanes};
+  if (first->input == 0 || postings < first->postings) {
+    *second = *first;
+    *first  = offered;
+  } else if (second->input == 0 || postings < second->postings) {
+    *second = offered;
+  }
+}
+
+// ============================================================================
+// Internal: Cost of joining two inputs (a the sparser)
+// Each posting of a takes a step on b, plus a descent when b is far behind,
+// and b never costs more than reading it through; the joined entries are the
+// candidates a residual check reads.
+// ============================================================================
+static uint64_t plan_intersect_cost(const PlanInput* a, const PlanInput* b,
+                                    uint64_t window, uint64_t matches,
+                                    uint64_t limit, bool residual)
+{
+  uint64_t seeks  = a->postings * (1 + NOSTR_DB_QUERY_COST_LANE);
+  uint64_t join   = a->postings + (b->postings < seeks ? b->postings : seeks);
+  uint64_t joined = plan_scale(a->postings, b->postings, window);
+  return plan_path_cost(join, joined, matches, limit, a->lanes + b->lanes,
+                        residual);
+}
+
+// ============================================================================
+// query_plan: Choose the cheapest access path from the index statistics
+// ============================================================================
+NostrDBQueryStrategy query_plan(const IndexManager*  im,
+                                const NostrDBFilter* filter, QueryPlan* plan)
+{
+  QueryPlan local;
+  if (is_null(plan)) plan = &local;
+
+  internal_memset(plan, 0, sizeof(QueryPlan));
+  for (uint32_t i = 0; i < NOSTR_DB_QUERY_STRATEGY_COUNT; i++) {
+    plan->cost[i] = UINT64_MAX;
+  }
+  if (is_null(filter)) {
+    plan->strategy = NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN;
+    return plan->strategy;
+  }
+  plan->strategy = select_strategy(filter);
+
+  const IndexStats* stats = is_null(im) ? NULL : im->stats;
+  if (filter->ids_count > 0 || is_null(stats) || stats->data.events == 0) {
+    return plan->strategy;
+  }
+
+  // Postings each family holds within the [since, until] window, scaled from
+  // whole-index counts by the window's share of all events
+  uint64_t total  = stats->data.events;
+  uint64_t window = index_stats_time_count(stats, filter->since, filter->until);
+  if (window == 0) window = 1;
+
+  uint64_t authors = 0, kinds = 0, pairs = 0, tags = 0;
+  for (size_t i = 0; i < filter->authors_count; i++) {
+    authors += index_stats_key_count(stats, INDEX_STATS_PUBKEY,
+                                     filter->authors[i].value, 32);
+  }
+  for (size_t k = 0; k < filter->kinds_count; k++) {
+    uint8_t prefix[4];
+    index_put_be32(prefix, filter->kinds[k]);
+    kinds += index_stats_key_count(stats, INDEX_STATS_KIND, prefix, 4);
+  }
+  if (filter->authors_count > 0 && filter->kinds_count > 0) {
+    for (size_t i = 0; i < filter->authors_count; i++) {
+      for (size_t k = 0; k < filter->kinds_count; k++) {
+        uint8_t prefix[36];
+        internal_memcpy(prefix, filter->authors[i].value, 32);
+        index_put_be32(prefix + 32, filter->kinds[k]);
+        pairs += index_stats_key_count(stats, INDEX_STATS_PUBKEY_KIND, prefix,
+                                       36);
+      }
+    }
+  }
+  authors = plan_scale(authors, window, total);
+  kinds   = plan_scale(kinds, window, total);
+  pairs   = plan_scale(pairs, window, total);
+
+  // Matching events, assuming the families are independent
+  uint64_t matches = window;
+  if (filter->authors_count > 0 && filter->kinds_count > 0) {
+    matches = plan_scale(matches, pairs < window ? pairs : window, window);
+  } else if (filter->authors_count > 0) {
+    matches = plan_scale(matches, authors < window ? authors : window, window);
+  } else if (filter->kinds_count > 0) {
+    matches = plan_scale(matches, kinds < window ? kinds : window, window);
+  }
+  for (size_t i = 0; i < filter->tags_count; i++) {
+    uint64_t count =
+      plan_scale(tag_postings(stats, &filter->tags[i]), window, total);
+    matches = plan_scale(matches, count < window ? count : window, window);
+  }
+  plan->matches = matches;
+
+  // Share of a family's postings also passing the covered kinds / authors
+  uint64_t kinds_of   = filter->kinds_count > 0 ? kinds : window;
+  uint64_t authors_of = filter->authors_count > 0 ? authors : window;
+  uint64_t limit      = filter->limit > 0 ? filter->limit
+                                          : NOSTR_DB_QUERY_DEFAULT_LIMIT;
+
+  uint64_t* cost = plan->cost;
+  cost[NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN] = plan_path_cost(
+    window, window, matches, limit, 1,
+    needs_residual(NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN, filter));
+
+  if (filter->kinds_count > 0) {
+    cost[NOSTR_DB_QUERY_STRATEGY_BY_KIND] = plan_path_cost(
+      kinds, plan_scale(kinds, authors_of, window), matches, limit,
+      filter->kinds_count,
+      needs_residual(NOSTR_DB_QUERY_STRATEGY_BY_KIND, filter));
+  }
+  if (filter->authors_count > 0) {
+    cost[NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY] = plan_path_cost(
+      authors, plan_scale(authors, kinds_of, window), matches, limit,
+      filter->authors_count,
+      needs_residual(NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY, filter));
+  }
+  if (filter->authors_count > 0 && filter->kinds_count > 0) {
+    cost[NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY_KIND] = plan_path_cost(
+      pairs, pairs, matches, limit,
+      filter->authors_count * filter->kinds_count,
+      needs_residual(NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY_KIND, filter));
+  }
+  if (filter->tags_count > 0) {
+    plan->tag = (uint32_t)cheapest_tag(im, filter);
+
+    const NostrDBFilterTag* tag = &filter->tags[plan->tag];
+    tags    = plan_scale(tag_postings(stats, tag), window, total);
+    uint64_t covered =
+      plan_scale(plan_scale(tags, kinds_of, window), authors_of, window);
+    cost[NOSTR_DB_QUERY_STRATEGY_BY_TAG] = plan_path_cost(
+      tags, covered, matches, limit, tag->values_count,
+      needs_residual(NOSTR_DB_QUERY_STRATEGY_BY_TAG, filter));
+  }
+
+  // Intersection of the two most selective families
+  PlanInput first  = {0, 0, 0, 0};
+  PlanInput second = {0, 0, 0, 0};
+  if (filter->authors_count > 0 && filter->kinds_count > 0) {
+    plan_offer_input(&first, &second, NOSTR_DB_QUERY_INPUT_PUBKEY_KIND, pairs,
+                     filter->authors_count * filter->kinds_count);
+  } else if (filter->authors_count > 0) {
+    plan_offer_input(&first, &second, NOSTR_DB_QUERY_INPUT_PUBKEY, authors,
+                     filter->authors_count);
+  } else if (filter->kinds_count > 0) {
+    plan_offer_input(&first, &second, NOSTR_DB_QUERY_INPUT_KIND, kinds,
+                     filter->kinds_count);
+  }
+  for (size_t i = 0; i < filter->tags_count; i++) {
+    plan_offer_input(
+      &first, &second, NOSTR_DB_QUERY_INPUT_TAG(i),
+      plan_scale(tag_postings(stats, &filter->tags[i]), window, total),
+      filter->tags[i].values_count);
+  }
+  if (second.input != 0) {
+    plan->inputs = first.input | second.input;
+    cost[NOSTR_DB_QUERY_STRATEGY_INTERSECT] = plan_intersect_cost(
+      &first, &second, window, matches, limit,
+      intersect_needs_residual(filter, plan->inputs));
+  }
+
+  // Cheapest wins; ties go to the fixed priority order
+  static const NostrDBQueryStrategy order[] = {
+    NOSTR_DB_QUERY_STRATEGY_BY_TAG,
+    NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY_KIND,
+    NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY,
+    NOSTR_DB_QUERY_STRATEGY_BY_KIND,
+    NOSTR_DB_QUERY_STRATEGY_INTERSECT,
+    NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN,
+  };
+  plan->strategy = NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN;
+  for (size_t i = 0; i < sizeof(order) / sizeof(order[0]); i++) {
+    if (cost[order[i]] < cost[plan->strategy]) plan->strategy = order[i];
+  }
+
+  return plan->strategy;
+}
+
+// ============================================================================
+// Internal: Validate and plan a filter into a scan that finishes like
+// query_execute (post-filter, sort, limit)
+// ============================================================================
+static NostrDBError scan_plan(QueryScan* scan, IndexManager* im,
+                              BufferPool* pool, const NostrDBFilter* filter,
+                              QueryResultSet* rs)
+{
+  if (!filter_validate(filter)) {
+    return NOSTR_DB_ERROR_INVALID_EVENT;
+  }
+
+  // If limit is explicitly 0, return empty result immediately
+  if (filter->limit == 0) {
+    internal_memset(scan, 0, sizeof(QueryScan));
+    scan->done = true;
+    return NOSTR_DB_OK;
+  }
+
+  QueryPlan            plan;
+  NostrDBQueryStrategy strategy = query_plan(im, filter, &plan);
+  scan_init(scan, im, pool, filter, rs, strategy, plan.inputs);
+  scan->finish = true;
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// query_scan_open: Plan a filter for stepwise execution
+// ============================================================================
+NostrDBError query_scan_open(IndexManager* im, BufferPool* pool,
+                             const NostrDBFilter* filter, QueryResultSet* rs,
+                             QueryScan** out)
+{
+  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(out, NOSTR_DB_ERROR_NULL_PARAM);
+
+  *out = NULL;
+
+  QueryScan* scan = (QueryScan*)merge_alloc(sizeof(QueryScan));
+  if (is_null(scan)) return NOSTR_DB_ERROR_MMAP_FAILED;
+
+  NostrDBError err = scan_plan(scan, im, pool, filter, rs);
+  if (err != NOSTR_DB_OK) {
+    merge_free(scan, sizeof(QueryScan));
+    return err;
+  }
+
+  *out = scan;
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// query_scan_step: Run a scan for about budget units of work
+// ============================================================================
+bool query_scan_step(QueryScan* scan, uint32_t budget, uint32_t* spent)
+{
+  require_not_null(scan, true);
+
+  bool done = scan_step(scan, budget);
+  if (!is_null(spent)) *spent = scan->budget.spent;
+  return done;
+}
+
+// ============================================================================
+// query_scan_error
+// ============================================================================
+NostrDBError query_scan_error(const QueryScan* scan)
+{
+  require_not_null(scan, NOSTR_DB_ERROR_NULL_PARAM);
+  return scan->err;
+}
+
+// ============================================================================
+// query_scan_close
+// ============================================================================
+void query_scan_close(QueryScan* scan)
+{
+  if (is_null(scan)) return;
+  scan_release(scan);
+  merge_free(scan, sizeof(QueryScan));
+}
+
+// ============================================================================
+// query_execute: Select strategy and execute
+// ============================================================================
+NostrDBError query_execute(IndexManager* im, BufferPool* pool,
+                           const NostrDBFilter* filter, QueryResultSet* rs)
+{
+  require_not_null(im, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(filter, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(rs, NOSTR_DB_ERROR_NULL_PARAM);
+
+  QueryScan    scan;
+  NostrDBError err = scan_plan(&scan, im, pool, filter, rs);
+  if (err != NOSTR_DB_OK) return err;
+
+  scan_step(&scan, 0);
+  scan_release(&scan);
+  return scan.err;
 }
@@ -10,6 +10,9 @@
 
 // ============================================================================
 // RecordId-based result set with bloom filter for dedup
+//
+// With top_k set the arrays form a min-heap on created_at holding the K
+// newest results seen so far; anything not newer than the root is pruned.
 // ============================================================================
 typedef struct {
   RecordId* rids;        // RecordId array
@@ -17,12 +20,21 @@ typedef struct {
   uint32_t  count;
   uint32_t  capacity;
   uint64_t  bloom[64];  // 512-byte bloom filter for O(1) dedup
+  uint32_t  top_k;      // 0 = keep everything
+  uint32_t  examined;   // Index entries read to produce the results
 } QueryResultSet;
 
 // ============================================================================
 // Result set operations
 // ============================================================================
 
+// Record id order used to break created_at ties (page, then slot)
+static inline bool query_rid_before(RecordId a, RecordId b)
+{
+  return a.page_id != b.page_id ? a.page_id < b.page_id
+                                : a.slot_index < b.slot_index;
+}
+
 QueryResultSet* query_result_create(uint32_t capacity);
 void            query_result_free(QueryResultSet* rs);
 int32_t         query_result_add(QueryResultSet* rs, RecordId rid,
@@ -30,6 +42,47 @@ int32_t         query_result_add(QueryResultSet* rs, RecordId rid,
 int32_t         query_result_sort(QueryResultSet* rs);
 void            query_result_apply_limit(QueryResultSet* rs, uint32_t limit);
 
+// Keep only the k newest results (bounded heap); k = 0 keeps everything
+void query_result_set_top_k(QueryResultSet* rs, uint32_t k);
+
+// False once a result at created_at could no longer enter the top k
+bool query_result_accepts(const QueryResultSet* rs, int64_t created_at);
+
+// ============================================================================
+// Cost-based planning
+//
+// Each access path the filter allows is costed from the index statistics:
+// the index entries it reads before the top `limit` matches are found
+// (newest first), record reads for the predicates its entries do not cover,
+// and one tree descent per lane. Predicates are assumed independent. Without
+// statistics the fixed priority ids > tags > pubkey+kind > pubkey > kind >
+// timeline is used; ids always use the ID index.
+//
+// INTERSECT joins the two most selective posting families (a tag filter,
+// authors, kinds, or authors+kinds) instead of verifying one on the records.
+// ============================================================================
+#define NOSTR_DB_QUERY_COST_LANE 4    // Opening a cursor (root-to-leaf descent)
+#define NOSTR_DB_QUERY_COST_RECORD 8  // Reading a record to verify a candidate
+
+// Intersection inputs (QueryPlan.inputs)
+#define NOSTR_DB_QUERY_INPUT_PUBKEY (1u << 0)
+#define NOSTR_DB_QUERY_INPUT_KIND (1u << 1)
+#define NOSTR_DB_QUERY_INPUT_PUBKEY_KIND (1u << 2)
+#define NOSTR_DB_QUERY_INPUT_TAG(i) (1u << (3 + (i)))  // Tag filter i
+
+typedef struct {
+  NostrDBQueryStrategy strategy;  // Cheapest access path
+  uint32_t             tag;       // Tag filter scanned by BY_TAG
+  uint32_t             inputs;    // Families joined by INTERSECT
+  uint32_t             dummy;
+  uint64_t             matches;   // Estimated matching events
+  uint64_t             cost[NOSTR_DB_QUERY_STRATEGY_COUNT];  // UINT64_MAX = not applicable
+} QueryPlan;
+
+// Choose the access path for a filter; plan (optional) receives the costs
+NostrDBQueryStrategy query_plan(const IndexManager*  im,
+                                const NostrDBFilter* filter, QueryPlan* plan);
+
 // ============================================================================
 // Query engine: execute queries against B+ tree indexes
 // ============================================================================
@@ -37,6 +90,30 @@ void            query_result_apply_limit(QueryResultSet* rs, uint32_t limit);
 NostrDBError query_execute(IndexManager* im, BufferPool* pool,
                            const NostrDBFilter* filter, QueryResultSet* rs);
 
+// ============================================================================
+// Stepwise execution: query_execute a budget at a time
+//
+// Every index entry, tree descent, overflow page and record read costs one
+// unit. Between steps the scan keeps its B+ tree positions (as keys) and the
+// partial top k in rs; no page stays pinned, so the indexes may change in
+// between. filter and rs must outlive the scan.
+// ============================================================================
+typedef struct QueryScan QueryScan;
+
+NostrDBError query_scan_open(IndexManager* im, BufferPool* pool,
+                             const NostrDBFilter* filter, QueryResultSet* rs,
+                             QueryScan** out);
+
+// Run for about budget units (0 = to the end; a timeline key's events are
+// read together); spent (optional) receives the units used. True once rs
+// holds the complete, sorted and limited result
+bool query_scan_step(QueryScan* scan, uint32_t budget, uint32_t* spent);
+
+// First error the scan hit (rs is then incomplete)
+NostrDBError query_scan_error(const QueryScan* scan);
+
+void query_scan_close(QueryScan* scan);
+
 NostrDBError query_by_ids(IndexManager* im, BufferPool* pool,
                           const NostrDBFilter* filter, QueryResultSet* rs);
 
@@ -56,6 +133,10 @@ NostrDBError query_by_tag(IndexManager* im, const NostrDBFilter* filter,
 NostrDBError query_timeline_scan(IndexManager* im, const NostrDBFilter* filter,
                                  QueryResultSet* rs);
 
+// Join the postings of two or more families (NOSTR_DB_QUERY_INPUT_* bits)
+NostrDBError query_intersect(IndexManager* im, const NostrDBFilter* filter,
+                             uint32_t inputs, QueryResultSet* rs);
+
 // ============================================================================
 // Post-filter: verify results against full filter criteria
 // Reads EventRecord from BufferPool to check fields not covered by index
@@ -63,4 +144,14 @@ NostrDBError query_timeline_scan(IndexManager* im, const NostrDBFilter* filter,
 NostrDBError query_post_filter(BufferPool* pool, QueryResultSet* rs,
                                const NostrDBFilter* filter);
 
+// Whether a serialized tag list (record tags blob) has a tag called name whose
+// first value is one of values (binary for 'e' / 'p', zero-padded text else)
+bool query_tags_match(const uint8_t* tags_data, uint16_t tags_length,
+                      char name, const uint8_t (*values)[32],
+                      size_t values_count);
+
+// Decode 2 * out_len hex characters (either case) into out; false if any is
+// not a hex digit
+bool query_hex_decode(const uint8_t* hex, uint8_t* out, size_t out_len);
+
 #endif
@@ -53,6 +53,67 @@ static inline void bloom_set(uint64_t bloom[64], RecordId rid)
   bloom[h2 / 64] |= (1ULL << (h2 % 64));
 }
 
+// ============================================================================
+// Internal: Min-heap over the parallel arrays, ordered like the posting
+// indexes (created_at, then record id descending), so sorted results are
+// newest first with ties in record id order and lists merge exactly
+// ============================================================================
+static inline bool heap_less(const QueryResultSet* rs, uint32_t a, uint32_t b)
+{
+  if (rs->created_at[a] != rs->created_at[b]) {
+    return rs->created_at[a] < rs->created_at[b];
+  }
+  return query_rid_before(rs->rids[b], rs->rids[a]);
+}
+
+static inline void heap_swap(QueryResultSet* rs, uint32_t a, uint32_t b)
+{
+  int64_t  ts  = rs->created_at[a];
+  RecordId rid = rs->rids[a];
+
+  rs->created_at[a] = rs->created_at[b];
+  rs->rids[a]       = rs->rids[b];
+  rs->created_at[b] = ts;
+  rs->rids[b]       = rid;
+}
+
+static void heap_sift_up(QueryResultSet* rs, uint32_t i)
+{
+  while (i > 0) {
+    uint32_t parent = (i - 1) / 2;
+    if (!heap_less(rs, i, parent)) break;
+    heap_swap(rs, parent, i);
+    i = parent;
+  }
+}
+
+static void heap_sift_down(QueryResultSet* rs, uint32_t i, uint32_t count)
+{
+  for (;;) {
+    uint32_t smallest = i;
+    uint32_t left     = 2 * i + 1;
+    uint32_t right    = left + 1;
+
+    if (left < count && heap_less(rs, left, smallest)) {
+      smallest = left;
+    }
+    if (right < count && heap_less(rs, right, smallest)) {
+      smallest = right;
+    }
+    if (smallest == i) break;
+
+    heap_swap(rs, i, smallest);
+    i = smallest;
+  }
+}
+
+static void heap_build(QueryResultSet* rs)
+{
+  for (uint32_t i = rs->count / 2; i > 0; i--) {
+    heap_sift_down(rs, i - 1, rs->count);
+  }
+}
+
 // ============================================================================
 // query_result_create
 // ============================================================================
@@ -78,6 +139,7 @@ QueryResultSet* query_result_create(uint32_t capacity)
 
   rs->count    = 0;
   rs->capacity = capacity;
+  rs->top_k    = 0;
   internal_memset(rs->bloom, 0, sizeof(rs->bloom));
 
   return rs;
@@ -99,14 +161,46 @@ void query_result_free(QueryResultSet* rs)
   qr_free(rs, sizeof(QueryResultSet));
 }
 
+// ============================================================================
+// query_result_set_top_k: Switch to a bounded heap of the k newest results
+// ============================================================================
+void query_result_set_top_k(QueryResultSet* rs, uint32_t k)
+{
+  if (is_null(rs)) return;
+
+  rs->top_k = k;
+  if (k == 0) return;
+
+  heap_build(rs);
+  while (rs->count > k) {
+    rs->count--;
+    heap_swap(rs, 0, rs->count);
+    heap_sift_down(rs, 0, rs->count);
+  }
+}
+
+// ============================================================================
+// query_result_accepts: Could a result at created_at still enter the top k?
+// ============================================================================
+bool query_result_accepts(const QueryResultSet* rs, int64_t created_at)
+{
+  if (is_null(rs)) return false;
+  if (rs->top_k == 0 || rs->count < rs->top_k) return true;
+  return created_at > rs->created_at[0];
+}
+
 // ============================================================================
 // query_result_add: Add RecordId with bloom-filter dedup
-// Returns 0 on success, 1 if duplicate, -1 on error
+// Returns 0 on success, 1 if duplicate or pruned by the top-k bound,
+// -1 on error
 // ============================================================================
 int32_t query_result_add(QueryResultSet* rs, RecordId rid, int64_t created_at)
 {
   require_not_null(rs, -1);
 
+  // Heap full and not newer than the k-th newest: nothing to do
+  if (!query_result_accepts(rs, created_at)) return 1;
+
   // Bloom filter quick check
   if (bloom_test(rs->bloom, rid)) {
     // Possible duplicate — linear scan to confirm
@@ -141,37 +235,42 @@ int32_t query_result_add(QueryResultSet* rs, RecordId rid, int64_t created_at)
     rs->capacity   = new_cap;
   }
 
+  bloom_set(rs->bloom, rid);
+
+  if (rs->top_k > 0 && rs->count >= rs->top_k) {
+    // Replace the oldest of the top k
+    rs->rids[0]       = rid;
+    rs->created_at[0] = created_at;
+    heap_sift_down(rs, 0, rs->count);
+    return 0;
+  }
+
   rs->rids[rs->count]       = rid;
   rs->created_at[rs->count] = created_at;
   rs->count++;
-  bloom_set(rs->bloom, rid);
+  if (rs->top_k > 0) {
+    heap_sift_up(rs, rs->count - 1);
+  }
 
   return 0;
 }
 
 // ============================================================================
-// query_result_sort: Descending by created_at (newest first)
+// query_result_sort: Newest first, ties in record id order
+// Heap sort: O(n log n), in place. Ends top-k collection.
 // ============================================================================
 int32_t query_result_sort(QueryResultSet* rs)
 {
   require_not_null(rs, -1);
 
-  // Insertion sort (good for typically small result sets)
-  for (uint32_t i = 1; i < rs->count; i++) {
-    int64_t  key_time = rs->created_at[i];
-    RecordId key_rid  = rs->rids[i];
-    int32_t  j        = (int32_t)i - 1;
-
-    while (j >= 0 && rs->created_at[j] < key_time) {
-      rs->created_at[j + 1] = rs->created_at[j];
-      rs->rids[j + 1]       = rs->rids[j];
-      j--;
-    }
-
-    rs->created_at[j + 1] = key_time;
-    rs->rids[j + 1]       = key_rid;
+  // Min-heap, then move the minimum to the back: the result is descending
+  heap_build(rs);
+  for (uint32_t n = rs->count; n > 1; n--) {
+    heap_swap(rs, 0, n - 1);
+    heap_sift_down(rs, 0, n - 1);
   }
 
+  rs->top_k = 0;
   return 0;
 }
 
@@ -0,0 +1,279 @@
+#include "event_json.h"
+
+#include "../../../arch/memory.h"
+#include "../../../util/string.h"
+#include "../db_types.h"
+
+// ============================================================================
+// Internal: Bounded output cursor; overflow latches and drops later writes
+// ============================================================================
+typedef struct {
+  char*  out;
+  size_t pos;
+  size_t capacity;
+  bool   overflow;
+  int32_t dummy;
+} JsonWriter;
+
+static const char HEX_CHARS[] = "0123456789abcdef";
+
+static inline bool json_reserve(JsonWriter* w, size_t n)
+{
+  if (w->overflow || w->capacity - w->pos < n) {
+    w->overflow = true;
+    return false;
+  }
+  return true;
+}
+
+static void json_put(JsonWriter* w, const char* s, size_t n)
+{
+  if (!json_reserve(w, n)) return;
+  internal_memcpy(w->out + w->pos, s, n);
+  w->pos += n;
+}
+
+#define JSON_PUT_LITERAL(w, s) json_put((w), (s), sizeof(s) - 1)
+
+// ============================================================================
+// Internal: Word-at-a-time helpers (no SIMD in this build: 8 lanes per
+// uint64_t instead)
+// ============================================================================
+#define JSON_LANES_01 0x0101010101010101ull
+#define JSON_LANES_80 0x8080808080808080ull
+
+// Spread 4 bytes to the even byte lanes of a word
+static inline uint64_t json_spread_bytes(uint32_t x)
+{
+  uint64_t v = x;
+  v          = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+  v          = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+  return v;
+}
+
+// Lanes equal to zero (exact for the first one; later lanes may be false
+// positives after a borrow, which only costs a slow pass over the word)
+static inline uint64_t json_lanes_zero(uint64_t v)
+{
+  return (v - JSON_LANES_01) & ~v & JSON_LANES_80;
+}
+
+// ============================================================================
+// Internal: Lowercase hex of raw bytes, 4 input bytes per step
+// Each nibble lands in its own byte lane; lanes >= 10 get the 'a' offset.
+// ============================================================================
+static void json_put_hex(JsonWriter* w, const uint8_t* bytes, size_t len)
+{
+  if (!json_reserve(w, len * 2)) return;
+  char*  dst = w->out + w->pos;
+  size_t i   = 0;
+
+  for (; i + 4 <= len; i += 4) {
+    uint32_t in;
+    internal_memcpy(&in, bytes + i, sizeof(in));
+    uint64_t nibbles = json_spread_bytes((in >> 4) & 0x0F0F0F0Fu) |
+                       (json_spread_bytes(in & 0x0F0F0F0Fu) << 8);
+    uint64_t letters = ((nibbles + 0x7676767676767676ull) & JSON_LANES_80) >> 7;
+    uint64_t ascii   = nibbles + 0x3030303030303030ull + letters * ('a' - '0' - 10);
+    internal_memcpy(dst + i * 2, &ascii, sizeof(ascii));
+  }
+  for (; i < len; i++) {
+    dst[i * 2]     = HEX_CHARS[bytes[i] >> 4];
+    dst[i * 2 + 1] = HEX_CHARS[bytes[i] & 0x0F];
+  }
+  w->pos += len * 2;
+}
+
+// ============================================================================
+// Internal: JSON string body with the escaping of the response layer
+// Runs of 8 bytes with nothing to escape are copied as one word; only words
+// holding a control character, '"' or '\\' go byte by byte.
+// ============================================================================
+static void json_put_escaped_byte(JsonWriter* w, uint8_t c)
+{
+  switch (c) {
+    case '"':
+      JSON_PUT_LITERAL(w, "\\\"");
+      break;
+    case '\\':
+      JSON_PUT_LITERAL(w, "\\\\");
+      break;
+    case '\b':
+      JSON_PUT_LITERAL(w, "\\b");
+      break;
+    case '\f':
+      JSON_PUT_LITERAL(w, "\\f");
+      break;
+    case '\n':
+      JSON_PUT_LITERAL(w, "\\n");
+      break;
+    case '\r':
+      JSON_PUT_LITERAL(w, "\\r");
+      break;
+    case '\t':
+      JSON_PUT_LITERAL(w, "\\t");
+      break;
+    default:
+      if (c < 0x20) {
+        char esc[6] = {'\\', 'u', '0', '0', HEX_CHARS[c >> 4],
+                       HEX_CHARS[c & 0x0F]};
+        json_put(w, esc, sizeof(esc));
+      } else if (json_reserve(w, 1)) {
+        w->out[w->pos++] = (char)c;
+      }
+      break;
+  }
+}
+
+static void json_put_escaped(JsonWriter* w, const uint8_t* s, size_t len)
+{
+  size_t i = 0;
+  while (i < len && !w->overflow) {
+    // Clean words: the cursor is kept local so byte stores through out do
+    // not force it back to memory on every word
+    char*  out = w->out;
+    size_t pos = w->pos;
+    size_t cap = w->capacity;
+    for (; len - i >= 8 && cap - pos >= 8; i += 8, pos += 8) {
+      uint64_t v = 0;
+      internal_memcpy(&v, s + i, sizeof(v));
+      uint64_t control = (v - 0x2020202020202020ull) & ~v & JSON_LANES_80;
+      uint64_t quote   = json_lanes_zero(v ^ (JSON_LANES_01 * '"'));
+      uint64_t slash   = json_lanes_zero(v ^ (JSON_LANES_01 * '\\'));
+      if ((control | quote | slash) != 0) break;
+      internal_memcpy(out + pos, &v, sizeof(v));
+    }
+    w->pos = pos;
+
+    // A word with something to escape (or the tail): byte by byte
+    for (size_t end = (len - i < 8) ? len : i + 8; i < end && !w->overflow; i++) {
+      json_put_escaped_byte(w, s[i]);
+    }
+  }
+}
+
+// ============================================================================
+// Internal: Decimal integers
+// ============================================================================
+static void json_put_uint64(JsonWriter* w, uint64_t value)
+{
+  char   digits[20];
+  size_t n = 0;
+  do {
+    digits[n++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value > 0);
+
+  if (!json_reserve(w, n)) return;
+  for (size_t i = 0; i < n; i++) {
+    w->out[w->pos + i] = digits[n - 1 - i];
+  }
+  w->pos += n;
+}
+
+static void json_put_int64(JsonWriter* w, int64_t value)
+{
+  if (value < 0) {
+    JSON_PUT_LITERAL(w, "-");
+    json_put_uint64(w, (uint64_t)0 - (uint64_t)value);
+  } else {
+    json_put_uint64(w, (uint64_t)value);
+  }
+}
+
+// ============================================================================
+// Internal: Serialized tags ([count:u16] then per tag [value_count:u8]
+// [name_len:u8][name] and per value [len:u16][bytes]) as a JSON array
+// Returns false if the blob is malformed.
+// ============================================================================
+static bool json_put_tags(JsonWriter* w, const uint8_t* tags, size_t len)
+{
+  JSON_PUT_LITERAL(w, "[");
+  if (len < 2) {
+    JSON_PUT_LITERAL(w, "]");
+    return len == 0;
+  }
+
+  const uint8_t* ptr   = tags + 2;
+  const uint8_t* end   = tags + len;
+  uint16_t       count = (uint16_t)(tags[0] | (tags[1] << 8));
+
+  for (uint16_t i = 0; i < count; i++) {
+    if (end - ptr < 2) return false;
+    uint8_t value_count = *ptr++;
+    uint8_t name_len    = *ptr++;
+    if (end - ptr < name_len) return false;
+
+    if (i > 0) JSON_PUT_LITERAL(w, ",");
+    JSON_PUT_LITERAL(w, "[\"");
+    json_put_escaped(w, ptr, name_len);
+    JSON_PUT_LITERAL(w, "\"");
+    ptr += name_len;
+
+    for (uint8_t j = 0; j < value_count; j++) {
+      if (end - ptr < 2) return false;
+      uint16_t value_len = (uint16_t)(ptr[0] | (ptr[1] << 8));
+      ptr += 2;
+      if (end - ptr < value_len) return false;
+
+      JSON_PUT_LITERAL(w, ",\"");
+      json_put_escaped(w, ptr, value_len);
+      JSON_PUT_LITERAL(w, "\"");
+      ptr += value_len;
+    }
+    JSON_PUT_LITERAL(w, "]");
+  }
+
+  JSON_PUT_LITERAL(w, "]");
+  return true;
+}
+
+// ============================================================================
+// event_json_write
+// ============================================================================
+size_t event_json_write(const uint8_t* record, uint16_t length, char* out,
+                        size_t capacity)
+{
+  require_not_null(record, 0);
+  require_not_null(out, 0);
+  require(length >= sizeof(EventRecord), 0);
+
+  const EventRecord* rec     = (const EventRecord*)record;
+  const uint8_t*     content = record + sizeof(EventRecord);
+  const uint8_t*     tags    = content + rec->content_length;
+  if ((size_t)sizeof(EventRecord) + rec->content_length + rec->tags_length >
+      length) {
+    return 0;
+  }
+
+  // Stored form: the JSON is the rest of the record
+  if (rec->flags & NOSTR_DB_EVENT_FLAG_JSON) {
+    const uint8_t* json     = tags + rec->tags_length;
+    size_t         json_len = (size_t)(record + length - json);
+    if (json_len > 0) {
+      if (json_len > capacity) return 0;
+      internal_memcpy(out, json, json_len);
+      return json_len;
+    }
+  }
+
+  JsonWriter w = {out, 0, capacity, false, 0};
+
+  JSON_PUT_LITERAL(&w, "{\"id\":\"");
+  json_put_hex(&w, rec->id, sizeof(rec->id));
+  JSON_PUT_LITERAL(&w, "\",\"pubkey\":\"");
+  json_put_hex(&w, rec->pubkey, sizeof(rec->pubkey));
+  JSON_PUT_LITERAL(&w, "\",\"created_at\":");
+  json_put_int64(&w, rec->created_at);
+  JSON_PUT_LITERAL(&w, ",\"kind\":");
+  json_put_uint64(&w, rec->kind);
+  JSON_PUT_LITERAL(&w, ",\"tags\":");
+  if (!json_put_tags(&w, tags, rec->tags_length)) return 0;
+  JSON_PUT_LITERAL(&w, ",\"content\":\"");
+  json_put_escaped(&w, content, rec->content_length);
+  JSON_PUT_LITERAL(&w, "\",\"sig\":\"");
+  json_put_hex(&w, rec->sig, sizeof(rec->sig));
+  JSON_PUT_LITERAL(&w, "\"}");
+
+  return w.overflow ? 0 : w.pos;
+}
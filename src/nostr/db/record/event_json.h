@@ -0,0 +1,25 @@
+#ifndef NOSTR_DB_EVENT_JSON_H_
+#define NOSTR_DB_EVENT_JSON_H_
+
+#include "../../../util/types.h"
+#include "record_types.h"
+
+/**
+ * @brief Write the wire JSON object of a stored event straight from its record
+ *
+ * Output: {"id":"..","pubkey":"..","created_at":N,"kind":N,"tags":[..],
+ * "content":"..","sig":".."}, the same text the response layer produces for
+ * the deserialized NostrEventEntity, without building one. The output is not
+ * NUL-terminated. Records stored with NOSTR_DB_EVENT_FLAG_JSON already carry
+ * that text and are copied as is.
+ *
+ * @param record EventRecord followed by content and serialized tags
+ * @param length Record length
+ * @param out Output buffer
+ * @param capacity Output buffer capacity
+ * @return Bytes written, 0 if the record is malformed or does not fit
+ */
+size_t event_json_write(const uint8_t* record, uint16_t length, char* out,
+                        size_t capacity);
+
+#endif
@@ -129,6 +129,67 @@ NostrDBError record_read(BufferPool* pool, RecordId rid, void* out,
   return err;
 }
 
+// ============================================================================
+// record_view
+// ============================================================================
+NostrDBError record_view(BufferPool* pool, RecordId rid, void* scratch,
+                         uint16_t scratch_capacity, const uint8_t** data,
+                         uint16_t* length)
+{
+  require_not_null(pool, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(data, NOSTR_DB_ERROR_NULL_PARAM);
+  require_not_null(length, NOSTR_DB_ERROR_NULL_PARAM);
+  require(rid.page_id != PAGE_ID_NULL, NOSTR_DB_ERROR_NULL_PARAM);
+
+  PageData* page = buffer_pool_pin(pool, rid.page_id);
+  if (is_null(page)) {
+    return NOSTR_DB_ERROR_NOT_FOUND;
+  }
+
+  // Spanned record: assemble it (the primary page stays pinned regardless)
+  if (overflow_is_spanned(page, rid.slot_index)) {
+    uint16_t     len = scratch_capacity;
+    NostrDBError err =
+      is_null(scratch) ? NOSTR_DB_ERROR_FULL
+                       : overflow_read(pool, page, rid.slot_index, scratch, &len);
+    if (err == NOSTR_DB_OK && len > scratch_capacity) {
+      err = NOSTR_DB_ERROR_FULL;
+    }
+    if (err != NOSTR_DB_OK) {
+      buffer_pool_unpin(pool, rid.page_id);
+      return err;
+    }
+    *data   = (const uint8_t*)scratch;
+    *length = len;
+    return NOSTR_DB_OK;
+  }
+
+  const SlotPageHeader* hdr = (const SlotPageHeader*)page->data;
+  const SlotEntry*      slot =
+    (const SlotEntry*)(page->data + SLOT_PAGE_HEADER_SIZE +
+                       rid.slot_index * SLOT_ENTRY_SIZE);
+  if (rid.slot_index >= hdr->slot_count ||
+      (slot->offset == 0 && slot->length == 0)) {
+    buffer_pool_unpin(pool, rid.page_id);
+    return NOSTR_DB_ERROR_NOT_FOUND;
+  }
+
+  *data   = page->data + slot->offset;
+  *length = slot->length;
+  return NOSTR_DB_OK;
+}
+
+// ============================================================================
+// record_release
+// ============================================================================
+void record_release(BufferPool* pool, RecordId rid)
+{
+  if (is_null(pool) || rid.page_id == PAGE_ID_NULL) {
+    return;
+  }
+  buffer_pool_unpin(pool, rid.page_id);
+}
+
 // ============================================================================
 // record_delete
 // ============================================================================
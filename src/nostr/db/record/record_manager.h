@@ -37,6 +37,33 @@ NostrDBError record_insert(BufferPool* pool, const void* data,
 NostrDBError record_read(BufferPool* pool, RecordId rid, void* out,
                          uint16_t* length);
 
+/**
+ * @brief Point at a record in place, with its page pinned
+ *
+ * The record is not copied: *data points into the buffer pool page and stays
+ * valid until record_release. Spanned records are not contiguous in the pool,
+ * so they are assembled into scratch instead (NOSTR_DB_ERROR_FULL if it is
+ * too small).
+ *
+ * @param pool Buffer pool instance
+ * @param rid Record ID to view
+ * @param scratch Buffer for a spanned record
+ * @param scratch_capacity Capacity of scratch
+ * @param data Receives the record bytes
+ * @param length Receives the record length
+ * @return NOSTR_DB_OK on success (release the rid), error code otherwise
+ */
+NostrDBError record_view(BufferPool* pool, RecordId rid, void* scratch,
+                         uint16_t scratch_capacity, const uint8_t** data,
+                         uint16_t* length);
+
+/**
+ * @brief Unpin the page of a record opened with record_view
+ * @param pool Buffer pool instance
+ * @param rid Record ID passed to record_view
+ */
+void record_release(BufferPool* pool, RecordId rid);
+
 /**
  * @brief Delete a record from the database
  * @param pool Buffer pool instance
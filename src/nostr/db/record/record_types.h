@@ -98,6 +98,7 @@ typedef struct {
   // Followed by:
   // uint8_t content[content_length];
   // uint8_t tags[tags_length];
+  // char    json[];  (NOSTR_DB_EVENT_FLAG_JSON: the rest of the record)
 } EventRecord;
 
 _Static_assert(sizeof(EventRecord) == 152, "EventRecord must be 152 bytes");
@@ -0,0 +1,314 @@
+#include "../../arch/memory.h"
+#include "../../util/log.h"
+#include "../../util/string.h"
+#include "../nostr_func.h"
+
+extern bool extract_nostr_event_id(const PJsonFuncs funcs, const char* json, const jsontok_t* token, char* id);
+extern bool extract_nostr_event_pubkey(const PJsonFuncs funcs, const char* json, const jsontok_t* token, char* pubkey);
+extern bool extract_nostr_event_kind(const PJsonFuncs funcs, const char* json, const jsontok_t* token, uint32_t* kind);
+extern bool extract_nostr_event_created_at(const PJsonFuncs funcs, const char* json, const jsontok_t* token, time_t* created_at);
+extern bool extract_nostr_event_sig(const PJsonFuncs funcs, const char* json, const jsontok_t* token, char* sig);
+
+// Count total tokens for a JSMN token subtree (including the token itself)
+static int count_value_tokens(const jsontok_t* token, int remaining)
+{
+  if (remaining <= 0) {
+    return 0;
+  }
+
+  if (token->type == JSMN_PRIMITIVE || token->type == JSMN_STRING) {
+    return 1;
+  }
+
+  int count    = 1;
+  int children = token->size;
+
+  if (token->type == JSMN_OBJECT) {
+    for (int i = 0; i < children && count < remaining; i++) {
+      count++;  // key token
+      count += count_value_tokens(&token[count], remaining - count);
+    }
+  } else if (token->type == JSMN_ARRAY) {
+    for (int i = 0; i < children && count < remaining; i++) {
+      count += count_value_tokens(&token[count], remaining - count);
+    }
+  }
+
+  return count;
+}
+
+static int32_t hex_char_value(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+static bool hex64_to_bytes(const char* hex, uint8_t* out)
+{
+  for (size_t i = 0; i < 32; i++) {
+    int32_t h = hex_char_value(hex[i * 2]);
+    int32_t l = hex_char_value(hex[i * 2 + 1]);
+    if (h < 0 || l < 0) {
+      return false;
+    }
+    out[i] = (uint8_t)((h << 4) | l);
+  }
+  return true;
+}
+
+// Decode the first value of every single-letter tag straight from the tokens
+static bool extract_match_tags(
+  const PJsonFuncs funcs,
+  const char*      json,
+  const jsontok_t* token,
+  int              remaining,
+  NostrMatchEvent* match)
+{
+  if (!funcs->is_array(token)) {
+    log_debug("Nostr Event Error: tags is not array\n");
+    return false;
+  }
+
+  match->tags_count = 0;
+
+  int idx = 1;
+  for (int i = 0; i < token->size && idx < remaining; i++) {
+    const jsontok_t* tag = &token[idx];
+    idx += count_value_tokens(tag, remaining - idx);
+
+    if (!funcs->is_array(tag)) {
+      log_debug("Nostr Event Error: tag is not array\n");
+      return false;
+    }
+
+    if (tag->size < 2 || match->tags_count >= NOSTR_MATCH_EVENT_MAX_TAGS) {
+      continue;
+    }
+
+    const jsontok_t* name  = &tag[1];
+    const jsontok_t* value = &tag[2];
+    if (!funcs->is_string(name) || !funcs->is_string(value)) {
+      continue;
+    }
+    if (funcs->get_token_length(name) != 1) {
+      continue;
+    }
+
+    char                tag_name  = json[name->start];
+    size_t              value_len = funcs->get_token_length(value);
+    NostrMatchEventTag* mtag      = &match->tags[match->tags_count];
+
+    internal_memset(mtag->value, 0, 32);
+    if (tag_name == 'e' || tag_name == 'p') {
+      if (value_len != 64 || !hex64_to_bytes(&json[value->start], mtag->value)) {
+        continue;
+      }
+      value_len = 32;
+    } else if (value_len > NOSTR_FILTER_LONG_TAG_VALUE_LENGTH) {
+      continue;
+    } else {
+      internal_memcpy(mtag->value, &json[value->start], value_len < 32 ? value_len : 32);
+    }
+
+    mtag->name   = tag_name;
+    mtag->length = (uint8_t)value_len;
+    mtag->raw    = &json[value->start];
+    match->tags_count++;
+  }
+
+  return true;
+}
+
+// Find the value token of a top-level event field by walking the key/value pairs
+static const jsontok_t* find_event_field(
+  const PJsonFuncs funcs,
+  const char*      json,
+  const jsontok_t* token,
+  const size_t     token_count,
+  const char*      key,
+  const size_t     key_len)
+{
+  for (int i = 0; i < (int)token_count;) {
+    int key_index   = i;
+    int value_index = i + 1;
+
+    if (value_index >= (int)token_count) {
+      break;
+    }
+
+    i += 1 + count_value_tokens(&token[value_index], (int)token_count - value_index);
+
+    if (funcs->is_string(&token[key_index]) &&
+        funcs->get_token_length(&token[key_index]) == key_len &&
+        funcs->strncmp(json, &token[key_index], key, key_len)) {
+      return &token[value_index];
+    }
+  }
+
+  return NULL;
+}
+
+bool nostr_event_peek_kind(
+  const PJsonFuncs funcs,
+  const char*      json,
+  const jsontok_t* token,
+  const size_t     token_count,
+  uint32_t*        kind)
+{
+  require_not_null(funcs, false);
+  require_not_null(json, false);
+  require_not_null(token, false);
+  require_not_null(kind, false);
+
+  const jsontok_t* value = find_event_field(funcs, json, token, token_count, "kind", 4);
+  if (value == NULL) {
+    return false;
+  }
+
+  return extract_nostr_event_kind(funcs, json, value, kind);
+}
+
+bool nostr_event_peek_tags_count(
+  const PJsonFuncs funcs,
+  const char*      json,
+  const jsontok_t* token,
+  const size_t     token_count,
+  size_t*          tags_count)
+{
+  require_not_null(funcs, false);
+  require_not_null(json, false);
+  require_not_null(token, false);
+  require_not_null(tags_count, false);
+
+  const jsontok_t* value = find_event_field(funcs, json, token, token_count, "tags", 4);
+  if (value == NULL || !funcs->is_array(value)) {
+    return false;
+  }
+
+  *tags_count = (size_t)value->size;
+  return true;
+}
+
+bool extract_nostr_ephemeral_event(
+  const PJsonFuncs     funcs,
+  const char*          json,
+  const jsontok_t*     object,
+  const size_t         token_count,
+  NostrEphemeralEvent* event)
+{
+  require_not_null(funcs, false);
+  require_not_null(json, false);
+  require_not_null(object, false);
+  require_not_null(event, false);
+
+  struct {
+    bool id;
+    bool pubkey;
+    bool kind;
+    bool created_at;
+    bool sig;
+    bool tags;
+    bool content;
+  } found;
+
+  internal_memset(&found, 0x00, sizeof(found));
+
+  const jsontok_t* token = &object[1];
+  int              count = (int)token_count - 1;
+
+  char   pubkey[65];
+  char   sig[129];
+  time_t created_at = 0;
+
+  for (int i = 0; i < count;) {
+    int key_index   = i;
+    int value_index = i + 1;
+
+    if (value_index >= count) {
+      break;
+    }
+
+    int value_tokens = count_value_tokens(&token[value_index], count - value_index);
+    i += 1 + value_tokens;
+
+    if (!funcs->is_string(&token[key_index])) {
+      log_debug("JSON error: key is not string\n");
+      return false;
+    }
+
+    if (funcs->strncmp(json, &token[key_index], "id", 2)) {
+      found.id = extract_nostr_event_id(funcs, json, &token[value_index], event->id);
+      if (!found.id || !hex64_to_bytes(event->id, event->match.id)) {
+        return false;
+      }
+      continue;
+    }
+
+    if (funcs->strncmp(json, &token[key_index], "pubkey", 6)) {
+      found.pubkey = extract_nostr_event_pubkey(funcs, json, &token[value_index], pubkey);
+      if (!found.pubkey || !hex64_to_bytes(pubkey, event->match.pubkey)) {
+        return false;
+      }
+      continue;
+    }
+
+    if (funcs->strncmp(json, &token[key_index], "kind", 4)) {
+      found.kind = extract_nostr_event_kind(funcs, json, &token[value_index], &event->match.kind);
+      if (!found.kind) {
+        return false;
+      }
+      continue;
+    }
+
+    if (funcs->strncmp(json, &token[key_index], "created_at", 10)) {
+      found.created_at = extract_nostr_event_created_at(funcs, json, &token[value_index], &created_at);
+      if (!found.created_at) {
+        return false;
+      }
+      continue;
+    }
+
+    if (funcs->strncmp(json, &token[key_index], "sig", 3)) {
+      found.sig = extract_nostr_event_sig(funcs, json, &token[value_index], sig);
+      if (!found.sig) {
+        return false;
+      }
+      continue;
+    }
+
+    if (funcs->strncmp(json, &token[key_index], "tags", 4)) {
+      found.tags = extract_match_tags(funcs, json, &token[value_index], value_tokens, &event->match);
+      if (!found.tags) {
+        return false;
+      }
+      continue;
+    }
+
+    if (funcs->strncmp(json, &token[key_index], "content", 7)) {
+      // Content is forwarded verbatim, so it only has to be a string
+      found.content = funcs->is_string(&token[value_index]);
+      if (!found.content) {
+        return false;
+      }
+      continue;
+    }
+  }
+
+  require(found.id, false);
+  require(found.pubkey, false);
+  require(found.kind, false);
+  require(found.created_at, false);
+  require(found.sig, false);
+  require(found.tags, false);
+  require(found.content, false);
+
+  event->match.id_valid     = true;
+  event->match.pubkey_valid = true;
+  event->match.created_at   = (int64_t)created_at;
+  event->json               = &json[object->start];
+  event->json_len           = (size_t)(object->end - object->start);
+
+  return true;
+}
@@ -0,0 +1,172 @@
+#include "nostr_verified_cache.h"
+
+#include "../../arch/memory.h"
+#include "../../arch/mmap.h"
+#include "../../util/log.h"
+#include "../../util/string.h"
+
+// ============================================================================
+// Helper: Convert hex char to value
+// ============================================================================
+static int32_t hex_char_value(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// ============================================================================
+// Helper: Decode 64-char hex event id to 32 bytes
+// ============================================================================
+static bool decode_id(const char* id_hex, uint8_t* out)
+{
+  for (size_t i = 0; i < 32; i++) {
+    int32_t h = hex_char_value(id_hex[i * 2]);
+    int32_t l = hex_char_value(id_hex[i * 2 + 1]);
+    if (h < 0 || l < 0) {
+      return false;
+    }
+    out[i] = (uint8_t)((h << 4) | l);
+  }
+  return true;
+}
+
+// ============================================================================
+// Helper: FNV-1a hash over the hex signature
+// ============================================================================
+static uint64_t hash_sig(const char* sig_hex)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < 128 && sig_hex[i] != '\0'; i++) {
+    hash ^= (uint8_t)sig_hex[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+// ============================================================================
+// Helper: Slot for an id (ids are SHA-256 digests, so any 8 bytes are uniform)
+// ============================================================================
+static inline NostrVerifiedCacheEntry* slot_for(const NostrVerifiedCache* cache, const uint8_t* id)
+{
+  uint64_t h = 0;
+  for (size_t i = 0; i < 8; i++) {
+    h = (h << 8) | id[i];
+  }
+  return &cache->entries[h & (cache->capacity - 1)];
+}
+
+// ============================================================================
+// Initialize cache (capacity is rounded up to a power of two)
+// ============================================================================
+bool nostr_verified_cache_init(NostrVerifiedCache* cache, size_t capacity)
+{
+  require_not_null(cache, false);
+
+  internal_memset(cache, 0, sizeof(NostrVerifiedCache));
+  if (capacity == 0) {
+    return true;  // Disabled
+  }
+
+  size_t rounded = 1;
+  while (rounded < capacity) {
+    rounded <<= 1;
+  }
+
+  size_t alloc_size = sizeof(NostrVerifiedCacheEntry) * rounded;
+  void*  ptr        = internal_mmap(NULL, alloc_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (ptr == MAP_FAILED) {
+    log_error("Failed to allocate verified event cache\n");
+    return false;
+  }
+
+  cache->entries  = (NostrVerifiedCacheEntry*)ptr;
+  cache->capacity = rounded;
+  return true;
+}
+
+// ============================================================================
+// Destroy cache
+// ============================================================================
+void nostr_verified_cache_destroy(NostrVerifiedCache* cache)
+{
+  if (cache == NULL) {
+    return;
+  }
+
+  if (cache->entries != NULL) {
+    internal_munmap(cache->entries, sizeof(NostrVerifiedCacheEntry) * cache->capacity);
+  }
+
+  internal_memset(cache, 0, sizeof(NostrVerifiedCache));
+}
+
+// ============================================================================
+// Check if an event was already verified
+// ============================================================================
+bool nostr_verified_cache_contains(NostrVerifiedCache* cache, const char* id_hex, const char* sig_hex)
+{
+  require_not_null(cache, false);
+  require_not_null(id_hex, false);
+  require_not_null(sig_hex, false);
+
+  if (cache->entries == NULL) {
+    return false;
+  }
+
+  uint8_t id[32];
+  if (!decode_id(id_hex, id)) {
+    return false;
+  }
+
+  NostrVerifiedCacheEntry* entry = slot_for(cache, id);
+
+  uint64_t seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+  bool     hit = false;
+  if (seq != 0 && (seq & 1) == 0) {
+    hit = entry->sig_hash == hash_sig(sig_hex) && internal_memcmp(entry->id, id, 32) == 0;
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&entry->seq, __ATOMIC_RELAXED) != seq) {
+      hit = false;  // Slot was rewritten while reading
+    }
+  }
+
+  if (hit) {
+    cache->hits++;
+  } else {
+    cache->misses++;
+  }
+  return hit;
+}
+
+// ============================================================================
+// Remember an event as verified
+// ============================================================================
+void nostr_verified_cache_insert(NostrVerifiedCache* cache, const char* id_hex, const char* sig_hex)
+{
+  if (cache == NULL || cache->entries == NULL || id_hex == NULL || sig_hex == NULL) {
+    return;
+  }
+
+  uint8_t id[32];
+  if (!decode_id(id_hex, id)) {
+    return;
+  }
+
+  NostrVerifiedCacheEntry* entry = slot_for(cache, id);
+
+  // Claim the slot; if another writer holds it, skip (it is only a cache)
+  uint64_t seq = __atomic_load_n(&entry->seq, __ATOMIC_RELAXED);
+  if ((seq & 1) != 0) {
+    return;
+  }
+  if (!__atomic_compare_exchange_n(&entry->seq, &seq, seq + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+    return;
+  }
+
+  internal_memcpy(entry->id, id, 32);
+  entry->sig_hash = hash_sig(sig_hex);
+
+  __atomic_store_n(&entry->seq, seq + 2, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,58 @@
+#ifndef NOSTR_VERIFIED_CACHE_H_
+#define NOSTR_VERIFIED_CACHE_H_
+
+#include "../../util/types.h"
+
+// ============================================================================
+// Constants
+// ============================================================================
+#define NOSTR_VERIFIED_CACHE_DEFAULT_ENTRIES 4096
+
+// ============================================================================
+// Cache entry
+//
+// seq is a per-slot sequence counter: 0 means empty, odd means a writer is
+// updating the slot, even and non-zero means id/sig_hash are published.
+// ============================================================================
+typedef struct {
+  uint64_t seq;
+  uint64_t sig_hash;
+  uint8_t  id[32];
+} NostrVerifiedCacheEntry;
+
+// ============================================================================
+// Recently-verified event cache
+//
+// Direct-mapped table of (event id, signature hash) pairs for events that
+// already passed validation and were accepted. Lookups and inserts never
+// block: readers validate the slot sequence instead of locking, writers
+// claim a slot with a single CAS and give up if another writer holds it.
+// ============================================================================
+typedef struct {
+  NostrVerifiedCacheEntry* entries;
+  size_t                   capacity;  // Power of two
+  uint64_t                 hits;
+  uint64_t                 misses;
+} NostrVerifiedCache, *PNostrVerifiedCache;
+
+// ============================================================================
+// Initialize cache (capacity is rounded up to a power of two)
+// ============================================================================
+bool nostr_verified_cache_init(NostrVerifiedCache* cache, size_t capacity);
+
+// ============================================================================
+// Destroy cache
+// ============================================================================
+void nostr_verified_cache_destroy(NostrVerifiedCache* cache);
+
+// ============================================================================
+// Check if an event (64-char hex id, 128-char hex sig) was already verified
+// ============================================================================
+bool nostr_verified_cache_contains(NostrVerifiedCache* cache, const char* id_hex, const char* sig_hex);
+
+// ============================================================================
+// Remember an event as verified
+// ============================================================================
+void nostr_verified_cache_insert(NostrVerifiedCache* cache, const char* id_hex, const char* sig_hex);
+
+#endif
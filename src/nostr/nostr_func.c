@@ -12,6 +12,64 @@
 static size_t append_string(char* buffer, size_t pos, size_t capacity, const char* str);
 static size_t append_json_string_field(char* buffer, size_t pos, size_t capacity, const char* key, const char* value, bool add_comma);
 static size_t append_json_nips_array(char* buffer, size_t pos, size_t capacity, const int* nips, bool add_comma);
+static size_t append_json_limitation(char* buffer, size_t pos, size_t capacity, const NostrRelayLimits* limits, bool add_comma);
+
+static bool report_limit(PNostrFuncs nostr_funcs, const char* subscription_id, const char* reason)
+{
+  log_debug("Nostr Error: admission limit exceeded\n");
+
+  if (nostr_funcs->limit_exceeded == NULL) {
+    return false;
+  }
+
+  NostrLimitViolation violation;
+  violation.subscription_id = subscription_id;
+  violation.reason          = reason;
+  nostr_funcs->limit_exceeded(&violation);
+  return true;
+}
+
+static bool exceeds(size_t limit, size_t value)
+{
+  return limit > 0 && value > limit;
+}
+
+// Structural REQ limits, read from the token tree before any filter is extracted
+static bool check_req_limits(
+  const PJsonFuncs funcs,
+  const char*      json,
+  const jsontok_t* token,
+  PNostrFuncs      nostr_funcs,
+  bool*            within)
+{
+  const NostrRelayLimits* limits = nostr_funcs->limits;
+
+  *within = true;
+  if (!funcs->is_string(&token[2])) {
+    return true;  // Left to the parser to reject
+  }
+
+  size_t subid_len = funcs->get_token_length(&token[2]);
+  if (exceeds(limits->max_subid_length, subid_len)) {
+    *within = false;
+    return report_limit(nostr_funcs, NULL, "invalid: subscription id too long");
+  }
+
+  size_t filters_count = (size_t)token[0].size - 2;
+  if (exceeds(limits->max_filters, filters_count)) {
+    *within = false;
+    if (subid_len == 0 || subid_len > NOSTR_REQ_SUBSCRIPTION_ID_LENGTH) {
+      return report_limit(nostr_funcs, NULL, "invalid: too many filters");
+    }
+
+    char subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+    websocket_memcpy(subscription_id, &json[token[2].start], subid_len);
+    subscription_id[subid_len] = '\0';
+    return report_limit(nostr_funcs, subscription_id, "invalid: too many filters");
+  }
+
+  return true;
+}
 
 bool nostr_event_handler(const char* json, PNostrFuncs nostr_funcs)
 {
@@ -25,6 +83,11 @@ bool nostr_event_handler(const char* json, PNostrFuncs nostr_funcs)
 
   size_t json_len = strlen(json);
 
+  const NostrRelayLimits* limits = nostr_funcs->limits;
+  if (limits != NULL && exceeds(limits->max_message_length, json_len)) {
+    return report_limit(nostr_funcs, NULL, "invalid: message too large");
+  }
+
   int32_t token_count = json_funcs.parse(
     &parser,
     json,
@@ -54,6 +117,27 @@ bool nostr_event_handler(const char* json, PNostrFuncs nostr_funcs)
       return false;
     }
 
+    size_t tags_count = 0;
+    if (limits != NULL && limits->max_event_tags > 0 &&
+        nostr_event_peek_tags_count(&json_funcs, json, &token[3], token_count - 3, &tags_count) &&
+        tags_count > limits->max_event_tags) {
+      return report_limit(nostr_funcs, NULL, "invalid: too many tags");
+    }
+
+    // Ephemeral kinds are pure fan-out: parse only what matching needs
+    uint32_t kind = 0;
+    if (nostr_funcs->ephemeral != NULL &&
+        nostr_event_peek_kind(&json_funcs, json, &token[3], token_count - 3, &kind) &&
+        is_ephemeral_kind(kind)) {
+      static NostrEphemeralEvent ephemeral;  // Holds the match view, too large for the stack
+      if (!extract_nostr_ephemeral_event(&json_funcs, json, &token[2], token_count - 2, &ephemeral)) {
+        log_debug("Nostr Event Error: Invalid ephemeral event\n");
+        return false;
+      }
+
+      return nostr_funcs->ephemeral(&ephemeral);
+    }
+
     NostrEventEntity* event = (NostrEventEntity*)internal_mmap(
       NULL, sizeof(NostrEventEntity), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
     if (event == MAP_FAILED) {
@@ -79,6 +163,14 @@ bool nostr_event_handler(const char* json, PNostrFuncs nostr_funcs)
   }
 
   if (json_funcs.strncmp(json, &token[1], "REQ", 3)) {
+    if (limits != NULL) {
+      bool within   = true;
+      bool reported = check_req_limits(&json_funcs, json, token, nostr_funcs, &within);
+      if (!within) {
+        return reported;
+      }
+    }
+
     // Parse REQ message
     NostrReqMessage* req = (NostrReqMessage*)internal_mmap(
       NULL, sizeof(NostrReqMessage), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
@@ -175,6 +267,56 @@ static size_t append_json_nips_array(char* buffer, size_t pos, size_t capacity,
   return pos;
 }
 
+static size_t append_json_number_field(char* buffer, size_t pos, size_t capacity, const char* key, size_t value, bool add_comma)
+{
+  char num_buf[24];
+  itoa((int32_t)value, num_buf, sizeof(num_buf));
+
+  if (add_comma) {
+    pos = append_string(buffer, pos, capacity, ",");
+  }
+  pos = append_string(buffer, pos, capacity, "\"");
+  pos = append_string(buffer, pos, capacity, key);
+  pos = append_string(buffer, pos, capacity, "\":");
+  pos = append_string(buffer, pos, capacity, num_buf);
+
+  return pos;
+}
+
+static size_t append_json_limitation(char* buffer, size_t pos, size_t capacity, const NostrRelayLimits* limits, bool add_comma)
+{
+  if (add_comma) {
+    pos = append_string(buffer, pos, capacity, ",");
+  }
+  pos = append_string(buffer, pos, capacity, "\"limitation\":{");
+
+  // Disabled limits (0) are not advertised
+  bool has_fields = false;
+  if (limits->max_message_length > 0) {
+    pos        = append_json_number_field(buffer, pos, capacity, "max_message_length", limits->max_message_length, has_fields);
+    has_fields = true;
+  }
+  if (limits->max_subscriptions > 0) {
+    pos        = append_json_number_field(buffer, pos, capacity, "max_subscriptions", limits->max_subscriptions, has_fields);
+    has_fields = true;
+  }
+  if (limits->max_filters > 0) {
+    pos        = append_json_number_field(buffer, pos, capacity, "max_filters", limits->max_filters, has_fields);
+    has_fields = true;
+  }
+  if (limits->max_subid_length > 0) {
+    pos        = append_json_number_field(buffer, pos, capacity, "max_subid_length", limits->max_subid_length, has_fields);
+    has_fields = true;
+  }
+  if (limits->max_event_tags > 0) {
+    pos = append_json_number_field(buffer, pos, capacity, "max_event_tags", limits->max_event_tags, has_fields);
+  }
+
+  pos = append_string(buffer, pos, capacity, "}");
+
+  return pos;
+}
+
 bool nostr_nip11_response(const PNostrRelayInfo info, const size_t buffer_capacity, char* buffer)
 {
   require_not_null(info, false);
@@ -218,6 +360,12 @@ bool nostr_nip11_response(const PNostrRelayInfo info, const size_t buffer_capaci
     has_fields = true;
   }
 
+  // Add limitation object
+  if (!is_null(info->limitation)) {
+    pos        = append_json_limitation(buffer, pos, buffer_capacity, info->limitation, has_fields);
+    has_fields = true;
+  }
+
   // Add software field
   if (!is_null(info->software)) {
     pos        = append_json_string_field(buffer, pos, buffer_capacity, "software", info->software, has_fields);
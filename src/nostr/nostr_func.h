@@ -5,19 +5,58 @@
 #include "../json/json_wrapper.h"
 #include "nostr_types.h"
 #include "subscription/nostr_close.h"
+#include "subscription/nostr_filter_types.h"
 #include "subscription/nostr_req.h"
 
+#define NOSTR_EPHEMERAL_KIND_MIN 20000
+#define NOSTR_EPHEMERAL_KIND_MAX 29999
+
+/**
+ * @brief Minimally parsed ephemeral event (kinds 20000-29999)
+ *
+ * Only what fan-out needs: the id for the OK reply, the binary match view,
+ * and the raw event object, which is forwarded to subscribers verbatim.
+ */
+typedef struct {
+  char            id[65];
+  char            dummy[7];
+  const char*     json;      ///< Raw event object inside the received message (not NUL-terminated)
+  size_t          json_len;  ///< Length of the raw event object
+  NostrMatchEvent match;     ///< Binary form for subscription matching
+} NostrEphemeralEvent, *PNostrEphemeralEvent;
+
+/**
+ * @brief Admission limit violation found before the message was fully parsed
+ */
+typedef struct {
+  const char* subscription_id;  ///< Set when the violation closes a REQ (reply CLOSED), NULL otherwise (reply NOTICE)
+  const char* reason;           ///< Human-readable reason with a NIP-01 machine-readable prefix
+} NostrLimitViolation, *PNostrLimitViolation;
+
 typedef bool (*PNostrEventCallback)(const NostrEventEntity* event);
+typedef bool (*PNostrEphemeralCallback)(const NostrEphemeralEvent* event);
 typedef bool (*PNostrReqCallback)(const NostrReqMessage* req);
 typedef bool (*PNostrCloseCallback)(const NostrCloseMessage* close_msg);
+typedef void (*PNostrLimitCallback)(const NostrLimitViolation* violation);
 
 typedef struct {
-  PNostrEventCallback event;
-  PNostrReqCallback   req;
-  PNostrCloseCallback close;
+  PNostrEventCallback     event;
+  PNostrReqCallback       req;
+  PNostrCloseCallback     close;
+  PNostrEphemeralCallback ephemeral;       ///< Optional. When set, ephemeral kinds skip NostrEventEntity entirely.
+  const NostrRelayLimits* limits;          ///< Optional. Checked right after tokenization, before extraction.
+  PNostrLimitCallback     limit_exceeded;  ///< Optional. Reports a limit violation; the message is dropped either way.
 } NostrFuncs, *PNostrFuncs;
 
+static inline bool is_ephemeral_kind(uint32_t kind)
+{
+  return kind >= NOSTR_EPHEMERAL_KIND_MIN && kind <= NOSTR_EPHEMERAL_KIND_MAX;
+}
+
 bool extract_nostr_event(const PJsonFuncs funcs, const char* json, const jsontok_t* token, const size_t token_count, NostrEventEntity* event);
+bool nostr_event_peek_kind(const PJsonFuncs funcs, const char* json, const jsontok_t* token, const size_t token_count, uint32_t* kind);
+bool nostr_event_peek_tags_count(const PJsonFuncs funcs, const char* json, const jsontok_t* token, const size_t token_count, size_t* tags_count);
+bool extract_nostr_ephemeral_event(const PJsonFuncs funcs, const char* json, const jsontok_t* object, const size_t token_count, NostrEphemeralEvent* event);
 bool nostr_event_handler(const char* json, PNostrFuncs nostr_funcs);
 
 /**
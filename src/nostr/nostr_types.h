@@ -13,6 +13,16 @@
 #define NOSTR_REQ_KINDS_LENGTH 512
 #define NOSTR_REQ_TAGS_LENGTH 512
 
+#define NOSTR_DEFAULT_MAX_MESSAGE_LENGTH (64 * 1024)
+#define NOSTR_DEFAULT_MAX_SUBSCRIPTIONS 20
+#define NOSTR_DEFAULT_MAX_FILTERS 16
+#define NOSTR_DEFAULT_MAX_SUBID_LENGTH 64
+#define NOSTR_DEFAULT_MAX_EVENT_TAGS 2000
+#define NOSTR_DEFAULT_MAX_TOTAL_SUBSCRIPTIONS 16384
+#define NOSTR_DEFAULT_MAX_QUEUED_PER_CONNECTION 4096
+#define NOSTR_DEFAULT_REQ_BUDGET 256
+#define NOSTR_DEFAULT_QUERY_CACHE_ENTRIES 256
+
 typedef struct {
   char   key[64];
   char   values[NOSTR_EVENT_TAG_VALUE_COUNT][NOSTR_EVENT_TAG_VALUE_LENGTH];
@@ -43,6 +53,26 @@ typedef struct {
   size_t   limit;
 } NostrReqEntity, *PNostrReqEntity;
 
+/**
+ * @brief Admission limits, checked before a message is fully parsed (0 disables a limit)
+ */
+typedef struct {
+  size_t max_message_length;  ///< Max websocket payload bytes, checked at frame header decode
+  size_t max_subscriptions;   ///< Max open subscriptions per connection
+  size_t max_filters;         ///< Max filters in one REQ
+  size_t max_subid_length;    ///< Max subscription id length
+  size_t max_event_tags;      ///< Max tags in one EVENT
+} NostrRelayLimits, *PNostrRelayLimits;
+
+/**
+ * @brief What to do with a connection whose queued live events exceed its budget
+ */
+typedef enum {
+  NOSTR_SLOW_CONSUMER_DROP_OLDEST = 0,  ///< Drop its oldest queued events and send a NOTICE
+  NOSTR_SLOW_CONSUMER_CLOSE       = 1,  ///< Close the overflowing subscription with CLOSED "rate-limited: ..."
+  NOSTR_SLOW_CONSUMER_DISCONNECT  = 2,  ///< Drop the connection
+} NostrSlowConsumerPolicy;
+
 /**
  * @brief NIP-11 relay information document structure
  */
@@ -54,6 +84,25 @@ typedef struct {
   const char* software;        ///< URL to relay software project
   const char* version;         ///< Software version
   const int*  supported_nips;  ///< Array of supported NIP numbers (NULL-terminated with -1)
+
+  const NostrRelayLimits* limitation;  ///< Advertised as "limitation" (NULL omits it)
 } NostrRelayInfo, *PNostrRelayInfo;
 
+/**
+ * @brief Relay runtime configuration
+ */
+typedef struct {
+  size_t                  verified_cache_entries;     ///< Slots in the recently-verified event cache (0 disables it)
+  size_t                  max_total_subscriptions;    ///< Relay-wide subscription cap (all connections)
+  size_t                  fanout_budget;              ///< EVENT deliveries sent per event loop iteration (0 = drain all)
+  size_t                  req_budget;                 ///< Index entries and stored events read per event loop iteration for REQs (0 = run each REQ until its socket blocks)
+  size_t                  fanout_deliveries;          ///< Deliveries the fan-out queue can hold
+  size_t                  fanout_arena_bytes;         ///< Bytes of queued event payloads
+  size_t                  max_queued_per_connection;  ///< Live events one connection may have queued (0 = unlimited)
+  NostrSlowConsumerPolicy slow_consumer_policy;       ///< Applied when a connection exceeds its queue budget
+  bool                    store_event_json;           ///< Keep stored events' JSON in their records (faster reads, larger file)
+  size_t                  query_cache_entries;        ///< REQ filters whose results are cached (0 disables the cache)
+  NostrRelayLimits        limits;                     ///< Admission limits
+} NostrRelayConfig, *PNostrRelayConfig;
+
 #endif
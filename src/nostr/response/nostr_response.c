@@ -3,6 +3,7 @@
 #include "../../arch/memory.h"
 #include "../../util/log.h"
 #include "../../util/string.h"
+#include "../db/record/event_json.h"
 
 // ============================================================================
 // Helper: Copy string to buffer with bounds check
@@ -354,28 +355,19 @@ static size_t serialize_tags(
 }
 
 // ============================================================================
-// Generate EVENT response: ["EVENT", "<subscription_id>", <event>]
+// Helper: Serialize the event object {"id":...,"sig":...}
+// Returns number of characters that WOULD be written
 // ============================================================================
-bool nostr_response_event(
-  const char*             subscription_id,
-  const NostrEventEntity* event,
+static size_t serialize_event_object(
   char*                   buffer,
-  size_t                  capacity)
+  size_t                  capacity,
+  size_t                  offset,
+  const NostrEventEntity* event)
 {
-  require_not_null(subscription_id, false);
-  require_not_null(event, false);
-  require_not_null(buffer, false);
-  require(capacity > 0, false);
-
-  size_t pos = 0;
-
-  // Start array and EVENT type
-  pos += safe_copy(buffer, capacity, pos, "[\"EVENT\",\"");
-  pos += safe_copy_json_escaped(buffer, capacity, pos, subscription_id);
-  pos += safe_copy(buffer, capacity, pos, "\",{");
+  size_t pos = offset;
 
   // id field
-  pos += safe_copy(buffer, capacity, pos, "\"id\":\"");
+  pos += safe_copy(buffer, capacity, pos, "{\"id\":\"");
   pos += safe_copy(buffer, capacity, pos, event->id);
   pos += safe_copy(buffer, capacity, pos, "\",");
 
@@ -407,10 +399,101 @@ bool nostr_response_event(
   // sig field
   pos += safe_copy(buffer, capacity, pos, "\"sig\":\"");
   pos += safe_copy(buffer, capacity, pos, event->sig);
-  pos += safe_copy(buffer, capacity, pos, "\"");
+  pos += safe_copy(buffer, capacity, pos, "\"}");
+
+  return pos - offset;
+}
+
+// ============================================================================
+// Generate EVENT response: ["EVENT", "<subscription_id>", <event>]
+// ============================================================================
+bool nostr_response_event(
+  const char*             subscription_id,
+  const NostrEventEntity* event,
+  char*                   buffer,
+  size_t                  capacity)
+{
+  require_not_null(subscription_id, false);
+  require_not_null(event, false);
+  require_not_null(buffer, false);
+  require(capacity > 0, false);
+
+  size_t pos = 0;
+
+  // Start array and EVENT type
+  pos += safe_copy(buffer, capacity, pos, "[\"EVENT\",\"");
+  pos += safe_copy_json_escaped(buffer, capacity, pos, subscription_id);
+  pos += safe_copy(buffer, capacity, pos, "\",");
+
+  pos += serialize_event_object(buffer, capacity, pos, event);
+
+  // Close array
+  pos += safe_copy(buffer, capacity, pos, "]");
+
+  if (pos < capacity) {
+    buffer[pos] = '\0';
+  } else {
+    buffer[capacity - 1] = '\0';
+    return false;
+  }
+
+  return true;
+}
+
+// ============================================================================
+// Serialize the event object alone (for nostr_response_event_raw)
+// ============================================================================
+size_t nostr_response_event_object(
+  const NostrEventEntity* event,
+  char*                   buffer,
+  size_t                  capacity)
+{
+  require_not_null(event, 0);
+  require_not_null(buffer, 0);
+  require(capacity > 0, 0);
+
+  size_t pos = serialize_event_object(buffer, capacity, 0, event);
+
+  if (pos < capacity) {
+    buffer[pos] = '\0';
+  } else {
+    buffer[capacity - 1] = '\0';
+    return 0;
+  }
+
+  return pos;
+}
+
+// ============================================================================
+// Generate EVENT response from an already-serialized event object
+// ============================================================================
+bool nostr_response_event_raw(
+  const char* subscription_id,
+  const char* event_json,
+  size_t      event_json_len,
+  char*       buffer,
+  size_t      capacity)
+{
+  require_not_null(subscription_id, false);
+  require_not_null(event_json, false);
+  require_not_null(buffer, false);
+  require(capacity > 0, false);
+
+  size_t pos = 0;
 
-  // Close event object and array
-  pos += safe_copy(buffer, capacity, pos, "}]");
+  pos += safe_copy(buffer, capacity, pos, "[\"EVENT\",\"");
+  pos += safe_copy_json_escaped(buffer, capacity, pos, subscription_id);
+  pos += safe_copy(buffer, capacity, pos, "\",");
+
+  // Event object is forwarded verbatim (need room for "]" and terminator)
+  if (pos + event_json_len + 2 > capacity) {
+    buffer[capacity - 1] = '\0';
+    return false;
+  }
+  internal_memcpy(buffer + pos, event_json, event_json_len);
+  pos += event_json_len;
+
+  pos += safe_copy(buffer, capacity, pos, "]");
 
   if (pos < capacity) {
     buffer[pos] = '\0';
@@ -421,3 +504,41 @@ bool nostr_response_event(
 
   return true;
 }
+
+// ============================================================================
+// Generate EVENT response from a stored event record
+// ============================================================================
+size_t nostr_response_event_record(
+  const char*    subscription_id,
+  const uint8_t* record,
+  uint16_t       record_length,
+  char*          buffer,
+  size_t         capacity)
+{
+  require_not_null(subscription_id, 0);
+  require_not_null(record, 0);
+  require_not_null(buffer, 0);
+  require(capacity > 0, 0);
+
+  size_t pos = 0;
+
+  pos += safe_copy(buffer, capacity, pos, "[\"EVENT\",\"");
+  pos += safe_copy_json_escaped(buffer, capacity, pos, subscription_id);
+  pos += safe_copy(buffer, capacity, pos, "\",");
+
+  // Event object is written in place (keep room for "]" and terminator)
+  if (pos + 2 >= capacity) {
+    buffer[capacity - 1] = '\0';
+    return 0;
+  }
+  size_t object_len = event_json_write(record, record_length, buffer + pos, capacity - pos - 2);
+  if (object_len == 0) {
+    buffer[pos] = '\0';
+    return 0;
+  }
+  pos += object_len;
+
+  buffer[pos++] = ']';
+  buffer[pos]   = '\0';
+  return pos;
+}
@@ -13,6 +13,38 @@ bool nostr_response_event(
   char*                   buffer,
   size_t                  capacity);
 
+// ============================================================================
+// Serialize the event object alone: {"id": ..., "sig": ...}
+// Returns the length written (0 if it does not fit)
+// ============================================================================
+size_t nostr_response_event_object(
+  const NostrEventEntity* event,
+  char*                   buffer,
+  size_t                  capacity);
+
+// ============================================================================
+// Generate EVENT response from an already-serialized event object:
+// ["EVENT", "<subscription_id>", <event_json>]
+// ============================================================================
+bool nostr_response_event_raw(
+  const char* subscription_id,
+  const char* event_json,
+  size_t      event_json_len,
+  char*       buffer,
+  size_t      capacity);
+
+// ============================================================================
+// Generate EVENT response straight from a stored event record (EventRecord +
+// content + tags), without deserializing it
+// Returns the length written (0 if it does not fit or the record is malformed)
+// ============================================================================
+size_t nostr_response_event_record(
+  const char*    subscription_id,
+  const uint8_t* record,
+  uint16_t       record_length,
+  char*          buffer,
+  size_t         capacity);
+
 // ============================================================================
 // Generate EOSE response: ["EOSE", "<subscription_id>"]
 // ============================================================================
@@ -0,0 +1,712 @@
+#include "nostr_fanout.h"
+
+#include "../../arch/memory.h"
+#include "../../arch/mmap.h"
+#include "../../util/log.h"
+#include "../../util/string.h"
+
+#define FANOUT_NIL NOSTR_FANOUT_NIL
+#define FANOUT_INITIAL_CONNECTIONS 1024
+
+// ============================================================================
+// Helper: Allocate / free zeroed anonymous memory
+// ============================================================================
+static void* fanout_alloc(size_t size)
+{
+  void* ptr = internal_mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static void fanout_free(void* ptr, size_t size)
+{
+  if (ptr != NULL) {
+    internal_munmap(ptr, size);
+  }
+}
+
+// ============================================================================
+// Initialize queue
+// ============================================================================
+bool nostr_fanout_init(NostrFanoutQueue* queue, size_t max_deliveries, size_t arena_bytes)
+{
+  require_not_null(queue, false);
+
+  internal_memset(queue, 0, sizeof(NostrFanoutQueue));
+  require_valid_length(max_deliveries, false);
+  require_valid_length(arena_bytes, false);
+  require(max_deliveries < FANOUT_NIL, false);
+
+  queue->capacity             = max_deliveries;
+  queue->arena_capacity       = arena_bytes;
+  queue->connections_capacity = FANOUT_INITIAL_CONNECTIONS;
+  queue->open_event           = FANOUT_NIL;
+  queue->policy               = NOSTR_SLOW_CONSUMER_DROP_OLDEST;
+
+  queue->deliveries  = (NostrFanoutDelivery*)fanout_alloc(sizeof(NostrFanoutDelivery) * max_deliveries);
+  queue->events      = (NostrFanoutEvent*)fanout_alloc(sizeof(NostrFanoutEvent) * max_deliveries);
+  queue->arena       = (char*)fanout_alloc(arena_bytes);
+  queue->connections = (NostrFanoutConnection*)fanout_alloc(sizeof(NostrFanoutConnection) * queue->connections_capacity);
+
+  if (queue->deliveries == NULL || queue->events == NULL || queue->arena == NULL || queue->connections == NULL) {
+    log_error("Failed to allocate fan-out queue\n");
+    nostr_fanout_destroy(queue);
+    return false;
+  }
+
+  return true;
+}
+
+// ============================================================================
+// Destroy queue (pending deliveries are discarded)
+// ============================================================================
+void nostr_fanout_destroy(NostrFanoutQueue* queue)
+{
+  if (queue == NULL) {
+    return;
+  }
+
+  fanout_free(queue->deliveries, sizeof(NostrFanoutDelivery) * queue->capacity);
+  fanout_free(queue->events, sizeof(NostrFanoutEvent) * queue->capacity);
+  fanout_free(queue->arena, queue->arena_capacity);
+  fanout_free(queue->connections, sizeof(NostrFanoutConnection) * queue->connections_capacity);
+
+  internal_memset(queue, 0, sizeof(NostrFanoutQueue));
+}
+
+// ============================================================================
+// Set the per-connection budget and the slow-consumer policy
+// ============================================================================
+void nostr_fanout_set_policy(NostrFanoutQueue* queue, NostrSlowConsumerPolicy policy, size_t max_per_connection)
+{
+  if (queue == NULL) {
+    return;
+  }
+
+  queue->policy             = policy;
+  queue->max_per_connection = max_per_connection;
+}
+
+// ============================================================================
+// Helper: Output state for a client (optionally growing the fd table)
+// ============================================================================
+static NostrFanoutConnection* connection_for(NostrFanoutQueue* queue, int32_t client_fd, bool create)
+{
+  if (client_fd < 0) {
+    return NULL;
+  }
+
+  if ((size_t)client_fd >= queue->connections_capacity) {
+    if (!create) {
+      return NULL;
+    }
+
+    size_t capacity = queue->connections_capacity;
+    while ((size_t)client_fd >= capacity) {
+      capacity <<= 1;
+    }
+
+    void* ptr = internal_mremap(
+      queue->connections,
+      sizeof(NostrFanoutConnection) * queue->connections_capacity,
+      sizeof(NostrFanoutConnection) * capacity,
+      MREMAP_MAYMOVE);
+    if (ptr == MAP_FAILED) {
+      log_error("Failed to grow fan-out connection table\n");
+      return NULL;
+    }
+
+    // Pages added by mremap are zero-filled
+    queue->connections          = (NostrFanoutConnection*)ptr;
+    queue->connections_capacity = capacity;
+  }
+
+  return &queue->connections[client_fd];
+}
+
+// ============================================================================
+// Helper: Reserve payload bytes at the arena tail (wrapping to the start)
+// Live payloads are [head, tail) when unwrapped, [head, end) + [0, tail) when wrapped
+// ============================================================================
+static bool arena_reserve(NostrFanoutQueue* queue, size_t length, size_t* offset)
+{
+  if (queue->events_count == 0) {
+    queue->arena_head = 0;
+    queue->arena_tail = 0;
+  }
+
+  bool wrapped = queue->events_count > 0 && queue->arena_tail <= queue->arena_head;
+
+  if (!wrapped) {
+    if (queue->arena_capacity - queue->arena_tail >= length) {
+      *offset = queue->arena_tail;
+    } else if (queue->events_count > 0 && queue->arena_head >= length) {
+      *offset = 0;
+    } else {
+      return false;
+    }
+  } else if (queue->arena_head - queue->arena_tail >= length) {
+    *offset = queue->arena_tail;
+  } else {
+    return false;
+  }
+
+  queue->arena_tail = *offset + length;
+  return true;
+}
+
+// ============================================================================
+// Helper: Release finished events from the front of the event ring
+// ============================================================================
+static void release_sent_events(NostrFanoutQueue* queue)
+{
+  while (queue->events_count > 0) {
+    uint32_t slot = (uint32_t)queue->events_head;
+    if (slot == queue->open_event || queue->events[slot].pending > 0) {
+      break;
+    }
+
+    queue->events_head = (queue->events_head + 1) % queue->capacity;
+    queue->events_count--;
+
+    if (queue->events_count > 0) {
+      queue->arena_head = queue->events[queue->events_head].offset;
+    }
+  }
+}
+
+// ============================================================================
+// Helper: Append a delivery at the ring tail (caller checks for room)
+// ============================================================================
+static void append_delivery(
+  NostrFanoutQueue*      queue,
+  NostrFanoutConnection* conn,
+  int32_t                client_fd,
+  NostrFanoutFrameType   type,
+  uint32_t               event,
+  const char*            subscription_id,
+  size_t                 id_len)
+{
+  NostrFanoutDelivery* delivery = &queue->deliveries[(queue->head + queue->count) % queue->capacity];
+  delivery->client_fd           = client_fd;
+  delivery->event               = event;
+  delivery->type                = (uint8_t)type;
+  internal_memcpy(delivery->subscription_id, subscription_id, id_len);
+  delivery->subscription_id[id_len] = '\0';
+
+  if (event != FANOUT_NIL) {
+    queue->events[event].pending++;
+  }
+  conn->queued++;
+  queue->count++;
+}
+
+// ============================================================================
+// Helper: Queue a NOTICE / CLOSED frame (skipped if the ring is full)
+// ============================================================================
+static void append_control(
+  NostrFanoutQueue*      queue,
+  NostrFanoutConnection* conn,
+  int32_t                client_fd,
+  NostrFanoutFrameType   type,
+  const char*            subscription_id)
+{
+  if (queue->count >= queue->capacity) {
+    return;
+  }
+
+  append_delivery(queue, conn, client_fd, type, FANOUT_NIL, subscription_id, strlen(subscription_id));
+}
+
+// ============================================================================
+// Helper: Which deliveries of one connection to cancel
+// ============================================================================
+typedef struct {
+  int32_t     client_fd;
+  uint32_t    event;            // Only deliveries of this event (NIL = any)
+  const char* subscription_id;  // Only this subscription (NULL = any)
+  size_t      limit;            // Stop after this many (0 = all)
+  bool        events_only;      // Keep NOTICE / CLOSED frames
+  bool        keep_in_flight;   // Keep a partially written front frame
+} CancelSpec;
+
+// ============================================================================
+// Helper: Cancel matching deliveries, compacting the ring in place (order kept)
+// ============================================================================
+static size_t cancel_deliveries(NostrFanoutQueue* queue, NostrFanoutConnection* conn, const CancelSpec* spec)
+{
+  size_t cancelled = 0;
+  size_t write     = 0;
+  bool   front     = true;
+  size_t id_len    = spec->subscription_id != NULL ? strlen(spec->subscription_id) + 1 : 0;
+
+  for (size_t read = 0; read < queue->count; read++) {
+    NostrFanoutDelivery* delivery = &queue->deliveries[(queue->head + read) % queue->capacity];
+
+    bool cancel = delivery->client_fd == spec->client_fd;
+    if (cancel) {
+      bool in_flight = front && conn->resume > 0;
+      front          = false;
+
+      if (in_flight && spec->keep_in_flight) {
+        cancel = false;
+      } else if (spec->events_only && delivery->type != NOSTR_FANOUT_FRAME_EVENT) {
+        cancel = false;
+      } else if (spec->event != FANOUT_NIL && delivery->event != spec->event) {
+        cancel = false;
+      } else if (id_len > 0 && internal_memcmp(delivery->subscription_id, spec->subscription_id, id_len) != 0) {
+        cancel = false;
+      } else if (spec->limit > 0 && cancelled >= spec->limit) {
+        cancel = false;
+      } else if (in_flight) {
+        conn->resume = 0;
+      }
+    }
+
+    if (cancel) {
+      if (delivery->event != FANOUT_NIL) {
+        queue->events[delivery->event].pending--;
+      }
+      conn->queued--;
+      cancelled++;
+      continue;
+    }
+
+    if (write != read) {
+      queue->deliveries[(queue->head + write) % queue->capacity] = *delivery;
+    }
+    write++;
+  }
+
+  queue->count = write;
+  if (conn->queued == 0) {
+    conn->noticed = false;
+  }
+
+  release_sent_events(queue);
+  return cancelled;
+}
+
+// ============================================================================
+// Helper: Drop the connection's oldest events and tell it once per backlog
+// ============================================================================
+static size_t drop_oldest(NostrFanoutQueue* queue, NostrFanoutConnection* conn, int32_t client_fd, uint32_t event, size_t limit)
+{
+  CancelSpec spec;
+  spec.client_fd       = client_fd;
+  spec.event           = event;
+  spec.subscription_id = NULL;
+  spec.limit           = limit;
+  spec.events_only     = true;
+  spec.keep_in_flight  = true;
+
+  size_t dropped = cancel_deliveries(queue, conn, &spec);
+  queue->dropped += dropped;
+
+  if (dropped > 0 && !conn->noticed) {
+    append_control(queue, conn, client_fd, NOSTR_FANOUT_FRAME_NOTICE, "");
+    conn->noticed = true;
+    queue->notices++;
+  }
+
+  return dropped;
+}
+
+// ============================================================================
+// Helper: Cancel the subscription's queued events and queue its CLOSED
+// ============================================================================
+static void close_subscription(NostrFanoutQueue* queue, NostrFanoutConnection* conn, int32_t client_fd, const char* subscription_id)
+{
+  CancelSpec spec;
+  spec.client_fd       = client_fd;
+  spec.event           = FANOUT_NIL;
+  spec.subscription_id = subscription_id;
+  spec.limit           = 0;
+  spec.events_only     = true;
+  spec.keep_in_flight  = true;
+
+  cancel_deliveries(queue, conn, &spec);
+  append_control(queue, conn, client_fd, NOSTR_FANOUT_FRAME_CLOSED, subscription_id);
+  queue->closed++;
+}
+
+// ============================================================================
+// Helper: Cancel everything for the connection and refuse further frames
+// ============================================================================
+static void disconnect_connection(NostrFanoutQueue* queue, NostrFanoutConnection* conn, int32_t client_fd)
+{
+  CancelSpec spec;
+  spec.client_fd       = client_fd;
+  spec.event           = FANOUT_NIL;
+  spec.subscription_id = NULL;
+  spec.limit           = 0;
+  spec.events_only     = false;
+  spec.keep_in_flight  = false;
+
+  cancel_deliveries(queue, conn, &spec);
+  conn->resume   = 0;
+  conn->dropping = true;
+  queue->disconnected++;
+}
+
+// ============================================================================
+// Helper: Copy a payload into a new slot at the event ring tail
+// Returns the slot, NIL if the event ring or arena has no room
+// ============================================================================
+static uint32_t append_event(NostrFanoutQueue* queue, const char* payload, size_t length)
+{
+  if (queue->events_count >= queue->capacity) {
+    return FANOUT_NIL;
+  }
+
+  size_t offset;
+  if (!arena_reserve(queue, length, &offset)) {
+    return FANOUT_NIL;
+  }
+  internal_memcpy(queue->arena + offset, payload, length);
+
+  uint32_t          slot = (uint32_t)((queue->events_head + queue->events_count) % queue->capacity);
+  NostrFanoutEvent* ev   = &queue->events[slot];
+  ev->offset             = offset;
+  ev->length             = length;
+  ev->pending            = 0;
+
+  if (queue->events_count == 0) {
+    queue->arena_head = offset;
+  }
+  queue->events_count++;
+  return slot;
+}
+
+// ============================================================================
+// Start queuing an event
+// ============================================================================
+bool nostr_fanout_begin(NostrFanoutQueue* queue, const char* event_json, size_t event_json_len)
+{
+  require_not_null(queue, false);
+  require_not_null(queue->arena, false);
+  require_not_null(event_json, false);
+  require_valid_length(event_json_len, false);
+  require(queue->open_event == FANOUT_NIL, false);
+
+  size_t   tail = queue->events_count > 0 ? queue->arena_tail : 0;
+  uint32_t slot = append_event(queue, event_json, event_json_len);
+  if (slot == FANOUT_NIL) {
+    return false;
+  }
+
+  queue->open_event = slot;
+  queue->open_tail  = tail;
+  return true;
+}
+
+// ============================================================================
+// Queue a delivery of the open event
+// ============================================================================
+NostrFanoutPushResult nostr_fanout_push(NostrFanoutQueue* queue, int32_t client_fd, const char* subscription_id)
+{
+  require_not_null(queue, NOSTR_FANOUT_DROPPED);
+  require_not_null(subscription_id, NOSTR_FANOUT_DROPPED);
+  require(queue->open_event != FANOUT_NIL, NOSTR_FANOUT_DROPPED);
+
+  size_t id_len = strlen(subscription_id);
+  if (id_len > NOSTR_REQ_SUBSCRIPTION_ID_LENGTH) {
+    return NOSTR_FANOUT_DROPPED;
+  }
+
+  NostrFanoutConnection* conn = connection_for(queue, client_fd, true);
+  if (conn == NULL || conn->dropping) {
+    return NOSTR_FANOUT_DROPPED;
+  }
+
+  if (queue->max_per_connection > 0 && conn->queued >= queue->max_per_connection) {
+    switch (queue->policy) {
+      case NOSTR_SLOW_CONSUMER_CLOSE:
+        close_subscription(queue, conn, client_fd, subscription_id);
+        return NOSTR_FANOUT_CLOSE;
+      case NOSTR_SLOW_CONSUMER_DISCONNECT:
+        disconnect_connection(queue, conn, client_fd);
+        return NOSTR_FANOUT_DISCONNECT;
+      case NOSTR_SLOW_CONSUMER_DROP_OLDEST:
+      default:
+        // Drop to half the budget so the scan is paid once per many events
+        drop_oldest(queue, conn, client_fd, FANOUT_NIL, conn->queued - queue->max_per_connection / 2);
+        break;
+    }
+  }
+
+  if (queue->count >= queue->capacity) {
+    return NOSTR_FANOUT_FULL;
+  }
+
+  append_delivery(queue, conn, client_fd, NOSTR_FANOUT_FRAME_EVENT, queue->open_event, subscription_id, id_len);
+  queue->enqueued++;
+  return NOSTR_FANOUT_QUEUED;
+}
+
+// ============================================================================
+// Finish the open event
+// ============================================================================
+void nostr_fanout_end(NostrFanoutQueue* queue)
+{
+  if (queue == NULL || queue->open_event == FANOUT_NIL) {
+    return;
+  }
+
+  uint32_t          slot = queue->open_event;
+  NostrFanoutEvent* ev   = &queue->events[slot];
+  queue->open_event      = FANOUT_NIL;
+
+  if (ev->pending > 0) {
+    return;
+  }
+
+  // Nothing queued: the open event is the newest, give its payload back
+  queue->events_count--;
+  queue->arena_tail = queue->open_tail;
+  release_sent_events(queue);
+}
+
+// ============================================================================
+// Queue a protocol reply behind the connection's pending frames
+// ============================================================================
+NostrFanoutPushResult nostr_fanout_push_reply(
+  NostrFanoutQueue* queue,
+  int32_t           client_fd,
+  const char*       message,
+  size_t            message_len,
+  uint32_t          written)
+{
+  require_not_null(queue, NOSTR_FANOUT_DROPPED);
+  require_not_null(queue->arena, NOSTR_FANOUT_DROPPED);
+  require_not_null(message, NOSTR_FANOUT_DROPPED);
+  require_valid_length(message_len, NOSTR_FANOUT_DROPPED);
+  require(queue->open_event == FANOUT_NIL, NOSTR_FANOUT_DROPPED);
+
+  NostrFanoutConnection* conn = connection_for(queue, client_fd, true);
+  if (conn == NULL || conn->dropping) {
+    return NOSTR_FANOUT_DROPPED;
+  }
+  require(written == 0 || conn->queued == 0, NOSTR_FANOUT_DROPPED);
+
+  // A reply cannot be dropped: shed the connection's oldest events, or drop the connection
+  if (queue->max_per_connection > 0 && conn->queued >= queue->max_per_connection) {
+    if (queue->policy != NOSTR_SLOW_CONSUMER_DROP_OLDEST ||
+        drop_oldest(queue, conn, client_fd, FANOUT_NIL, conn->queued - queue->max_per_connection / 2) == 0) {
+      disconnect_connection(queue, conn, client_fd);
+      return NOSTR_FANOUT_DISCONNECT;
+    }
+  }
+
+  if (queue->count >= queue->capacity) {
+    return NOSTR_FANOUT_FULL;
+  }
+
+  uint32_t slot = append_event(queue, message, message_len);
+  if (slot == FANOUT_NIL) {
+    return NOSTR_FANOUT_FULL;
+  }
+
+  append_delivery(queue, conn, client_fd, NOSTR_FANOUT_FRAME_REPLY, slot, "", 0);
+  if (written > 0) {
+    conn->resume = written;
+  }
+  queue->enqueued++;
+  return NOSTR_FANOUT_QUEUED;
+}
+
+// ============================================================================
+// Send up to budget frames, oldest first per connection
+// ============================================================================
+size_t nostr_fanout_drain(
+  NostrFanoutQueue*       queue,
+  size_t                  budget,
+  NostrFanoutSendCallback send,
+  void*                   user_data)
+{
+  require_not_null(queue, 0);
+  require_not_null(send, 0);
+
+  queue->pass++;
+
+  size_t sent    = 0;
+  size_t visible = queue->count;  // Each delivery is looked at once per pass
+  while (visible > 0 && queue->count > 0 && (budget == 0 || sent < budget)) {
+    NostrFanoutDelivery delivery = queue->deliveries[queue->head];
+    queue->head                  = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    visible--;
+
+    NostrFanoutConnection* conn = connection_for(queue, delivery.client_fd, false);
+
+    // Blocked earlier in this pass: keep it, behind the rest, in order
+    if (conn != NULL && conn->blocked_pass == queue->pass) {
+      queue->deliveries[(queue->head + queue->count) % queue->capacity] = delivery;
+      queue->count++;
+      continue;
+    }
+
+    const char* event_json     = NULL;
+    size_t      event_json_len = 0;
+    if (delivery.event != FANOUT_NIL) {
+      event_json     = queue->arena + queue->events[delivery.event].offset;
+      event_json_len = queue->events[delivery.event].length;
+    }
+
+    uint32_t              resume = conn != NULL ? conn->resume : 0;
+    NostrFanoutSendResult result = send(
+      delivery.client_fd,
+      (NostrFanoutFrameType)delivery.type,
+      delivery.subscription_id,
+      event_json,
+      event_json_len,
+      &resume,
+      user_data);
+
+    if (result == NOSTR_FANOUT_BLOCKED && conn != NULL) {
+      conn->resume       = resume;
+      conn->blocked_pass = queue->pass;
+      queue->blocked++;
+      queue->deliveries[(queue->head + queue->count) % queue->capacity] = delivery;
+      queue->count++;
+      continue;
+    }
+
+    if (conn != NULL) {
+      conn->resume = 0;
+      conn->queued--;
+      if (conn->queued == 0) {
+        conn->noticed = false;
+      }
+    }
+    if (delivery.event != FANOUT_NIL) {
+      queue->events[delivery.event].pending--;
+    }
+    if (result == NOSTR_FANOUT_SENT) {
+      queue->delivered++;
+      sent++;
+    }
+
+    release_sent_events(queue);
+  }
+
+  return sent;
+}
+
+// ============================================================================
+// Shed the oldest queued event through the slow-consumer policy
+// ============================================================================
+bool nostr_fanout_shed_oldest(NostrFanoutQueue* queue, NostrFanoutActionCallback on_action, void* user_data)
+{
+  require_not_null(queue, false);
+
+  if (queue->events_count == 0 || queue->events_head == queue->open_event) {
+    return false;
+  }
+
+  uint32_t oldest = (uint32_t)queue->events_head;
+  size_t   before = queue->events_count;
+
+  while (queue->events_count == before && queue->events[oldest].pending > 0) {
+    // Find a delivery still holding the oldest event
+    NostrFanoutDelivery* holder = NULL;
+    for (size_t i = 0; i < queue->count; i++) {
+      NostrFanoutDelivery* delivery = &queue->deliveries[(queue->head + i) % queue->capacity];
+      if (delivery->event == oldest) {
+        holder = delivery;
+        break;
+      }
+    }
+    if (holder == NULL) {
+      return false;
+    }
+
+    int32_t                client_fd = holder->client_fd;
+    NostrFanoutConnection* conn      = connection_for(queue, client_fd, false);
+    if (conn == NULL) {
+      return false;
+    }
+
+    char subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+    internal_memcpy(subscription_id, holder->subscription_id, sizeof(subscription_id));
+
+    // A reply cannot be dropped: the connection holding it is
+    NostrSlowConsumerPolicy policy = holder->type == NOSTR_FANOUT_FRAME_REPLY ? NOSTR_SLOW_CONSUMER_DISCONNECT : queue->policy;
+    if (policy == NOSTR_SLOW_CONSUMER_DROP_OLDEST && drop_oldest(queue, conn, client_fd, oldest, 0) > 0) {
+      continue;
+    }
+    if (policy == NOSTR_SLOW_CONSUMER_CLOSE) {
+      size_t pending = queue->events[oldest].pending;
+      close_subscription(queue, conn, client_fd, subscription_id);
+      if (on_action != NULL) {
+        on_action(NOSTR_FANOUT_CLOSE, client_fd, subscription_id, user_data);
+      }
+      if (queue->events_count != before || queue->events[oldest].pending < pending) {
+        continue;
+      }
+    }
+
+    // Policy could not release it (the frame is partially written): drop the connection
+    disconnect_connection(queue, conn, client_fd);
+    if (on_action != NULL) {
+      on_action(NOSTR_FANOUT_DISCONNECT, client_fd, subscription_id, user_data);
+    }
+  }
+
+  return true;
+}
+
+// ============================================================================
+// True while a frame to the connection is partially written
+// ============================================================================
+bool nostr_fanout_in_flight(const NostrFanoutQueue* queue, int32_t client_fd)
+{
+  require_not_null(queue, false);
+
+  if (client_fd < 0 || (size_t)client_fd >= queue->connections_capacity) {
+    return false;
+  }
+
+  return queue->connections[client_fd].resume > 0;
+}
+
+// ============================================================================
+// True while frames to the connection are waiting
+// ============================================================================
+bool nostr_fanout_pending(const NostrFanoutQueue* queue, int32_t client_fd)
+{
+  require_not_null(queue, false);
+
+  if (client_fd < 0 || (size_t)client_fd >= queue->connections_capacity) {
+    return false;
+  }
+
+  return queue->connections[client_fd].queued > 0;
+}
+
+// ============================================================================
+// Forget a closed connection
+// ============================================================================
+void nostr_fanout_remove_connection(NostrFanoutQueue* queue, int32_t client_fd)
+{
+  if (queue == NULL) {
+    return;
+  }
+
+  NostrFanoutConnection* conn = connection_for(queue, client_fd, false);
+  if (conn == NULL) {
+    return;
+  }
+
+  if (conn->queued > 0) {
+    CancelSpec spec;
+    spec.client_fd       = client_fd;
+    spec.event           = FANOUT_NIL;
+    spec.subscription_id = NULL;
+    spec.limit           = 0;
+    spec.events_only     = false;
+    spec.keep_in_flight  = false;
+    cancel_deliveries(queue, conn, &spec);
+  }
+
+  internal_memset(conn, 0, sizeof(NostrFanoutConnection));
+}
@@ -0,0 +1,222 @@
+#ifndef NOSTR_FANOUT_H_
+#define NOSTR_FANOUT_H_
+
+#include "../../util/types.h"
+#include "../nostr_types.h"
+#include "nostr_req.h"
+
+// ============================================================================
+// Constants
+// ============================================================================
+#define NOSTR_FANOUT_DEFAULT_BUDGET 1024                     // Deliveries per loop iteration
+#define NOSTR_FANOUT_DEFAULT_DELIVERIES (64 * 1024)          // Queued deliveries
+#define NOSTR_FANOUT_DEFAULT_ARENA_BYTES (16 * 1024 * 1024)  // Queued event payloads
+#define NOSTR_FANOUT_NIL 0xFFFFFFFFu
+
+// ============================================================================
+// Frame kinds carried by a delivery
+// ============================================================================
+typedef enum {
+  NOSTR_FANOUT_FRAME_EVENT  = 0,  // ["EVENT", subid, event]
+  NOSTR_FANOUT_FRAME_NOTICE = 1,  // Slow consumer: live events were dropped
+  NOSTR_FANOUT_FRAME_CLOSED = 2,  // Slow consumer: subscription closed as rate-limited
+  NOSTR_FANOUT_FRAME_REPLY  = 3,  // Protocol reply (OK / NOTICE / CLOSED / EOSE), sent as is
+} NostrFanoutFrameType;
+
+// ============================================================================
+// Result of queuing a delivery
+// ============================================================================
+typedef enum {
+  NOSTR_FANOUT_QUEUED     = 0,  // Queued (older events may have been dropped)
+  NOSTR_FANOUT_FULL       = 1,  // Delivery ring full
+  NOSTR_FANOUT_DROPPED    = 2,  // Not queued: invalid, or connection being dropped
+  NOSTR_FANOUT_CLOSE      = 3,  // Over budget: caller must remove the subscription
+  NOSTR_FANOUT_DISCONNECT = 4,  // Over budget: caller must drop the connection
+} NostrFanoutPushResult;
+
+// ============================================================================
+// Result of one send attempt
+// ============================================================================
+typedef enum {
+  NOSTR_FANOUT_SENT    = 0,  // Frame fully written
+  NOSTR_FANOUT_BLOCKED = 1,  // Socket buffer full; retried on a later drain
+  NOSTR_FANOUT_SKIPPED = 2,  // Subscription or connection gone; discarded
+} NostrFanoutSendResult;
+
+// ============================================================================
+// One pending frame for one connection
+// ============================================================================
+typedef struct {
+  int32_t  client_fd;
+  uint32_t event;  // Slot in the event ring (event or reply text), NIL for NOTICE / CLOSED
+  uint8_t  type;   // NostrFanoutFrameType
+  char     subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+} NostrFanoutDelivery;
+
+// ============================================================================
+// Queued event: serialized once, shared by all of its deliveries
+// ============================================================================
+typedef struct {
+  size_t   offset;   // Payload start in the arena
+  size_t   length;   // Payload length
+  uint32_t pending;  // Deliveries not yet sent
+  uint32_t dummy;
+} NostrFanoutEvent;
+
+// ============================================================================
+// Per-connection output state (indexed by fd)
+// ============================================================================
+typedef struct {
+  uint32_t queued;        // Deliveries waiting in the ring
+  uint32_t resume;        // Bytes of the front frame already written
+  uint32_t blocked_pass;  // Drain pass in which the socket last blocked
+  uint8_t  noticed;       // NOTICE queued since the backlog last emptied
+  uint8_t  dropping;      // Being disconnected: nothing more is queued
+  uint8_t  dummy[2];
+} NostrFanoutConnection;
+
+// ============================================================================
+// Bounded fan-out queue
+//
+// Deliveries and events are FIFO rings; event payloads live in a byte ring
+// (the arena) and are released in order once their last delivery is sent.
+// Ingest enqueues, the event loop drains a bounded slice per iteration.
+// A connection whose socket blocks is skipped for the rest of the pass and
+// keeps its frames, in order; once its backlog reaches max_per_connection
+// the slow-consumer policy is applied.
+// ============================================================================
+typedef struct {
+  NostrFanoutDelivery* deliveries;
+  size_t               capacity;  // Delivery ring size
+  size_t               head;
+  size_t               count;
+
+  NostrFanoutEvent* events;
+  size_t            events_head;
+  size_t            events_count;  // Event ring size is capacity
+  uint32_t          open_event;    // Event between begin and end, or NIL
+  uint32_t          pass;          // Drain pass counter
+
+  char*  arena;
+  size_t arena_capacity;
+  size_t arena_head;  // Oldest live payload byte
+  size_t arena_tail;  // Next free byte
+  size_t open_tail;   // arena_tail before the open event was reserved
+
+  NostrFanoutConnection*  connections;
+  size_t                  connections_capacity;
+  size_t                  max_per_connection;  // 0 = unlimited
+  NostrSlowConsumerPolicy policy;
+  uint32_t                dummy;
+
+  uint64_t enqueued;      // Deliveries pushed
+  uint64_t delivered;     // Frames fully written
+  uint64_t blocked;       // Send attempts that found the socket buffer full
+  uint64_t dropped;       // Events dropped by the drop-oldest policy
+  uint64_t notices;       // Slow-consumer NOTICEs queued
+  uint64_t closed;        // Subscriptions closed as rate-limited
+  uint64_t disconnected;  // Connections dropped as slow consumers
+} NostrFanoutQueue, *PNostrFanoutQueue;
+
+// ============================================================================
+// Send callback: frame and write one delivery
+// resume holds the bytes of this frame already written and is advanced on a
+// short write; the frame must be rebuilt identically on the next attempt.
+// event_json is NULL for NOTICE / CLOSED frames and the message for REPLY frames.
+// ============================================================================
+typedef NostrFanoutSendResult (*NostrFanoutSendCallback)(
+  int32_t              client_fd,
+  NostrFanoutFrameType type,
+  const char*          subscription_id,
+  const char*          event_json,
+  size_t               event_json_len,
+  uint32_t*            resume,
+  void*                user_data);
+
+// ============================================================================
+// Initialize queue (drop-oldest policy, no per-connection budget)
+// ============================================================================
+bool nostr_fanout_init(NostrFanoutQueue* queue, size_t max_deliveries, size_t arena_bytes);
+
+// ============================================================================
+// Destroy queue (pending deliveries are discarded)
+// ============================================================================
+void nostr_fanout_destroy(NostrFanoutQueue* queue);
+
+// ============================================================================
+// Set the per-connection budget (0 = unlimited) and the slow-consumer policy
+// ============================================================================
+void nostr_fanout_set_policy(NostrFanoutQueue* queue, NostrSlowConsumerPolicy policy, size_t max_per_connection);
+
+// ============================================================================
+// Start queuing an event; the serialized event object is copied
+// Returns false if the event ring or arena has no room
+// ============================================================================
+bool nostr_fanout_begin(NostrFanoutQueue* queue, const char* event_json, size_t event_json_len);
+
+// ============================================================================
+// Queue a delivery of the open event, applying the slow-consumer policy
+// when the connection is over budget
+// ============================================================================
+NostrFanoutPushResult nostr_fanout_push(NostrFanoutQueue* queue, int32_t client_fd, const char* subscription_id);
+
+// ============================================================================
+// Finish the open event (released at once if nothing was queued)
+// ============================================================================
+void nostr_fanout_end(NostrFanoutQueue* queue);
+
+// ============================================================================
+// Queue a protocol reply behind the connection's pending frames; the message
+// is copied. written is the part of the frame already sent directly (only
+// when nothing else is pending for the connection). Replies are never
+// dropped: over budget, the policy makes room or the connection is dropped.
+// Returns FULL if the rings or arena have no room. Not while an event is open.
+// ============================================================================
+NostrFanoutPushResult nostr_fanout_push_reply(
+  NostrFanoutQueue* queue,
+  int32_t           client_fd,
+  const char*       message,
+  size_t            message_len,
+  uint32_t          written);
+
+// ============================================================================
+// Send up to budget frames (0 = all), oldest first per connection
+// Returns number of frames fully written
+// ============================================================================
+size_t nostr_fanout_drain(
+  NostrFanoutQueue*       queue,
+  size_t                  budget,
+  NostrFanoutSendCallback send,
+  void*                   user_data);
+
+// ============================================================================
+// Shed the oldest queued event by applying the slow-consumer policy to every
+// connection still holding it. The caller handles returned CLOSE / DISCONNECT
+// actions through on_action. Returns false if nothing could be shed.
+// ============================================================================
+typedef void (*NostrFanoutActionCallback)(
+  NostrFanoutPushResult action,
+  int32_t               client_fd,
+  const char*           subscription_id,
+  void*                 user_data);
+
+bool nostr_fanout_shed_oldest(NostrFanoutQueue* queue, NostrFanoutActionCallback on_action, void* user_data);
+
+// ============================================================================
+// True while a frame to the connection is partially written
+// (anything else sent to it now would corrupt the stream)
+// ============================================================================
+bool nostr_fanout_in_flight(const NostrFanoutQueue* queue, int32_t client_fd);
+
+// ============================================================================
+// True while frames to the connection are waiting (a reply sent directly
+// now would overtake them)
+// ============================================================================
+bool nostr_fanout_pending(const NostrFanoutQueue* queue, int32_t client_fd);
+
+// ============================================================================
+// Forget a closed connection: cancel its deliveries and reset its state
+// ============================================================================
+void nostr_fanout_remove_connection(NostrFanoutQueue* queue, int32_t client_fd);
+
+#endif
@@ -218,8 +218,9 @@ bool nostr_filter_parse(
     } else if (key_len == 2 && key_str[0] == '#' && filter->tags_count < NOSTR_FILTER_MAX_TAGS) {
       // Tag filter like "#e", "#p", "#t"
       char tag_name = key_str[1];
-      extract_nostr_filter_tag(funcs, json, val_token, tag_name, &filter->tags[filter->tags_count]);
-      if (filter->tags[filter->tags_count].values_count > 0) {
+      NostrFilterTag* tag = &filter->tags[filter->tags_count];
+      extract_nostr_filter_tag(funcs, json, val_token, tag_name, tag);
+      if (tag->values_count + tag->long_values_count > 0) {
         filter->tags_count++;
       }
     }
@@ -245,135 +246,819 @@ static bool bytes_match_prefix(const uint8_t* data, const uint8_t* prefix, size_
 }
 
 // ============================================================================
-// Check if event matches filter
+// Helper: Fixed-width 32-byte equality
 // ============================================================================
-bool nostr_filter_matches(
-  const NostrFilter*      filter,
-  const NostrEventEntity* event)
+static inline bool bytes32_equal(const uint8_t* a, const uint8_t* b)
 {
-  require_not_null(filter, false);
-  require_not_null(event, false);
+  uint8_t diff = 0;
+  for (size_t i = 0; i < 32; i++) {
+    diff |= a[i] ^ b[i];
+  }
+  return diff == 0;
+}
 
-  // Check ids filter (prefix match supported)
-  if (filter->ids_count > 0) {
-    bool    found            = false;
-    uint8_t event_id_bin[32] = {0};
-    size_t  converted        = hex_to_bytes(event->id, 64, event_id_bin, 32);
-
-    // Only proceed if we successfully converted at least some bytes
-    if (converted > 0) {
-      for (size_t i = 0; i < filter->ids_count; i++) {
-        if (filter->ids[i].prefix_len <= converted &&
-            bytes_match_prefix(event_id_bin, filter->ids[i].value, filter->ids[i].prefix_len)) {
-          found = true;
-          break;
-        }
-      }
+// ============================================================================
+// Helper: Binary search a sorted array of 32-byte values
+// base points at the first value, stride is the distance between values
+// ============================================================================
+static bool bytes32_search(const uint8_t* base, size_t stride, size_t count, const uint8_t* key)
+{
+  size_t lo = 0;
+  size_t hi = count;
+
+  while (lo < hi) {
+    size_t  mid = lo + (hi - lo) / 2;
+    int32_t cmp = internal_memcmp(base + mid * stride, key, 32);
+    if (cmp == 0) {
+      return true;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  return false;
+}
+
+// ============================================================================
+// Helper: Order two id / pubkey entries: full-length first, then by bytes,
+// then shorter prefixes first
+// ============================================================================
+static int32_t compare_prefixed(const uint8_t* a, size_t a_len, const uint8_t* b, size_t b_len, size_t full_len)
+{
+  bool a_full = a_len == full_len;
+  bool b_full = b_len == full_len;
+  if (a_full != b_full) {
+    return a_full ? -1 : 1;
+  }
+
+  int32_t cmp = internal_memcmp(a, b, 32);
+  if (cmp != 0) {
+    return cmp;
+  }
+  if (a_len != b_len) {
+    return a_len < b_len ? -1 : 1;
+  }
+  return 0;
+}
+
+// ============================================================================
+// Helper: Sort ids so full-length entries come first in byte order, drop duplicates
+// Returns the number of full-length entries
+// ============================================================================
+static size_t sort_filter_ids(NostrFilterId* ids, size_t* count)
+{
+  for (size_t i = 1; i < *count; i++) {
+    NostrFilterId key = ids[i];
+    size_t        j   = i;
+    while (j > 0 && compare_prefixed(ids[j - 1].value, ids[j - 1].prefix_len, key.value, key.prefix_len, NOSTR_FILTER_ID_LENGTH) > 0) {
+      ids[j] = ids[j - 1];
+      j--;
+    }
+    ids[j] = key;
+  }
+
+  size_t unique = 0;
+  for (size_t i = 0; i < *count; i++) {
+    if (unique > 0 &&
+        compare_prefixed(ids[unique - 1].value, ids[unique - 1].prefix_len, ids[i].value, ids[i].prefix_len, NOSTR_FILTER_ID_LENGTH) == 0) {
+      continue;
+    }
+    ids[unique++] = ids[i];
+  }
+  *count = unique;
+
+  size_t full = 0;
+  while (full < unique && ids[full].prefix_len == NOSTR_FILTER_ID_LENGTH) {
+    full++;
+  }
+  return full;
+}
+
+// ============================================================================
+// Helper: Sort authors so full-length entries come first in byte order, drop duplicates
+// Returns the number of full-length entries
+// ============================================================================
+static size_t sort_filter_authors(NostrFilterPubkey* authors, size_t* count)
+{
+  for (size_t i = 1; i < *count; i++) {
+    NostrFilterPubkey key = authors[i];
+    size_t            j   = i;
+    while (j > 0 && compare_prefixed(authors[j - 1].value, authors[j - 1].prefix_len, key.value, key.prefix_len, NOSTR_FILTER_PUBKEY_LENGTH) > 0) {
+      authors[j] = authors[j - 1];
+      j--;
     }
-    if (!found) {
+    authors[j] = key;
+  }
+
+  size_t unique = 0;
+  for (size_t i = 0; i < *count; i++) {
+    if (unique > 0 &&
+        compare_prefixed(authors[unique - 1].value, authors[unique - 1].prefix_len, authors[i].value, authors[i].prefix_len, NOSTR_FILTER_PUBKEY_LENGTH) == 0) {
+      continue;
+    }
+    authors[unique++] = authors[i];
+  }
+  *count = unique;
+
+  size_t full = 0;
+  while (full < unique && authors[full].prefix_len == NOSTR_FILTER_PUBKEY_LENGTH) {
+    full++;
+  }
+  return full;
+}
+
+// ============================================================================
+// Helper: Sort kinds ascending, drop duplicates
+// ============================================================================
+static void sort_kinds(uint32_t* kinds, size_t* count)
+{
+  for (size_t i = 1; i < *count; i++) {
+    uint32_t key = kinds[i];
+    size_t   j   = i;
+    while (j > 0 && kinds[j - 1] > key) {
+      kinds[j] = kinds[j - 1];
+      j--;
+    }
+    kinds[j] = key;
+  }
+
+  size_t unique = 0;
+  for (size_t i = 0; i < *count; i++) {
+    if (unique == 0 || kinds[unique - 1] != kinds[i]) {
+      kinds[unique++] = kinds[i];
+    }
+  }
+  *count = unique;
+}
+
+// ============================================================================
+// Helper: Sort tag values in byte order, drop duplicates
+// ============================================================================
+static void sort_tag_values(NostrFilterTag* tag)
+{
+  for (size_t i = 1; i < tag->values_count; i++) {
+    uint8_t key[32];
+    internal_memcpy(key, tag->values[i], 32);
+    size_t j = i;
+    while (j > 0 && internal_memcmp(tag->values[j - 1], key, 32) > 0) {
+      internal_memcpy(tag->values[j], tag->values[j - 1], 32);
+      j--;
+    }
+    internal_memcpy(tag->values[j], key, 32);
+  }
+
+  size_t unique = 0;
+  for (size_t i = 0; i < tag->values_count; i++) {
+    if (unique > 0 && internal_memcmp(tag->values[unique - 1], tag->values[i], 32) == 0) {
+      continue;
+    }
+    if (unique != i) {
+      internal_memcpy(tag->values[unique], tag->values[i], 32);
+    }
+    unique++;
+  }
+  tag->values_count = unique;
+}
+
+// ============================================================================
+// Helper: Order two long tag values: by length, then by bytes
+// ============================================================================
+static int32_t compare_long_values(const NostrFilterLongTagValue* a, const NostrFilterLongTagValue* b)
+{
+  if (a->length != b->length) {
+    return a->length < b->length ? -1 : 1;
+  }
+  return internal_memcmp(a->value, b->value, a->length);
+}
+
+// ============================================================================
+// Helper: Sort long tag values, drop duplicates
+// ============================================================================
+static void sort_long_values(NostrFilterTag* tag)
+{
+  for (size_t i = 1; i < tag->long_values_count; i++) {
+    NostrFilterLongTagValue key = tag->long_values[i];
+    size_t                  j   = i;
+    while (j > 0 && compare_long_values(&tag->long_values[j - 1], &key) > 0) {
+      tag->long_values[j] = tag->long_values[j - 1];
+      j--;
+    }
+    tag->long_values[j] = key;
+  }
+
+  size_t unique = 0;
+  for (size_t i = 0; i < tag->long_values_count; i++) {
+    if (unique > 0 && compare_long_values(&tag->long_values[unique - 1], &tag->long_values[i]) == 0) {
+      continue;
+    }
+    tag->long_values[unique++] = tag->long_values[i];
+  }
+  tag->long_values_count = unique;
+}
+
+// ============================================================================
+// Helper: Order two tag constraints: by name, then by their (sorted) values
+// ============================================================================
+static int32_t compare_tags(const NostrFilterTag* a, const NostrFilterTag* b)
+{
+  if (a->name != b->name) {
+    return (uint8_t)a->name < (uint8_t)b->name ? -1 : 1;
+  }
+  if (a->values_count != b->values_count) {
+    return a->values_count < b->values_count ? -1 : 1;
+  }
+  if (a->long_values_count != b->long_values_count) {
+    return a->long_values_count < b->long_values_count ? -1 : 1;
+  }
+
+  int32_t cmp = internal_memcmp(a->values, b->values, a->values_count * 32);
+  for (size_t i = 0; cmp == 0 && i < a->long_values_count; i++) {
+    cmp = compare_long_values(&a->long_values[i], &b->long_values[i]);
+  }
+  return cmp;
+}
+
+// ============================================================================
+// Helper: Sort tag constraints (values must already be sorted)
+// ============================================================================
+static void sort_tags(NostrFilter* filter)
+{
+  static NostrFilterTag key;
+
+  for (size_t i = 1; i < filter->tags_count; i++) {
+    if (compare_tags(&filter->tags[i - 1], &filter->tags[i]) <= 0) {
+      continue;
+    }
+
+    internal_memcpy(&key, &filter->tags[i], sizeof(NostrFilterTag));
+    size_t j = i;
+    while (j > 0 && compare_tags(&filter->tags[j - 1], &key) > 0) {
+      internal_memcpy(&filter->tags[j], &filter->tags[j - 1], sizeof(NostrFilterTag));
+      j--;
+    }
+    internal_memcpy(&filter->tags[j], &key, sizeof(NostrFilterTag));
+  }
+}
+
+// ============================================================================
+// Helper: Hash slot of a 32-byte key (folds all four words, then avalanches)
+// ============================================================================
+static inline size_t authors_hash_slot(const uint8_t* key)
+{
+  uint64_t words[4];
+  internal_memcpy(words, key, sizeof(words));
+
+  uint64_t hash = words[0] ^ (words[1] * 0x9E3779B97F4A7C15ULL) ^ (words[2] * 0xC2B2AE3D27D4EB4FULL) ^
+                  (words[3] * 0x165667B19E3779F9ULL);
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  return (size_t)hash & (NOSTR_FILTER_AUTHORS_HASH_SLOTS - 1);
+}
+
+// ============================================================================
+// Helper: Build the open-addressing table over full-length authors
+// ============================================================================
+static void build_authors_hash(NostrFilter* filter)
+{
+  internal_memset(filter->authors_hash, 0, sizeof(filter->authors_hash));
+
+  for (size_t i = 0; i < filter->authors_full_count; i++) {
+    size_t slot = authors_hash_slot(filter->authors[i].value);
+    while (filter->authors_hash[slot] != 0) {
+      slot = (slot + 1) & (NOSTR_FILTER_AUTHORS_HASH_SLOTS - 1);
+    }
+    filter->authors_hash[slot] = (uint16_t)(i + 1);
+  }
+}
+
+// ============================================================================
+// Helper: Append one instruction to the predicate program
+// ============================================================================
+static inline void emit(NostrFilter* filter, NostrFilterOp op, size_t operand)
+{
+  NostrFilterInstruction* instruction = &filter->program[filter->program_length++];
+  instruction->op                     = (uint8_t)op;
+  instruction->operand                = (uint8_t)operand;
+}
+
+// ============================================================================
+// Helper: Number of values of a tag constraint, short and long
+// ============================================================================
+static inline size_t tag_values_count(const NostrFilterTag* tag)
+{
+  return tag->values_count + tag->long_values_count;
+}
+
+// ============================================================================
+// Helper: Build the predicate program
+// Fixed-width tests first (kind, created_at), then id, author and tag probes.
+// Tags with fewer values are tested first: they reject more events.
+// ============================================================================
+static void build_program(NostrFilter* filter)
+{
+  filter->program_length = 0;
+
+  if (filter->kinds_count == 1) {
+    emit(filter, NOSTR_FILTER_OP_KIND_ONE, 0);
+  } else if (filter->kinds_count > 1) {
+    emit(filter, NOSTR_FILTER_OP_KIND_BITMAP, 0);
+  }
+
+  if (filter->since > 0 && filter->until > 0) {
+    emit(filter, NOSTR_FILTER_OP_RANGE, 0);
+  } else if (filter->since > 0) {
+    emit(filter, NOSTR_FILTER_OP_SINCE, 0);
+  } else if (filter->until > 0) {
+    emit(filter, NOSTR_FILTER_OP_UNTIL, 0);
+  }
+
+  if (filter->ids_count == 1 && filter->ids_full_count == 1) {
+    emit(filter, NOSTR_FILTER_OP_ID_ONE, 0);
+  } else if (filter->ids_count > 0) {
+    emit(filter, NOSTR_FILTER_OP_ID_SET, 0);
+  }
+
+  if (filter->authors_count == 1 && filter->authors_full_count == 1) {
+    emit(filter, NOSTR_FILTER_OP_AUTHOR_ONE, 0);
+  } else if (filter->authors_count > 0) {
+    emit(filter, NOSTR_FILTER_OP_AUTHOR_HASH, 0);
+  }
+
+  size_t first_tag = filter->program_length;
+  for (size_t i = 0; i < filter->tags_count; i++) {
+    const NostrFilterTag* tag = &filter->tags[i];
+    NostrFilterOp         op  = tag_values_count(tag) == 1 && tag->values_count == 1 ? NOSTR_FILTER_OP_TAG_ONE : NOSTR_FILTER_OP_TAG_SET;
+
+    // Insertion sort by value count
+    size_t j = filter->program_length++;
+    while (j > first_tag && tag_values_count(&filter->tags[filter->program[j - 1].operand]) > tag_values_count(tag)) {
+      filter->program[j] = filter->program[j - 1];
+      j--;
+    }
+    filter->program[j].op      = (uint8_t)op;
+    filter->program[j].operand = (uint8_t)i;
+  }
+}
+
+// ============================================================================
+// Compile filter for matching
+// ============================================================================
+void nostr_filter_compile(NostrFilter* filter)
+{
+  if (filter == NULL) {
+    return;
+  }
+
+  // Canonical form: sorted, duplicate-free arrays and tags ordered by name,
+  // so equal filters compare (and hash) equal byte for byte
+  filter->ids_full_count     = sort_filter_ids(filter->ids, &filter->ids_count);
+  filter->authors_full_count = sort_filter_authors(filter->authors, &filter->authors_count);
+  sort_kinds(filter->kinds, &filter->kinds_count);
+
+  internal_memset(filter->kinds_bitmap, 0, sizeof(filter->kinds_bitmap));
+  for (size_t i = 0; i < filter->kinds_count; i++) {
+    uint32_t kind = filter->kinds[i];
+    if (kind < NOSTR_FILTER_KIND_BITMAP_BITS) {
+      filter->kinds_bitmap[kind >> 6] |= (uint64_t)1 << (kind & 63);
+    }
+  }
+
+  for (size_t i = 0; i < filter->tags_count; i++) {
+    sort_tag_values(&filter->tags[i]);
+    sort_long_values(&filter->tags[i]);
+  }
+  sort_tags(filter);
+
+  build_authors_hash(filter);
+  build_program(filter);
+  filter->compiled = true;
+}
+
+// ============================================================================
+// Helper: Mix a byte range into a 64-bit hash, a word at a time
+// ============================================================================
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t length)
+{
+  const uint8_t* bytes = (const uint8_t*)data;
+
+  while (length >= 8) {
+    uint64_t word;
+    internal_memcpy(&word, bytes, 8);
+    hash = (hash ^ word) * 0x9E3779B97F4A7C15ULL;
+    bytes += 8;
+    length -= 8;
+  }
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+// ============================================================================
+// Hash the matching fields of a compiled filter (limit is ignored)
+// ============================================================================
+uint64_t nostr_filter_hash(const NostrFilter* filter)
+{
+  require_not_null(filter, 0);
+
+  uint64_t hash = 0xCBF29CE484222325ULL;
+
+  hash = hash_bytes(hash, &filter->ids_count, sizeof(size_t));
+  for (size_t i = 0; i < filter->ids_count; i++) {
+    hash = hash_bytes(hash, &filter->ids[i], sizeof(NostrFilterId));
+  }
+
+  hash = hash_bytes(hash, &filter->authors_count, sizeof(size_t));
+  for (size_t i = 0; i < filter->authors_count; i++) {
+    hash = hash_bytes(hash, &filter->authors[i], sizeof(NostrFilterPubkey));
+  }
+
+  hash = hash_bytes(hash, &filter->kinds_count, sizeof(size_t));
+  hash = hash_bytes(hash, filter->kinds, sizeof(uint32_t) * filter->kinds_count);
+
+  hash = hash_bytes(hash, &filter->tags_count, sizeof(size_t));
+  for (size_t i = 0; i < filter->tags_count; i++) {
+    const NostrFilterTag* tag = &filter->tags[i];
+    hash                      = hash_bytes(hash, &tag->name, 1);
+    hash                      = hash_bytes(hash, &tag->values_count, sizeof(size_t));
+    hash                      = hash_bytes(hash, tag->values, 32 * tag->values_count);
+    hash                      = hash_bytes(hash, &tag->long_values_count, sizeof(size_t));
+    for (size_t j = 0; j < tag->long_values_count; j++) {
+      hash = hash_bytes(hash, &tag->long_values[j], 1 + tag->long_values[j].length);
+    }
+  }
+
+  hash = hash_bytes(hash, &filter->since, sizeof(int64_t));
+  hash = hash_bytes(hash, &filter->until, sizeof(int64_t));
+
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+// ============================================================================
+// Check if two compiled filters match exactly the same events
+// (same canonical fields; limit is ignored)
+// ============================================================================
+bool nostr_filter_equal(const NostrFilter* a, const NostrFilter* b)
+{
+  require_not_null(a, false);
+  require_not_null(b, false);
+
+  if (a->ids_count != b->ids_count || a->authors_count != b->authors_count || a->kinds_count != b->kinds_count ||
+      a->tags_count != b->tags_count || a->since != b->since || a->until != b->until) {
+    return false;
+  }
+
+  for (size_t i = 0; i < a->ids_count; i++) {
+    if (a->ids[i].prefix_len != b->ids[i].prefix_len || !bytes32_equal(a->ids[i].value, b->ids[i].value)) {
+      return false;
+    }
+  }
+  for (size_t i = 0; i < a->authors_count; i++) {
+    if (a->authors[i].prefix_len != b->authors[i].prefix_len || !bytes32_equal(a->authors[i].value, b->authors[i].value)) {
+      return false;
+    }
+  }
+  if (a->kinds_count > 0 && internal_memcmp(a->kinds, b->kinds, sizeof(uint32_t) * a->kinds_count) != 0) {
+    return false;
+  }
+  for (size_t i = 0; i < a->tags_count; i++) {
+    if (compare_tags(&a->tags[i], &b->tags[i]) != 0) {
       return false;
     }
   }
 
-  // Check authors filter (prefix match supported)
-  if (filter->authors_count > 0) {
-    bool    found                = false;
-    uint8_t event_pubkey_bin[32] = {0};
-    size_t  converted            = hex_to_bytes(event->pubkey, 64, event_pubkey_bin, 32);
-
-    // Only proceed if we successfully converted at least some bytes
-    if (converted > 0) {
-      for (size_t i = 0; i < filter->authors_count; i++) {
-        if (filter->authors[i].prefix_len <= converted &&
-            bytes_match_prefix(event_pubkey_bin, filter->authors[i].value, filter->authors[i].prefix_len)) {
-          found = true;
-          break;
-        }
+  return true;
+}
+
+// ============================================================================
+// Decode event to binary form for matching
+// ============================================================================
+void nostr_match_event_init(
+  NostrMatchEvent*        match_event,
+  const NostrEventEntity* event)
+{
+  if (match_event == NULL || event == NULL) {
+    return;
+  }
+
+  match_event->id_valid     = hex_to_bytes(event->id, 64, match_event->id, 32) == 32;
+  match_event->pubkey_valid = hex_to_bytes(event->pubkey, 64, match_event->pubkey, 32) == 32;
+  match_event->kind         = event->kind;
+  match_event->created_at   = (int64_t)event->created_at;
+  match_event->tags_count   = 0;
+
+  // NIP-01: tag filters match against the first value of single-letter tags
+  for (uint32_t i = 0; i < event->tag_count && match_event->tags_count < NOSTR_MATCH_EVENT_MAX_TAGS; i++) {
+    const NostrTagEntity* etag = &event->tags[i];
+    if (etag->key[0] == '\0' || etag->key[1] != '\0' || etag->item_count < 1) {
+      continue;
+    }
+
+    NostrMatchEventTag* mtag  = &match_event->tags[match_event->tags_count];
+    const char*         value = etag->values[0];
+    size_t              len   = strlen(value);
+
+    internal_memset(mtag->value, 0, 32);
+    if (etag->key[0] == 'e' || etag->key[0] == 'p') {
+      // Filter values for e/p are binary, so only 64-char hex can match
+      if (len != 64 || hex_to_bytes(value, 64, mtag->value, 32) != 32) {
+        continue;
       }
+      len = 32;
+    } else if (len > NOSTR_FILTER_LONG_TAG_VALUE_LENGTH) {
+      // No filter keeps a value this long
+      continue;
+    } else {
+      internal_memcpy(mtag->value, value, len < 32 ? len : 32);
     }
-    if (!found) {
-      return false;
+
+    mtag->name   = etag->key[0];
+    mtag->length = (uint8_t)len;
+    mtag->raw    = value;
+    match_event->tags_count++;
+  }
+}
+
+// ============================================================================
+// Helper: Match id/pubkey against sorted full entries, then prefix entries
+// ============================================================================
+static bool match_ids(const NostrFilter* filter, const uint8_t* id)
+{
+  size_t start = 0;
+  if (filter->compiled) {
+    if (bytes32_search(filter->ids[0].value, sizeof(NostrFilterId), filter->ids_full_count, id)) {
+      return true;
     }
+    start = filter->ids_full_count;
   }
 
-  // Check kinds filter
-  if (filter->kinds_count > 0) {
-    bool found = false;
-    for (size_t i = 0; i < filter->kinds_count; i++) {
-      if (filter->kinds[i] == event->kind) {
-        found = true;
-        break;
+  for (size_t i = start; i < filter->ids_count; i++) {
+    if (bytes_match_prefix(id, filter->ids[i].value, filter->ids[i].prefix_len)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool match_authors(const NostrFilter* filter, const uint8_t* pubkey)
+{
+  size_t start = 0;
+  if (filter->compiled) {
+    if (bytes32_search(filter->authors[0].value, sizeof(NostrFilterPubkey), filter->authors_full_count, pubkey)) {
+      return true;
+    }
+    start = filter->authors_full_count;
+  }
+
+  for (size_t i = start; i < filter->authors_count; i++) {
+    if (bytes_match_prefix(pubkey, filter->authors[i].value, filter->authors[i].prefix_len)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ============================================================================
+// Helper: Match kind via bitmap (compiled) or linear scan
+// ============================================================================
+static bool match_kinds(const NostrFilter* filter, uint32_t kind)
+{
+  if (filter->compiled && kind < NOSTR_FILTER_KIND_BITMAP_BITS) {
+    return (filter->kinds_bitmap[kind >> 6] >> (kind & 63)) & 1;
+  }
+
+  for (size_t i = 0; i < filter->kinds_count; i++) {
+    if (filter->kinds[i] == kind) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ============================================================================
+// Helper: Match an event tag value longer than 32 bytes against the whole
+// long values of a tag filter
+// ============================================================================
+static bool match_long_value(const NostrFilterTag* ftag, const NostrMatchEventTag* mtag)
+{
+  for (size_t i = 0; i < ftag->long_values_count; i++) {
+    const NostrFilterLongTagValue* long_value = &ftag->long_values[i];
+    if (long_value->length == mtag->length && internal_memcmp(long_value->value, mtag->raw, mtag->length) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ============================================================================
+// Helper: Match one tag filter against the decoded event tags
+// ============================================================================
+static bool match_tag(const NostrFilter* filter, const NostrFilterTag* ftag, const NostrMatchEvent* match_event)
+{
+  for (size_t ei = 0; ei < match_event->tags_count; ei++) {
+    const NostrMatchEventTag* mtag = &match_event->tags[ei];
+    if (mtag->name != ftag->name) {
+      continue;
+    }
+
+    if (mtag->length > 32) {
+      if (match_long_value(ftag, mtag)) {
+        return true;
       }
+      continue;
     }
-    if (!found) {
-      return false;
+
+    if (filter->compiled) {
+      if (bytes32_search(ftag->values[0], 32, ftag->values_count, mtag->value)) {
+        return true;
+      }
+      continue;
+    }
+
+    for (size_t fvi = 0; fvi < ftag->values_count; fvi++) {
+      if (bytes32_equal(ftag->values[fvi], mtag->value)) {
+        return true;
+      }
     }
   }
 
+  return false;
+}
+
+// ============================================================================
+// Check if a decoded event matches filter, testing every field generically
+// ============================================================================
+bool nostr_filter_matches_generic(
+  const NostrFilter*     filter,
+  const NostrMatchEvent* match_event)
+{
+  require_not_null(filter, false);
+  require_not_null(match_event, false);
+
+  // Cheap fixed-width checks first
+  if (filter->kinds_count > 0 && !match_kinds(filter, match_event->kind)) {
+    return false;
+  }
+
   // Check since (event created_at >= since)
-  if (filter->since > 0) {
-    if ((int64_t)event->created_at < filter->since) {
+  if (filter->since > 0 && match_event->created_at < filter->since) {
+    return false;
+  }
+
+  // Check until (event created_at <= until)
+  if (filter->until > 0 && match_event->created_at > filter->until) {
+    return false;
+  }
+
+  // Check ids filter (prefix match supported)
+  if (filter->ids_count > 0) {
+    if (!match_event->id_valid || !match_ids(filter, match_event->id)) {
       return false;
     }
   }
 
-  // Check until (event created_at <= until)
-  if (filter->until > 0) {
-    if ((int64_t)event->created_at > filter->until) {
+  // Check authors filter (prefix match supported)
+  if (filter->authors_count > 0) {
+    if (!match_event->pubkey_valid || !match_authors(filter, match_event->pubkey)) {
       return false;
     }
   }
 
   // Check tag filters
   for (size_t ti = 0; ti < filter->tags_count; ti++) {
-    const NostrFilterTag* ftag  = &filter->tags[ti];
-    bool                  found = false;
+    if (!match_tag(filter, &filter->tags[ti], match_event)) {
+      return false;
+    }
+  }
 
-    // Search in event tags
-    for (uint32_t ei = 0; ei < event->tag_count && !found; ei++) {
-      const NostrTagEntity* etag = &event->tags[ei];
+  return true;
+}
 
-      // Check if tag name matches (key[0] is the tag letter)
-      if (etag->key[0] != ftag->name || etag->key[1] != '\0') {
-        continue;
-      }
+// ============================================================================
+// Helper: Probe the authors hash, then the prefix entries
+// ============================================================================
+static bool match_authors_hash(const NostrFilter* filter, const uint8_t* pubkey)
+{
+  size_t slot = authors_hash_slot(pubkey);
+  for (uint16_t entry = filter->authors_hash[slot]; entry != 0; entry = filter->authors_hash[slot]) {
+    if (bytes32_equal(filter->authors[entry - 1].value, pubkey)) {
+      return true;
+    }
+    slot = (slot + 1) & (NOSTR_FILTER_AUTHORS_HASH_SLOTS - 1);
+  }
 
-      // Check if any value matches (values[0] is the first value after the tag name)
-      if (etag->item_count < 1) {
-        continue;
-      }
+  for (size_t i = filter->authors_full_count; i < filter->authors_count; i++) {
+    if (bytes_match_prefix(pubkey, filter->authors[i].value, filter->authors[i].prefix_len)) {
+      return true;
+    }
+  }
+  return false;
+}
 
-      for (size_t fvi = 0; fvi < ftag->values_count && !found; fvi++) {
-        for (size_t evi = 0; evi < etag->item_count && !found; evi++) {
-          const char* eval     = etag->values[evi];
-          size_t      eval_len = strlen(eval);
-
-          // For 'e' and 'p' tags, compare binary
-          if (ftag->name == 'e' || ftag->name == 'p') {
-            if (eval_len == 64) {
-              uint8_t eval_bin[32] = {0};
-              size_t  converted    = hex_to_bytes(eval, 64, eval_bin, 32);
-              if (converted == 32 && internal_memcmp(eval_bin, ftag->values[fvi], 32) == 0) {
-                found = true;
-              }
-            }
-          } else {
-            // For other tags, compare as strings
-            size_t fval_len = strlen((const char*)ftag->values[fvi]);
-            if (eval_len == fval_len) {
-              if (strncmp(eval, (const char*)ftag->values[fvi], fval_len)) {
-                found = true;
-              }
-            }
-          }
-        }
-      }
+// ============================================================================
+// Helper: Match a single-value tag filter
+// ============================================================================
+static bool match_tag_one(const NostrFilterTag* ftag, const NostrMatchEvent* match_event)
+{
+  for (size_t ei = 0; ei < match_event->tags_count; ei++) {
+    const NostrMatchEventTag* mtag = &match_event->tags[ei];
+    if (mtag->name == ftag->name && mtag->length <= 32 && bytes32_equal(ftag->values[0], mtag->value)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// ============================================================================
+// Helper: Run the compiled predicate program
+// ============================================================================
+static bool run_program(const NostrFilter* filter, const NostrMatchEvent* match_event)
+{
+  for (size_t pc = 0; pc < filter->program_length; pc++) {
+    const NostrFilterInstruction* instruction = &filter->program[pc];
+    bool                          matched;
+
+    switch (instruction->op) {
+      case NOSTR_FILTER_OP_KIND_ONE:
+        matched = match_event->kind == filter->kinds[0];
+        break;
+      case NOSTR_FILTER_OP_KIND_BITMAP:
+        matched = match_kinds(filter, match_event->kind);
+        break;
+      case NOSTR_FILTER_OP_SINCE:
+        matched = match_event->created_at >= filter->since;
+        break;
+      case NOSTR_FILTER_OP_UNTIL:
+        matched = match_event->created_at <= filter->until;
+        break;
+      case NOSTR_FILTER_OP_RANGE:
+        matched = match_event->created_at >= filter->since && match_event->created_at <= filter->until;
+        break;
+      case NOSTR_FILTER_OP_ID_ONE:
+        matched = match_event->id_valid && bytes32_equal(filter->ids[0].value, match_event->id);
+        break;
+      case NOSTR_FILTER_OP_ID_SET:
+        matched = match_event->id_valid && match_ids(filter, match_event->id);
+        break;
+      case NOSTR_FILTER_OP_AUTHOR_ONE:
+        matched = match_event->pubkey_valid && bytes32_equal(filter->authors[0].value, match_event->pubkey);
+        break;
+      case NOSTR_FILTER_OP_AUTHOR_HASH:
+        matched = match_event->pubkey_valid && match_authors_hash(filter, match_event->pubkey);
+        break;
+      case NOSTR_FILTER_OP_TAG_ONE:
+        matched = match_tag_one(&filter->tags[instruction->operand], match_event);
+        break;
+      case NOSTR_FILTER_OP_TAG_SET:
+        matched = match_tag(filter, &filter->tags[instruction->operand], match_event);
+        break;
+      default:
+        matched = false;
+        break;
     }
 
-    if (!found) {
+    if (!matched) {
       return false;
     }
   }
 
   return true;
 }
+
+// ============================================================================
+// Check if a decoded event matches filter
+// ============================================================================
+bool nostr_filter_matches_binary(
+  const NostrFilter*     filter,
+  const NostrMatchEvent* match_event)
+{
+  require_not_null(filter, false);
+  require_not_null(match_event, false);
+
+  if (filter->compiled) {
+    return run_program(filter, match_event);
+  }
+  return nostr_filter_matches_generic(filter, match_event);
+}
+
+// ============================================================================
+// Check if event matches filter
+// ============================================================================
+bool nostr_filter_matches(
+  const NostrFilter*      filter,
+  const NostrEventEntity* event)
+{
+  require_not_null(filter, false);
+  require_not_null(event, false);
+
+  static NostrMatchEvent match_event;  // Too large for the stack
+  nostr_match_event_init(&match_event, event);
+  return nostr_filter_matches_binary(filter, &match_event);
+}
@@ -21,6 +21,45 @@ bool nostr_filter_parse(
   const size_t     token_count,
   NostrFilter*     filter);
 
+// ============================================================================
+// Compile filter for matching: bring it to canonical form (sorted, duplicate-free
+// ids/authors/kinds/tag values, tags ordered by name), then build the kinds
+// bitmap, authors hash and predicate program
+// ============================================================================
+void nostr_filter_compile(NostrFilter* filter);
+
+// ============================================================================
+// Hash the matching fields of a compiled filter (limit is ignored)
+// ============================================================================
+uint64_t nostr_filter_hash(const NostrFilter* filter);
+
+// ============================================================================
+// Check if two compiled filters match exactly the same events (limit is ignored)
+// ============================================================================
+bool nostr_filter_equal(const NostrFilter* a, const NostrFilter* b);
+
+// ============================================================================
+// Decode event to binary form for matching (once per broadcast)
+// ============================================================================
+void nostr_match_event_init(
+  NostrMatchEvent*        match_event,
+  const NostrEventEntity* event);
+
+// ============================================================================
+// Check if a decoded event matches filter
+// Runs the predicate program once the filter is compiled
+// ============================================================================
+bool nostr_filter_matches_binary(
+  const NostrFilter*     filter,
+  const NostrMatchEvent* match_event);
+
+// ============================================================================
+// Check if a decoded event matches filter, testing every field generically
+// ============================================================================
+bool nostr_filter_matches_generic(
+  const NostrFilter*     filter,
+  const NostrMatchEvent* match_event);
+
 // ============================================================================
 // Check if event matches filter
 // ============================================================================
@@ -0,0 +1,268 @@
+#include "nostr_filter_registry.h"
+
+#include "../../arch/memory.h"
+#include "../../arch/mmap.h"
+#include "../../util/log.h"
+#include "../../util/string.h"
+#include "nostr_filter.h"
+
+#define REGISTRY_NIL NOSTR_FILTER_REGISTRY_NIL
+
+// ============================================================================
+// Helper: Allocate / free zeroed anonymous memory
+// ============================================================================
+static void* registry_alloc(size_t size)
+{
+  void* ptr = internal_mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static void registry_free(void* ptr, size_t size)
+{
+  if (ptr != NULL) {
+    internal_munmap(ptr, size);
+  }
+}
+
+static inline uint32_t* bucket_for(const NostrFilterRegistry* registry, uint64_t hash)
+{
+  return &registry->buckets[hash & (registry->buckets_capacity - 1)];
+}
+
+// ============================================================================
+// Initialize registry
+// ============================================================================
+bool nostr_filter_registry_init(NostrFilterRegistry* registry, size_t max_entries)
+{
+  require_not_null(registry, false);
+
+  internal_memset(registry, 0, sizeof(NostrFilterRegistry));
+  require_valid_length(max_entries, false);
+  require(max_entries < REGISTRY_NIL, false);
+
+  registry->max_entries      = max_entries;
+  registry->buckets_capacity = 1;
+  while (registry->buckets_capacity < max_entries) {
+    registry->buckets_capacity <<= 1;
+  }
+
+  registry->entries = (NostrSharedFilter*)registry_alloc(sizeof(NostrSharedFilter) * max_entries);
+  registry->links   = (NostrFilterLink*)registry_alloc(sizeof(NostrFilterLink) * max_entries);
+  registry->buckets = (uint32_t*)registry_alloc(sizeof(uint32_t) * registry->buckets_capacity);
+  registry->scratch = (NostrFilter*)registry_alloc(sizeof(NostrFilter));
+
+  if (registry->entries == NULL || registry->links == NULL || registry->buckets == NULL || registry->scratch == NULL) {
+    log_error("Failed to allocate filter registry\n");
+    nostr_filter_registry_destroy(registry);
+    return false;
+  }
+
+  for (size_t i = 0; i < registry->buckets_capacity; i++) {
+    registry->buckets[i] = REGISTRY_NIL;
+  }
+
+  registry->entries_free = REGISTRY_NIL;
+  registry->links_free   = REGISTRY_NIL;
+  for (size_t i = max_entries; i > 0; i--) {
+    registry->entries[i - 1].hash_next = registry->entries_free;
+    registry->entries_free             = (uint32_t)(i - 1);
+    registry->links[i - 1].next        = registry->links_free;
+    registry->links_free               = (uint32_t)(i - 1);
+  }
+
+  return true;
+}
+
+// ============================================================================
+// Destroy registry
+// ============================================================================
+void nostr_filter_registry_destroy(NostrFilterRegistry* registry)
+{
+  if (registry == NULL) {
+    return;
+  }
+
+  if (registry->entries != NULL) {
+    for (size_t i = 0; i < registry->max_entries; i++) {
+      registry_free(registry->entries[i].filter, sizeof(NostrFilter));
+    }
+  }
+
+  registry_free(registry->entries, sizeof(NostrSharedFilter) * registry->max_entries);
+  registry_free(registry->links, sizeof(NostrFilterLink) * registry->max_entries);
+  registry_free(registry->buckets, sizeof(uint32_t) * registry->buckets_capacity);
+  registry_free(registry->scratch, sizeof(NostrFilter));
+  internal_memset(registry, 0, sizeof(NostrFilterRegistry));
+}
+
+// ============================================================================
+// Get the live entry in a slot
+// ============================================================================
+const NostrSharedFilter* nostr_filter_registry_entry(const NostrFilterRegistry* registry, uint32_t entry)
+{
+  if (registry == NULL || entry >= registry->max_entries || registry->entries[entry].filter == NULL) {
+    return NULL;
+  }
+  return &registry->entries[entry];
+}
+
+// ============================================================================
+// Helper: Find the entry equal to the (compiled) scratch filter, or NIL
+// ============================================================================
+static uint32_t find_entry(const NostrFilterRegistry* registry, uint64_t hash)
+{
+  for (uint32_t e = *bucket_for(registry, hash); e != REGISTRY_NIL; e = registry->entries[e].hash_next) {
+    const NostrSharedFilter* entry = &registry->entries[e];
+    if (entry->hash == hash && nostr_filter_equal(entry->filter, registry->scratch)) {
+      return e;
+    }
+  }
+  return REGISTRY_NIL;
+}
+
+// ============================================================================
+// Helper: Turn the scratch filter into a new entry (the scratch buffer is
+// handed over and replaced, so the filter is not copied again)
+// ============================================================================
+static uint32_t create_entry(NostrFilterRegistry* registry, uint64_t hash)
+{
+  if (registry->entries_free == REGISTRY_NIL) {
+    log_debug("Filter registry: no free entries\n");
+    return REGISTRY_NIL;
+  }
+
+  NostrFilter* replacement = (NostrFilter*)registry_alloc(sizeof(NostrFilter));
+  if (replacement == NULL) {
+    log_error("Failed to allocate shared filter\n");
+    return REGISTRY_NIL;
+  }
+
+  uint32_t           e     = registry->entries_free;
+  NostrSharedFilter* entry = &registry->entries[e];
+  registry->entries_free   = entry->hash_next;
+
+  entry->filter      = registry->scratch;
+  entry->hash        = hash;
+  entry->subscribers = REGISTRY_NIL;
+  entry->refs        = 0;
+
+  uint32_t* bucket = bucket_for(registry, hash);
+  entry->hash_next = *bucket;
+  *bucket          = e;
+
+  registry->scratch = replacement;
+  registry->count++;
+  return e;
+}
+
+// ============================================================================
+// Helper: Unlink an entry from its bucket and free it
+// ============================================================================
+static void free_entry(NostrFilterRegistry* registry, uint32_t e)
+{
+  NostrSharedFilter* entry = &registry->entries[e];
+
+  uint32_t* link = bucket_for(registry, entry->hash);
+  while (*link != REGISTRY_NIL && *link != e) {
+    link = &registry->entries[*link].hash_next;
+  }
+  if (*link == e) {
+    *link = entry->hash_next;
+  }
+
+  registry_free(entry->filter, sizeof(NostrFilter));
+  internal_memset(entry, 0, sizeof(NostrSharedFilter));
+
+  entry->hash_next       = registry->entries_free;
+  registry->entries_free = e;
+  registry->count--;
+}
+
+// ============================================================================
+// Subscribe to the shared entry of a filter
+// ============================================================================
+uint32_t nostr_filter_registry_acquire(
+  NostrFilterRegistry* registry,
+  const NostrFilter*   filter,
+  uint32_t             subscription,
+  bool*                created)
+{
+  require_not_null(registry, REGISTRY_NIL);
+  require_not_null(registry->entries, REGISTRY_NIL);
+  require_not_null(filter, REGISTRY_NIL);
+
+  if (created != NULL) {
+    *created = false;
+  }
+
+  if (registry->links_free == REGISTRY_NIL) {
+    log_debug("Filter registry: no free links\n");
+    return REGISTRY_NIL;
+  }
+
+  internal_memcpy(registry->scratch, filter, sizeof(NostrFilter));
+  nostr_filter_compile(registry->scratch);
+
+  uint64_t hash = nostr_filter_hash(registry->scratch);
+  uint32_t e    = find_entry(registry, hash);
+  if (e == REGISTRY_NIL) {
+    e = create_entry(registry, hash);
+    if (e == REGISTRY_NIL) {
+      return REGISTRY_NIL;
+    }
+    if (created != NULL) {
+      *created = true;
+    }
+  }
+
+  NostrSharedFilter* entry = &registry->entries[e];
+  uint32_t           l     = registry->links_free;
+  NostrFilterLink*   link  = &registry->links[l];
+  registry->links_free     = link->next;
+
+  link->subscription = subscription;
+  link->entry        = e;
+  link->prev         = REGISTRY_NIL;
+  link->next         = entry->subscribers;
+  if (link->next != REGISTRY_NIL) {
+    registry->links[link->next].prev = l;
+  }
+  entry->subscribers = l;
+  entry->refs++;
+  registry->links_count++;
+  return l;
+}
+
+// ============================================================================
+// Drop a link, freeing its entry with the last subscriber
+// ============================================================================
+uint32_t nostr_filter_registry_release(NostrFilterRegistry* registry, uint32_t link)
+{
+  require_not_null(registry, REGISTRY_NIL);
+  require(link < registry->max_entries, REGISTRY_NIL);
+
+  NostrFilterLink*   l     = &registry->links[link];
+  uint32_t           e     = l->entry;
+  NostrSharedFilter* entry = &registry->entries[e];
+
+  if (l->prev != REGISTRY_NIL) {
+    registry->links[l->prev].next = l->next;
+  } else {
+    entry->subscribers = l->next;
+  }
+  if (l->next != REGISTRY_NIL) {
+    registry->links[l->next].prev = l->prev;
+  }
+
+  internal_memset(l, 0, sizeof(NostrFilterLink));
+  l->next              = registry->links_free;
+  registry->links_free = link;
+  registry->links_count--;
+
+  if (--entry->refs > 0) {
+    return REGISTRY_NIL;
+  }
+
+  free_entry(registry, e);
+  return e;
+}
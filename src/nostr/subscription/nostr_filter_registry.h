@@ -0,0 +1,87 @@
+#ifndef NOSTR_FILTER_REGISTRY_H_
+#define NOSTR_FILTER_REGISTRY_H_
+
+#include "../../util/types.h"
+#include "nostr_filter_types.h"
+
+// ============================================================================
+// Constants
+// ============================================================================
+#define NOSTR_FILTER_REGISTRY_NIL 0xFFFFFFFFu
+
+// ============================================================================
+// One distinct (canonical) filter and the subscriptions that use it
+// ============================================================================
+typedef struct {
+  NostrFilter* filter;       // Compiled canonical filter, NULL if the slot is free
+  uint64_t     hash;         // nostr_filter_hash of filter
+  uint32_t     subscribers;  // First link of the subscriber list
+  uint32_t     refs;         // Links in the subscriber list
+  uint32_t     hash_next;    // Bucket chain, or free list link
+  uint32_t     dummy;
+} NostrSharedFilter;
+
+// ============================================================================
+// One use of a shared filter by one subscription
+// ============================================================================
+typedef struct {
+  uint32_t subscription;  // Subscription slot
+  uint32_t entry;         // Shared filter slot
+  uint32_t prev;          // Subscriber list of the entry
+  uint32_t next;          // Subscriber list of the entry, or free list link
+} NostrFilterLink;
+
+// ============================================================================
+// Hash-consed filter registry
+//
+// Filters are canonicalized by nostr_filter_compile, so two REQs asking for
+// the same events (in any order, with duplicates) resolve to one entry; the
+// matcher then evaluates each distinct filter once per event and fans out to
+// its subscriber list. Identity ignores limit, which only bounds stored-event
+// queries.
+// ============================================================================
+typedef struct {
+  NostrSharedFilter* entries;
+  size_t             max_entries;
+  uint32_t           entries_free;      // Free list head (linked through hash_next)
+  uint32_t           links_free;        // Free list head (linked through next)
+  uint32_t*          buckets;           // Entry chains by hash
+  size_t             buckets_capacity;  // Power of two
+  NostrFilterLink*   links;             // max_entries links
+  NostrFilter*       scratch;           // Canonicalization buffer; becomes the entry on a miss
+  size_t             count;             // Live entries
+  size_t             links_count;       // Live links
+} NostrFilterRegistry, *PNostrFilterRegistry;
+
+// ============================================================================
+// Initialize registry for up to max_entries filters (and as many links)
+// ============================================================================
+bool nostr_filter_registry_init(NostrFilterRegistry* registry, size_t max_entries);
+
+// ============================================================================
+// Destroy registry (frees every filter)
+// ============================================================================
+void nostr_filter_registry_destroy(NostrFilterRegistry* registry);
+
+// ============================================================================
+// Get the live entry in a slot (NULL if the slot is free)
+// ============================================================================
+const NostrSharedFilter* nostr_filter_registry_entry(const NostrFilterRegistry* registry, uint32_t entry);
+
+// ============================================================================
+// Compile a copy of filter and subscribe to its shared entry, creating the
+// entry if no equal filter exists yet (created is set accordingly)
+// Returns the new link, or NIL on failure
+// ============================================================================
+uint32_t nostr_filter_registry_acquire(
+  NostrFilterRegistry* registry,
+  const NostrFilter*   filter,
+  uint32_t             subscription,
+  bool*                created);
+
+// ============================================================================
+// Drop a link; returns the entry slot if this freed it, else NIL
+// ============================================================================
+uint32_t nostr_filter_registry_release(NostrFilterRegistry* registry, uint32_t link);
+
+#endif
@@ -107,7 +107,7 @@ bool extract_nostr_filter_tag(
       continue;
     }
 
-    if (val_len > 64) {
+    if (val_len > NOSTR_FILTER_LONG_TAG_VALUE_LENGTH) {
       token_idx++;
       continue;
     }
@@ -122,11 +122,17 @@ bool extract_nostr_filter_tag(
         hex_to_bytes(val_str, val_len, tag->values[tag->values_count], 32);
         tag->values_count++;
       }
-    } else {
-      // For generic tags (like #t), store as-is (up to 32 bytes)
-      size_t copy_len = val_len < 32 ? val_len : 32;
-      internal_memcpy(tag->values[tag->values_count], val_str, copy_len);
+    } else if (val_len <= 32) {
+      // For generic tags (like #t), store as-is
+      internal_memcpy(tag->values[tag->values_count], val_str, val_len);
       tag->values_count++;
+    } else if (tag->long_values_count < NOSTR_FILTER_MAX_LONG_TAG_VALUES) {
+      // Longer values are kept whole so they are compared in full
+      NostrFilterLongTagValue* long_value = &tag->long_values[tag->long_values_count++];
+      long_value->length                  = (uint8_t)val_len;
+      internal_memcpy(long_value->value, val_str, val_len);
+    } else {
+      log_debug("Filter error: too many long tag values\n");
     }
 
     token_idx++;
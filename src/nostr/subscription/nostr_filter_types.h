@@ -14,6 +14,12 @@
 #define NOSTR_FILTER_ID_LENGTH 32
 #define NOSTR_FILTER_PUBKEY_LENGTH 32
 #define NOSTR_FILTER_TAG_VALUE_LENGTH 256
+#define NOSTR_FILTER_MAX_LONG_TAG_VALUES 16
+#define NOSTR_FILTER_LONG_TAG_VALUE_LENGTH 64  // Longer tag values are dropped by the parser
+#define NOSTR_FILTER_KIND_BITMAP_BITS 65536
+#define NOSTR_MATCH_EVENT_MAX_TAGS (2 * 1024)
+#define NOSTR_FILTER_PROGRAM_LENGTH (4 + NOSTR_FILTER_MAX_TAGS)
+#define NOSTR_FILTER_AUTHORS_HASH_SLOTS 512  // Power of two, >= 2 * NOSTR_FILTER_MAX_AUTHORS
 
 // ============================================================================
 // Filter ID (supports prefix matching)
@@ -31,15 +37,47 @@ typedef struct {
   size_t  prefix_len;
 } NostrFilterPubkey;
 
+// ============================================================================
+// Filter tag value longer than 32 bytes (kept whole, compared in full)
+// ============================================================================
+typedef struct {
+  uint8_t length;
+  uint8_t value[NOSTR_FILTER_LONG_TAG_VALUE_LENGTH];
+} NostrFilterLongTagValue;
+
 // ============================================================================
 // Filter Tag
 // ============================================================================
 typedef struct {
-  char    name;  // Tag name character ('e', 'p', 't', etc.)
-  uint8_t values[NOSTR_FILTER_MAX_TAG_VALUES][32];
-  size_t  values_count;
+  char                    name;  // Tag name character ('e', 'p', 't', etc.)
+  uint8_t                 values[NOSTR_FILTER_MAX_TAG_VALUES][32];  // Binary for 'e'/'p', zero-padded string otherwise
+  size_t                  values_count;
+  NostrFilterLongTagValue long_values[NOSTR_FILTER_MAX_LONG_TAG_VALUES];  // Values longer than 32 bytes
+  size_t                  long_values_count;
 } NostrFilterTag;
 
+// ============================================================================
+// Predicate program opcodes (one instruction per constrained field)
+// ============================================================================
+typedef enum {
+  NOSTR_FILTER_OP_KIND_ONE    = 0,  // kind == kinds[0]
+  NOSTR_FILTER_OP_KIND_BITMAP = 1,  // kinds_bitmap test (scan for kinds past the bitmap)
+  NOSTR_FILTER_OP_SINCE       = 2,
+  NOSTR_FILTER_OP_UNTIL       = 3,
+  NOSTR_FILTER_OP_RANGE       = 4,  // since and until
+  NOSTR_FILTER_OP_ID_ONE      = 5,  // Single full id
+  NOSTR_FILTER_OP_ID_SET      = 6,  // Sorted full ids, then prefixes
+  NOSTR_FILTER_OP_AUTHOR_ONE  = 7,  // Single full pubkey
+  NOSTR_FILTER_OP_AUTHOR_HASH = 8,  // authors_hash probe, then prefixes
+  NOSTR_FILTER_OP_TAG_ONE     = 9,  // operand: tag index with a single value
+  NOSTR_FILTER_OP_TAG_SET     = 10, // operand: tag index, sorted values
+} NostrFilterOp;
+
+typedef struct {
+  uint8_t op;
+  uint8_t operand;
+} NostrFilterInstruction;
+
 // ============================================================================
 // NostrFilter - Complete filter structure
 // ============================================================================
@@ -67,6 +105,41 @@ typedef struct {
   // result limit
   uint32_t limit;      // 0 = use default (when has_limit is false)
   bool     has_limit;  // true if limit was explicitly specified in filter
+
+  // compiled form (filled once by nostr_filter_compile at REQ time)
+  bool     compiled;
+  size_t   ids_full_count;      // ids[0..n) are full 32-byte ids, sorted; the rest are prefixes
+  size_t   authors_full_count;  // authors[0..n) are full pubkeys, sorted; the rest are prefixes
+  uint64_t kinds_bitmap[NOSTR_FILTER_KIND_BITMAP_BITS / 64];
+
+  // predicate program: only the fields present, most selective first
+  NostrFilterInstruction program[NOSTR_FILTER_PROGRAM_LENGTH];
+  size_t                 program_length;
+  uint16_t               authors_hash[NOSTR_FILTER_AUTHORS_HASH_SLOTS];  // 1-based index into authors, 0 = empty
 } NostrFilter, *PNostrFilter;
 
+// ============================================================================
+// Event tag decoded for matching (first value of a single-letter tag)
+// ============================================================================
+typedef struct {
+  char        name;
+  uint8_t     length;     // Value length (32 for 'e'/'p')
+  uint8_t     value[32];  // Binary for 'e'/'p', zero-padded string (or its first 32 bytes) otherwise
+  const char* raw;        // Whole value, inside the event, when longer than 32 bytes
+} NostrMatchEventTag;
+
+// ============================================================================
+// NostrMatchEvent - Event decoded to binary once per broadcast
+// ============================================================================
+typedef struct {
+  uint8_t            id[32];
+  uint8_t            pubkey[32];
+  bool               id_valid;
+  bool               pubkey_valid;
+  uint32_t           kind;
+  int64_t            created_at;
+  size_t             tags_count;
+  NostrMatchEventTag tags[NOSTR_MATCH_EVENT_MAX_TAGS];
+} NostrMatchEvent, *PNostrMatchEvent;
+
 #endif
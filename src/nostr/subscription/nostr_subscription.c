@@ -6,29 +6,282 @@
 #include "../../util/string.h"
 #include "nostr_filter.h"
 
+#define SUB_NIL NOSTR_SUBSCRIPTION_NIL
+
 // ============================================================================
-// Initialize subscription manager (allocates subscriptions via mmap)
+// Helper: Allocate / free zeroed anonymous memory
 // ============================================================================
-bool nostr_subscription_manager_init(NostrSubscriptionManager* manager)
+static void* sub_alloc(size_t size)
 {
-  if (manager == NULL) {
+  void* ptr = internal_mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static void sub_free(void* ptr, size_t size)
+{
+  if (ptr != NULL) {
+    internal_munmap(ptr, size);
+  }
+}
+
+// ============================================================================
+// Helper: Hash (client_fd, subscription_id) with FNV-1a
+// ============================================================================
+static uint32_t key_hash(int32_t client_fd, const char* subscription_id, size_t id_len)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL ^ (uint32_t)client_fd;
+  hash *= 0x100000001b3ULL;
+  for (size_t i = 0; i < id_len; i++) {
+    hash ^= (uint8_t)subscription_id[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static inline uint32_t* bucket_for(const NostrSubscriptionManager* manager, int32_t client_fd, const char* subscription_id, size_t id_len)
+{
+  return &manager->buckets[key_hash(client_fd, subscription_id, id_len) & (manager->buckets_capacity - 1)];
+}
+
+// ============================================================================
+// Get the subscription in a slab slot
+// ============================================================================
+NostrSubscription* nostr_subscription_at(const NostrSubscriptionManager* manager, uint32_t slot)
+{
+  if (manager == NULL || manager->chunks == NULL || slot == SUB_NIL) {
+    return NULL;
+  }
+
+  size_t chunk = slot / NOSTR_SUBSCRIPTION_SLAB_CHUNK;
+  if (chunk >= manager->chunks_count) {
+    return NULL;
+  }
+  return &manager->chunks[chunk][slot % NOSTR_SUBSCRIPTION_SLAB_CHUNK];
+}
+
+// ============================================================================
+// Helper: Add one slab chunk and thread its slots onto the free list
+// ============================================================================
+static bool grow_slab(NostrSubscriptionManager* manager)
+{
+  size_t base = manager->chunks_count * NOSTR_SUBSCRIPTION_SLAB_CHUNK;
+  if (base >= manager->max_count) {
     return false;
   }
 
-  size_t alloc_size = sizeof(NostrSubscription) * NOSTR_SUBSCRIPTION_MAX_COUNT;
-  void*  ptr        = internal_mmap(NULL, alloc_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-  if (ptr == MAP_FAILED) {
+  NostrSubscription* chunk = (NostrSubscription*)sub_alloc(sizeof(NostrSubscription) * NOSTR_SUBSCRIPTION_SLAB_CHUNK);
+  if (chunk == NULL) {
+    log_error("Failed to allocate subscription slab chunk\n");
+    return false;
+  }
+
+  for (size_t i = NOSTR_SUBSCRIPTION_SLAB_CHUNK; i > 0; i--) {
+    NostrSubscription* sub = &chunk[i - 1];
+    sub->slot              = (uint32_t)(base + i - 1);
+    sub->hash_next         = manager->free_head;
+    manager->free_head     = sub->slot;
+  }
+
+  manager->chunks[manager->chunks_count++] = chunk;
+  return true;
+}
+
+// ============================================================================
+// Helper: Take a free slot (grows the slab up to the global cap)
+// ============================================================================
+static NostrSubscription* alloc_slot(NostrSubscriptionManager* manager)
+{
+  if (manager->count >= manager->max_count) {
+    return NULL;
+  }
+
+  if (manager->free_head == SUB_NIL && !grow_slab(manager)) {
+    return NULL;
+  }
+
+  NostrSubscription* sub = nostr_subscription_at(manager, manager->free_head);
+  manager->free_head     = sub->hash_next;
+  return sub;
+}
+
+// ============================================================================
+// Helper: Return a slot to the free list (its filters must be released)
+// ============================================================================
+static void free_slot(NostrSubscriptionManager* manager, NostrSubscription* sub)
+{
+  uint32_t slot = sub->slot;
+
+  internal_memset(sub, 0, sizeof(NostrSubscription));
+
+  sub->slot          = slot;
+  sub->hash_next     = manager->free_head;
+  manager->free_head = slot;
+}
+
+// ============================================================================
+// Helper: Per-connection list for a client (optionally growing the fd table)
+// ============================================================================
+static NostrSubscriptionConnection* connection_for(NostrSubscriptionManager* manager, int32_t client_fd, bool create)
+{
+  if (client_fd < 0) {
+    return NULL;
+  }
+
+  if ((size_t)client_fd >= manager->connections_capacity) {
+    if (!create) {
+      return NULL;
+    }
+
+    size_t capacity = manager->connections_capacity;
+    while ((size_t)client_fd >= capacity) {
+      capacity <<= 1;
+    }
+
+    void* ptr = internal_mremap(
+      manager->connections,
+      sizeof(NostrSubscriptionConnection) * manager->connections_capacity,
+      sizeof(NostrSubscriptionConnection) * capacity,
+      MREMAP_MAYMOVE);
+    if (ptr == MAP_FAILED) {
+      log_error("Failed to grow subscription connection table\n");
+      return NULL;
+    }
+
+    manager->connections = (NostrSubscriptionConnection*)ptr;
+    for (size_t i = manager->connections_capacity; i < capacity; i++) {
+      manager->connections[i].head  = SUB_NIL;
+      manager->connections[i].count = 0;
+    }
+    manager->connections_capacity = capacity;
+  }
+
+  return &manager->connections[client_fd];
+}
+
+// ============================================================================
+// Helper: Link a subscription into its hash bucket and connection list
+// ============================================================================
+static void link_subscription(NostrSubscriptionManager* manager, NostrSubscription* sub, NostrSubscriptionConnection* conn)
+{
+  uint32_t* bucket = bucket_for(manager, sub->client_fd, sub->subscription_id, strlen(sub->subscription_id));
+  sub->hash_next   = *bucket;
+  *bucket          = sub->slot;
+
+  sub->conn_prev = SUB_NIL;
+  sub->conn_next = conn->head;
+  if (conn->head != SUB_NIL) {
+    nostr_subscription_at(manager, conn->head)->conn_prev = sub->slot;
+  }
+  conn->head = sub->slot;
+  conn->count++;
+}
+
+// ============================================================================
+// Helper: Unlink a subscription from its hash bucket and connection list
+// ============================================================================
+static void unlink_subscription(NostrSubscriptionManager* manager, NostrSubscription* sub)
+{
+  uint32_t* link = bucket_for(manager, sub->client_fd, sub->subscription_id, strlen(sub->subscription_id));
+  while (*link != SUB_NIL && *link != sub->slot) {
+    link = &nostr_subscription_at(manager, *link)->hash_next;
+  }
+  if (*link == sub->slot) {
+    *link = sub->hash_next;
+  }
+
+  NostrSubscriptionConnection* conn = connection_for(manager, sub->client_fd, false);
+  if (conn == NULL) {
+    return;
+  }
+
+  if (sub->conn_prev != SUB_NIL) {
+    nostr_subscription_at(manager, sub->conn_prev)->conn_next = sub->conn_next;
+  } else {
+    conn->head = sub->conn_next;
+  }
+  if (sub->conn_next != SUB_NIL) {
+    nostr_subscription_at(manager, sub->conn_next)->conn_prev = sub->conn_prev;
+  }
+  conn->count--;
+}
+
+// ============================================================================
+// Initialize subscription manager with explicit caps
+// ============================================================================
+bool nostr_subscription_manager_init_with_limits(
+  NostrSubscriptionManager* manager,
+  size_t                    max_count,
+  size_t                    max_per_connection)
+{
+  require_not_null(manager, false);
+
+  internal_memset(manager, 0, sizeof(NostrSubscriptionManager));
+  require_valid_length(max_count, false);
+  require(max_count < SUB_NIL, false);
+
+  manager->free_head          = SUB_NIL;
+  manager->max_count          = max_count;
+  manager->max_per_connection = max_per_connection;
+
+  size_t chunks_capacity = (max_count + NOSTR_SUBSCRIPTION_SLAB_CHUNK - 1) / NOSTR_SUBSCRIPTION_SLAB_CHUNK;
+  manager->chunks        = (NostrSubscription**)sub_alloc(sizeof(NostrSubscription*) * chunks_capacity);
+
+  manager->buckets_capacity = 1;
+  while (manager->buckets_capacity < max_count * 2) {
+    manager->buckets_capacity <<= 1;
+  }
+  manager->buckets = (uint32_t*)sub_alloc(sizeof(uint32_t) * manager->buckets_capacity);
+
+  manager->connections_capacity = NOSTR_SUBSCRIPTION_INITIAL_CONNECTIONS;
+  manager->connections          = (NostrSubscriptionConnection*)sub_alloc(
+    sizeof(NostrSubscriptionConnection) * manager->connections_capacity);
+
+  manager->registry  = (NostrFilterRegistry*)sub_alloc(sizeof(NostrFilterRegistry));
+  manager->index     = (NostrSubscriptionIndex*)sub_alloc(sizeof(NostrSubscriptionIndex));
+  manager->sub_epoch = (uint32_t*)sub_alloc(sizeof(uint32_t) * max_count);
+
+  if (manager->chunks == NULL || manager->buckets == NULL || manager->connections == NULL || manager->registry == NULL ||
+      manager->index == NULL || manager->sub_epoch == NULL) {
     log_error("Failed to allocate subscription manager\n");
-    manager->subscriptions = NULL;
-    manager->count         = 0;
+    nostr_subscription_manager_destroy(manager);
+    return false;
+  }
+
+  // Every subscription may hold up to NOSTR_REQ_MAX_FILTERS distinct filters
+  size_t max_filters = max_count * NOSTR_REQ_MAX_FILTERS;
+
+  if (!nostr_filter_registry_init(manager->registry, max_filters)) {
+    sub_free(manager->registry, sizeof(NostrFilterRegistry));
+    manager->registry = NULL;
+    nostr_subscription_manager_destroy(manager);
     return false;
   }
 
-  manager->subscriptions = (NostrSubscription*)ptr;
-  manager->count         = 0;
+  if (!nostr_subscription_index_init(manager->index, max_filters)) {
+    sub_free(manager->index, sizeof(NostrSubscriptionIndex));
+    manager->index = NULL;
+    nostr_subscription_manager_destroy(manager);
+    return false;
+  }
+
+  for (size_t i = 0; i < manager->buckets_capacity; i++) {
+    manager->buckets[i] = SUB_NIL;
+  }
+  for (size_t i = 0; i < manager->connections_capacity; i++) {
+    manager->connections[i].head = SUB_NIL;
+  }
+
   return true;
 }
 
+// ============================================================================
+// Initialize subscription manager with default capacity
+// ============================================================================
+bool nostr_subscription_manager_init(NostrSubscriptionManager* manager)
+{
+  return nostr_subscription_manager_init_with_limits(manager, NOSTR_SUBSCRIPTION_MAX_COUNT, 0);
+}
+
 // ============================================================================
 // Destroy subscription manager (frees subscriptions via munmap)
 // ============================================================================
@@ -38,13 +291,90 @@ void nostr_subscription_manager_destroy(NostrSubscriptionManager* manager)
     return;
   }
 
-  if (manager->subscriptions != NULL) {
-    size_t alloc_size = sizeof(NostrSubscription) * NOSTR_SUBSCRIPTION_MAX_COUNT;
-    internal_munmap(manager->subscriptions, alloc_size);
-    manager->subscriptions = NULL;
+  if (manager->chunks != NULL) {
+    for (size_t c = 0; c < manager->chunks_count; c++) {
+      sub_free(manager->chunks[c], sizeof(NostrSubscription) * NOSTR_SUBSCRIPTION_SLAB_CHUNK);
+    }
+
+    size_t chunks_capacity = (manager->max_count + NOSTR_SUBSCRIPTION_SLAB_CHUNK - 1) / NOSTR_SUBSCRIPTION_SLAB_CHUNK;
+    sub_free(manager->chunks, sizeof(NostrSubscription*) * chunks_capacity);
+  }
+
+  sub_free(manager->buckets, sizeof(uint32_t) * manager->buckets_capacity);
+  sub_free(manager->connections, sizeof(NostrSubscriptionConnection) * manager->connections_capacity);
+
+  if (manager->registry != NULL) {
+    nostr_filter_registry_destroy(manager->registry);
+    sub_free(manager->registry, sizeof(NostrFilterRegistry));
   }
+  if (manager->index != NULL) {
+    nostr_subscription_index_destroy(manager->index);
+    sub_free(manager->index, sizeof(NostrSubscriptionIndex));
+  }
+  sub_free(manager->sub_epoch, sizeof(uint32_t) * manager->max_count);
+
+  internal_memset(manager, 0, sizeof(NostrSubscriptionManager));
+}
 
-  manager->count = 0;
+// ============================================================================
+// Helper: Drop registry links, unposting entries that lose their last subscriber
+// ============================================================================
+static void release_filters(NostrSubscriptionManager* manager, const uint32_t* links, size_t count)
+{
+  for (size_t i = 0; i < count; i++) {
+    uint32_t entry = nostr_filter_registry_release(manager->registry, links[i]);
+    if (entry != NOSTR_FILTER_REGISTRY_NIL) {
+      nostr_subscription_index_remove(manager->index, entry);
+    }
+  }
+}
+
+// ============================================================================
+// Helper: Resolve the REQ's filters to shared entries, posting new entries in
+// the inverted index. On failure the subscription keeps its previous filters.
+// ============================================================================
+static bool store_filters(NostrSubscriptionManager* manager, NostrSubscription* sub, const NostrReqMessage* req)
+{
+  require(req->filters_count <= NOSTR_REQ_MAX_FILTERS, false);
+
+  uint32_t links[NOSTR_REQ_MAX_FILTERS];
+
+  for (size_t i = 0; i < req->filters_count; i++) {
+    bool     created = false;
+    uint32_t link    = nostr_filter_registry_acquire(manager->registry, &req->filters[i], sub->slot, &created);
+    if (link == NOSTR_FILTER_REGISTRY_NIL) {
+      release_filters(manager, links, i);
+      return false;
+    }
+    links[i] = link;
+
+    uint32_t entry = manager->registry->links[link].entry;
+    if (created && !nostr_subscription_index_add(manager->index, entry, manager->registry->entries[entry].filter)) {
+      release_filters(manager, links, i + 1);
+      return false;
+    }
+  }
+
+  // Acquire before releasing, so entries kept across a replace stay posted
+  release_filters(manager, sub->filter_links, sub->filters_count);
+
+  for (size_t i = 0; i < req->filters_count; i++) {
+    sub->filter_links[i] = links[i];
+    sub->filters[i]      = manager->registry->entries[manager->registry->links[links[i]].entry].filter;
+  }
+  sub->filters_count = req->filters_count;
+  return true;
+}
+
+// ============================================================================
+// Helper: Release an active subscription
+// ============================================================================
+static void release_subscription(NostrSubscriptionManager* manager, NostrSubscription* sub)
+{
+  release_filters(manager, sub->filter_links, sub->filters_count);
+  unlink_subscription(manager, sub);
+  free_slot(manager, sub);
+  manager->count--;
 }
 
 // ============================================================================
@@ -56,39 +386,47 @@ NostrSubscription* nostr_subscription_add(
   const NostrReqMessage*    req)
 {
   require_not_null(manager, NULL);
+  require_not_null(manager->chunks, NULL);
   require_not_null(req, NULL);
 
-  // Check if subscription already exists (update it)
-  for (size_t i = 0; i < NOSTR_SUBSCRIPTION_MAX_COUNT; i++) {
-    NostrSubscription* sub = &manager->subscriptions[i];
-    if (sub->active && sub->client_fd == client_fd) {
-      size_t sub_id_len = strlen(sub->subscription_id);
-      size_t req_id_len = strlen(req->subscription_id);
-      if (sub_id_len == req_id_len && strncmp(sub->subscription_id, req->subscription_id, sub_id_len)) {
-        // Update existing subscription
-        internal_memcpy(sub->filters, req->filters, sizeof(NostrFilter) * req->filters_count);
-        sub->filters_count = req->filters_count;
-        return sub;
-      }
+  // Same (client, subscription_id): replace the filters in place
+  NostrSubscription* sub = nostr_subscription_find(manager, client_fd, req->subscription_id);
+  if (sub != NULL) {
+    if (!store_filters(manager, sub, req)) {
+      release_subscription(manager, sub);
+      return NULL;
     }
+    return sub;
   }
 
-  // Find an empty slot
-  for (size_t i = 0; i < NOSTR_SUBSCRIPTION_MAX_COUNT; i++) {
-    NostrSubscription* sub = &manager->subscriptions[i];
-    if (!sub->active) {
-      sub->active    = true;
-      sub->client_fd = client_fd;
-      internal_memcpy(sub->subscription_id, req->subscription_id, strlen(req->subscription_id) + 1);
-      internal_memcpy(sub->filters, req->filters, sizeof(NostrFilter) * req->filters_count);
-      sub->filters_count = req->filters_count;
-      manager->count++;
-      return sub;
-    }
+  NostrSubscriptionConnection* conn = connection_for(manager, client_fd, true);
+  if (conn == NULL) {
+    return NULL;
   }
 
-  log_debug("Subscription manager: no free slots\n");
-  return NULL;
+  if (manager->max_per_connection > 0 && conn->count >= manager->max_per_connection) {
+    log_debug("Subscription manager: per-connection cap reached\n");
+    return NULL;
+  }
+
+  sub = alloc_slot(manager);
+  if (sub == NULL) {
+    log_debug("Subscription manager: no free slots\n");
+    return NULL;
+  }
+
+  sub->active    = true;
+  sub->client_fd = client_fd;
+  internal_memcpy(sub->subscription_id, req->subscription_id, strlen(req->subscription_id) + 1);
+
+  if (!store_filters(manager, sub, req)) {
+    free_slot(manager, sub);
+    return NULL;
+  }
+
+  link_subscription(manager, sub, conn);
+  manager->count++;
+  return sub;
 }
 
 // ============================================================================
@@ -102,21 +440,13 @@ bool nostr_subscription_remove(
   require_not_null(manager, false);
   require_not_null(subscription_id, false);
 
-  size_t search_id_len = strlen(subscription_id);
-
-  for (size_t i = 0; i < NOSTR_SUBSCRIPTION_MAX_COUNT; i++) {
-    NostrSubscription* sub = &manager->subscriptions[i];
-    if (sub->active && sub->client_fd == client_fd) {
-      size_t sub_id_len = strlen(sub->subscription_id);
-      if (sub_id_len == search_id_len && strncmp(sub->subscription_id, subscription_id, sub_id_len)) {
-        internal_memset(sub, 0, sizeof(NostrSubscription));
-        manager->count--;
-        return true;
-      }
-    }
+  NostrSubscription* sub = nostr_subscription_find(manager, client_fd, subscription_id);
+  if (sub == NULL) {
+    return false;
   }
 
-  return false;
+  release_subscription(manager, sub);
+  return true;
 }
 
 // ============================================================================
@@ -128,19 +458,35 @@ size_t nostr_subscription_remove_client(
 {
   require_not_null(manager, 0);
 
+  NostrSubscriptionConnection* conn = connection_for(manager, client_fd, false);
+  if (conn == NULL) {
+    return 0;
+  }
+
   size_t removed = 0;
-  for (size_t i = 0; i < NOSTR_SUBSCRIPTION_MAX_COUNT; i++) {
-    NostrSubscription* sub = &manager->subscriptions[i];
-    if (sub->active && sub->client_fd == client_fd) {
-      internal_memset(sub, 0, sizeof(NostrSubscription));
-      manager->count--;
-      removed++;
-    }
+  while (conn->head != SUB_NIL) {
+    release_subscription(manager, nostr_subscription_at(manager, conn->head));
+    removed++;
   }
 
   return removed;
 }
 
+// ============================================================================
+// Count active subscriptions for a client
+// ============================================================================
+size_t nostr_subscription_count_client(
+  const NostrSubscriptionManager* manager,
+  int32_t                         client_fd)
+{
+  require_not_null(manager, 0);
+
+  if (client_fd < 0 || (size_t)client_fd >= manager->connections_capacity) {
+    return 0;
+  }
+  return manager->connections[client_fd].count;
+}
+
 // ============================================================================
 // Find a subscription by subscription_id and client_fd
 // ============================================================================
@@ -150,32 +496,35 @@ NostrSubscription* nostr_subscription_find(
   const char*               subscription_id)
 {
   require_not_null(manager, NULL);
+  require_not_null(manager->buckets, NULL);
   require_not_null(subscription_id, NULL);
 
   size_t search_id_len = strlen(subscription_id);
 
-  for (size_t i = 0; i < NOSTR_SUBSCRIPTION_MAX_COUNT; i++) {
-    NostrSubscription* sub = &manager->subscriptions[i];
-    if (sub->active && sub->client_fd == client_fd) {
+  uint32_t slot = *bucket_for(manager, client_fd, subscription_id, search_id_len);
+  while (slot != SUB_NIL) {
+    NostrSubscription* sub = nostr_subscription_at(manager, slot);
+    if (sub->client_fd == client_fd) {
       size_t sub_id_len = strlen(sub->subscription_id);
       if (sub_id_len == search_id_len && strncmp(sub->subscription_id, subscription_id, sub_id_len)) {
         return sub;
       }
     }
+    slot = sub->hash_next;
   }
 
   return NULL;
 }
 
 // ============================================================================
-// Check if an event matches any filter in a subscription
+// Check if a decoded event matches any filter in a subscription
 // ============================================================================
-bool nostr_subscription_matches_event(
+bool nostr_subscription_matches_binary(
   const NostrSubscription* subscription,
-  const NostrEventEntity*  event)
+  const NostrMatchEvent*   match_event)
 {
   require_not_null(subscription, false);
-  require_not_null(event, false);
+  require_not_null(match_event, false);
 
   if (!subscription->active) {
     return false;
@@ -183,7 +532,7 @@ bool nostr_subscription_matches_event(
 
   // An event matches if it matches ANY filter in the subscription
   for (size_t i = 0; i < subscription->filters_count; i++) {
-    if (nostr_filter_matches(&subscription->filters[i], event)) {
+    if (nostr_filter_matches_binary(subscription->filters[i], match_event)) {
       return true;
     }
   }
@@ -191,6 +540,112 @@ bool nostr_subscription_matches_event(
   return false;
 }
 
+// ============================================================================
+// Check if an event matches any filter in a subscription
+// ============================================================================
+bool nostr_subscription_matches_event(
+  const NostrSubscription* subscription,
+  const NostrEventEntity*  event)
+{
+  require_not_null(subscription, false);
+  require_not_null(event, false);
+
+  static NostrMatchEvent match_event;  // Too large for the stack
+  nostr_match_event_init(&match_event, event);
+  return nostr_subscription_matches_binary(subscription, &match_event);
+}
+
+// ============================================================================
+// Cheap global pre-filter over every live filter's keys
+// ============================================================================
+bool nostr_subscription_may_match(
+  const NostrSubscriptionManager* manager,
+  const NostrMatchEvent*          match_event)
+{
+  require_not_null(manager, false);
+  require_not_null(match_event, false);
+
+  if (manager->count == 0 || manager->index == NULL) {
+    return false;
+  }
+  return nostr_subscription_index_may_match(manager->index, match_event);
+}
+
+// ============================================================================
+// Candidate verification context for index probes
+// ============================================================================
+typedef struct {
+  NostrSubscriptionManager*      manager;
+  const NostrMatchEvent*         match_event;
+  NostrSubscriptionMatchCallback callback;
+  void*                          user_data;
+} MatchContext;
+
+// ============================================================================
+// Helper: Verify one shared filter, then deliver to each of its subscribers
+// not yet delivered in this pass
+// ============================================================================
+static size_t verify_candidate(uint32_t entry, void* user_data)
+{
+  MatchContext*             ctx     = (MatchContext*)user_data;
+  NostrSubscriptionManager* manager = ctx->manager;
+  const NostrSharedFilter*  shared  = nostr_filter_registry_entry(manager->registry, entry);
+  const NostrFilterLink*    links   = manager->registry->links;
+
+  if (shared == NULL || !nostr_filter_matches_binary(shared->filter, ctx->match_event)) {
+    return 0;
+  }
+
+  size_t matched = 0;
+  for (uint32_t l = shared->subscribers; l != NOSTR_FILTER_REGISTRY_NIL; l = links[l].next) {
+    uint32_t slot = links[l].subscription;
+    if (manager->sub_epoch[slot] == manager->epoch) {
+      continue;  // Already delivered through another of its filters
+    }
+    manager->sub_epoch[slot] = manager->epoch;
+
+    NostrSubscription* sub = nostr_subscription_at(manager, slot);
+    if (sub == NULL || !sub->active) {
+      continue;
+    }
+
+    if (ctx->callback != NULL) {
+      ctx->callback(sub, ctx->user_data);
+    }
+    matched++;
+  }
+  return matched;
+}
+
+// ============================================================================
+// Iterate over all active subscriptions that match a decoded event
+// Only filters posted under a key the event carries are verified, each
+// distinct filter once however many subscriptions share it
+// ============================================================================
+size_t nostr_subscription_find_matching_binary(
+  NostrSubscriptionManager*      manager,
+  const NostrMatchEvent*         match_event,
+  NostrSubscriptionMatchCallback callback,
+  void*                          user_data)
+{
+  require_not_null(manager, 0);
+  require_not_null(manager->index, 0);
+  require_not_null(match_event, 0);
+
+  if (++manager->epoch == 0) {
+    internal_memset(manager->sub_epoch, 0, sizeof(uint32_t) * manager->max_count);
+    manager->epoch = 1;
+  }
+
+  MatchContext ctx;
+  ctx.manager     = manager;
+  ctx.match_event = match_event;
+  ctx.callback    = callback;
+  ctx.user_data   = user_data;
+
+  return nostr_subscription_index_probe(manager->index, match_event, verify_candidate, &ctx);
+}
+
 // ============================================================================
 // Iterate over all active subscriptions that match an event
 // ============================================================================
@@ -203,17 +658,9 @@ size_t nostr_subscription_find_matching(
   require_not_null(manager, 0);
   require_not_null(event, 0);
 
-  size_t count = 0;
-
-  for (size_t i = 0; i < NOSTR_SUBSCRIPTION_MAX_COUNT; i++) {
-    NostrSubscription* sub = &manager->subscriptions[i];
-    if (sub->active && nostr_subscription_matches_event(sub, event)) {
-      count++;
-      if (callback != NULL) {
-        callback(sub, user_data);
-      }
-    }
-  }
+  // Decode the event once for all subscriptions
+  static NostrMatchEvent match_event;  // Too large for the stack
+  nostr_match_event_init(&match_event, event);
 
-  return count;
+  return nostr_subscription_find_matching_binary(manager, &match_event, callback, user_data);
 }
@@ -3,43 +3,91 @@
 
 #include "../../util/types.h"
 #include "../nostr_types.h"
+#include "nostr_filter_registry.h"
 #include "nostr_filter_types.h"
 #include "nostr_req.h"
+#include "nostr_subscription_index.h"
 
 // ============================================================================
 // Constants
 // ============================================================================
-#define NOSTR_SUBSCRIPTION_MAX_COUNT 256
+#define NOSTR_SUBSCRIPTION_MAX_COUNT 16384  // Default global cap
+#define NOSTR_SUBSCRIPTION_SLAB_CHUNK 64    // Subscriptions per slab chunk
+#define NOSTR_SUBSCRIPTION_INITIAL_CONNECTIONS 1024
+#define NOSTR_SUBSCRIPTION_NIL 0xFFFFFFFFu
 
 // ============================================================================
 // Subscription entry
+//
+// Allocated from the manager's slab; slot numbers are stable for the
+// lifetime of the subscription. Filters are shared with every other
+// subscription asking for the same events (see NostrFilterRegistry).
 // ============================================================================
 typedef struct {
-  bool        active;
-  int32_t     client_fd;  // Associated client socket
-  char        subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
-  NostrFilter filters[NOSTR_REQ_MAX_FILTERS];
-  size_t      filters_count;
+  bool               active;
+  int32_t            client_fd;  // Associated client socket
+  char               subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+  const NostrFilter* filters[NOSTR_REQ_MAX_FILTERS];       // Shared, compiled filters
+  uint32_t           filter_links[NOSTR_REQ_MAX_FILTERS];  // Registry links backing filters
+  size_t             filters_count;
+  uint32_t           slot;       // Slab slot
+  uint32_t           conn_prev;  // Per-connection list
+  uint32_t           conn_next;
+  uint32_t           hash_next;  // (fd, subscription_id) bucket chain, or free list link
 } NostrSubscription, *PNostrSubscription;
 
+// ============================================================================
+// Per-connection subscription list (indexed by fd)
+// ============================================================================
+typedef struct {
+  uint32_t head;
+  uint32_t count;
+} NostrSubscriptionConnection;
+
 // ============================================================================
 // Subscription manager
 // ============================================================================
 typedef struct {
-  NostrSubscription* subscriptions;
-  size_t             count;
+  NostrSubscription**          chunks;                // Slab chunk table (max_count / SLAB_CHUNK entries)
+  size_t                       chunks_count;          // Chunks allocated so far
+  size_t                       count;                 // Active subscriptions
+  uint32_t                     free_head;             // Free slot list
+  uint32_t                     epoch;                 // Match pass counter
+  uint32_t*                    buckets;               // (fd, subscription_id) hash heads
+  size_t                       buckets_capacity;      // Power of two
+  NostrSubscriptionConnection* connections;           // Indexed by fd, grown on demand
+  size_t                       connections_capacity;
+  size_t                       max_count;             // Global cap
+  size_t                       max_per_connection;    // 0 = no per-connection cap
+  NostrFilterRegistry*         registry;              // Distinct filters and their subscribers
+  NostrSubscriptionIndex*      index;                 // Inverted index over registry entries
+  uint32_t*                    sub_epoch;             // Per slot: last match pass that delivered it
 } NostrSubscriptionManager, *PNostrSubscriptionManager;
 
 // ============================================================================
-// Initialize subscription manager (allocates subscriptions via mmap)
+// Initialize subscription manager with default capacity and no per-connection cap
 // ============================================================================
 bool nostr_subscription_manager_init(NostrSubscriptionManager* manager);
 
+// ============================================================================
+// Initialize subscription manager with explicit caps
+// max_count: global cap; max_per_connection: 0 for no per-connection cap
+// ============================================================================
+bool nostr_subscription_manager_init_with_limits(
+  NostrSubscriptionManager* manager,
+  size_t                    max_count,
+  size_t                    max_per_connection);
+
 // ============================================================================
 // Destroy subscription manager (frees subscriptions via munmap)
 // ============================================================================
 void nostr_subscription_manager_destroy(NostrSubscriptionManager* manager);
 
+// ============================================================================
+// Get the subscription in a slab slot (NULL if the slot is not allocated)
+// ============================================================================
+NostrSubscription* nostr_subscription_at(const NostrSubscriptionManager* manager, uint32_t slot);
+
 // ============================================================================
 // Add a new subscription
 // Returns pointer to the subscription, or NULL on failure
@@ -59,13 +107,20 @@ bool nostr_subscription_remove(
   const char*               subscription_id);
 
 // ============================================================================
-// Remove all subscriptions for a client
+// Remove all subscriptions for a client (walks only the client's own list)
 // Returns number of subscriptions removed
 // ============================================================================
 size_t nostr_subscription_remove_client(
   NostrSubscriptionManager* manager,
   int32_t                   client_fd);
 
+// ============================================================================
+// Count active subscriptions for a client (O(1))
+// ============================================================================
+size_t nostr_subscription_count_client(
+  const NostrSubscriptionManager* manager,
+  int32_t                         client_fd);
+
 // ============================================================================
 // Find a subscription by subscription_id and client_fd
 // Returns pointer to the subscription, or NULL if not found
@@ -75,6 +130,13 @@ NostrSubscription* nostr_subscription_find(
   int32_t                   client_fd,
   const char*               subscription_id);
 
+// ============================================================================
+// Check if a decoded event matches any filter in a subscription
+// ============================================================================
+bool nostr_subscription_matches_binary(
+  const NostrSubscription* subscription,
+  const NostrMatchEvent*   match_event);
+
 // ============================================================================
 // Check if an event matches any filter in a subscription
 // ============================================================================
@@ -82,6 +144,14 @@ bool nostr_subscription_matches_event(
   const NostrSubscription* subscription,
   const NostrEventEntity*  event);
 
+// ============================================================================
+// Cheap global pre-filter: false if no live subscription can match the event,
+// so callers can skip serialization and matching altogether
+// ============================================================================
+bool nostr_subscription_may_match(
+  const NostrSubscriptionManager* manager,
+  const NostrMatchEvent*          match_event);
+
 // ============================================================================
 // Iterate over all active subscriptions that match an event
 // Callback is called for each matching subscription
@@ -97,4 +167,13 @@ size_t nostr_subscription_find_matching(
   NostrSubscriptionMatchCallback callback,
   void*                          user_data);
 
+// ============================================================================
+// Same as nostr_subscription_find_matching for an already-decoded event
+// ============================================================================
+size_t nostr_subscription_find_matching_binary(
+  NostrSubscriptionManager*      manager,
+  const NostrMatchEvent*         match_event,
+  NostrSubscriptionMatchCallback callback,
+  void*                          user_data);
+
 #endif
@@ -0,0 +1,587 @@
+#include "nostr_subscription_index.h"
+
+#include "../../arch/memory.h"
+#include "../../arch/mmap.h"
+#include "../../util/log.h"
+#include "../../util/string.h"
+
+#define INDEX_NIL NOSTR_SUBSCRIPTION_INDEX_NIL
+
+// ============================================================================
+// Helper: Allocate / free zeroed anonymous memory
+// ============================================================================
+static void* index_alloc(size_t size)
+{
+  void* ptr = internal_mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static void index_free(void* ptr, size_t size)
+{
+  if (ptr != NULL) {
+    internal_munmap(ptr, size);
+  }
+}
+
+// ============================================================================
+// Helper: Hash a key (ids and pubkeys are uniform, tag strings and kinds are not)
+// ============================================================================
+static uint64_t key_hash(uint8_t type, char tag_name, const uint8_t* value)
+{
+  const uint64_t mul = 0x9E3779B97F4A7C15ULL;
+  uint64_t       h   = (((uint64_t)type << 8) | (uint8_t)tag_name) * mul;
+
+  for (size_t w = 0; w < 4; w++) {
+    uint64_t word = 0;
+    for (size_t i = 0; i < 8; i++) {
+      word |= (uint64_t)value[w * 8 + i] << (i * 8);
+    }
+    h = (h ^ word) * mul;
+  }
+
+  // Final avalanche so the high bytes reach the slot bits
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  return h;
+}
+
+static bool key_equal(const NostrIndexKey* key, uint8_t type, char tag_name, const uint8_t* value)
+{
+  return key->type == type && key->tag_name == tag_name && internal_memcmp(key->value, value, 32) == 0;
+}
+
+// ============================================================================
+// Helper: Bloom counters of a key hash: one block, three counters in it
+// (block from the high bits; the key table slot uses the low bits)
+// ============================================================================
+static inline uint8_t* bloom_block(const NostrSubscriptionIndex* index, uint64_t hash)
+{
+  size_t block = (size_t)(hash >> 40) & (NOSTR_SUBSCRIPTION_INDEX_BLOOM_BLOCKS - 1);
+  return &index->bloom[block * NOSTR_SUBSCRIPTION_INDEX_BLOOM_BLOCK_SIZE];
+}
+
+static inline size_t bloom_counter(uint64_t hash, size_t i)
+{
+  return (size_t)(hash >> (16 + i * 6)) & (NOSTR_SUBSCRIPTION_INDEX_BLOOM_BLOCK_SIZE - 1);
+}
+
+static void bloom_add(NostrSubscriptionIndex* index, uint64_t hash)
+{
+  uint8_t* block = bloom_block(index, hash);
+  for (size_t i = 0; i < 3; i++) {
+    uint8_t* counter = &block[bloom_counter(hash, i)];
+    if (*counter < 255) {
+      (*counter)++;
+    }
+  }
+}
+
+static void bloom_remove(NostrSubscriptionIndex* index, uint64_t hash)
+{
+  uint8_t* block = bloom_block(index, hash);
+  for (size_t i = 0; i < 3; i++) {
+    uint8_t* counter = &block[bloom_counter(hash, i)];
+    if (*counter < 255) {
+      (*counter)--;  // Saturated counters are sticky
+    }
+  }
+}
+
+static bool bloom_test(const NostrSubscriptionIndex* index, uint64_t hash)
+{
+  const uint8_t* block = bloom_block(index, hash);
+  return block[bloom_counter(hash, 0)] != 0 && block[bloom_counter(hash, 1)] != 0 && block[bloom_counter(hash, 2)] != 0;
+}
+
+// ============================================================================
+// Helper: Find the slot of a key by its hash, or NIL
+// ============================================================================
+static uint32_t find_key_hashed(const NostrSubscriptionIndex* index, uint64_t hash, uint8_t type, char tag_name, const uint8_t* value)
+{
+  size_t mask = index->key_capacity - 1;
+  size_t slot = hash & mask;
+
+  while (index->keys[slot].used) {
+    if (key_equal(&index->keys[slot], type, tag_name, value)) {
+      return (uint32_t)slot;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return INDEX_NIL;
+}
+
+static uint32_t find_key(const NostrSubscriptionIndex* index, uint8_t type, char tag_name, const uint8_t* value)
+{
+  return find_key_hashed(index, key_hash(type, tag_name, value), type, tag_name, value);
+}
+
+// ============================================================================
+// Helper: Place a key into a table known to have room (no existence check)
+// ============================================================================
+static uint32_t place_key(NostrIndexKey* keys, size_t capacity, uint8_t type, char tag_name, const uint8_t* value)
+{
+  size_t mask = capacity - 1;
+  size_t slot = key_hash(type, tag_name, value) & mask;
+
+  while (keys[slot].used) {
+    slot = (slot + 1) & mask;
+  }
+
+  keys[slot].used     = 1;
+  keys[slot].type     = type;
+  keys[slot].tag_name = tag_name;
+  keys[slot].head     = INDEX_NIL;
+  internal_memcpy(keys[slot].value, value, 32);
+  return (uint32_t)slot;
+}
+
+// ============================================================================
+// Helper: Rebuild the key table, dropping tombstones and growing if needed
+// ============================================================================
+static bool rehash_keys(NostrSubscriptionIndex* index)
+{
+  size_t live = 0;
+  for (size_t i = 0; i < index->key_capacity; i++) {
+    if (index->keys[i].used && index->keys[i].head != INDEX_NIL) {
+      live++;
+    }
+  }
+
+  size_t capacity = index->key_capacity;
+  while ((live + 1) * 2 > capacity) {
+    capacity <<= 1;
+  }
+
+  NostrIndexKey* keys = (NostrIndexKey*)index_alloc(sizeof(NostrIndexKey) * capacity);
+  if (keys == NULL) {
+    log_error("Failed to grow subscription index keys\n");
+    return false;
+  }
+
+  for (size_t i = 0; i < index->key_capacity; i++) {
+    const NostrIndexKey* old = &index->keys[i];
+    if (!old->used || old->head == INDEX_NIL) {
+      continue;
+    }
+
+    uint32_t slot   = place_key(keys, capacity, old->type, old->tag_name, old->value);
+    keys[slot].head = old->head;
+    for (uint32_t p = old->head; p != INDEX_NIL; p = index->postings[p].next) {
+      index->postings[p].key = slot;
+    }
+  }
+
+  index_free(index->keys, sizeof(NostrIndexKey) * index->key_capacity);
+  index->keys         = keys;
+  index->key_capacity = capacity;
+  index->key_used     = live;
+  return true;
+}
+
+// ============================================================================
+// Helper: Find or create the slot of a key
+// ============================================================================
+static uint32_t upsert_key(NostrSubscriptionIndex* index, uint8_t type, char tag_name, const uint8_t* value)
+{
+  uint32_t slot = find_key(index, type, tag_name, value);
+  if (slot != INDEX_NIL) {
+    return slot;
+  }
+
+  if ((index->key_used + 1) * 4 > index->key_capacity * 3 && !rehash_keys(index)) {
+    return INDEX_NIL;
+  }
+
+  index->key_used++;
+  return place_key(index->keys, index->key_capacity, type, tag_name, value);
+}
+
+// ============================================================================
+// Helper: Thread postings [from, to) onto the free list
+// ============================================================================
+static void free_postings_range(NostrSubscriptionIndex* index, size_t from, size_t to)
+{
+  for (size_t i = to; i > from; i--) {
+    index->postings[i - 1].next = index->posting_free;
+    index->posting_free         = (uint32_t)(i - 1);
+  }
+}
+
+// ============================================================================
+// Helper: Allocate a posting, growing the pool if needed
+// ============================================================================
+static uint32_t alloc_posting(NostrSubscriptionIndex* index)
+{
+  if (index->posting_free == INDEX_NIL) {
+    size_t old_size = sizeof(NostrIndexPosting) * index->posting_capacity;
+    size_t new_cap  = index->posting_capacity * 2;
+    void*  ptr      = internal_mremap(index->postings, old_size, sizeof(NostrIndexPosting) * new_cap, MREMAP_MAYMOVE);
+    if (ptr == MAP_FAILED) {
+      log_error("Failed to grow subscription index postings\n");
+      return INDEX_NIL;
+    }
+
+    index->postings = (NostrIndexPosting*)ptr;
+    free_postings_range(index, index->posting_capacity, new_cap);
+    index->posting_capacity = new_cap;
+  }
+
+  uint32_t p          = index->posting_free;
+  index->posting_free = index->postings[p].next;
+  return p;
+}
+
+// ============================================================================
+// Helper: Post an entry under one key
+// ============================================================================
+static bool post(
+  NostrSubscriptionIndex* index,
+  uint32_t                entry,
+  uint8_t                 type,
+  char                    tag_name,
+  const uint8_t*          value)
+{
+  uint32_t slot = upsert_key(index, type, tag_name, value);
+  if (slot == INDEX_NIL) {
+    return false;
+  }
+
+  uint32_t p = alloc_posting(index);
+  if (p == INDEX_NIL) {
+    return false;
+  }
+
+  NostrIndexPosting* posting = &index->postings[p];
+  posting->key               = slot;
+  posting->prev              = INDEX_NIL;
+  posting->next              = index->keys[slot].head;
+  posting->entry             = entry;
+  posting->entry_next        = index->entry_head[entry];
+
+  if (posting->next == INDEX_NIL) {
+    // First posting under this key (new or revived tombstone)
+    bloom_add(index, key_hash(type, tag_name, value));
+  } else {
+    index->postings[posting->next].prev = p;
+  }
+  if (type == NOSTR_INDEX_KEY_RESIDUAL) {
+    index->residual++;
+  }
+  index->keys[slot].head   = p;
+  index->entry_head[entry] = p;
+  return true;
+}
+
+// ============================================================================
+// Helper: Post one filter under its most selective exact field
+// ============================================================================
+static bool post_filter(NostrSubscriptionIndex* index, uint32_t entry, const NostrFilter* filter)
+{
+  size_t  best      = (size_t)-1;
+  uint8_t type      = NOSTR_INDEX_KEY_RESIDUAL;
+  size_t  tag_index = 0;
+
+  // Prefix entries cannot be looked up by key, so such fields are skipped
+  if (filter->ids_count > 0 && filter->compiled && filter->ids_full_count == filter->ids_count) {
+    best = filter->ids_count;
+    type = NOSTR_INDEX_KEY_ID;
+  }
+  if (filter->authors_count > 0 && filter->compiled && filter->authors_full_count == filter->authors_count &&
+      filter->authors_count < best) {
+    best = filter->authors_count;
+    type = NOSTR_INDEX_KEY_AUTHOR;
+  }
+  for (size_t i = 0; i < filter->tags_count; i++) {
+    size_t count = filter->tags[i].values_count + filter->tags[i].long_values_count;
+    if (count < best) {
+      best      = count;
+      type      = NOSTR_INDEX_KEY_TAG;
+      tag_index = i;
+    }
+  }
+  // Kinds are the least selective key (kind 1 is most of the traffic)
+  if (type == NOSTR_INDEX_KEY_RESIDUAL && filter->kinds_count > 0) {
+    type = NOSTR_INDEX_KEY_KIND;
+  }
+
+  uint8_t value[32];
+  internal_memset(value, 0, sizeof(value));
+
+  switch (type) {
+    case NOSTR_INDEX_KEY_ID:
+      for (size_t i = 0; i < filter->ids_count; i++) {
+        if (!post(index, entry, type, 0, filter->ids[i].value)) {
+          return false;
+        }
+      }
+      return true;
+    case NOSTR_INDEX_KEY_AUTHOR:
+      for (size_t i = 0; i < filter->authors_count; i++) {
+        if (!post(index, entry, type, 0, filter->authors[i].value)) {
+          return false;
+        }
+      }
+      return true;
+    case NOSTR_INDEX_KEY_TAG: {
+      const NostrFilterTag* tag = &filter->tags[tag_index];
+      for (size_t i = 0; i < tag->values_count; i++) {
+        if (!post(index, entry, type, tag->name, tag->values[i])) {
+          return false;
+        }
+      }
+      // Long values are keyed by their first 32 bytes, as event tags are
+      for (size_t i = 0; i < tag->long_values_count; i++) {
+        if (!post(index, entry, type, tag->name, tag->long_values[i].value)) {
+          return false;
+        }
+      }
+      return true;
+    }
+    case NOSTR_INDEX_KEY_KIND:
+      for (size_t i = 0; i < filter->kinds_count; i++) {
+        internal_memcpy(value, &filter->kinds[i], sizeof(uint32_t));
+        if (!post(index, entry, type, 0, value)) {
+          return false;
+        }
+      }
+      return true;
+    default:
+      return post(index, entry, NOSTR_INDEX_KEY_RESIDUAL, 0, value);
+  }
+}
+
+// ============================================================================
+// Initialize index
+// ============================================================================
+bool nostr_subscription_index_init(NostrSubscriptionIndex* index, size_t max_entries)
+{
+  require_not_null(index, false);
+  require_valid_length(max_entries, false);
+
+  internal_memset(index, 0, sizeof(NostrSubscriptionIndex));
+
+  index->key_capacity     = NOSTR_SUBSCRIPTION_INDEX_INITIAL_KEYS;
+  index->posting_capacity = NOSTR_SUBSCRIPTION_INDEX_INITIAL_POSTINGS;
+  index->max_entries      = max_entries;
+  index->posting_free     = INDEX_NIL;
+
+  index->keys        = (NostrIndexKey*)index_alloc(sizeof(NostrIndexKey) * index->key_capacity);
+  index->postings    = (NostrIndexPosting*)index_alloc(sizeof(NostrIndexPosting) * index->posting_capacity);
+  index->entry_head  = (uint32_t*)index_alloc(sizeof(uint32_t) * max_entries);
+  index->entry_epoch = (uint32_t*)index_alloc(sizeof(uint32_t) * max_entries);
+  index->bloom       = (uint8_t*)index_alloc(NOSTR_SUBSCRIPTION_INDEX_BLOOM_BLOCKS * NOSTR_SUBSCRIPTION_INDEX_BLOOM_BLOCK_SIZE);
+
+  if (index->keys == NULL || index->postings == NULL || index->entry_head == NULL || index->entry_epoch == NULL ||
+      index->bloom == NULL) {
+    log_error("Failed to allocate subscription index\n");
+    nostr_subscription_index_destroy(index);
+    return false;
+  }
+
+  for (size_t i = 0; i < max_entries; i++) {
+    index->entry_head[i] = INDEX_NIL;
+  }
+  free_postings_range(index, 0, index->posting_capacity);
+  return true;
+}
+
+// ============================================================================
+// Destroy index
+// ============================================================================
+void nostr_subscription_index_destroy(NostrSubscriptionIndex* index)
+{
+  if (index == NULL) {
+    return;
+  }
+
+  index_free(index->keys, sizeof(NostrIndexKey) * index->key_capacity);
+  index_free(index->postings, sizeof(NostrIndexPosting) * index->posting_capacity);
+  index_free(index->entry_head, sizeof(uint32_t) * index->max_entries);
+  index_free(index->entry_epoch, sizeof(uint32_t) * index->max_entries);
+  index_free(index->bloom, NOSTR_SUBSCRIPTION_INDEX_BLOOM_BLOCKS * NOSTR_SUBSCRIPTION_INDEX_BLOOM_BLOCK_SIZE);
+  internal_memset(index, 0, sizeof(NostrSubscriptionIndex));
+}
+
+// ============================================================================
+// Post the filter of an entry
+// ============================================================================
+bool nostr_subscription_index_add(
+  NostrSubscriptionIndex* index,
+  uint32_t                entry,
+  const NostrFilter*      filter)
+{
+  require_not_null(index, false);
+  require_not_null(filter, false);
+  require(entry < index->max_entries, false);
+
+  if (!post_filter(index, entry, filter)) {
+    nostr_subscription_index_remove(index, entry);
+    return false;
+  }
+
+  return true;
+}
+
+// ============================================================================
+// Remove all postings of an entry
+// ============================================================================
+void nostr_subscription_index_remove(NostrSubscriptionIndex* index, uint32_t entry)
+{
+  if (index == NULL || entry >= index->max_entries) {
+    return;
+  }
+
+  uint32_t p = index->entry_head[entry];
+  while (p != INDEX_NIL) {
+    NostrIndexPosting* posting = &index->postings[p];
+    uint32_t           next    = posting->entry_next;
+
+    NostrIndexKey* key = &index->keys[posting->key];
+    if (posting->prev != INDEX_NIL) {
+      index->postings[posting->prev].next = posting->next;
+    } else {
+      key->head = posting->next;
+    }
+    if (posting->next != INDEX_NIL) {
+      index->postings[posting->next].prev = posting->prev;
+    }
+
+    if (key->head == INDEX_NIL) {
+      bloom_remove(index, key_hash(key->type, key->tag_name, key->value));
+    }
+    if (key->type == NOSTR_INDEX_KEY_RESIDUAL) {
+      index->residual--;
+    }
+
+    posting->next       = index->posting_free;
+    index->posting_free = p;
+    p                   = next;
+  }
+
+  index->entry_head[entry] = INDEX_NIL;
+}
+
+// ============================================================================
+// Helper: Verify every posting under one key
+// ============================================================================
+static size_t probe_key(
+  NostrSubscriptionIndex*         index,
+  uint8_t                         type,
+  char                            tag_name,
+  const uint8_t*                  value,
+  NostrSubscriptionIndexCandidate candidate,
+  void*                           user_data)
+{
+  uint64_t hash = key_hash(type, tag_name, value);
+  if (!bloom_test(index, hash)) {
+    return 0;  // Not posted: skip the probe chain
+  }
+
+  uint32_t slot = find_key_hashed(index, hash, type, tag_name, value);
+  if (slot == INDEX_NIL) {
+    return 0;
+  }
+
+  size_t matched = 0;
+  for (uint32_t p = index->keys[slot].head; p != INDEX_NIL; p = index->postings[p].next) {
+    const NostrIndexPosting* posting = &index->postings[p];
+    if (index->entry_epoch[posting->entry] == index->epoch) {
+      continue;  // Already verified for this event (posted under several keys it carries)
+    }
+
+    index->entry_epoch[posting->entry] = index->epoch;
+    matched += candidate(posting->entry, user_data);
+  }
+  return matched;
+}
+
+// ============================================================================
+// Helper: Check one key against the bloom filter
+// ============================================================================
+static inline bool bloom_has_key(const NostrSubscriptionIndex* index, uint8_t type, char tag_name, const uint8_t* value)
+{
+  return bloom_test(index, key_hash(type, tag_name, value));
+}
+
+// ============================================================================
+// Pre-filter an event against every posted key
+// ============================================================================
+bool nostr_subscription_index_may_match(
+  const NostrSubscriptionIndex* index,
+  const NostrMatchEvent*        match_event)
+{
+  require_not_null(index, false);
+  require_not_null(match_event, false);
+
+  // Residual filters (time-only, prefixes, empty) are not keyed: check everything
+  if (index->residual > 0) {
+    return true;
+  }
+
+  if (match_event->id_valid && bloom_has_key(index, NOSTR_INDEX_KEY_ID, 0, match_event->id)) {
+    return true;
+  }
+  if (match_event->pubkey_valid && bloom_has_key(index, NOSTR_INDEX_KEY_AUTHOR, 0, match_event->pubkey)) {
+    return true;
+  }
+
+  uint8_t value[32];
+  internal_memset(value, 0, sizeof(value));
+  internal_memcpy(value, &match_event->kind, sizeof(uint32_t));
+  if (bloom_has_key(index, NOSTR_INDEX_KEY_KIND, 0, value)) {
+    return true;
+  }
+
+  for (size_t i = 0; i < match_event->tags_count; i++) {
+    const NostrMatchEventTag* tag = &match_event->tags[i];
+    if (bloom_has_key(index, NOSTR_INDEX_KEY_TAG, tag->name, tag->value)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// ============================================================================
+// Probe the keys an event carries
+// ============================================================================
+size_t nostr_subscription_index_probe(
+  NostrSubscriptionIndex*         index,
+  const NostrMatchEvent*          match_event,
+  NostrSubscriptionIndexCandidate candidate,
+  void*                           user_data)
+{
+  require_not_null(index, 0);
+  require_not_null(match_event, 0);
+  require_not_null(candidate, 0);
+
+  if (++index->epoch == 0) {
+    internal_memset(index->entry_epoch, 0, sizeof(uint32_t) * index->max_entries);
+    index->epoch = 1;
+  }
+
+  uint8_t value[32];
+  size_t  matched = 0;
+
+  if (match_event->id_valid) {
+    matched += probe_key(index, NOSTR_INDEX_KEY_ID, 0, match_event->id, candidate, user_data);
+  }
+  if (match_event->pubkey_valid) {
+    matched += probe_key(index, NOSTR_INDEX_KEY_AUTHOR, 0, match_event->pubkey, candidate, user_data);
+  }
+
+  internal_memset(value, 0, sizeof(value));
+  internal_memcpy(value, &match_event->kind, sizeof(uint32_t));
+  matched += probe_key(index, NOSTR_INDEX_KEY_KIND, 0, value, candidate, user_data);
+
+  for (size_t i = 0; i < match_event->tags_count; i++) {
+    const NostrMatchEventTag* tag = &match_event->tags[i];
+    matched += probe_key(index, NOSTR_INDEX_KEY_TAG, tag->name, tag->value, candidate, user_data);
+  }
+
+  internal_memset(value, 0, sizeof(value));
+  matched += probe_key(index, NOSTR_INDEX_KEY_RESIDUAL, 0, value, candidate, user_data);
+
+  return matched;
+}
@@ -0,0 +1,132 @@
+#ifndef NOSTR_SUBSCRIPTION_INDEX_H_
+#define NOSTR_SUBSCRIPTION_INDEX_H_
+
+#include "../../util/types.h"
+#include "nostr_filter_types.h"
+
+// ============================================================================
+// Constants
+// ============================================================================
+#define NOSTR_SUBSCRIPTION_INDEX_NIL 0xFFFFFFFFu
+#define NOSTR_SUBSCRIPTION_INDEX_INITIAL_KEYS 1024
+#define NOSTR_SUBSCRIPTION_INDEX_INITIAL_POSTINGS 4096
+#define NOSTR_SUBSCRIPTION_INDEX_BLOOM_BLOCKS 4096  // 64 counters (one cache line) per block
+#define NOSTR_SUBSCRIPTION_INDEX_BLOOM_BLOCK_SIZE 64
+
+// ============================================================================
+// Key types: which event field a posting is keyed on
+// ============================================================================
+typedef enum {
+  NOSTR_INDEX_KEY_RESIDUAL = 0,  // Filters with no indexable field (only since/until/limit or prefixes)
+  NOSTR_INDEX_KEY_ID       = 1,
+  NOSTR_INDEX_KEY_AUTHOR   = 2,
+  NOSTR_INDEX_KEY_KIND     = 3,
+  NOSTR_INDEX_KEY_TAG      = 4,
+} NostrIndexKeyType;
+
+// ============================================================================
+// Key table slot (open addressing)
+//
+// A used slot whose head is NIL is a tombstone: it keeps probe chains intact
+// and is reused or purged on the next rehash.
+// ============================================================================
+typedef struct {
+  uint8_t  type;
+  char     tag_name;
+  uint8_t  used;
+  uint8_t  dummy;
+  uint32_t head;  // First posting under this key
+  uint8_t  value[32];
+} NostrIndexKey;
+
+// ============================================================================
+// Posting: one filter entry under one key
+// ============================================================================
+typedef struct {
+  uint32_t key;         // Slot in the key table
+  uint32_t prev;        // Previous posting under the same key
+  uint32_t next;        // Next posting under the same key
+  uint32_t entry_next;  // Next posting of the same entry
+  uint32_t entry;       // Filter entry (shared filter slot)
+  uint32_t dummy;
+} NostrIndexPosting;
+
+// ============================================================================
+// Inverted index from event keys to filter entries
+//
+// Each filter is posted under exactly one of its mandatory fields, the most
+// selective one it can be looked up by: the smallest of ids, authors or a
+// single tag (exact values only), else kinds, else the residual key. An event
+// then probes only the keys it carries plus the residual key, and every
+// candidate entry is verified once with the full filter.
+//
+// A blocked counting bloom filter over the live keys sits in front of the
+// key table: a key it has never seen costs one cache line instead of a
+// probe chain, and an event none of whose keys hit it (with no residual
+// filter live) is known to match nothing. Counters saturate at 255 and then
+// stay set, which only costs false positives.
+// ============================================================================
+typedef struct {
+  NostrIndexKey*     keys;
+  size_t             key_capacity;  // Power of two
+  size_t             key_used;      // Used slots, tombstones included
+  NostrIndexPosting* postings;
+  size_t             posting_capacity;
+  uint32_t           posting_free;  // Free list head (linked through next)
+  uint32_t           epoch;         // Probe counter for per-event dedup
+  uint32_t*          entry_head;    // Per entry: first posting
+  uint32_t*          entry_epoch;   // Per entry: last probe that visited it
+  size_t             max_entries;
+  uint8_t*           bloom;         // BLOOM_BLOCKS x BLOOM_BLOCK_SIZE counters
+  size_t             residual;      // Postings under the residual key
+} NostrSubscriptionIndex, *PNostrSubscriptionIndex;
+
+// ============================================================================
+// Candidate callback: verify an entry against the event (called at most once
+// per entry and event). Returns the number of subscriptions it matched.
+// ============================================================================
+typedef size_t (*NostrSubscriptionIndexCandidate)(
+  uint32_t entry,
+  void*    user_data);
+
+// ============================================================================
+// Initialize index for entries [0, max_entries)
+// ============================================================================
+bool nostr_subscription_index_init(NostrSubscriptionIndex* index, size_t max_entries);
+
+// ============================================================================
+// Destroy index
+// ============================================================================
+void nostr_subscription_index_destroy(NostrSubscriptionIndex* index);
+
+// ============================================================================
+// Post the filter of an entry (filter must be compiled)
+// ============================================================================
+bool nostr_subscription_index_add(
+  NostrSubscriptionIndex* index,
+  uint32_t                entry,
+  const NostrFilter*      filter);
+
+// ============================================================================
+// Remove all postings of an entry
+// ============================================================================
+void nostr_subscription_index_remove(NostrSubscriptionIndex* index, uint32_t entry);
+
+// ============================================================================
+// Cheap pre-filter: false if no posted filter can match the event
+// (no residual filter is live and none of the event's keys is posted)
+// ============================================================================
+bool nostr_subscription_index_may_match(
+  const NostrSubscriptionIndex* index,
+  const NostrMatchEvent*        match_event);
+
+// ============================================================================
+// Probe the keys an event carries; returns number of matched subscriptions
+// ============================================================================
+size_t nostr_subscription_index_probe(
+  NostrSubscriptionIndex*         index,
+  const NostrMatchEvent*          match_event,
+  NostrSubscriptionIndexCandidate candidate,
+  void*                           user_data);
+
+#endif
@@ -87,6 +87,10 @@ typedef uint64_t clock_t;
 #define INT64_MAX 9223372036854775807LL
 #endif
 
+#ifndef UINT64_MAX
+#define UINT64_MAX 18446744073709551615ULL
+#endif
+
 #ifndef bool
 #define bool int32_t
 #endif
@@ -129,6 +129,50 @@ bool to_websocket_entity(const char* restrict raw, const size_t capacity, WebSoc
   return true;
 }
 
+/**
+ * @brief Decode only the frame header to learn the payload length
+ *
+ * Lets the caller reject an oversized frame before anything is unmasked or copied.
+ *
+ * @param[in]  raw            Raw data (network byte order)
+ * @param[in]  capacity       Capacity of raw data
+ * @param[out] payload_length Payload length announced by the header
+ *
+ * @return Header length in bytes (including the masking key), or 0 if the header is incomplete
+ */
+size_t websocket_frame_header_decode(const char* restrict raw, const size_t capacity, uint64_t* restrict payload_length)
+{
+  require_not_null(raw, 0);
+  require_not_null(payload_length, 0);
+  require(capacity >= 2, 0);
+
+  uint8_t mask        = (raw[1] & 0x80) >> 7;
+  uint8_t payload_len = (raw[1] & 0x7F);
+  size_t  header_len  = 2;
+
+  if (payload_len == 126) {
+    require(capacity >= 4, 0);
+    *payload_length = ((unsigned char)raw[2] << 8) | (unsigned char)raw[3];
+    header_len += 2;
+  } else if (payload_len == 127) {
+    require(capacity >= 10, 0);
+    *payload_length = 0;
+    for (int32_t i = 0; i < 8; i++) {
+      *payload_length = (*payload_length << 8) | (unsigned char)raw[2 + i];
+    }
+    header_len += 8;
+  } else {
+    *payload_length = payload_len;
+  }
+
+  if (mask) {
+    header_len += 4;
+  }
+
+  require(capacity >= header_len, 0);
+  return header_len;
+}
+
 /**
  * @brief Parse raw data into a websocket packet and return consumed bytes
  *
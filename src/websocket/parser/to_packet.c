@@ -100,3 +100,31 @@ size_t to_websocket_packet(const WebSocketEntity* restrict entity, const size_t
 
   return offset;
 }
+
+size_t websocket_frame_header_encode(const uint8_t opcode, const uint64_t payload_length, const size_t capacity, char* restrict raw)
+{
+  require_not_null(raw, 0);
+  require(capacity >= 2, 0);
+
+  raw[0] = (char)(0x80 | (opcode & 0x0F));  // FIN, no RSV bits
+
+  if (payload_length <= 125) {
+    raw[1] = (char)payload_length;
+    return 2;
+  }
+
+  if (payload_length <= 0xFFFF) {
+    require(capacity >= 4, 0);
+    raw[1] = 126;
+    raw[2] = (char)((payload_length >> 8) & 0xFF);
+    raw[3] = (char)(payload_length & 0xFF);
+    return 4;
+  }
+
+  require(capacity >= 10, 0);
+  raw[1] = 127;
+  for (int32_t i = 7; i >= 0; i--) {
+    raw[2 + (7 - i)] = (char)((payload_length >> (i * 8)) & 0xFF);
+  }
+  return 10;
+}
@@ -28,7 +28,8 @@ bool websocket_server_loop(const WebSocketLoopArgs* args)
   var_debug("websocket server fd : ", args->server_sock);
   var_debug("websocket epoll  fd : ", epoll_fd);
 
-  buffer.capacity = args->buffer_capacity;
+  buffer.capacity           = args->buffer_capacity;
+  buffer.max_message_length = args->max_message_length;
   buffer.request  = websocket_alloc(buffer.capacity);
   buffer.response = websocket_alloc(buffer.capacity);
 
@@ -48,6 +49,10 @@ bool websocket_server_loop(const WebSocketLoopArgs* args)
   websocket_memset(buffer.response, 0x00, buffer.capacity);
 
   while (1) {
+    if (!is_null(args->callbacks.tick_callback)) {
+      args->callbacks.tick_callback();
+    }
+
     int32_t num_of_events = websocket_epoll_wait(epoll_fd, epoll_events, MAX_EVENTS);
     if (num_of_events <= 0) {
       if (num_of_events != WEBSOCKET_ERRORCODE_FATAL_ERROR) {
@@ -24,6 +24,19 @@ static inline int32_t receive_handle(
   size_t          offset      = 0;
 
   while (offset < read_size) {
+    // Admission check from the header alone, before the payload is unmasked
+    uint64_t payload_length = 0;
+    if (buffer->max_message_length > 0 &&
+        websocket_frame_header_decode(buffer->request + offset, read_size - offset, &payload_length) > 0 &&
+        payload_length > buffer->max_message_length) {
+      var_info("frame too large. sock : ", client_sock);
+      if (!is_null(callbacks->oversize_callback)) {
+        callbacks->oversize_callback(client_sock, payload_length, buffer->capacity, buffer->response);
+      }
+      rtn = WEBSOCKET_ERRORCODE_SOCKET_CLOSE_ERROR;
+      goto FINALIZE;
+    }
+
     websocket_memset(&entity, 0x00, sizeof(entity));
     entity.payload = payload_buf;
 
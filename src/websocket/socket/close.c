@@ -1,4 +1,5 @@
 #include "../../arch/close.h"
+#include "../../arch/shutdown.h"
 
 #include "../websocket_local.h"
 
@@ -16,3 +17,18 @@ int32_t websocket_close(const int32_t sock_fd)
 
   return WEBSOCKET_ERRORCODE_NONE;
 }
+
+int32_t websocket_shutdown(const int32_t sock_fd)
+{
+  var_info("WebSocket shutdown...: ", sock_fd);
+  if (sock_fd < 0) {
+    return WEBSOCKET_ERRORCODE_NONE;
+  }
+
+  if (internal_shutdown(sock_fd, SHUT_RDWR) == WEBSOCKET_SYSCALL_ERROR) {
+    str_info("WebSocket shutdown error: ", strerror(errno));
+    return WEBSOCKET_ERRORCODE_SOCKET_CLOSE_ERROR;
+  }
+
+  return WEBSOCKET_ERRORCODE_NONE;
+}
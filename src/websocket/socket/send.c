@@ -17,6 +17,17 @@ int32_t websocket_send(const int32_t sock_fd, const size_t buffer_size, const ch
   return WEBSOCKET_ERRORCODE_NONE;
 }
 
+ssize_t websocket_send_partial(const int32_t sock_fd, const size_t buffer_size, const char* restrict buffer)
+{
+  int32_t errcode;
+  ssize_t bytes_send = internal_sendto(sock_fd, buffer, buffer_size, 0, NULL, 0);
+  if ((errcode = get_send_err(bytes_send)) != WEBSOCKET_ERRORCODE_NONE) {
+    return errcode;
+  }
+
+  return bytes_send;
+}
+
 static int32_t get_send_err(ssize_t bytes_send)
 {
   if (bytes_send != WEBSOCKET_SYSCALL_ERROR) {
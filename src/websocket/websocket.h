@@ -9,6 +9,11 @@
 #include "../http/http.h"
 #include "../util/types.h"
 
+/**
+ * @brief Longest possible frame header: 2 bytes + 8 bytes extended length + 4 bytes masking key
+ */
+#define WEBSOCKET_FRAME_HEADER_MAX_LENGTH 14
+
 /**
  * @enum WebSocketOpCode
  * @brief websocket packet type
@@ -59,6 +64,19 @@ typedef bool (*PWebSocketReceiveCallback)(
   char*                  response_buffer   ///< @param[in/out] response_buffer This buffer must be used to create the return packet.
 );
 
+/**
+ * @brief User callback that is called when a frame header announces a payload over the size limit.
+ *
+ * The payload has not been unmasked or copied. After the callback returns the
+ * client socket is closed, since the rest of the frame cannot be skipped reliably.
+ */
+typedef void (*PWebSocketOversizeCallback)(
+  const int32_t  client_sock,      ///< @param[in]     client_sock     Client socket that sent the frame
+  const uint64_t payload_length,   ///< @param[in]     payload_length  Payload length announced by the frame header
+  const size_t   buffer_capacity,  ///< @param[in]     buffer_capacity Response_buffer capacity.
+  char*          response_buffer   ///< @param[in/out] response_buffer This buffer must be used to create the return packet.
+);
+
 /**
  * @brief User callback to be called when connection is established
  */
@@ -95,6 +113,14 @@ typedef bool (*PWebSocketHandshakeCallback)(
   const size_t       buffer_capacity,
   char*              response_buffer);
 
+/**
+ * @brief User callback that is called once per event loop iteration, before waiting for events.
+ *
+ * Use it for deferred work that must not block the receive path (e.g. event fan-out).
+ * Keep each call bounded: receive processing resumes only after it returns.
+ */
+typedef void (*PWebSocketTickCallback)(void);
+
 /**
  * @brief User callback list to pass to the WebSocket library.
  */
@@ -103,6 +129,8 @@ typedef struct {
   PWebSocketConnectCallback    connect_callback;     ///< @see PWebSocketConnectCallback
   PWebSocketDisconnectCallback disconnect_callback;  ///< @see PWebSocketDisconnectCallback
   PWebSocketHandshakeCallback  handshake_callback;   ///< @see PWebSocketHandshakeCallback
+  PWebSocketOversizeCallback   oversize_callback;    ///< @see PWebSocketOversizeCallback
+  PWebSocketTickCallback       tick_callback;        ///< @see PWebSocketTickCallback
 } WebSocketCallbacks;
 
 /**
@@ -117,10 +145,11 @@ typedef struct {
  * @brief Arguments to pass to websocket_loop()
  */
 typedef struct {
-  int32_t            server_sock;      ///< Socket descriptor obtained by websocket_server_init() function
-  int32_t            dummy;            ///< dummy
-  size_t             buffer_capacity;  ///< Capacity of the send and receive buffer for one client.
-  WebSocketCallbacks callbacks;        ///< @see WebSocketCallBacks
+  int32_t            server_sock;         ///< Socket descriptor obtained by websocket_server_init() function
+  int32_t            dummy;               ///< dummy
+  size_t             buffer_capacity;     ///< Capacity of the send and receive buffer for one client.
+  WebSocketCallbacks callbacks;           ///< @see WebSocketCallBacks
+  size_t             max_message_length;  ///< Max payload length of one frame (0: bounded by buffer_capacity only)
 } WebSocketLoopArgs;
 
 /**
@@ -135,6 +164,17 @@ typedef struct {
 bool   to_websocket_entity(const char* raw, const size_t packet_size, WebSocketEntity* entity);
 size_t to_websocket_entity_consumed(const char* raw, const size_t capacity, WebSocketEntity* entity);
 
+/**
+ * @brief Decode only the frame header to learn the payload length
+ *
+ * @param[in]  raw            raw data (network byte order)
+ * @param[in]  capacity       Capacity of raw data
+ * @param[out] payload_length Payload length announced by the header
+ *
+ * @return Header length in bytes (including the masking key), or 0 if the header is incomplete
+ */
+size_t websocket_frame_header_decode(const char* raw, const size_t capacity, uint64_t* payload_length);
+
 /**
  * @brief Creates raw data to send back to the client
  *
@@ -146,6 +186,21 @@ size_t to_websocket_entity_consumed(const char* raw, const size_t capacity, WebS
  */
 size_t to_websocket_packet(const WebSocketEntity* entity, const size_t capacity, char* raw);
 
+/**
+ * @brief Encodes an unmasked, final frame header for a payload written separately
+ *
+ * Lets the caller serialize the payload in place and prepend the header,
+ * instead of copying the payload through to_websocket_packet.
+ *
+ * @param[in]  opcode         Frame opcode
+ * @param[in]  payload_length Payload length
+ * @param[in]  capacity       Capacity of raw data
+ * @param[out] raw            Header (2, 4 or 10 bytes)
+ *
+ * @return Header length in bytes. If capacity is insufficient, 0 is returned.
+ */
+size_t websocket_frame_header_encode(const uint8_t opcode, const uint64_t payload_length, const size_t capacity, char* raw);
+
 /**
  * @brief Initialize a WebSocket server. socket listen and register signal handler.
  *
@@ -169,6 +224,19 @@ int32_t websocket_server_init(const WebSocketInitArgs* args);
  */
 int32_t websocket_send(const int32_t sock_fd, const size_t buffer_size, const char* buffer);
 
+/**
+ * @brief Wrapper for the BSD socket send() API that reports short writes.
+ *
+ * @param[in] sock_fd     Destination socket descriptor
+ * @param[in] buffer_size Buffer size
+ * @param[in] buffer      Buffer that stores the transmission data
+ *
+ * @return Positive value or zero: Bytes written / Negative value: WebSocket error code
+ *         (WEBSOCKET_ERRORCODE_CONTINUABLE_ERROR when the socket buffer is full)
+ * @see WebSocketErrorCode
+ */
+ssize_t websocket_send_partial(const int32_t sock_fd, const size_t buffer_size, const char* buffer);
+
 /**
  * @brief Wrapper for the BSD socket recv() API.
  *
@@ -191,6 +259,17 @@ ssize_t websocket_recv(const int32_t sock_fd, const size_t capacity, char* buffe
  */
 int32_t websocket_close(const int32_t sock_fd);
 
+/**
+ * @brief Wrapper for the BSD socket shutdown() API (both directions).
+ *        The descriptor stays open; the server loop sees the hangup and closes it.
+ *
+ * @param[in] sock_fd Socket descriptor
+ *
+ * @return WebSocket error code
+ * @see WebSocketErrorCode
+ */
+int32_t websocket_shutdown(const int32_t sock_fd);
+
 /**
  * @brief Enter the receive loop from the client.
  *        This function will block until it is sent a SIGHUP/SIGINT/SIGTERM signal or detects a FATAL ERROR internally.
@@ -23,6 +23,7 @@ typedef struct {
 
 typedef struct {
   size_t  capacity;
+  size_t  max_message_length;  // 0: no limit beyond capacity
   char*   request;
   char*   response;
   uint8_t dummy[6];
@@ -153,6 +153,14 @@ typedef struct {
   uint16_t  depth;
 } BTreePath;
 
+typedef struct {
+  BTree*      tree;
+  const void* max_key;
+  page_id_t   leaf;
+  uint16_t    pos;
+  uint16_t    dummy;
+} BTreeCursor;
+
 typedef struct {
   page_id_t next_page;
   uint16_t  entry_count;
@@ -192,6 +200,10 @@ NostrDBError btree_delete(BTree* tree, const void* key);
 NostrDBError btree_range_scan(BTree* tree, const void* min_key,
                               const void* max_key,
                               BTreeScanCallback callback, void* user_data);
+NostrDBError btree_cursor_open(BTreeCursor* cursor, BTree* tree,
+                               const void* min_key, const void* max_key);
+bool         btree_cursor_next(BTreeCursor* cursor, void* key_out,
+                               void* value_out);
 NostrDBError btree_insert_dup(BTree* tree, const void* key, RecordId rid);
 NostrDBError btree_scan_key(BTree* tree, const void* key,
                             BTreeScanCallback callback, void* user_data);
@@ -668,6 +680,58 @@ TEST_F(BTreeTest, RangeScanWithLimit) {
   EXPECT_EQ(5u, result.keys.size());
 }
 
+TEST_F(BTreeTest, CursorWalksRangeAcrossLeaves) {
+  ASSERT_EQ(NOSTR_DB_OK,
+            btree_create(&tree, &pool, 4, sizeof(RecordId), BTREE_KEY_UINT32));
+
+  for (uint32_t i = 1; i <= 2000; i++) {
+    RecordId rid = {i, (uint16_t)(i % 7)};
+    ASSERT_EQ(NOSTR_DB_OK, btree_insert(&tree, &i, &rid));
+  }
+
+  // Two cursors stepped alternately, as a merge would
+  uint32_t    min_a = 100, max_a = 1500, min_b = 1400;
+  BTreeCursor a, b;
+  ASSERT_EQ(NOSTR_DB_OK, btree_cursor_open(&a, &tree, &min_a, &max_a));
+  ASSERT_EQ(NOSTR_DB_OK, btree_cursor_open(&b, &tree, &min_b, nullptr));
+
+  uint32_t expect_a = 100, expect_b = 1400;
+  bool     more_a = true, more_b = true;
+  while (more_a || more_b) {
+    uint32_t key;
+    RecordId value;
+    if (more_a && (more_a = btree_cursor_next(&a, &key, &value))) {
+      EXPECT_EQ(expect_a, key);
+      EXPECT_EQ(expect_a, value.page_id);
+      expect_a++;
+    }
+    if (more_b && (more_b = btree_cursor_next(&b, &key, nullptr))) {
+      EXPECT_EQ(expect_b, key);
+      expect_b++;
+    }
+  }
+  EXPECT_EQ(1501u, expect_a);
+  EXPECT_EQ(2001u, expect_b);
+}
+
+TEST_F(BTreeTest, CursorEmptyTreeAndRange) {
+  ASSERT_EQ(NOSTR_DB_OK,
+            btree_create(&tree, &pool, 4, sizeof(RecordId), BTREE_KEY_UINT32));
+
+  BTreeCursor c;
+  ASSERT_EQ(NOSTR_DB_OK, btree_cursor_open(&c, &tree, nullptr, nullptr));
+  EXPECT_FALSE(btree_cursor_next(&c, nullptr, nullptr));
+
+  for (uint32_t i = 10; i <= 20; i += 10) {
+    RecordId rid = {i, 0};
+    ASSERT_EQ(NOSTR_DB_OK, btree_insert(&tree, &i, &rid));
+  }
+
+  uint32_t min = 11, max = 19;
+  ASSERT_EQ(NOSTR_DB_OK, btree_cursor_open(&c, &tree, &min, &max));
+  EXPECT_FALSE(btree_cursor_next(&c, nullptr, nullptr));
+}
+
 // ============================================================================
 // Int64 key tests (for timeline index)
 // ============================================================================
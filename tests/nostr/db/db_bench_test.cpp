@@ -65,6 +65,10 @@ typedef struct {
   uint64_t kind_index_entries;
   uint64_t tag_index_entries;
   uint64_t timeline_index_entries;
+  uint64_t query_cache_hits;
+  uint64_t query_cache_misses;
+  uint64_t query_cache_invalidations;
+  uint64_t query_cache_evictions;
 } NostrDBStats;
 
 #define NOSTR_DB_FILTER_MAX_IDS 256
@@ -124,6 +128,24 @@ NostrDBError      nostr_db_query_execute(NostrDB* db,
                                          const NostrDBFilter* filter,
                                          NostrDBResultSet* result);
 
+int32_t      event_serialize(const NostrEventEntity* event, uint8_t* buffer,
+                             uint16_t capacity);
+NostrDBError event_deserialize(const uint8_t* buffer, uint16_t length,
+                               NostrEventEntity* event);
+size_t       event_json_write(const uint8_t* record, uint16_t length, char* out,
+                              size_t capacity);
+size_t       nostr_response_event_object(const NostrEventEntity* event,
+                                         char* buffer, size_t capacity);
+size_t       nostr_response_event_record(const char*    subscription_id,
+                                         const uint8_t* record,
+                                         uint16_t       record_length,
+                                         char* buffer, size_t capacity);
+void         nostr_db_set_event_json(NostrDB* db, bool enabled);
+typedef bool (*NostrDBRecordVisitor)(const uint8_t* record, uint16_t length,
+                                     void* ctx);
+NostrDBError nostr_db_query_visit(NostrDB* db, const NostrDBFilter* filter,
+                                  NostrDBRecordVisitor visit, void* ctx);
+
 }  // extern "C"
 
 class NostrDBBenchTest : public ::testing::Test {
@@ -322,3 +344,247 @@ TEST_F(NostrDBBenchTest, TimelineScanThroughput) {
   nostr_db_result_free(result);
   free_event(event);
 }
+
+// ============================================================================
+// Covered query benchmark: kind and tag+kind filters answered from index
+// entries (created_at, kind, pubkey prefix) rather than record pages
+// ============================================================================
+TEST_F(NostrDBBenchTest, CoveredQueryLatency) {
+  const int COUNT   = 2000;
+  const int QUERIES = 200;
+
+  NostrEventEntity* event = allocate_event();
+  memset(event->sig, '0', 128);
+  event->sig[128] = '\0';
+  strcpy(event->content, "Covered query benchmark");
+
+  for (int i = 0; i < COUNT; i++) {
+    snprintf(
+        event->id, sizeof(event->id),
+        "%016x%016x%016x%016x", i, i * 31, i * 37, i * 41);
+    snprintf(
+        event->pubkey, sizeof(event->pubkey),
+        "%016x%016x%016x%016x", i % 100, 0, 0, 0);
+    event->kind       = (uint32_t)(i % 10);
+    event->created_at = 1704067200 + i;
+
+    // Every event mentions one of 4 pubkeys
+    strcpy(event->tags[0].key, "p");
+    snprintf(event->tags[0].values[0], NOSTR_EVENT_TAG_VALUE_LENGTH,
+             "%016x%016x%016x%016x", 0xabc0 + (i % 4), 0, 0, 0);
+    event->tags[0].item_count = 1;
+    event->tag_count          = 1;
+    ASSERT_EQ(nostr_db_write_event(db, event), NOSTR_DB_OK);
+  }
+
+  NostrDBFilter* filter = (NostrDBFilter*)malloc(sizeof(NostrDBFilter));
+  ASSERT_NE(filter, nullptr);
+
+  // kinds=[1], limit=50
+  nostr_db_filter_init(filter);
+  filter->kinds[0]    = 1;
+  filter->kinds_count = 1;
+  filter->limit       = 50;
+
+  uint32_t kind_count = 0;
+  auto     start      = std::chrono::high_resolution_clock::now();
+  for (int q = 0; q < QUERIES; q++) {
+    NostrDBResultSet* result = nostr_db_result_create(64);
+    ASSERT_NE(result, nullptr);
+    ASSERT_EQ(nostr_db_query_execute(db, filter, result), NOSTR_DB_OK);
+    kind_count = result->count;
+    nostr_db_result_free(result);
+  }
+  auto   end     = std::chrono::high_resolution_clock::now();
+  double kind_us = std::chrono::duration<double, std::micro>(
+                       end - start).count() / QUERIES;
+
+  // #p=[one of 4], kinds=[1], limit=20
+  nostr_db_filter_init(filter);
+  filter->tags[0].name = 'p';
+  hex_to_bytes("000000000000abc1000000000000000000000000000000000000000000000000",
+               filter->tags[0].values[0], 32);
+  filter->tags[0].values_count = 1;
+  filter->tags_count           = 1;
+  filter->kinds[0]             = 1;
+  filter->kinds_count          = 1;
+  filter->limit                = 20;
+
+  uint32_t tag_count = 0;
+  start              = std::chrono::high_resolution_clock::now();
+  for (int q = 0; q < QUERIES; q++) {
+    NostrDBResultSet* result = nostr_db_result_create(64);
+    ASSERT_NE(result, nullptr);
+    ASSERT_EQ(nostr_db_query_execute(db, filter, result), NOSTR_DB_OK);
+    tag_count = result->count;
+    nostr_db_result_free(result);
+  }
+  end           = std::chrono::high_resolution_clock::now();
+  double tag_us = std::chrono::duration<double, std::micro>(
+                      end - start).count() / QUERIES;
+
+  printf("\n  [BENCH] Covered kind query: %u results, %.1f us/query\n",
+         kind_count, kind_us);
+  printf("  [BENCH] Covered tag+kind query: %u results, %.1f us/query\n",
+         tag_count, tag_us);
+
+  EXPECT_EQ(kind_count, 50u);
+  EXPECT_EQ(tag_count, 20u);
+
+  free(filter);
+  free_event(event);
+}
+
+TEST_F(NostrDBBenchTest, RecordToJsonThroughput) {
+  const int ITERATIONS = 20000;
+
+  // A typical note: 280 characters with a few escapes, an e, a p and a t tag
+  NostrEventEntity* event = allocate_event();
+  snprintf(event->id, sizeof(event->id), "%016x%016x%016x%016x",
+           0x1234, 0x5678, 0x9abc, 0xdef0);
+  snprintf(event->pubkey, sizeof(event->pubkey), "%016x%016x%016x%016x",
+           0xfeed, 0xbeef, 0xcafe, 0xf00d);
+  memset(event->sig, 'e', 128);
+  event->sig[128]   = '\0';
+  event->kind       = 1;
+  event->created_at = 1704067200;
+  for (int i = 0; i < 280; i++) {
+    event->content[i] = (i % 70 == 69) ? '\n' : (char)('a' + i % 26);
+  }
+  event->content[280] = '\0';
+  const char* keys[3] = {"e", "p", "t"};
+  for (int t = 0; t < 3; t++) {
+    strcpy(event->tags[t].key, keys[t]);
+    memset(event->tags[t].values[0], '0' + t, 64);
+    event->tags[t].values[0][64] = '\0';
+    event->tags[t].item_count    = 1;
+  }
+  strcpy(event->tags[2].values[0], "nostr");
+  event->tag_count = 3;
+
+  uint8_t record[8192];
+  int32_t length = event_serialize(event, record, sizeof(record));
+  ASSERT_GT(length, 0);
+
+  static char entity_json[65536];
+  static char record_json[65536];
+  size_t      entity_len = 0;
+  size_t      record_len = 0;
+
+  // Current path: record -> NostrEventEntity -> JSON
+  NostrEventEntity* decoded = allocate_event();
+  auto              start   = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    ASSERT_EQ(event_deserialize(record, (uint16_t)length, decoded), NOSTR_DB_OK);
+    entity_len = nostr_response_event_object(decoded, entity_json,
+                                             sizeof(entity_json));
+  }
+  auto   end       = std::chrono::high_resolution_clock::now();
+  double entity_ns = std::chrono::duration<double, std::nano>(
+                         end - start).count() / ITERATIONS;
+
+  // Direct path: record -> JSON
+  start = std::chrono::high_resolution_clock::now();
+  for (int i = 0; i < ITERATIONS; i++) {
+    record_len = event_json_write(record, (uint16_t)length, record_json,
+                                  sizeof(record_json));
+  }
+  end              = std::chrono::high_resolution_clock::now();
+  double record_ns = std::chrono::duration<double, std::nano>(
+                         end - start).count() / ITERATIONS;
+
+  printf("\n  [BENCH] Record -> entity -> JSON: %.0f ns/event\n", entity_ns);
+  printf("  [BENCH] Record -> JSON: %.0f ns/event (%.1fx)\n", record_ns,
+         record_ns > 0 ? entity_ns / record_ns : 0.0);
+
+  ASSERT_GT(record_len, 0u);
+  EXPECT_EQ(record_len, entity_len);
+  EXPECT_EQ(memcmp(record_json, entity_json, record_len), 0);
+
+  free_event(decoded);
+  free_event(event);
+}
+
+// Serializes every visited record as a REQ would
+struct ServeStats {
+  uint64_t bytes;
+  uint32_t events;
+};
+
+static bool serve_record(const uint8_t* record, uint16_t length, void* ctx) {
+  static char message[65536];
+  ServeStats* stats = (ServeStats*)ctx;
+  stats->bytes += length;
+  stats->events += nostr_response_event_record("bench", record, length, message,
+                                               sizeof(message)) > 0;
+  return true;
+}
+
+TEST_F(NostrDBBenchTest, StoredEventJsonTradeoff) {
+  const int COUNT  = 1000;
+  const int ROUNDS = 20;
+
+  // Same notes in both forms: kind 1 rebuilt from fields, kind 2 stored JSON
+  NostrEventEntity* event = allocate_event();
+  memset(event->sig, 'f', 128);
+  event->sig[128] = '\0';
+  for (int i = 0; i < 200; i++) {
+    event->content[i] = (char)('a' + i % 26);
+  }
+  strcpy(event->tags[0].key, "p");
+  memset(event->tags[0].values[0], '7', 64);
+  event->tags[0].item_count = 1;
+  event->tag_count          = 1;
+
+  for (int form = 0; form < 2; form++) {
+    nostr_db_set_event_json(db, form == 1);
+    for (int i = 0; i < COUNT; i++) {
+      snprintf(event->id, sizeof(event->id), "%016x%016x%016x%016x", form, i,
+               i * 31, i * 37);
+      snprintf(event->pubkey, sizeof(event->pubkey), "%016x%016x%016x%016x",
+               i % 50, 0, 0, 0);
+      event->kind       = (uint32_t)(1 + form);
+      event->created_at = 1704067200 + i;
+      ASSERT_EQ(nostr_db_write_event(db, event), NOSTR_DB_OK);
+    }
+  }
+
+  NostrDBFilter* filter = (NostrDBFilter*)malloc(sizeof(NostrDBFilter));
+  ASSERT_NE(filter, nullptr);
+
+  double     ns[2];
+  ServeStats stats[2];
+  for (int form = 0; form < 2; form++) {
+    nostr_db_filter_init(filter);
+    filter->kinds[0]    = (uint32_t)(1 + form);
+    filter->kinds_count = 1;
+    filter->limit       = COUNT;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < ROUNDS; r++) {
+      stats[form] = {0, 0};
+      ASSERT_EQ(nostr_db_query_visit(db, filter, serve_record, &stats[form]),
+                NOSTR_DB_OK);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    ns[form] = std::chrono::duration<double, std::nano>(end - start).count() /
+               ((double)ROUNDS * COUNT);
+  }
+
+  double bytes_rebuilt = (double)stats[0].bytes / COUNT;
+  double bytes_stored  = (double)stats[1].bytes / COUNT;
+  printf("\n  [BENCH] Serve rebuilt JSON: %.0f ns/event, %.0f record bytes/event\n",
+         ns[0], bytes_rebuilt);
+  printf("  [BENCH] Serve stored JSON:  %.0f ns/event, %.0f record bytes/event\n",
+         ns[1], bytes_stored);
+  printf("  [BENCH] Stored JSON: +%.0f%% storage, %.0f ns/event saved\n",
+         100.0 * (bytes_stored - bytes_rebuilt) / bytes_rebuilt, ns[0] - ns[1]);
+
+  EXPECT_EQ(stats[0].events, (uint32_t)COUNT);
+  EXPECT_EQ(stats[1].events, (uint32_t)COUNT);
+  EXPECT_GT(stats[1].bytes, stats[0].bytes);
+
+  free(filter);
+  free_event(event);
+}
+
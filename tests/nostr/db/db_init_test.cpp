@@ -38,6 +38,10 @@ typedef struct {
   uint64_t kind_index_entries;
   uint64_t tag_index_entries;
   uint64_t timeline_index_entries;
+  uint64_t query_cache_hits;
+  uint64_t query_cache_misses;
+  uint64_t query_cache_invalidations;
+  uint64_t query_cache_evictions;
 } NostrDBStats;
 
 // DB functions
@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <string>
+
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -105,10 +107,31 @@ typedef enum {
   NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN,
 } NostrDBQueryStrategy;
 
+typedef struct {
+  uint64_t event_count;
+  uint64_t deleted_count;
+  uint64_t events_file_size;
+  uint64_t id_index_entries;
+  uint64_t pubkey_index_entries;
+  uint64_t kind_index_entries;
+  uint64_t tag_index_entries;
+  uint64_t timeline_index_entries;
+  uint64_t query_cache_hits;
+  uint64_t query_cache_misses;
+  uint64_t query_cache_invalidations;
+  uint64_t query_cache_evictions;
+} NostrDBStats;
+
 // DB functions
 NostrDBError nostr_db_init(NostrDB** db, const char* data_dir);
 void         nostr_db_shutdown(NostrDB* db);
 NostrDBError nostr_db_write_event(NostrDB* db, const NostrEventEntity* event);
+NostrDBError nostr_db_delete_event(NostrDB* db, const uint8_t* id);
+void         nostr_db_set_event_json(NostrDB* db, bool enabled);
+NostrDBError nostr_db_set_query_cache(NostrDB* db, size_t entries);
+NostrDBError nostr_db_get_stats(NostrDB* db, NostrDBStats* stats);
+size_t       event_json_write(const uint8_t* record, uint16_t length, char* out,
+                              size_t capacity);
 
 // Filter functions
 void                 nostr_db_filter_init(NostrDBFilter* filter);
@@ -127,6 +150,19 @@ void              nostr_db_result_free(NostrDBResultSet* r);
 // Query execution
 NostrDBError nostr_db_query_execute(NostrDB* db, const NostrDBFilter* filter,
                                     NostrDBResultSet* result);
+typedef bool (*NostrDBRecordVisitor)(const uint8_t* record, uint16_t length,
+                                     void* ctx);
+NostrDBError nostr_db_query_visit(NostrDB* db, const NostrDBFilter* filter,
+                                  NostrDBRecordVisitor visit, void* ctx);
+NostrDBError nostr_db_query_visit_all(NostrDB* db, const NostrDBFilter* filters,
+                                      size_t count, NostrDBRecordVisitor visit,
+                                      void* ctx);
+typedef struct NostrDBCursor NostrDBCursor;
+NostrDBError nostr_db_cursor_open(NostrDB* db, const NostrDBFilter* filters,
+                                  size_t count, NostrDBCursor** out);
+bool         nostr_db_cursor_step(NostrDBCursor* cursor, uint32_t budget,
+                                  NostrDBRecordVisitor visit, void* ctx);
+void         nostr_db_cursor_close(NostrDBCursor* cursor);
 
 }  // extern "C"
 
@@ -425,6 +461,424 @@ TEST_F(NostrDBQueryTest, QueryWithLimit) {
   nostr_db_result_free(result);
 }
 
+// Records are visited newest first; created_at sits after id, pubkey and sig
+struct VisitLog {
+  int64_t  created_at[8];
+  uint32_t count;
+  uint32_t stop_after;
+};
+
+static bool log_visit(const uint8_t* record, uint16_t length, void* ctx) {
+  VisitLog* log = (VisitLog*)ctx;
+  int64_t   created_at;
+  EXPECT_GE(length, 152u);
+  memcpy(&created_at, record + 128, sizeof(created_at));
+  log->created_at[log->count++] = created_at;
+  return log->count < log->stop_after;
+}
+
+TEST_F(NostrDBQueryTest, QueryVisitStreamsNewestFirst) {
+  write_event("00000001", "00000010", 1, 1000);
+  write_event("00000002", "00000010", 1, 2000);
+  write_event("00000003", "00000010", 1, 3000);
+
+  NostrDBFilter filter;
+  nostr_db_filter_init(&filter);
+  filter.limit = 10;
+
+  VisitLog log = {{0}, 0, 8};
+  EXPECT_EQ(nostr_db_query_visit(db, &filter, log_visit, &log), NOSTR_DB_OK);
+  ASSERT_EQ(log.count, 3u);
+  EXPECT_EQ(log.created_at[0], 3000);
+  EXPECT_EQ(log.created_at[1], 2000);
+  EXPECT_EQ(log.created_at[2], 1000);
+
+  // The visitor stops the scan
+  VisitLog first = {{0}, 0, 1};
+  EXPECT_EQ(nostr_db_query_visit(db, &filter, log_visit, &first), NOSTR_DB_OK);
+  EXPECT_EQ(first.count, 1u);
+  EXPECT_EQ(first.created_at[0], 3000);
+
+  EXPECT_EQ(nostr_db_query_visit(db, &filter, nullptr, &log),
+            NOSTR_DB_ERROR_NULL_PARAM);
+}
+
+TEST_F(NostrDBQueryTest, QueryVisitAllMergesFilters) {
+  write_event("00000001", "00000010", 1, 1000);
+  write_event("00000002", "00000010", 1, 2000);
+  write_event("00000003", "00000010", 1, 3000);
+  write_event("00000004", "00000010", 1, 3000);
+  write_event("00000005", "00000010", 1, 4000);
+
+  NostrDBFilter* filters = (NostrDBFilter*)malloc(sizeof(NostrDBFilter) * 3);
+  for (int i = 0; i < 3; i++) nostr_db_filter_init(&filters[i]);
+  filters[0].since = 1000;
+  filters[0].until = 3000;
+  filters[0].limit = 10;
+  filters[1].since = 2000;
+  filters[1].until = 4000;
+  filters[1].limit = 10;
+
+  // Overlapping filters: each event once, newest first
+  VisitLog log = {{0}, 0, 8};
+  EXPECT_EQ(nostr_db_query_visit_all(db, filters, 2, log_visit, &log),
+            NOSTR_DB_OK);
+  ASSERT_EQ(log.count, 5u);
+  EXPECT_EQ(log.created_at[0], 4000);
+  EXPECT_EQ(log.created_at[1], 3000);
+  EXPECT_EQ(log.created_at[2], 3000);
+  EXPECT_EQ(log.created_at[3], 2000);
+  EXPECT_EQ(log.created_at[4], 1000);
+
+  // Each filter keeps its own limit: the union of the newest of each
+  filters[0].limit = 1;
+  filters[1].limit = 1;
+  VisitLog limited = {{0}, 0, 8};
+  EXPECT_EQ(nostr_db_query_visit_all(db, filters, 2, log_visit, &limited),
+            NOSTR_DB_OK);
+  ASSERT_EQ(limited.count, 2u);
+  EXPECT_EQ(limited.created_at[0], 4000);
+  EXPECT_EQ(limited.created_at[1], 3000);
+
+  // Filters differing only in limit run once, under the larger limit
+  memcpy(&filters[2], &filters[0], sizeof(NostrDBFilter));
+  filters[2].limit = 3;
+  VisitLog shared = {{0}, 0, 8};
+  EXPECT_EQ(nostr_db_query_visit_all(db, filters, 3, log_visit, &shared),
+            NOSTR_DB_OK);
+  ASSERT_EQ(shared.count, 4u);
+  EXPECT_EQ(shared.created_at[0], 4000);
+  EXPECT_EQ(shared.created_at[1], 3000);
+  EXPECT_EQ(shared.created_at[2], 3000);
+  EXPECT_EQ(shared.created_at[3], 2000);
+
+  free(filters);
+}
+
+TEST_F(NostrDBQueryTest, CursorStepsWithinBudget) {
+  write_event("00000001", "00000010", 1, 1000);
+  write_event("00000002", "00000010", 1, 2000);
+  write_event("00000003", "00000010", 1, 3000);
+  write_event("00000004", "00000010", 1, 4000);
+  write_event("00000005", "00000010", 1, 5000);
+
+  NostrDBFilter filter;
+  nostr_db_filter_init(&filter);
+  filter.limit = 10;
+
+  NostrDBCursor* cursor = nullptr;
+  ASSERT_EQ(nostr_db_cursor_open(db, &filter, 1, &cursor), NOSTR_DB_OK);
+  ASSERT_NE(cursor, nullptr);
+
+  // The index scan comes out of the same budget, across steps; the first
+  // record is refused so the next step starts with it
+  VisitLog log   = {{0}, 0, 1};
+  uint32_t steps = 0;
+  while (log.count == 0 && steps < 64) {
+    EXPECT_FALSE(nostr_db_cursor_step(cursor, 2, log_visit, &log));
+    steps++;
+  }
+  EXPECT_GT(steps, 1u);
+  ASSERT_EQ(log.count, 1u);
+  EXPECT_EQ(log.created_at[0], 5000);
+  log.count      = 0;
+  log.stop_after = 8;
+
+  EXPECT_FALSE(nostr_db_cursor_step(cursor, 2, log_visit, &log));
+  ASSERT_EQ(log.count, 2u);
+  EXPECT_EQ(log.created_at[1], 4000);
+
+  // A refused record is offered again by the next step
+  log.stop_after = 3;
+  EXPECT_FALSE(nostr_db_cursor_step(cursor, 2, log_visit, &log));
+  ASSERT_EQ(log.count, 3u);
+  EXPECT_EQ(log.created_at[2], 3000);
+  log.count      = 2;
+  log.stop_after = 8;
+
+  // An event deleted between steps is skipped
+  uint8_t id[32] = {0};
+  id[31]         = 0x02;
+  ASSERT_EQ(nostr_db_delete_event(db, id), NOSTR_DB_OK);
+
+  EXPECT_TRUE(nostr_db_cursor_step(cursor, 0, log_visit, &log));
+  ASSERT_EQ(log.count, 4u);
+  EXPECT_EQ(log.created_at[2], 3000);
+  EXPECT_EQ(log.created_at[3], 1000);
+  nostr_db_cursor_close(cursor);
+}
+
+TEST_F(NostrDBQueryTest, CursorScanResumesAcrossWrites) {
+  ASSERT_EQ(nostr_db_set_query_cache(db, 4), NOSTR_DB_OK);
+  write_event("00000001", "00000010", 1, 1000);
+  write_event("00000002", "00000010", 1, 2000);
+  write_event("00000003", "00000010", 1, 3000);
+  write_event("00000004", "00000010", 1, 4000);
+  write_event("00000005", "00000010", 1, 5000);
+  write_event("00000006", "00000010", 1, 6000);
+
+  NostrDBFilter filter;
+  nostr_db_filter_init(&filter);
+  filter.kinds[0]    = 1;
+  filter.kinds_count = 1;
+  filter.limit       = 10;
+
+  NostrDBCursor* cursor = nullptr;
+  ASSERT_EQ(nostr_db_cursor_open(db, &filter, 1, &cursor), NOSTR_DB_OK);
+
+  VisitLog log = {{0}, 0, 8};
+  EXPECT_FALSE(nostr_db_cursor_step(cursor, 3, log_visit, &log));
+  EXPECT_EQ(log.count, 0u);
+
+  // Postings added behind the scan position are still found
+  write_event("00000007", "00000020", 1, 500);
+
+  uint32_t steps = 0;
+  while (!nostr_db_cursor_step(cursor, 3, log_visit, &log) && steps < 64) {
+    steps++;
+  }
+  nostr_db_cursor_close(cursor);
+  ASSERT_EQ(log.count, 7u);
+  EXPECT_EQ(log.created_at[0], 6000);
+  EXPECT_EQ(log.created_at[5], 1000);
+  EXPECT_EQ(log.created_at[6], 500);
+
+  // A result computed across a write is not cached
+  NostrDBStats stats;
+  log.count = 0;
+  EXPECT_EQ(nostr_db_query_visit(db, &filter, log_visit, &log), NOSTR_DB_OK);
+  EXPECT_EQ(log.count, 7u);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_hits, 0u);
+  EXPECT_EQ(stats.query_cache_misses, 2u);
+}
+
+TEST_F(NostrDBQueryTest, QueryCacheInvalidatedByAffectingWrites) {
+  ASSERT_EQ(nostr_db_set_query_cache(db, 4), NOSTR_DB_OK);
+  write_event("00000001", "00000010", 1, 2000);
+  write_event("00000002", "00000010", 1, 3000);
+  write_event("00000003", "00000010", 1, 4000);
+
+  NostrDBFilter* filter = (NostrDBFilter*)malloc(sizeof(NostrDBFilter));
+  nostr_db_filter_init(filter);
+  filter->since = 1000;
+  filter->limit = 10;
+
+  NostrDBStats stats;
+  VisitLog     log = {{0}, 0, 8};
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  log.count = 0;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  EXPECT_EQ(log.count, 3u);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_misses, 1u);
+  EXPECT_EQ(stats.query_cache_hits, 1u);
+
+  // An event outside the filter leaves the entry alone
+  write_event("00000004", "00000010", 1, 500);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_invalidations, 0u);
+
+  // A matching event drops it, and the next query sees the event
+  write_event("00000005", "00000010", 1, 2500);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_invalidations, 1u);
+  log.count = 0;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  ASSERT_EQ(log.count, 4u);
+  EXPECT_EQ(log.created_at[2], 2500);
+
+  // A full result ignores matches older than its oldest event
+  filter->limit = 2;
+  log.count     = 0;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  write_event("00000006", "00000010", 1, 1500);
+  log.count = 0;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_hits, 2u);
+  ASSERT_EQ(log.count, 2u);
+
+  // Deleting a cached event drops the entry
+  uint8_t id[32] = {0};
+  id[31]         = 0x03;
+  ASSERT_EQ(nostr_db_delete_event(db, id), NOSTR_DB_OK);
+  log.count = 0;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  ASSERT_EQ(log.count, 2u);
+  EXPECT_EQ(log.created_at[0], 3000);
+  EXPECT_EQ(log.created_at[1], 2500);
+
+  // Filters equal up to value order share an entry
+  filter->kinds[0]    = 7;
+  filter->kinds[1]    = 1;
+  filter->kinds_count = 2;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  uint64_t hits = stats.query_cache_hits;
+  filter->kinds[0] = 1;
+  filter->kinds[1] = 7;
+  log.count        = 0;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_hits, hits + 1);
+
+  free(filter);
+}
+
+TEST_F(NostrDBQueryTest, QueryCacheServesRelayProfileLookups) {
+  ASSERT_EQ(nostr_db_set_query_cache(db, 4), NOSTR_DB_OK);
+  write_event("00000001", "00000010", 0, 1000);
+  write_event("00000002", "00000020", 0, 1500);
+
+  // As the relay converts ["REQ", .., {"authors": [pk], "kinds": [0]}]
+  NostrDBFilter* filter = (NostrDBFilter*)malloc(sizeof(NostrDBFilter));
+  nostr_db_filter_init(filter);
+  hex_to_bytes("0000000000000000000000000000000000000000000000000000000000000010",
+               filter->authors[0].value, 32);
+  filter->authors[0].prefix_len = 32;
+  filter->authors_count         = 1;
+  filter->kinds[0]              = 0;
+  filter->kinds_count           = 1;
+  filter->limit                 = 500;
+
+  NostrDBStats stats;
+  VisitLog     log = {{0}, 0, 8};
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  log.count = 0;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  ASSERT_EQ(log.count, 1u);
+  EXPECT_EQ(log.created_at[0], 1000);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_misses, 1u);
+  EXPECT_EQ(stats.query_cache_hits, 1u);
+
+  // Another author's profile leaves the entry; a new one of this author drops it
+  write_event("00000003", "00000020", 0, 2000);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_invalidations, 0u);
+  write_event("00000004", "00000010", 0, 3000);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_invalidations, 1u);
+
+  log.count = 0;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  ASSERT_EQ(log.count, 2u);
+  EXPECT_EQ(log.created_at[0], 3000);
+  EXPECT_EQ(log.created_at[1], 1000);
+
+  free(filter);
+}
+
+TEST_F(NostrDBQueryTest, QueryCacheWriteDropsOnlyProbedEntries) {
+  ASSERT_EQ(nostr_db_set_query_cache(db, 64), NOSTR_DB_OK);
+
+  // One cached profile lookup per author, spread over many sets
+  NostrDBFilter* filter = (NostrDBFilter*)malloc(sizeof(NostrDBFilter));
+  VisitLog       log    = {{0}, 0, 8};
+  for (uint32_t a = 1; a <= 32; a++) {
+    nostr_db_filter_init(filter);
+    filter->authors[0].value[31]  = (uint8_t)a;
+    filter->authors[0].prefix_len = 32;
+    filter->authors_count         = 1;
+    filter->kinds[0]              = 0;
+    filter->kinds_count           = 1;
+    filter->limit                 = 500;
+    EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+    EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  }
+
+  NostrDBStats stats;
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_misses, 32u);
+  EXPECT_EQ(stats.query_cache_hits, 32u);
+  EXPECT_EQ(stats.query_cache_evictions, 0u);
+
+  // Author 0x10's new profile drops its own entry and no other
+  write_event("00000001", "00000010", 0, 1000);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_invalidations, 1u);
+
+  log.count = 0;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  ASSERT_EQ(nostr_db_get_stats(db, &stats), NOSTR_DB_OK);
+  EXPECT_EQ(stats.query_cache_hits, 33u);
+  EXPECT_EQ(log.count, 0u);
+
+  filter->authors[0].value[31] = 0x10;
+  EXPECT_EQ(nostr_db_query_visit(db, filter, log_visit, &log), NOSTR_DB_OK);
+  ASSERT_EQ(log.count, 1u);
+  EXPECT_EQ(log.created_at[0], 1000);
+
+  free(filter);
+}
+
+// Renders each visited record both as served and rebuilt from its fields
+struct JsonVisit {
+  uint32_t    count;
+  uint32_t    stored;
+  std::string served[4];
+  std::string rebuilt[4];
+};
+
+static bool json_visit(const uint8_t* record, uint16_t length, void* ctx) {
+  JsonVisit* v = (JsonVisit*)ctx;
+  char       out[2048];
+  size_t     n = event_json_write(record, length, out, sizeof(out));
+  v->served[v->count].assign(out, n);
+
+  // Same record without the stored JSON (flags at offset 140, bit 1)
+  uint8_t  copy[4096];
+  uint32_t flags;
+  uint16_t content_length, tags_length;
+  memcpy(copy, record, length);
+  memcpy(&flags, copy + 140, sizeof(flags));
+  memcpy(&content_length, copy + 144, sizeof(content_length));
+  memcpy(&tags_length, copy + 146, sizeof(tags_length));
+  if (flags & 2u) v->stored++;
+  flags &= ~2u;
+  memcpy(copy + 140, &flags, sizeof(flags));
+  n = event_json_write(copy, (uint16_t)(152 + content_length + tags_length),
+                       out, sizeof(out));
+  v->rebuilt[v->count].assign(out, n);
+
+  v->count++;
+  return true;
+}
+
+TEST_F(NostrDBQueryTest, StoredEventJsonMatchesRebuiltJson) {
+  write_event("00000001", "00000010", 1, 1000);
+  nostr_db_set_event_json(db, true);
+  write_event("00000002", "00000010", 1, 2000);
+  write_event("00000003", "00000010", 1, 3000);
+
+  NostrDBFilter filter;
+  nostr_db_filter_init(&filter);
+  filter.limit = 10;
+
+  JsonVisit visit;
+  visit.count  = 0;
+  visit.stored = 0;
+  ASSERT_EQ(nostr_db_query_visit(db, &filter, json_visit, &visit), NOSTR_DB_OK);
+  ASSERT_EQ(visit.count, 3u);
+  EXPECT_EQ(visit.stored, 2u);
+  for (uint32_t i = 0; i < visit.count; i++) {
+    EXPECT_FALSE(visit.served[i].empty());
+    EXPECT_EQ(visit.served[i], visit.rebuilt[i]);
+  }
+
+  // A deleted event with stored JSON is not served
+  uint8_t id[32];
+  hex_to_bytes("0000000000000000000000000000000000000000000000000000000000000003",
+               id, 32);
+  ASSERT_EQ(nostr_db_delete_event(db, id), NOSTR_DB_OK);
+  visit.count  = 0;
+  visit.stored = 0;
+  ASSERT_EQ(nostr_db_query_visit(db, &filter, json_visit, &visit), NOSTR_DB_OK);
+  EXPECT_EQ(visit.count, 2u);
+  EXPECT_EQ(visit.stored, 1u);
+}
+
 TEST_F(NostrDBQueryTest, QueryNullParams) {
   NostrDBFilter     filter;
   NostrDBResultSet* result = nostr_db_result_create(10);
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
+#include <ctime>
 #include <unistd.h>
 #include <vector>
 
@@ -89,6 +90,12 @@ typedef struct {
   uint16_t  slot_index;
 } RecordId;
 
+typedef struct {
+  RecordId rid;
+  uint32_t kind;
+  uint8_t  pubkey_prefix[8];
+} IndexPosting;
+
 #define RECORD_ID_NULL \
   (RecordId) { PAGE_ID_NULL, 0 }
 
@@ -101,6 +108,7 @@ typedef enum {
   BTREE_KEY_UINT32        = 2,
   BTREE_KEY_COMPOSITE     = 3,
   BTREE_KEY_COMPOSITE_TAG = 4,
+  BTREE_KEY_MEMCMP        = 5,
 } BTreeKeyType;
 
 typedef struct {
@@ -174,6 +182,46 @@ typedef struct {
   uint16_t tags_length;
 } EventRecord;
 
+// Index statistics
+#define INDEX_STATS_SKETCH_DEPTH 2
+#define INDEX_STATS_SKETCH_WIDTH 512
+#define INDEX_STATS_KMV_SIZE 64
+#define INDEX_STATS_TIME_BUCKETS 128
+#define INDEX_STATS_TIME_SHIFT 15
+
+typedef enum {
+  INDEX_STATS_PUBKEY = 0,
+  INDEX_STATS_KIND,
+  INDEX_STATS_PUBKEY_KIND,
+  INDEX_STATS_TAG,
+  INDEX_STATS_KEYS,
+} IndexStatsKey;
+
+typedef struct {
+  uint64_t entries;
+  uint64_t kmv[INDEX_STATS_KMV_SIZE];
+  uint32_t kmv_count;
+  uint32_t dummy;
+  uint32_t sketch[INDEX_STATS_SKETCH_DEPTH][INDEX_STATS_SKETCH_WIDTH];
+} IndexKeyStats;
+
+typedef struct {
+  uint64_t      events;
+  int64_t       time_origin;
+  uint32_t      time[INDEX_STATS_TIME_BUCKETS];
+  IndexKeyStats keys[INDEX_STATS_KEYS];
+} IndexStatsData;
+
+#define INDEX_STATS_PAGE_PAYLOAD (DB_PAGE_SIZE - sizeof(page_id_t))
+#define INDEX_STATS_PAGES \
+  ((sizeof(IndexStatsData) + INDEX_STATS_PAGE_PAYLOAD - 1) / INDEX_STATS_PAGE_PAYLOAD)
+
+typedef struct {
+  IndexStatsData data;
+  BufferPool*    pool;
+  page_id_t      pages[INDEX_STATS_PAGES];
+} IndexStats;
+
 // IndexManager
 typedef struct {
   BTree       id_index;
@@ -182,6 +230,7 @@ typedef struct {
   BTree       kind_index;
   BTree       pubkey_kind_index;
   BTree       tag_index;
+  IndexStats* stats;
   BufferPool* pool;
 } IndexManager;
 
@@ -223,8 +272,10 @@ NostrDBError index_manager_create(IndexManager* im, BufferPool* pool);
 NostrDBError index_manager_open(IndexManager* im, BufferPool* pool,
                                 page_id_t id_meta, page_id_t timeline_meta,
                                 page_id_t pubkey_meta, page_id_t kind_meta,
-                                page_id_t pk_kind_meta, page_id_t tag_meta);
+                                page_id_t pk_kind_meta, page_id_t tag_meta,
+                                page_id_t stats_meta);
 NostrDBError index_manager_flush(IndexManager* im);
+void         index_manager_close(IndexManager* im);
 NostrDBError index_manager_insert_event(IndexManager* im, RecordId rid,
                                         const EventRecord* record,
                                         const uint8_t*     tags_data,
@@ -246,22 +297,36 @@ NostrDBError index_timeline_delete(BTree* tree, int64_t created_at,
                                    RecordId rid);
 
 NostrDBError index_pubkey_insert(BTree* tree, const uint8_t pubkey[32],
-                                 RecordId rid);
+                                 int64_t created_at,
+                                 const IndexPosting* posting);
 NostrDBError index_pubkey_delete(BTree* tree, const uint8_t pubkey[32],
-                                 RecordId rid);
+                                 int64_t created_at,
+                                 const IndexPosting* posting);
 
-NostrDBError index_kind_insert(BTree* tree, uint32_t kind, RecordId rid);
-NostrDBError index_kind_delete(BTree* tree, uint32_t kind, RecordId rid);
+NostrDBError index_kind_insert(BTree* tree, uint32_t kind, int64_t created_at,
+                               const IndexPosting* posting);
+NostrDBError index_kind_delete(BTree* tree, uint32_t kind, int64_t created_at,
+                               const IndexPosting* posting);
 
 NostrDBError index_pk_kind_insert(BTree* tree, const uint8_t pubkey[32],
-                                  uint32_t kind, RecordId rid);
+                                  uint32_t kind, int64_t created_at,
+                                  const IndexPosting* posting);
 NostrDBError index_pk_kind_delete(BTree* tree, const uint8_t pubkey[32],
-                                  uint32_t kind, RecordId rid);
+                                  uint32_t kind, int64_t created_at,
+                                  const IndexPosting* posting);
 
 NostrDBError index_tag_insert(BTree* tree, uint8_t tag_name,
-                              const uint8_t tag_value[32], RecordId rid);
+                              const uint8_t tag_value[32], int64_t created_at,
+                              const IndexPosting* posting);
 NostrDBError index_tag_delete(BTree* tree, uint8_t tag_name,
-                              const uint8_t tag_value[32], RecordId rid);
+                              const uint8_t tag_value[32], int64_t created_at,
+                              const IndexPosting* posting);
+
+uint64_t index_stats_key_count(const IndexStats* stats, IndexStatsKey key,
+                               const uint8_t* prefix, uint16_t prefix_size);
+uint64_t index_stats_distinct(const IndexStats* stats, IndexStatsKey key);
+uint64_t index_stats_time_count(const IndexStats* stats, int64_t since,
+                                int64_t until);
 
 }  // extern "C"
 
@@ -279,9 +344,11 @@ class IndexTest : public ::testing::Test {
     snprintf(path, sizeof(path), "/tmp/nostr_index_test_%d.dat", getpid());
     ASSERT_EQ(NOSTR_DB_OK, disk_manager_create(&dm, path, 8192));
     ASSERT_EQ(NOSTR_DB_OK, buffer_pool_init(&pool, &dm, 1024));
+    memset(&im, 0, sizeof(im));
   }
 
   void TearDown() override {
+    index_manager_close(&im);
     buffer_pool_shutdown(&pool);
     disk_manager_close(&dm);
     unlink(path);
@@ -323,6 +390,51 @@ class IndexTest : public ::testing::Test {
     }
     return buf;
   }
+
+  // Helper: range scan every posting under a key prefix and return the
+  // created_at of each, in scan order (postings end with a 14-byte suffix
+  // whose first 8 bytes are be64(INT64_MAX - created_at))
+  std::vector<int64_t> scan_postings(BTree* tree, const uint8_t* prefix,
+                                     size_t prefix_size) {
+    uint8_t min_key[64], max_key[64];
+    memcpy(min_key, prefix, prefix_size);
+    memcpy(max_key, prefix, prefix_size);
+    memset(min_key + prefix_size, 0x00, 14);
+    memset(max_key + prefix_size, 0xFF, 14);
+
+    struct Ctx {
+      size_t               offset;
+      std::vector<int64_t> times;
+    } ctx = {prefix_size, {}};
+
+    auto cb = [](const void* key, const void*, void* ud) -> bool {
+      Ctx*           c = static_cast<Ctx*>(ud);
+      const uint8_t* k = static_cast<const uint8_t*>(key) + c->offset;
+      uint64_t       v = 0;
+      for (int i = 0; i < 8; i++) v = (v << 8) | k[i];
+      c->times.push_back(INT64_MAX - (int64_t)v);
+      return true;
+    };
+
+    EXPECT_EQ(NOSTR_DB_OK, btree_range_scan(tree, min_key, max_key, cb, &ctx));
+    return ctx.times;
+  }
+
+  // Helper: covering value for a posting (kind 1, zero pubkey prefix)
+  static const IndexPosting* posting(RecordId rid) {
+    static IndexPosting p;
+    memset(&p, 0, sizeof(p));
+    p.rid  = rid;
+    p.kind = 1;
+    return &p;
+  }
+
+  static void kind_prefix(uint32_t kind, uint8_t out[4]) {
+    out[0] = (uint8_t)(kind >> 24);
+    out[1] = (uint8_t)(kind >> 16);
+    out[2] = (uint8_t)(kind >> 8);
+    out[3] = (uint8_t)kind;
+  }
 };
 
 // ============================================================================
@@ -441,48 +553,41 @@ TEST_F(IndexTest, TimelineDelete) {
 TEST_F(IndexTest, PubkeyInsertAndScan) {
   BTree tree;
   ASSERT_EQ(NOSTR_DB_OK,
-            btree_create(&tree, &pool, 32, sizeof(page_id_t),
-                         BTREE_KEY_BYTES32));
+            btree_create(&tree, &pool, 46, sizeof(IndexPosting),
+                         BTREE_KEY_MEMCMP));
 
   uint8_t pk[32];
   memset(pk, 0x11, 32);
   RecordId rid1 = {10, 0};
   RecordId rid2 = {20, 1};
 
-  ASSERT_EQ(NOSTR_DB_OK, index_pubkey_insert(&tree, pk, rid1));
-  ASSERT_EQ(NOSTR_DB_OK, index_pubkey_insert(&tree, pk, rid2));
-
-  // Scan should find 2 entries
-  struct ScanCtx {
-    int count;
-  };
-  ScanCtx ctx = {0};
+  ASSERT_EQ(NOSTR_DB_OK, index_pubkey_insert(&tree, pk, 1000, posting(rid1)));
+  ASSERT_EQ(NOSTR_DB_OK, index_pubkey_insert(&tree, pk, 2000, posting(rid2)));
 
-  auto cb = [](const void*, const void*, void* ud) -> bool {
-    static_cast<ScanCtx*>(ud)->count++;
-    return true;
-  };
-
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&tree, pk, cb, &ctx));
-  EXPECT_EQ(2, ctx.count);
+  // Scan should find 2 entries, newest first
+  std::vector<int64_t> times = scan_postings(&tree, pk, 32);
+  ASSERT_EQ(2u, times.size());
+  EXPECT_EQ(2000, times[0]);
+  EXPECT_EQ(1000, times[1]);
 }
 
 TEST_F(IndexTest, PubkeyDelete) {
   BTree tree;
   ASSERT_EQ(NOSTR_DB_OK,
-            btree_create(&tree, &pool, 32, sizeof(page_id_t),
-                         BTREE_KEY_BYTES32));
+            btree_create(&tree, &pool, 46, sizeof(IndexPosting),
+                         BTREE_KEY_MEMCMP));
 
   uint8_t pk[32];
   memset(pk, 0x22, 32);
   RecordId rid1 = {10, 0};
 
-  ASSERT_EQ(NOSTR_DB_OK, index_pubkey_insert(&tree, pk, rid1));
-  ASSERT_EQ(NOSTR_DB_OK, index_pubkey_delete(&tree, pk, rid1));
+  ASSERT_EQ(NOSTR_DB_OK, index_pubkey_insert(&tree, pk, 1000, posting(rid1)));
+  ASSERT_EQ(NOSTR_DB_OK, index_pubkey_delete(&tree, pk, 1000, posting(rid1)));
 
-  // Key should be gone (overflow page freed, key removed from B+ tree)
-  page_id_t val = PAGE_ID_NULL;
-  EXPECT_EQ(NOSTR_DB_ERROR_NOT_FOUND, btree_search(&tree, pk, &val));
+  // Posting should be gone
+  EXPECT_TRUE(scan_postings(&tree, pk, 32).empty());
+  EXPECT_EQ(NOSTR_DB_ERROR_NOT_FOUND,
+            index_pubkey_delete(&tree, pk, 1000, posting(rid1)));
 }
 
 // ============================================================================
@@ -491,30 +596,47 @@ TEST_F(IndexTest, PubkeyDelete) {
 TEST_F(IndexTest, KindInsertAndScan) {
   BTree tree;
   ASSERT_EQ(NOSTR_DB_OK,
-            btree_create(&tree, &pool, sizeof(uint32_t), sizeof(page_id_t),
-                         BTREE_KEY_UINT32));
+            btree_create(&tree, &pool, 18, sizeof(IndexPosting),
+                         BTREE_KEY_MEMCMP));
 
   uint32_t kind = 1;
   RecordId rid1 = {10, 0};
   RecordId rid2 = {20, 1};
   RecordId rid3 = {30, 2};
 
-  ASSERT_EQ(NOSTR_DB_OK, index_kind_insert(&tree, kind, rid1));
-  ASSERT_EQ(NOSTR_DB_OK, index_kind_insert(&tree, kind, rid2));
-  ASSERT_EQ(NOSTR_DB_OK, index_kind_insert(&tree, kind, rid3));
-
-  struct ScanCtx {
-    int count;
-  };
-  ScanCtx ctx = {0};
+  ASSERT_EQ(NOSTR_DB_OK, index_kind_insert(&tree, kind, 1000, posting(rid1)));
+  ASSERT_EQ(NOSTR_DB_OK, index_kind_insert(&tree, kind, 3000, posting(rid2)));
+  ASSERT_EQ(NOSTR_DB_OK, index_kind_insert(&tree, kind, 2000, posting(rid3)));
+
+  uint8_t prefix[4];
+  kind_prefix(kind, prefix);
+  std::vector<int64_t> times = scan_postings(&tree, prefix, 4);
+  ASSERT_EQ(3u, times.size());
+  EXPECT_EQ(3000, times[0]);
+  EXPECT_EQ(2000, times[1]);
+  EXPECT_EQ(1000, times[2]);
+}
 
-  auto cb = [](const void*, const void*, void* ud) -> bool {
-    static_cast<ScanCtx*>(ud)->count++;
-    return true;
-  };
+TEST_F(IndexTest, KindPostingsNewestFirstAcrossSplits) {
+  BTree tree;
+  ASSERT_EQ(NOSTR_DB_OK,
+            btree_create(&tree, &pool, 18, sizeof(IndexPosting),
+                         BTREE_KEY_MEMCMP));
+
+  // Interleave two kinds with scrambled timestamps, enough to split leaves
+  for (int i = 0; i < 2000; i++) {
+    int64_t  ts  = (int64_t)((i * 7919) % 2000) + 1;
+    RecordId rid = {(page_id_t)(1 + i / 10), (uint16_t)(i % 10)};
+    ASSERT_EQ(NOSTR_DB_OK, index_kind_insert(&tree, (uint32_t)(i % 2), ts, posting(rid)));
+  }
 
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&tree, &kind, cb, &ctx));
-  EXPECT_EQ(3, ctx.count);
+  uint8_t prefix[4];
+  kind_prefix(1, prefix);
+  std::vector<int64_t> times = scan_postings(&tree, prefix, 4);
+  ASSERT_EQ(1000u, times.size());
+  for (size_t i = 1; i < times.size(); i++) {
+    EXPECT_GE(times[i - 1], times[i]);
+  }
 }
 
 // ============================================================================
@@ -523,8 +645,8 @@ TEST_F(IndexTest, KindInsertAndScan) {
 TEST_F(IndexTest, PubkeyKindInsertAndScan) {
   BTree tree;
   ASSERT_EQ(NOSTR_DB_OK,
-            btree_create(&tree, &pool, 36, sizeof(page_id_t),
-                         BTREE_KEY_COMPOSITE));
+            btree_create(&tree, &pool, 50, sizeof(IndexPosting),
+                         BTREE_KEY_MEMCMP));
 
   uint8_t pk[32];
   memset(pk, 0x33, 32);
@@ -532,65 +654,44 @@ TEST_F(IndexTest, PubkeyKindInsertAndScan) {
   RecordId rid1 = {10, 0};
   RecordId rid2 = {20, 1};
 
-  ASSERT_EQ(NOSTR_DB_OK, index_pk_kind_insert(&tree, pk, kind, rid1));
-  ASSERT_EQ(NOSTR_DB_OK, index_pk_kind_insert(&tree, pk, kind, rid2));
+  ASSERT_EQ(NOSTR_DB_OK, index_pk_kind_insert(&tree, pk, kind, 1000, posting(rid1)));
+  ASSERT_EQ(NOSTR_DB_OK, index_pk_kind_insert(&tree, pk, kind, 1000, posting(rid2)));
 
-  // Build composite key and scan
+  // Build composite prefix and scan
   uint8_t composite[36];
   memcpy(composite, pk, 32);
-  memcpy(composite + 32, &kind, sizeof(uint32_t));
-
-  struct ScanCtx {
-    int count;
-  };
-  ScanCtx ctx = {0};
-
-  auto cb = [](const void*, const void*, void* ud) -> bool {
-    static_cast<ScanCtx*>(ud)->count++;
-    return true;
-  };
+  kind_prefix(kind, composite + 32);
 
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&tree, composite, cb, &ctx));
-  EXPECT_EQ(2, ctx.count);
+  EXPECT_EQ(2u, scan_postings(&tree, composite, 36).size());
 }
 
 TEST_F(IndexTest, PubkeyKindDifferentKinds) {
   BTree tree;
   ASSERT_EQ(NOSTR_DB_OK,
-            btree_create(&tree, &pool, 36, sizeof(page_id_t),
-                         BTREE_KEY_COMPOSITE));
+            btree_create(&tree, &pool, 50, sizeof(IndexPosting),
+                         BTREE_KEY_MEMCMP));
 
   uint8_t pk[32];
   memset(pk, 0x44, 32);
   RecordId rid1 = {10, 0};
   RecordId rid2 = {20, 0};
 
-  ASSERT_EQ(NOSTR_DB_OK, index_pk_kind_insert(&tree, pk, 1, rid1));
-  ASSERT_EQ(NOSTR_DB_OK, index_pk_kind_insert(&tree, pk, 2, rid2));
+  ASSERT_EQ(NOSTR_DB_OK, index_pk_kind_insert(&tree, pk, 1, 1000, posting(rid1)));
+  ASSERT_EQ(NOSTR_DB_OK, index_pk_kind_insert(&tree, pk, 2, 2000, posting(rid2)));
 
   // Each kind has exactly 1 entry
   uint8_t key1[36], key2[36];
   memcpy(key1, pk, 32);
-  uint32_t k1 = 1;
-  memcpy(key1 + 32, &k1, 4);
+  kind_prefix(1, key1 + 32);
   memcpy(key2, pk, 32);
-  uint32_t k2 = 2;
-  memcpy(key2 + 32, &k2, 4);
-
-  struct ScanCtx {
-    int count;
-  };
-  ScanCtx ctx1 = {0}, ctx2 = {0};
-
-  auto cb = [](const void*, const void*, void* ud) -> bool {
-    static_cast<ScanCtx*>(ud)->count++;
-    return true;
-  };
-
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&tree, key1, cb, &ctx1));
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&tree, key2, cb, &ctx2));
-  EXPECT_EQ(1, ctx1.count);
-  EXPECT_EQ(1, ctx2.count);
+  kind_prefix(2, key2 + 32);
+
+  std::vector<int64_t> times1 = scan_postings(&tree, key1, 36);
+  std::vector<int64_t> times2 = scan_postings(&tree, key2, 36);
+  ASSERT_EQ(1u, times1.size());
+  ASSERT_EQ(1u, times2.size());
+  EXPECT_EQ(1000, times1[0]);
+  EXPECT_EQ(2000, times2[0]);
 }
 
 // ============================================================================
@@ -599,48 +700,37 @@ TEST_F(IndexTest, PubkeyKindDifferentKinds) {
 TEST_F(IndexTest, TagInsertAndScan) {
   BTree tree;
   ASSERT_EQ(NOSTR_DB_OK,
-            btree_create(&tree, &pool, 33, sizeof(page_id_t),
-                         BTREE_KEY_COMPOSITE_TAG));
+            btree_create(&tree, &pool, 47, sizeof(IndexPosting),
+                         BTREE_KEY_MEMCMP));
 
   uint8_t  tag_val[32];
   memset(tag_val, 0x55, 32);
   RecordId rid1 = {10, 0};
   RecordId rid2 = {20, 1};
 
-  ASSERT_EQ(NOSTR_DB_OK, index_tag_insert(&tree, 'e', tag_val, rid1));
-  ASSERT_EQ(NOSTR_DB_OK, index_tag_insert(&tree, 'e', tag_val, rid2));
+  ASSERT_EQ(NOSTR_DB_OK, index_tag_insert(&tree, 'e', tag_val, 1000, posting(rid1)));
+  ASSERT_EQ(NOSTR_DB_OK, index_tag_insert(&tree, 'e', tag_val, 2000, posting(rid2)));
 
   uint8_t composite[33];
   composite[0] = 'e';
   memcpy(composite + 1, tag_val, 32);
 
-  struct ScanCtx {
-    int count;
-  };
-  ScanCtx ctx = {0};
-
-  auto cb = [](const void*, const void*, void* ud) -> bool {
-    static_cast<ScanCtx*>(ud)->count++;
-    return true;
-  };
-
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&tree, composite, cb, &ctx));
-  EXPECT_EQ(2, ctx.count);
+  EXPECT_EQ(2u, scan_postings(&tree, composite, 33).size());
 }
 
 TEST_F(IndexTest, TagDifferentNames) {
   BTree tree;
   ASSERT_EQ(NOSTR_DB_OK,
-            btree_create(&tree, &pool, 33, sizeof(page_id_t),
-                         BTREE_KEY_COMPOSITE_TAG));
+            btree_create(&tree, &pool, 47, sizeof(IndexPosting),
+                         BTREE_KEY_MEMCMP));
 
   uint8_t  tag_val[32];
   memset(tag_val, 0x66, 32);
   RecordId rid1 = {10, 0};
   RecordId rid2 = {20, 0};
 
-  ASSERT_EQ(NOSTR_DB_OK, index_tag_insert(&tree, 'e', tag_val, rid1));
-  ASSERT_EQ(NOSTR_DB_OK, index_tag_insert(&tree, 'p', tag_val, rid2));
+  ASSERT_EQ(NOSTR_DB_OK, index_tag_insert(&tree, 'e', tag_val, 1000, posting(rid1)));
+  ASSERT_EQ(NOSTR_DB_OK, index_tag_insert(&tree, 'p', tag_val, 1000, posting(rid2)));
 
   uint8_t key_e[33], key_p[33];
   key_e[0] = 'e';
@@ -648,20 +738,27 @@ TEST_F(IndexTest, TagDifferentNames) {
   key_p[0] = 'p';
   memcpy(key_p + 1, tag_val, 32);
 
-  struct ScanCtx {
-    int count;
-  };
-  ScanCtx ctx_e = {0}, ctx_p = {0};
+  EXPECT_EQ(1u, scan_postings(&tree, key_e, 33).size());
+  EXPECT_EQ(1u, scan_postings(&tree, key_p, 33).size());
+}
 
-  auto cb = [](const void*, const void*, void* ud) -> bool {
-    static_cast<ScanCtx*>(ud)->count++;
-    return true;
-  };
+TEST_F(IndexTest, TagRepeatedValueIndexedOnce) {
+  BTree tree;
+  ASSERT_EQ(NOSTR_DB_OK,
+            btree_create(&tree, &pool, 47, sizeof(IndexPosting),
+                         BTREE_KEY_MEMCMP));
+
+  uint8_t  tag_val[32];
+  memset(tag_val, 0x77, 32);
+  RecordId rid = {10, 0};
 
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&tree, key_e, cb, &ctx_e));
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&tree, key_p, cb, &ctx_p));
-  EXPECT_EQ(1, ctx_e.count);
-  EXPECT_EQ(1, ctx_p.count);
+  ASSERT_EQ(NOSTR_DB_OK, index_tag_insert(&tree, 'p', tag_val, 1000, posting(rid)));
+  ASSERT_EQ(NOSTR_DB_OK, index_tag_insert(&tree, 'p', tag_val, 1000, posting(rid)));
+
+  uint8_t key[33];
+  key[0] = 'p';
+  memcpy(key + 1, tag_val, 32);
+  EXPECT_EQ(1u, scan_postings(&tree, key, 33).size());
 }
 
 // ============================================================================
@@ -689,16 +786,37 @@ TEST_F(IndexTest, ManagerInsertEvent) {
   EXPECT_EQ(found.slot_index, 0u);
 
   // Verify kind index
-  struct ScanCtx {
-    int count;
-  };
-  ScanCtx ctx = {0};
-  auto    cb  = [](const void*, const void*, void* ud) -> bool {
-    static_cast<ScanCtx*>(ud)->count++;
-    return true;
+  uint8_t prefix[4];
+  kind_prefix(rec.kind, prefix);
+  std::vector<int64_t> times = scan_postings(&im.kind_index, prefix, 4);
+  ASSERT_EQ(1u, times.size());
+  EXPECT_EQ(1000, times[0]);
+}
+
+TEST_F(IndexTest, ManagerPostingsCoverKindAndPubkey) {
+  ASSERT_EQ(NOSTR_DB_OK, index_manager_create(&im, &pool));
+
+  EventRecord rec;
+  make_event(&rec, 0xAA, 0xBB, 1000, 7);
+  rec.pubkey[1] = 0xBC;
+
+  RecordId rid = {12, 3};
+  ASSERT_EQ(NOSTR_DB_OK,
+            index_manager_insert_event(&im, rid, &rec, nullptr, 0));
+
+  // The pubkey posting carries RID, kind and pubkey prefix in its value
+  IndexPosting found;
+  memset(&found, 0, sizeof(found));
+  auto cb = [](const void*, const void* value, void* ud) -> bool {
+    memcpy(ud, value, sizeof(IndexPosting));
+    return false;
   };
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&im.kind_index, &rec.kind, cb, &ctx));
-  EXPECT_EQ(1, ctx.count);
+  ASSERT_EQ(NOSTR_DB_OK,
+            btree_range_scan(&im.pubkey_index, nullptr, nullptr, cb, &found));
+  EXPECT_EQ(12u, found.rid.page_id);
+  EXPECT_EQ(3u, found.rid.slot_index);
+  EXPECT_EQ(7u, found.kind);
+  EXPECT_EQ(0, memcmp(found.pubkey_prefix, rec.pubkey, 8));
 }
 
 TEST_F(IndexTest, ManagerInsertEventWithTags) {
@@ -738,16 +856,9 @@ TEST_F(IndexTest, ManagerInsertEventWithTags) {
   tag_key[0] = 'e';
   memcpy(tag_key + 1, expected_raw, 32);
 
-  struct ScanCtx {
-    int count;
-  };
-  ScanCtx ctx = {0};
-  auto    cb  = [](const void*, const void*, void* ud) -> bool {
-    static_cast<ScanCtx*>(ud)->count++;
-    return true;
-  };
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&im.tag_index, tag_key, cb, &ctx));
-  EXPECT_EQ(1, ctx.count);
+  std::vector<int64_t> times = scan_postings(&im.tag_index, tag_key, 33);
+  ASSERT_EQ(1u, times.size());
+  EXPECT_EQ(2000, times[0]);
 }
 
 TEST_F(IndexTest, ManagerDeleteEvent) {
@@ -793,24 +904,20 @@ TEST_F(IndexTest, ManagerMultipleEvents) {
     EXPECT_EQ(found.page_id, (page_id_t)(100 + i));
   }
 
-  // Verify: kind 0 has 5 events, kind 1 has 5 events
-  struct ScanCtx {
-    int count;
-  };
-  auto cb = [](const void*, const void*, void* ud) -> bool {
-    static_cast<ScanCtx*>(ud)->count++;
-    return true;
-  };
+  // Verify: kind 0 has 5 events, kind 1 has 5 events, newest first
+  uint8_t kind0[4], kind1[4];
+  kind_prefix(0, kind0);
+  kind_prefix(1, kind1);
 
-  uint32_t kind0 = 0;
-  ScanCtx  ctx0  = {0};
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&im.kind_index, &kind0, cb, &ctx0));
-  EXPECT_EQ(5, ctx0.count);
+  std::vector<int64_t> times0 = scan_postings(&im.kind_index, kind0, 4);
+  ASSERT_EQ(5u, times0.size());
+  EXPECT_EQ(1800, times0[0]);
+  EXPECT_EQ(1000, times0[4]);
 
-  uint32_t kind1 = 1;
-  ScanCtx  ctx1  = {0};
-  ASSERT_EQ(NOSTR_DB_OK, btree_scan_key(&im.kind_index, &kind1, cb, &ctx1));
-  EXPECT_EQ(5, ctx1.count);
+  std::vector<int64_t> times1 = scan_postings(&im.kind_index, kind1, 4);
+  ASSERT_EQ(5u, times1.size());
+  EXPECT_EQ(1900, times1[0]);
+  EXPECT_EQ(1100, times1[4]);
 }
 
 TEST_F(IndexTest, ManagerOpenExisting) {
@@ -831,6 +938,7 @@ TEST_F(IndexTest, ManagerOpenExisting) {
   page_id_t kind_meta    = im.kind_index.meta_page;
   page_id_t pkk_meta     = im.pubkey_kind_index.meta_page;
   page_id_t tag_meta     = im.tag_index.meta_page;
+  page_id_t stats_meta   = im.stats->pages[0];
 
   // Flush buffer pool to disk
   ASSERT_EQ(NOSTR_DB_OK, buffer_pool_flush_all(&pool));
@@ -839,11 +947,127 @@ TEST_F(IndexTest, ManagerOpenExisting) {
   IndexManager im2;
   ASSERT_EQ(NOSTR_DB_OK,
             index_manager_open(&im2, &pool, id_meta, tl_meta, pk_meta,
-                               kind_meta, pkk_meta, tag_meta));
+                               kind_meta, pkk_meta, tag_meta, stats_meta));
 
   // Verify the event is still findable
   RecordId found;
   ASSERT_EQ(NOSTR_DB_OK, index_id_lookup(&im2.id_index, rec.id, &found));
   EXPECT_EQ(found.page_id, 50u);
   EXPECT_EQ(found.slot_index, 3u);
+
+  // Statistics come back from their page chain
+  uint8_t kind7[4] = {0, 0, 0, 7};
+  EXPECT_EQ(1u, im2.stats->data.events);
+  EXPECT_EQ(1u, index_stats_key_count(im2.stats, INDEX_STATS_KIND, kind7, 4));
+  index_manager_close(&im2);
+}
+
+TEST_F(IndexTest, ManagerStatsTrackKeysAndTime) {
+  ASSERT_EQ(NOSTR_DB_OK, index_manager_create(&im, &pool));
+
+  // 30 kind-1 notes by 0x01 an hour apart, 5 kind-7 reactions by 0x02
+  // tagging the same event, all in the last bucket span
+  const int64_t        base = (int64_t)1700000000;
+  std::vector<uint8_t> tags = make_tags(
+    'e', "abababababababababababababababababababababababababababababababab");
+  uint16_t tags_length = (uint16_t)tags.size();
+  uint16_t slot        = 0;
+  for (int i = 0; i < 30; i++) {
+    EventRecord rec;
+    make_event(&rec, (uint8_t)i, 0x01, base + i * 3600, 1);
+    RecordId rid = {100, slot++};
+    ASSERT_EQ(NOSTR_DB_OK,
+              index_manager_insert_event(&im, rid, &rec, nullptr, 0));
+  }
+  EventRecord reactions[5];
+  for (int i = 0; i < 5; i++) {
+    make_event(&reactions[i], (uint8_t)(100 + i), 0x02, base + 40 * 3600, 7);
+    RecordId rid = {100, slot++};
+    ASSERT_EQ(NOSTR_DB_OK, index_manager_insert_event(&im, rid, &reactions[i],
+                                                      tags.data(), tags_length));
+  }
+
+  uint8_t pk1[32], pk2[32];
+  memset(pk1, 0x01, 32);
+  memset(pk2, 0x02, 32);
+  uint8_t kind1[4] = {0, 0, 0, 1};
+  uint8_t kind7[4] = {0, 0, 0, 7};
+  uint8_t pk2_kind7[36];
+  memcpy(pk2_kind7, pk2, 32);
+  memcpy(pk2_kind7 + 32, kind7, 4);
+  uint8_t tag_e[33];
+  tag_e[0] = 'e';
+  memset(tag_e + 1, 0xAB, 32);
+
+  EXPECT_EQ(35u, im.stats->data.events);
+  EXPECT_EQ(30u, index_stats_key_count(im.stats, INDEX_STATS_PUBKEY, pk1, 32));
+  EXPECT_EQ(5u, index_stats_key_count(im.stats, INDEX_STATS_PUBKEY, pk2, 32));
+  EXPECT_EQ(30u, index_stats_key_count(im.stats, INDEX_STATS_KIND, kind1, 4));
+  EXPECT_EQ(5u, index_stats_key_count(im.stats, INDEX_STATS_PUBKEY_KIND,
+                                      pk2_kind7, 36));
+  EXPECT_EQ(5u, index_stats_key_count(im.stats, INDEX_STATS_TAG, tag_e, 33));
+  EXPECT_EQ(2u, index_stats_distinct(im.stats, INDEX_STATS_PUBKEY));
+  EXPECT_EQ(1u, index_stats_distinct(im.stats, INDEX_STATS_TAG));
+
+  // The histogram resolves windows to within a bucket (about 9 hours)
+  EXPECT_EQ(35u, index_stats_time_count(im.stats, 0, 0));
+  uint64_t last_day = index_stats_time_count(im.stats, base + 20 * 3600, 0);
+  EXPECT_GE(last_day, 10u);
+  EXPECT_LE(last_day, 25u);
+  EXPECT_EQ(0u, index_stats_time_count(im.stats, base + 100 * 3600, 0));
+
+  // Deleting reverses the counts
+  RecordId rid = {100, 30};
+  ASSERT_EQ(NOSTR_DB_OK, index_manager_delete_event(
+                           &im, rid, &reactions[0], tags.data(), tags_length));
+  EXPECT_EQ(34u, im.stats->data.events);
+  EXPECT_EQ(4u, index_stats_key_count(im.stats, INDEX_STATS_PUBKEY, pk2, 32));
+  EXPECT_EQ(4u, index_stats_key_count(im.stats, INDEX_STATS_TAG, tag_e, 33));
+}
+
+TEST_F(IndexTest, ManagerStatsClampFarFutureCreatedAt) {
+  ASSERT_EQ(NOSTR_DB_OK, index_manager_create(&im, &pool));
+
+  // 20 notes an hour apart up to now, then one dated decades ahead
+  const int64_t base = (int64_t)time(nullptr) - 20 * 3600;
+  uint16_t      slot = 0;
+  for (int i = 0; i < 20; i++) {
+    EventRecord rec;
+    make_event(&rec, (uint8_t)i, 0x01, base + i * 3600, 1);
+    RecordId rid = {100, slot++};
+    ASSERT_EQ(NOSTR_DB_OK,
+              index_manager_insert_event(&im, rid, &rec, nullptr, 0));
+  }
+  EventRecord future;
+  make_event(&future, 0xFF, 0x01, (int64_t)4000000000, 1);
+  RecordId rid = {100, slot++};
+  ASSERT_EQ(NOSTR_DB_OK,
+            index_manager_insert_event(&im, rid, &future, nullptr, 0));
+
+  // The history still resolves windows instead of collapsing into time[0]
+  EXPECT_EQ(21u, index_stats_time_count(im.stats, 0, 0));
+  uint64_t window = index_stats_time_count(im.stats, base, base + 20 * 3600);
+  EXPECT_GE(window, 15u);
+  EXPECT_LE(window, 25u);
+  EXPECT_LE(index_stats_time_count(im.stats, 0, base - 10 * 24 * 3600), 1u);
+}
+
+TEST_F(IndexTest, ManagerStatsDistinctKeysEstimate) {
+  ASSERT_EQ(NOSTR_DB_OK, index_manager_create(&im, &pool));
+
+  // 2000 distinct authors: beyond the exact range of the sketch
+  for (uint32_t i = 0; i < 2000; i++) {
+    EventRecord rec;
+    make_event(&rec, 0, 0, 1000 + i, 1);
+    memcpy(rec.id, &i, sizeof(i));
+    memcpy(rec.pubkey, &i, sizeof(i));
+    RecordId rid = {200 + i / 100, (uint16_t)(i % 100)};
+    ASSERT_EQ(NOSTR_DB_OK,
+              index_manager_insert_event(&im, rid, &rec, nullptr, 0));
+  }
+
+  uint64_t distinct = index_stats_distinct(im.stats, INDEX_STATS_PUBKEY);
+  EXPECT_GE(distinct, 1400u);
+  EXPECT_LE(distinct, 2600u);
+  EXPECT_EQ(1u, index_stats_distinct(im.stats, INDEX_STATS_KIND));
 }
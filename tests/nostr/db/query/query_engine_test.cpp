@@ -199,6 +199,7 @@ typedef struct {
   BTree       kind_index;
   BTree       pubkey_kind_index;
   BTree       tag_index;
+  void*       stats;
   BufferPool* pool;
 } IndexManager;
 
@@ -247,6 +248,8 @@ typedef struct {
   uint32_t  count;
   uint32_t  capacity;
   uint64_t  bloom[64];
+  uint32_t  top_k;
+  uint32_t  examined;
 } QueryResultSet;
 
 typedef enum {
@@ -256,8 +259,24 @@ typedef enum {
   NOSTR_DB_QUERY_STRATEGY_BY_KIND,
   NOSTR_DB_QUERY_STRATEGY_BY_TAG,
   NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN,
+  NOSTR_DB_QUERY_STRATEGY_INTERSECT,
+  NOSTR_DB_QUERY_STRATEGY_COUNT,
 } NostrDBQueryStrategy;
 
+#define NOSTR_DB_QUERY_INPUT_PUBKEY (1u << 0)
+#define NOSTR_DB_QUERY_INPUT_KIND (1u << 1)
+#define NOSTR_DB_QUERY_INPUT_PUBKEY_KIND (1u << 2)
+#define NOSTR_DB_QUERY_INPUT_TAG(i) (1u << (3 + (i)))
+
+typedef struct {
+  NostrDBQueryStrategy strategy;
+  uint32_t             tag;
+  uint32_t             inputs;
+  uint32_t             dummy;
+  uint64_t             matches;
+  uint64_t             cost[NOSTR_DB_QUERY_STRATEGY_COUNT];
+} QueryPlan;
+
 // Disk/Buffer/B+tree API
 NostrDBError disk_manager_create(DiskManager* dm, const char* path,
                                  uint32_t initial_pages);
@@ -281,6 +300,7 @@ NostrDBError record_delete(BufferPool* pool, RecordId rid);
 
 // Index manager API
 NostrDBError index_manager_create(IndexManager* im, BufferPool* pool);
+void         index_manager_close(IndexManager* im);
 NostrDBError index_manager_insert_event(IndexManager* im, RecordId rid,
                                         const EventRecord* record,
                                         const uint8_t*     tags_data,
@@ -297,6 +317,8 @@ int32_t         query_result_add(QueryResultSet* rs, RecordId rid,
                                  int64_t created_at);
 int32_t         query_result_sort(QueryResultSet* rs);
 void            query_result_apply_limit(QueryResultSet* rs, uint32_t limit);
+void            query_result_set_top_k(QueryResultSet* rs, uint32_t k);
+bool            query_result_accepts(const QueryResultSet* rs, int64_t created_at);
 
 NostrDBError query_execute(IndexManager* im, BufferPool* pool,
                            const NostrDBFilter* filter, QueryResultSet* rs);
@@ -313,8 +335,12 @@ NostrDBError query_by_tag(IndexManager* im, const NostrDBFilter* filter,
                           QueryResultSet* rs);
 NostrDBError query_timeline_scan(IndexManager* im, const NostrDBFilter* filter,
                                  QueryResultSet* rs);
+NostrDBError query_intersect(IndexManager* im, const NostrDBFilter* filter,
+                             uint32_t inputs, QueryResultSet* rs);
 NostrDBError query_post_filter(BufferPool* pool, QueryResultSet* rs,
                                const NostrDBFilter* filter);
+NostrDBQueryStrategy query_plan(const IndexManager*  im,
+                                const NostrDBFilter* filter, QueryPlan* plan);
 
 }  // extern "C"
 
@@ -336,6 +362,7 @@ class QueryEngineTest : public ::testing::Test {
   }
 
   void TearDown() override {
+    index_manager_close(&im);
     buffer_pool_shutdown(&pool);
     disk_manager_close(&dm);
     unlink(path);
@@ -360,6 +387,66 @@ class QueryEngineTest : public ::testing::Test {
               index_manager_insert_event(&im, rid, &rec, nullptr, 0));
     return rid;
   }
+
+  // Helper: Store and index an event numbered n carrying one string tag
+  RecordId insert_tagged_event(uint32_t n, uint8_t pk_byte, int64_t created_at,
+                               uint32_t kind, char tag_name,
+                               const char* tag_value) {
+    return insert_tags_event(n, pk_byte, created_at, kind, tag_name, tag_value,
+                             0, nullptr);
+  }
+
+  // Helper: As insert_tagged_event, with an optional second string tag and
+  // content_length bytes of content
+  RecordId insert_tags_event(uint32_t n, uint8_t pk_byte, int64_t created_at,
+                             uint32_t kind, char tag_name,
+                             const char* tag_value, char tag2_name,
+                             const char* tag2_value,
+                             uint16_t content_length = 0) {
+    uint8_t      buf[8192];
+    EventRecord* rec = (EventRecord*)buf;
+    memset(buf, 0, sizeof(buf));
+    memcpy(rec->id, &n, sizeof(n));
+    memset(rec->pubkey, pk_byte, 32);
+    rec->created_at     = created_at;
+    rec->kind           = kind;
+    rec->content_length = content_length;
+    memset(buf + sizeof(EventRecord), 'x', content_length);
+
+    // [count:u16][value_count:u8][name_len:u8][name][value_len:u16][value]
+    uint8_t* tags = buf + sizeof(EventRecord) + content_length;
+    size_t   vlen = strlen(tag_value);
+    tags[0]       = tag2_value != nullptr ? 2 : 1;
+    tags[1]       = 0;
+    tags[2]       = 1;
+    tags[3]       = 1;
+    tags[4]       = (uint8_t)tag_name;
+    tags[5]       = (uint8_t)vlen;
+    tags[6]       = 0;
+    memcpy(tags + 7, tag_value, vlen);
+    rec->tags_length = (uint16_t)(7 + vlen);
+    if (tag2_value != nullptr) {
+      uint8_t* t2   = tags + rec->tags_length;
+      size_t   v2   = strlen(tag2_value);
+      t2[0]         = 1;
+      t2[1]         = 1;
+      t2[2]         = (uint8_t)tag2_name;
+      t2[3]         = (uint8_t)v2;
+      t2[4]         = 0;
+      memcpy(t2 + 5, tag2_value, v2);
+      rec->tags_length = (uint16_t)(rec->tags_length + 5 + v2);
+    }
+
+    RecordId rid;
+    EXPECT_EQ(NOSTR_DB_OK,
+              record_insert(&pool, buf,
+                            (uint16_t)(sizeof(EventRecord) + content_length +
+                                       rec->tags_length),
+                            &rid));
+    EXPECT_EQ(NOSTR_DB_OK, index_manager_insert_event(&im, rid, rec, tags,
+                                                      rec->tags_length));
+    return rid;
+  }
 };
 
 // ============================================================================
@@ -424,6 +511,53 @@ TEST(QueryResultTest, ApplyLimit) {
   query_result_free(rs);
 }
 
+TEST(QueryResultTest, SortLargeDescending) {
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+
+  // Pseudo-random order, with duplicate timestamps
+  for (uint32_t i = 0; i < 2000; i++) {
+    RecordId rid = {i + 1, 0};
+    query_result_add(rs, rid, (int64_t)((i * 7919u) % 1000u));
+  }
+  ASSERT_EQ(2000u, rs->count);
+
+  query_result_sort(rs);
+  for (uint32_t i = 1; i < rs->count; i++) {
+    ASSERT_GE(rs->created_at[i - 1], rs->created_at[i]);
+  }
+
+  query_result_free(rs);
+}
+
+TEST(QueryResultTest, TopKKeepsNewest) {
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  query_result_set_top_k(rs, 3);
+
+  const int64_t times[] = {500, 100, 900, 300, 700, 200, 800, 600, 400};
+  for (uint32_t i = 0; i < sizeof(times) / sizeof(times[0]); i++) {
+    RecordId rid = {i + 1, 0};
+    query_result_add(rs, rid, times[i]);
+  }
+  EXPECT_EQ(3u, rs->count);
+
+  // Not newer than the 3rd newest: pruned
+  EXPECT_FALSE(query_result_accepts(rs, 700));
+  EXPECT_TRUE(query_result_accepts(rs, 701));
+  RecordId old = {100, 0};
+  EXPECT_EQ(1, query_result_add(rs, old, 50));
+
+  query_result_sort(rs);
+  ASSERT_EQ(3u, rs->count);
+  EXPECT_EQ(900, rs->created_at[0]);
+  EXPECT_EQ(800, rs->created_at[1]);
+  EXPECT_EQ(700, rs->created_at[2]);
+  EXPECT_EQ(3u, rs->rids[0].page_id);
+
+  query_result_free(rs);
+}
+
 // ============================================================================
 // Query by ID tests
 // ============================================================================
@@ -582,6 +716,58 @@ TEST_F(QueryEngineTest, TimelineScanWithRange) {
 // ============================================================================
 // query_execute integration tests
 // ============================================================================
+TEST_F(QueryEngineTest, PostFilterBatchesKeepOrderAndDropMismatches) {
+  // 300 candidates span three batches; every 50th record is deleted
+  RecordId rids[300];
+  for (uint32_t i = 0; i < 300; i++) {
+    rids[i] = insert_tagged_event(i, (i % 2 == 0) ? 0x01 : 0x02, 1000 + i,
+                                  (i % 3 == 0) ? 7 : 1, 't',
+                                  (i % 5 == 0) ? "a" : "b");
+  }
+  for (uint32_t i = 0; i < 300; i += 50) {
+    ASSERT_EQ(NOSTR_DB_OK, record_delete(&pool, rids[i]));
+  }
+
+  NostrDBFilter* filter = (NostrDBFilter*)calloc(1, sizeof(NostrDBFilter));
+  ASSERT_NE(nullptr, filter);
+  memset(filter->authors[0].value, 0x01, 32);
+  filter->authors_count = 1;
+  filter->kinds[0]      = 7;
+  filter->kinds_count   = 1;
+  filter->since         = 1030;
+  filter->until         = 1270;
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  for (uint32_t i = 0; i < 300; i++) {
+    query_result_add(rs, rids[i], 1000 + i);
+  }
+  ASSERT_EQ(NOSTR_DB_OK, query_post_filter(&pool, rs, filter));
+
+  // Author 0x01 and kind 7: every 6th, minus the deleted 1150
+  std::vector<int64_t> expected;
+  for (uint32_t i = 30; i <= 270; i += 6) {
+    if (i % 50 != 0) expected.push_back(1000 + i);
+  }
+  ASSERT_EQ(expected.size(), rs->count);
+  for (uint32_t i = 0; i < rs->count; i++) {
+    EXPECT_EQ(expected[i], rs->created_at[i]);
+  }
+
+  // A single tag filter is verified on the survivors' records
+  filter->tags[0].name = 't';
+  memcpy(filter->tags[0].values[0], "a", 1);
+  filter->tags[0].values_count = 1;
+  filter->tags_count           = 1;
+  ASSERT_EQ(NOSTR_DB_OK, query_post_filter(&pool, rs, filter));
+  ASSERT_EQ(8u, rs->count);
+  EXPECT_EQ(1030, rs->created_at[0]);
+  EXPECT_EQ(1270, rs->created_at[7]);
+
+  query_result_free(rs);
+  free(filter);
+}
+
 TEST_F(QueryEngineTest, ExecuteSelectsIdStrategy) {
   insert_event(0x01, 0xAA, 1000, 1);
   insert_event(0x02, 0xBB, 2000, 1);
@@ -600,6 +786,33 @@ TEST_F(QueryEngineTest, ExecuteSelectsIdStrategy) {
   query_result_free(rs);
 }
 
+TEST_F(QueryEngineTest, ExecuteIdLimitCountsOnlyMatchingEvents) {
+  // The newest requested ids are of another kind: they must not take the
+  // limited places ahead of the one that matches
+  insert_event(0x01, 0xAA, 1000, 1);
+  insert_event(0x02, 0xAA, 2000, 2);
+  insert_event(0x03, 0xAA, 3000, 2);
+
+  NostrDBFilter filter;
+  memset(&filter, 0, sizeof(filter));
+  memset(filter.ids[0].value, 0x01, 32);
+  memset(filter.ids[1].value, 0x02, 32);
+  memset(filter.ids[2].value, 0x03, 32);
+  filter.ids_count   = 3;
+  filter.kinds[0]    = 1;
+  filter.kinds_count = 1;
+  filter.limit       = 1;
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+
+  ASSERT_EQ(NOSTR_DB_OK, query_execute(&im, &pool, &filter, rs));
+  ASSERT_EQ(1u, rs->count);
+  EXPECT_EQ(1000, rs->created_at[0]);
+
+  query_result_free(rs);
+}
+
 TEST_F(QueryEngineTest, ExecuteWithLimit) {
   for (int i = 0; i < 10; i++) {
     insert_event((uint8_t)i, 0xAA, (int64_t)(1000 + i * 100), 1);
@@ -639,3 +852,439 @@ TEST_F(QueryEngineTest, ExecuteEmptyResult) {
 
   query_result_free(rs);
 }
+
+TEST_F(QueryEngineTest, ExecuteReturnsNewestNotFirstInserted) {
+  // Oldest inserted first: results must still come back newest first
+  for (int i = 0; i < 10; i++) {
+    insert_event((uint8_t)(i + 1), 0xAA, (int64_t)(1000 + i * 100), 1);
+  }
+
+  NostrDBFilter filter;
+  memset(&filter, 0, sizeof(filter));
+  filter.kinds[0]    = 1;
+  filter.kinds_count = 1;
+  filter.limit       = 3;
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+
+  ASSERT_EQ(NOSTR_DB_OK, query_execute(&im, &pool, &filter, rs));
+  ASSERT_EQ(3u, rs->count);
+  EXPECT_EQ(1900, rs->created_at[0]);
+  EXPECT_EQ(1800, rs->created_at[1]);
+  EXPECT_EQ(1700, rs->created_at[2]);
+
+  query_result_free(rs);
+}
+
+TEST_F(QueryEngineTest, TimelineScanStopsAtTopK) {
+  for (int i = 0; i < 10; i++) {
+    insert_event((uint8_t)(i + 1), 0xAA, (int64_t)(1000 + i * 100), 1);
+  }
+
+  NostrDBFilter filter;
+  memset(&filter, 0, sizeof(filter));
+  filter.limit = 4;
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+
+  ASSERT_EQ(NOSTR_DB_OK, query_timeline_scan(&im, &filter, rs));
+  EXPECT_EQ(4u, rs->count);
+
+  query_result_sort(rs);
+  EXPECT_EQ(1900, rs->created_at[0]);
+  EXPECT_EQ(1600, rs->created_at[3]);
+
+  query_result_free(rs);
+}
+
+TEST_F(QueryEngineTest, PubkeyPostingsReturnNewestWithinWindow) {
+  // Scrambled insertion order across two authors
+  for (int i = 0; i < 40; i++) {
+    int64_t ts = 1000 + (int64_t)((i * 17) % 40) * 10;
+    insert_event((uint8_t)(i + 1), (i % 2 == 0) ? 0xAA : 0xBB, ts, 1);
+  }
+
+  NostrDBFilter filter;
+  memset(&filter, 0, sizeof(filter));
+  memset(filter.authors[0].value, 0xAA, 32);
+  filter.authors_count = 1;
+  filter.limit         = 3;
+
+  // No pool: created_at is taken from the posting keys alone
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK, query_by_pubkey(&im, &filter, rs));
+  query_result_sort(rs);
+  ASSERT_EQ(3u, rs->count);
+  EXPECT_EQ(1380, rs->created_at[0]);
+  EXPECT_EQ(1360, rs->created_at[1]);
+  EXPECT_EQ(1340, rs->created_at[2]);
+  query_result_free(rs);
+
+  // since / until bound the range scan itself
+  filter.since = 1100;
+  filter.until = 1200;
+  filter.limit = 100;
+  rs           = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK, query_by_pubkey(&im, &filter, rs));
+  query_result_sort(rs);
+  ASSERT_EQ(6u, rs->count);
+  EXPECT_EQ(1200, rs->created_at[0]);
+  EXPECT_EQ(1100, rs->created_at[5]);
+  query_result_free(rs);
+}
+
+TEST_F(QueryEngineTest, KindPostingsSeparateByKind) {
+  insert_event(0x01, 0xAA, 1000, 1);
+  insert_event(0x02, 0xAA, 2000, 256);
+  insert_event(0x03, 0xAA, 3000, 1);
+  insert_event(0x04, 0xAA, 4000, 0x01000000);
+
+  NostrDBFilter filter;
+  memset(&filter, 0, sizeof(filter));
+  filter.kinds[0]    = 1;
+  filter.kinds_count = 1;
+  filter.limit       = 10;
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK, query_by_kind(&im, &filter, rs));
+  query_result_sort(rs);
+  ASSERT_EQ(2u, rs->count);
+  EXPECT_EQ(3000, rs->created_at[0]);
+  EXPECT_EQ(1000, rs->created_at[1]);
+  query_result_free(rs);
+}
+
+TEST_F(QueryEngineTest, PostingsPruneByCoveredFields) {
+  insert_event(0x01, 0xAA, 1000, 1);
+  insert_event(0x02, 0xBB, 2000, 1);
+  insert_event(0x03, 0xAA, 3000, 1);
+  insert_event(0x04, 0xAA, 4000, 2);
+
+  // Authors are checked on the posting's pubkey prefix, no pool needed
+  NostrDBFilter filter;
+  memset(&filter, 0, sizeof(filter));
+  filter.kinds[0]    = 1;
+  filter.kinds_count = 1;
+  memset(filter.authors[0].value, 0xAA, 32);
+  filter.authors_count = 1;
+  filter.limit         = 10;
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK, query_by_kind(&im, &filter, rs));
+  query_result_sort(rs);
+  ASSERT_EQ(2u, rs->count);
+  EXPECT_EQ(3000, rs->created_at[0]);
+  EXPECT_EQ(1000, rs->created_at[1]);
+  query_result_free(rs);
+}
+
+TEST_F(QueryEngineTest, FollowFeedMergeReadsTopKPlusLanes) {
+  // 50 authors x 5 events, kinds 1 and 6, timestamps interleaved
+  const int AUTHORS = 50;
+  const int EVENTS  = 5;
+  for (int e = 0; e < EVENTS; e++) {
+    for (int a = 0; a < AUTHORS; a++) {
+      int n = e * AUTHORS + a;
+      insert_event((uint8_t)n, (uint8_t)(a + 1),
+                   (int64_t)(100000 + n * 3), (e % 2 == 0) ? 1 : 6);
+    }
+  }
+
+  NostrDBFilter* filter = (NostrDBFilter*)calloc(1, sizeof(NostrDBFilter));
+  ASSERT_NE(nullptr, filter);
+  for (int a = 0; a < AUTHORS; a++) {
+    memset(filter->authors[a].value, a + 1, 32);
+  }
+  filter->authors_count = AUTHORS;
+  filter->kinds[0]      = 1;
+  filter->kinds[1]      = 6;
+  filter->kinds_count   = 2;
+  filter->limit         = 10;
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK, query_by_pubkey_kind(&im, filter, rs));
+  query_result_sort(rs);
+
+  // Global newest 10
+  ASSERT_EQ(10u, rs->count);
+  for (uint32_t i = 0; i < 10; i++) {
+    EXPECT_EQ(100000 + (int64_t)(AUTHORS * EVENTS - 1 - i) * 3,
+              rs->created_at[i]);
+  }
+
+  // One head per lane plus about limit more, not every event
+  EXPECT_LE(rs->examined, 10u + AUTHORS * 2 + 1);
+
+  query_result_free(rs);
+  free(filter);
+}
+
+// ============================================================================
+// Planner tests
+// ============================================================================
+TEST_F(QueryEngineTest, PlannerFallsBackToPriorityWithoutStatistics) {
+  NostrDBFilter* filter = (NostrDBFilter*)calloc(1, sizeof(NostrDBFilter));
+  ASSERT_NE(nullptr, filter);
+  filter->kinds[0]     = 1;
+  filter->kinds_count  = 1;
+  filter->tags[0].name = 't';
+  memcpy(filter->tags[0].values[0], "nostr", 5);
+  filter->tags[0].values_count = 1;
+  filter->tags_count           = 1;
+
+  QueryPlan plan;
+  EXPECT_EQ(NOSTR_DB_QUERY_STRATEGY_BY_TAG, query_plan(&im, filter, &plan));
+  EXPECT_EQ(UINT64_MAX, plan.cost[NOSTR_DB_QUERY_STRATEGY_BY_KIND]);
+  free(filter);
+}
+
+TEST_F(QueryEngineTest, PlannerPicksRareKindOverBroadTag) {
+  // 300 notes tagged #t nostr, 10 long-form posts with the same tag
+  for (uint32_t i = 0; i < 300; i++) {
+    insert_tagged_event(i, 0x01, 100000 + i * 10, 1, 't', "nostr");
+  }
+  for (uint32_t i = 0; i < 10; i++) {
+    insert_tagged_event(1000 + i, 0x02, 100000 + i * 300 + 5, 30023, 't',
+                        "nostr");
+  }
+
+  NostrDBFilter* filter = (NostrDBFilter*)calloc(1, sizeof(NostrDBFilter));
+  ASSERT_NE(nullptr, filter);
+  filter->kinds[0]     = 30023;
+  filter->kinds_count  = 1;
+  filter->tags[0].name = 't';
+  memcpy(filter->tags[0].values[0], "nostr", 5);
+  filter->tags[0].values_count = 1;
+  filter->tags_count           = 1;
+  filter->limit                = 10;
+
+  // The rare kind drives: joined with the tag postings rather than verifying
+  // the tag on its records
+  QueryPlan plan;
+  EXPECT_EQ(NOSTR_DB_QUERY_STRATEGY_INTERSECT, query_plan(&im, filter, &plan));
+  EXPECT_LT(plan.cost[NOSTR_DB_QUERY_STRATEGY_BY_KIND],
+            plan.cost[NOSTR_DB_QUERY_STRATEGY_BY_TAG]);
+  EXPECT_LT(plan.cost[NOSTR_DB_QUERY_STRATEGY_INTERSECT],
+            plan.cost[NOSTR_DB_QUERY_STRATEGY_BY_KIND]);
+  EXPECT_EQ(UINT64_MAX, plan.cost[NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY]);
+
+  // Each kind posting costs at most a step and a seek on the tag postings
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK, query_execute(&im, &pool, filter, rs));
+  ASSERT_EQ(10u, rs->count);
+  for (uint32_t i = 0; i < 10; i++) {
+    EXPECT_EQ(100000 + (int64_t)(9 - i) * 300 + 5, rs->created_at[i]);
+  }
+  EXPECT_LE(rs->examined, 4u * 11u);
+
+  query_result_free(rs);
+  free(filter);
+}
+
+TEST_F(QueryEngineTest, PlannerPrefersTimelineForManyAuthorsInNarrowWindow) {
+  // 120 authors with one old event each, then 20 recent events by one of them
+  const int64_t old_time    = 1000000;
+  const int64_t recent_time = old_time + 50 * 32768;
+  for (uint32_t a = 0; a < 120; a++) {
+    insert_event((uint8_t)a, (uint8_t)(a + 1), old_time + a, 1);
+  }
+  for (uint32_t i = 0; i < 20; i++) {
+    insert_event((uint8_t)(200 + i), 1, recent_time + i * 60, 1);
+  }
+
+  NostrDBFilter* filter = (NostrDBFilter*)calloc(1, sizeof(NostrDBFilter));
+  ASSERT_NE(nullptr, filter);
+  for (uint32_t a = 0; a < 120; a++) {
+    memset(filter->authors[a].value, a + 1, 32);
+  }
+  filter->authors_count = 120;
+  filter->since         = recent_time;
+  filter->limit         = 10;
+
+  // 120 cursors cost more than reading the few events in the window
+  QueryPlan plan;
+  EXPECT_EQ(NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN,
+            query_plan(&im, filter, &plan));
+  EXPECT_LT(plan.cost[NOSTR_DB_QUERY_STRATEGY_TIMELINE_SCAN],
+            plan.cost[NOSTR_DB_QUERY_STRATEGY_BY_PUBKEY]);
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK, query_execute(&im, &pool, filter, rs));
+  ASSERT_EQ(10u, rs->count);
+  EXPECT_EQ(recent_time + 19 * 60, rs->created_at[0]);
+  EXPECT_EQ(recent_time + 10 * 60, rs->created_at[9]);
+
+  query_result_free(rs);
+  free(filter);
+}
+
+TEST_F(QueryEngineTest, IntersectJoinsTwoTagFiltersWithoutRecordReads) {
+  // 400 older events tagged #t nostr, 200 newer tagged #r thread, and 4 in
+  // between tagged with both
+  for (uint32_t i = 0; i < 400; i++) {
+    insert_tagged_event(i, 0x01, 100000 + i * 10, 1, 't', "nostr");
+  }
+  for (uint32_t i = 0; i < 200; i++) {
+    insert_tagged_event(1000 + i, 0x02, 200000 + i * 20, 1, 'r', "thread");
+  }
+  for (uint32_t i = 0; i < 4; i++) {
+    insert_tags_event(2000 + i, 0x03, 150000 + i * 1000, 1, 't', "nostr",
+                      'r', "thread");
+  }
+
+  NostrDBFilter* filter = (NostrDBFilter*)calloc(1, sizeof(NostrDBFilter));
+  ASSERT_NE(nullptr, filter);
+  filter->tags[0].name = 't';
+  memcpy(filter->tags[0].values[0], "nostr", 5);
+  filter->tags[0].values_count = 1;
+  filter->tags[1].name         = 'r';
+  memcpy(filter->tags[1].values[0], "thread", 6);
+  filter->tags[1].values_count = 1;
+  filter->tags_count           = 2;
+  filter->limit                = 10;
+
+  QueryPlan plan;
+  EXPECT_EQ(NOSTR_DB_QUERY_STRATEGY_INTERSECT, query_plan(&im, filter, &plan));
+  EXPECT_EQ(NOSTR_DB_QUERY_INPUT_TAG(0) | NOSTR_DB_QUERY_INPUT_TAG(1),
+            plan.inputs);
+  EXPECT_LT(plan.cost[NOSTR_DB_QUERY_STRATEGY_INTERSECT],
+            plan.cost[NOSTR_DB_QUERY_STRATEGY_BY_TAG]);
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK, query_execute(&im, &pool, filter, rs));
+  ASSERT_EQ(4u, rs->count);
+  for (uint32_t i = 0; i < 4; i++) {
+    EXPECT_EQ(150000 + (int64_t)(3 - i) * 1000, rs->created_at[i]);
+  }
+
+  // Scanning the sparser tag reads and verifies every one of its events; the
+  // join jumps over both runs
+  QueryResultSet* scan = query_result_create(0);
+  ASSERT_NE(nullptr, scan);
+  ASSERT_EQ(NOSTR_DB_OK, query_by_tag(&im, filter, scan));
+  EXPECT_EQ(4u, scan->count);
+  EXPECT_GE(scan->examined, 204u);
+  EXPECT_LT(rs->examined, scan->examined);
+
+  query_result_free(scan);
+  query_result_free(rs);
+  free(filter);
+}
+
+TEST_F(QueryEngineTest, ResidualReadsTagsPastLongContent) {
+  // A record larger than a page: its tags start past the first 4096 bytes
+  insert_tags_event(1, 0xAA, 1000, 1, 't', "nostr", 'r', "thread", 5000);
+  insert_tags_event(2, 0xAA, 2000, 1, 't', "nostr", 'r', "other", 5000);
+
+  NostrDBFilter* filter = (NostrDBFilter*)calloc(1, sizeof(NostrDBFilter));
+  ASSERT_NE(nullptr, filter);
+  memset(filter->authors[0].value, 0xAA, 32);
+  filter->authors_count = 1;
+  filter->tags[0].name  = 't';
+  memcpy(filter->tags[0].values[0], "nostr", 5);
+  filter->tags[0].values_count = 1;
+  filter->tags[1].name         = 'r';
+  memcpy(filter->tags[1].values[0], "thread", 6);
+  filter->tags[1].values_count = 1;
+  filter->tags_count           = 2;
+  filter->limit                = 10;
+
+  QueryResultSet* scan = query_result_create(0);
+  ASSERT_NE(nullptr, scan);
+  ASSERT_EQ(NOSTR_DB_OK, query_by_tag(&im, filter, scan));
+  ASSERT_EQ(1u, scan->count);
+  EXPECT_EQ(1000, scan->created_at[0]);
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK, query_execute(&im, &pool, filter, rs));
+  ASSERT_EQ(1u, rs->count);
+  EXPECT_EQ(1000, rs->created_at[0]);
+
+  query_result_free(rs);
+  query_result_free(scan);
+  free(filter);
+}
+
+TEST_F(QueryEngineTest, IntersectSeeksDenseAuthorToSparseThread) {
+  // A chatty author (300 events) and a thread of 30 replies, 3 of them theirs
+  for (uint32_t i = 0; i < 300; i++) {
+    insert_tagged_event(i, 0x01, 200000 + i * 10, 1, 't', "chatter");
+  }
+  for (uint32_t i = 0; i < 30; i++) {
+    uint8_t pk = (i % 10 == 0) ? 0x01 : (uint8_t)(0x10 + i);
+    insert_tagged_event(1000 + i, pk, 200000 + i * 100 + 3, 1, 'r', "root");
+  }
+
+  NostrDBFilter* filter = (NostrDBFilter*)calloc(1, sizeof(NostrDBFilter));
+  ASSERT_NE(nullptr, filter);
+  memset(filter->authors[0].value, 0x01, 32);
+  filter->authors_count = 1;
+  filter->tags[0].name  = 'r';
+  memcpy(filter->tags[0].values[0], "root", 4);
+  filter->tags[0].values_count = 1;
+  filter->tags_count           = 1;
+  filter->limit                = 10;
+
+  QueryPlan plan;
+  EXPECT_EQ(NOSTR_DB_QUERY_STRATEGY_INTERSECT, query_plan(&im, filter, &plan));
+  EXPECT_EQ(NOSTR_DB_QUERY_INPUT_PUBKEY | NOSTR_DB_QUERY_INPUT_TAG(0),
+            plan.inputs);
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK, query_execute(&im, &pool, filter, rs));
+  ASSERT_EQ(3u, rs->count);
+  EXPECT_EQ(200000 + 20 * 100 + 3, rs->created_at[0]);
+  EXPECT_EQ(200000 + 10 * 100 + 3, rs->created_at[1]);
+  EXPECT_EQ(200000 + 3, rs->created_at[2]);
+
+  // The author's postings are jumped over, not read through
+  EXPECT_LT(rs->examined, 100u);
+
+  query_result_free(rs);
+  free(filter);
+}
+
+TEST_F(QueryEngineTest, IntersectReturnsEventUnderTwoTagValuesOnce) {
+  insert_tags_event(1, 0x01, 1000, 7, 't', "a", 't', "b");
+  insert_tagged_event(2, 0x01, 1001, 1, 't', "a");
+  insert_tagged_event(3, 0x01, 1002, 7, 'r', "x");
+  insert_tagged_event(4, 0x01, 999, 7, 't', "b");
+
+  NostrDBFilter* filter = (NostrDBFilter*)calloc(1, sizeof(NostrDBFilter));
+  ASSERT_NE(nullptr, filter);
+  filter->kinds[0]     = 7;
+  filter->kinds_count  = 1;
+  filter->tags[0].name = 't';
+  memcpy(filter->tags[0].values[0], "a", 1);
+  memcpy(filter->tags[0].values[1], "b", 1);
+  filter->tags[0].values_count = 2;
+  filter->tags_count           = 1;
+  filter->limit                = 10;
+
+  QueryResultSet* rs = query_result_create(0);
+  ASSERT_NE(nullptr, rs);
+  ASSERT_EQ(NOSTR_DB_OK,
+            query_intersect(&im, filter,
+                            NOSTR_DB_QUERY_INPUT_KIND |
+                              NOSTR_DB_QUERY_INPUT_TAG(0),
+                            rs));
+  query_result_sort(rs);
+  ASSERT_EQ(2u, rs->count);
+  EXPECT_EQ(1000, rs->created_at[0]);
+  EXPECT_EQ(999, rs->created_at[1]);
+
+  query_result_free(rs);
+  free(filter);
+}
@@ -4,6 +4,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <filesystem>
+#include <string>
 
 extern "C" {
 
@@ -176,6 +177,10 @@ NostrDBError record_insert(BufferPool* pool, const void* data,
                            uint16_t length, RecordId* out_rid);
 NostrDBError record_read(BufferPool* pool, RecordId rid, void* out,
                          uint16_t* length);
+NostrDBError record_view(BufferPool* pool, RecordId rid, void* scratch,
+                         uint16_t scratch_capacity, const uint8_t** data,
+                         uint16_t* length);
+void         record_release(BufferPool* pool, RecordId rid);
 NostrDBError record_delete(BufferPool* pool, RecordId rid);
 NostrDBError record_update(BufferPool* pool, RecordId* rid, const void* data,
                            uint16_t length);
@@ -195,6 +200,10 @@ int32_t      event_serialize(const NostrEventEntity* event, uint8_t* buffer,
 NostrDBError event_deserialize(const uint8_t* buffer, uint16_t length,
                                NostrEventEntity* event);
 
+// Event JSON API
+size_t event_json_write(const uint8_t* record, uint16_t length, char* out,
+                        size_t capacity);
+
 }  // extern "C"
 
 namespace fs = std::filesystem;
@@ -631,6 +640,59 @@ TEST_F(EventSerializerTest, EmptyContent)
   EXPECT_EQ(restored.tag_count, 0u);
 }
 
+TEST_F(EventSerializerTest, JsonFromRecord)
+{
+  strcpy(event.content, "say \"hi\"\n\x01 caf\xc3\xa9 au lait, s'il vous pla\xc3\xaet");
+  event.tag_count = 2;
+  strcpy(event.tags[1].key, "t");
+  event.tags[1].item_count = 2;
+  strcpy(event.tags[1].values[0], "a\\b");
+  strcpy(event.tags[1].values[1], "");
+
+  uint8_t buffer[4096];
+  int32_t written = event_serialize(&event, buffer, sizeof(buffer));
+  ASSERT_GT(written, 0);
+
+  std::string id(64, 'a'), pubkey(64, 'b'), sig(128, 'c'), p(64, 'd');
+  std::string expected = "{\"id\":\"" + id + "\",\"pubkey\":\"" + pubkey +
+                         "\",\"created_at\":1700000000,\"kind\":1,"
+                         "\"tags\":[[\"p\",\"" + p + "\"],[\"t\",\"a\\\\b\",\"\"]],"
+                         "\"content\":\"say \\\"hi\\\"\\n\\u0001 caf\xc3\xa9 au lait, s'il vous pla\xc3\xaet\","
+                         "\"sig\":\"" + sig + "\"}";
+
+  char   out[4096];
+  size_t len = event_json_write(buffer, (uint16_t)written, out, sizeof(out));
+  EXPECT_EQ(std::string(out, len), expected);
+
+  // Exactly enough room, then one byte short
+  EXPECT_EQ(event_json_write(buffer, (uint16_t)written, out, expected.size()),
+            expected.size());
+  EXPECT_EQ(event_json_write(buffer, (uint16_t)written, out, expected.size() - 1),
+            0u);
+
+  // Truncated record
+  EXPECT_EQ(event_json_write(buffer, (uint16_t)(written - 1), out, sizeof(out)),
+            0u);
+}
+
+TEST_F(EventSerializerTest, JsonStoredInRecord)
+{
+  uint8_t buffer[4096];
+  int32_t written = event_serialize(&event, buffer, sizeof(buffer));
+  ASSERT_GT(written, 0);
+
+  // Stored JSON follows the tags and is copied verbatim
+  const char stored[] = "{\"stored\":true}";
+  memcpy(buffer + written, stored, sizeof(stored) - 1);
+  ((EventRecord*)buffer)->flags |= 2u;
+  uint16_t length = (uint16_t)(written + sizeof(stored) - 1);
+
+  char out[4096];
+  EXPECT_EQ(std::string(out, event_json_write(buffer, length, out, sizeof(out))),
+            std::string(stored));
+  EXPECT_EQ(event_json_write(buffer, length, out, sizeof(stored) - 2), 0u);
+}
+
 // ============================================================================
 // Integration: serialize event, insert as record, read back, deserialize
 // ============================================================================
@@ -712,6 +774,31 @@ TEST_F(RecordEventIntegrationTest, SerializeInsertReadDeserialize)
   EXPECT_STREQ(restored.content, event.content);
 }
 
+TEST_F(RecordEventIntegrationTest, ViewPointsIntoPinnedPage)
+{
+  init_all();
+
+  uint8_t buffer[4096];
+  int32_t written = event_serialize(&event, buffer, sizeof(buffer));
+  ASSERT_GT(written, 0);
+
+  RecordId rid;
+  ASSERT_EQ(record_insert(&pool, buffer, (uint16_t)written, &rid),
+            NOSTR_DB_OK);
+
+  // Not spanned: scratch is not needed
+  const uint8_t* data   = nullptr;
+  uint16_t       length = 0;
+  ASSERT_EQ(record_view(&pool, rid, nullptr, 0, &data, &length), NOSTR_DB_OK);
+  EXPECT_EQ(length, (uint16_t)written);
+  EXPECT_EQ(memcmp(data, buffer, length), 0);
+  record_release(&pool, rid);
+
+  ASSERT_EQ(record_delete(&pool, rid), NOSTR_DB_OK);
+  EXPECT_EQ(record_view(&pool, rid, nullptr, 0, &data, &length),
+            NOSTR_DB_ERROR_NOT_FOUND);
+}
+
 TEST_F(RecordEventIntegrationTest, MultipleEvents)
 {
   init_all();
@@ -814,6 +901,36 @@ TEST_F(OverflowTest, InsertAndReadSpanned)
   buffer_pool_unpin(&pool, rid.page_id);
 }
 
+TEST_F(OverflowTest, ViewAssemblesSpannedIntoScratch)
+{
+  init_all();
+
+  uint16_t data_len = 6000;
+  uint8_t  data[6000];
+  for (uint16_t i = 0; i < data_len; i++) {
+    data[i] = (uint8_t)(i % 251);
+  }
+
+  RecordId rid;
+  ASSERT_EQ(record_insert(&pool, data, data_len, &rid), NOSTR_DB_OK);
+
+  const uint8_t* view   = nullptr;
+  uint16_t       length = 0;
+  uint8_t        small[1000];
+  EXPECT_EQ(record_view(&pool, rid, small, sizeof(small), &view, &length),
+            NOSTR_DB_ERROR_FULL);
+  EXPECT_EQ(record_view(&pool, rid, nullptr, 0, &view, &length),
+            NOSTR_DB_ERROR_FULL);
+
+  static uint8_t scratch[8192];
+  ASSERT_EQ(record_view(&pool, rid, scratch, sizeof(scratch), &view, &length),
+            NOSTR_DB_OK);
+  EXPECT_EQ(view, scratch);
+  EXPECT_EQ(length, data_len);
+  EXPECT_EQ(memcmp(view, data, data_len), 0);
+  record_release(&pool, rid);
+}
+
 TEST_F(OverflowTest, ReadQueryLength)
 {
   init_all();
@@ -87,6 +87,25 @@ bool extract_nostr_event_tags(const JsonFuncs* funcs, const char* json, const js
 bool extract_nostr_event_kind(const JsonFuncs* funcs, const char* json, const jsmntok_t* token, uint32_t* kind);
 bool extract_nostr_event_created_at(const JsonFuncs* funcs, const char* json, const jsmntok_t* token, uint64_t* created_at);
 
+// Verified event cache
+typedef struct {
+  uint64_t seq;
+  uint64_t sig_hash;
+  uint8_t  id[32];
+} NostrVerifiedCacheEntry;
+
+typedef struct {
+  NostrVerifiedCacheEntry* entries;
+  size_t                   capacity;
+  uint64_t                 hits;
+  uint64_t                 misses;
+} NostrVerifiedCache;
+
+bool nostr_verified_cache_init(NostrVerifiedCache* cache, size_t capacity);
+void nostr_verified_cache_destroy(NostrVerifiedCache* cache);
+bool nostr_verified_cache_contains(NostrVerifiedCache* cache, const char* id_hex, const char* sig_hex);
+void nostr_verified_cache_insert(NostrVerifiedCache* cache, const char* id_hex, const char* sig_hex);
+
 }  // extern "C"
 
 class NostrEventTest : public ::testing::Test {
@@ -367,3 +386,59 @@ TEST_F(NostrEventTest, ExtractCreatedAtSuccess) {
   EXPECT_TRUE(result);
   EXPECT_EQ(created_at, 1704067200ull);
 }
+
+// ============================================================================
+// Verified Event Cache Tests
+// ============================================================================
+
+static const char* kCacheId1  = "aabbccdd00112233445566778899aabbccdd00112233445566778899aabbccdd";
+static const char* kCacheId2  = "11223344556677889900aabbccddeeff11223344556677889900aabbccddeeff";
+static const char* kCacheSig1 =
+  "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff"
+  "00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff";
+static const char* kCacheSig2 =
+  "ffeeddccbbaa99887766554433221100ffeeddccbbaa99887766554433221100"
+  "ffeeddccbbaa99887766554433221100ffeeddccbbaa99887766554433221100";
+
+TEST(NostrVerifiedCacheTest, InitRoundsCapacity) {
+  NostrVerifiedCache cache;
+  ASSERT_TRUE(nostr_verified_cache_init(&cache, 1000));
+  EXPECT_EQ(cache.capacity, 1024u);
+  EXPECT_NE(cache.entries, nullptr);
+  nostr_verified_cache_destroy(&cache);
+  EXPECT_EQ(cache.entries, nullptr);
+}
+
+TEST(NostrVerifiedCacheTest, MissThenHit) {
+  NostrVerifiedCache cache;
+  ASSERT_TRUE(nostr_verified_cache_init(&cache, 64));
+
+  EXPECT_FALSE(nostr_verified_cache_contains(&cache, kCacheId1, kCacheSig1));
+  nostr_verified_cache_insert(&cache, kCacheId1, kCacheSig1);
+  EXPECT_TRUE(nostr_verified_cache_contains(&cache, kCacheId1, kCacheSig1));
+  EXPECT_FALSE(nostr_verified_cache_contains(&cache, kCacheId2, kCacheSig1));
+  EXPECT_EQ(cache.hits, 1u);
+  EXPECT_EQ(cache.misses, 2u);
+
+  nostr_verified_cache_destroy(&cache);
+}
+
+TEST(NostrVerifiedCacheTest, DifferentSigIsMiss) {
+  NostrVerifiedCache cache;
+  ASSERT_TRUE(nostr_verified_cache_init(&cache, 64));
+
+  nostr_verified_cache_insert(&cache, kCacheId1, kCacheSig1);
+  EXPECT_FALSE(nostr_verified_cache_contains(&cache, kCacheId1, kCacheSig2));
+
+  nostr_verified_cache_destroy(&cache);
+}
+
+TEST(NostrVerifiedCacheTest, DisabledWhenZeroCapacity) {
+  NostrVerifiedCache cache;
+  ASSERT_TRUE(nostr_verified_cache_init(&cache, 0));
+
+  nostr_verified_cache_insert(&cache, kCacheId1, kCacheSig1);
+  EXPECT_FALSE(nostr_verified_cache_contains(&cache, kCacheId1, kCacheSig1));
+
+  nostr_verified_cache_destroy(&cache);
+}
@@ -0,0 +1,239 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+extern "C" {
+
+// Only pointers to these cross the boundary
+struct NostrEventEntity;
+struct NostrEphemeralEvent;
+struct NostrReqMessage;
+struct NostrCloseMessage;
+
+typedef struct {
+  size_t max_message_length;
+  size_t max_subscriptions;
+  size_t max_filters;
+  size_t max_subid_length;
+  size_t max_event_tags;
+} NostrRelayLimits;
+
+typedef struct {
+  const char* name;
+  const char* description;
+  const char* pubkey;
+  const char* contact;
+  const char* software;
+  const char* version;
+  const int*  supported_nips;
+
+  const NostrRelayLimits* limitation;
+} NostrRelayInfo;
+
+typedef struct {
+  const char* subscription_id;
+  const char* reason;
+} NostrLimitViolation;
+
+typedef bool (*PNostrEventCallback)(const NostrEventEntity* event);
+typedef bool (*PNostrEphemeralCallback)(const NostrEphemeralEvent* event);
+typedef bool (*PNostrReqCallback)(const NostrReqMessage* req);
+typedef bool (*PNostrCloseCallback)(const NostrCloseMessage* close_msg);
+typedef void (*PNostrLimitCallback)(const NostrLimitViolation* violation);
+
+typedef struct {
+  PNostrEventCallback     event;
+  PNostrReqCallback       req;
+  PNostrCloseCallback     close;
+  PNostrEphemeralCallback ephemeral;
+  const NostrRelayLimits* limits;
+  PNostrLimitCallback     limit_exceeded;
+} NostrFuncs;
+
+bool nostr_event_handler(const char* json, NostrFuncs* nostr_funcs);
+bool nostr_nip11_response(const NostrRelayInfo* info, const size_t buffer_capacity, char* buffer);
+
+}  // extern "C"
+
+// ============================================================================
+// Callback recorders (callbacks are plain function pointers)
+// ============================================================================
+static int         g_events     = 0;
+static int         g_reqs       = 0;
+static int         g_violations = 0;
+static std::string g_violation_subid;
+static std::string g_violation_reason;
+
+static bool on_event(const NostrEventEntity*)
+{
+  g_events++;
+  return true;
+}
+
+static bool on_req(const NostrReqMessage*)
+{
+  g_reqs++;
+  return true;
+}
+
+static bool on_close(const NostrCloseMessage*) { return true; }
+
+static void on_limit(const NostrLimitViolation* violation)
+{
+  g_violations++;
+  g_violation_subid  = violation->subscription_id != nullptr ? violation->subscription_id : "";
+  g_violation_reason = violation->reason;
+}
+
+class NostrFuncLimitTest : public ::testing::Test {
+protected:
+  void SetUp() override
+  {
+    g_events     = 0;
+    g_reqs       = 0;
+    g_violations = 0;
+    g_violation_subid.clear();
+    g_violation_reason.clear();
+
+    memset(&limits, 0, sizeof(limits));
+    funcs.event          = on_event;
+    funcs.req            = on_req;
+    funcs.close          = on_close;
+    funcs.ephemeral      = nullptr;
+    funcs.limits         = &limits;
+    funcs.limit_exceeded = on_limit;
+  }
+
+  static std::string build_event(int tag_count)
+  {
+    std::string tags;
+    for (int i = 0; i < tag_count; i++) {
+      tags += (i > 0 ? "," : "");
+      tags += "[\"t\",\"tag" + std::to_string(i) + "\"]";
+    }
+
+    char event[4096];
+    snprintf(event, sizeof(event),
+             "[\"EVENT\",{\"id\":\"%064x\",\"pubkey\":\"%064x\",\"created_at\":1700000000,\"kind\":1,"
+             "\"tags\":[%s],\"content\":\"hello\",\"sig\":\"%0128x\"}]",
+             1, 2, tags.c_str(), 3);
+    return event;
+  }
+
+  NostrRelayLimits limits;
+  NostrFuncs       funcs;
+};
+
+// ============================================================================
+// Admission limit tests
+// ============================================================================
+TEST_F(NostrFuncLimitTest, EventWithinTagLimit_Accepted)
+{
+  limits.max_event_tags = 3;
+  std::string json      = build_event(3);
+
+  EXPECT_TRUE(nostr_event_handler(json.c_str(), &funcs));
+  EXPECT_EQ(g_events, 1);
+  EXPECT_EQ(g_violations, 0);
+}
+
+TEST_F(NostrFuncLimitTest, EventTooManyTags_NoticeBeforeExtraction)
+{
+  limits.max_event_tags = 3;
+  std::string json      = build_event(4);
+
+  EXPECT_TRUE(nostr_event_handler(json.c_str(), &funcs));
+  EXPECT_EQ(g_events, 0);
+  EXPECT_EQ(g_violations, 1);
+  EXPECT_EQ(g_violation_subid, "");
+  EXPECT_EQ(g_violation_reason, "invalid: too many tags");
+}
+
+TEST_F(NostrFuncLimitTest, ReqTooManyFilters_Closed)
+{
+  limits.max_filters = 2;
+
+  EXPECT_TRUE(nostr_event_handler("[\"REQ\",\"sub1\",{\"kinds\":[1]},{\"kinds\":[2]},{\"kinds\":[3]}]", &funcs));
+  EXPECT_EQ(g_reqs, 0);
+  EXPECT_EQ(g_violations, 1);
+  EXPECT_EQ(g_violation_subid, "sub1");
+  EXPECT_EQ(g_violation_reason, "invalid: too many filters");
+
+  EXPECT_TRUE(nostr_event_handler("[\"REQ\",\"sub1\",{\"kinds\":[1]},{\"kinds\":[2]}]", &funcs));
+  EXPECT_EQ(g_reqs, 1);
+  EXPECT_EQ(g_violations, 1);
+}
+
+TEST_F(NostrFuncLimitTest, ReqSubidTooLong_Notice)
+{
+  limits.max_subid_length = 4;
+
+  EXPECT_TRUE(nostr_event_handler("[\"REQ\",\"abcde\",{\"kinds\":[1]}]", &funcs));
+  EXPECT_EQ(g_reqs, 0);
+  EXPECT_EQ(g_violations, 1);
+  EXPECT_EQ(g_violation_subid, "");
+  EXPECT_EQ(g_violation_reason, "invalid: subscription id too long");
+}
+
+TEST_F(NostrFuncLimitTest, MessageTooLarge_RejectedBeforeTokenizing)
+{
+  limits.max_message_length = 32;
+
+  EXPECT_TRUE(nostr_event_handler("[\"REQ\",\"sub1\",{\"kinds\":[1,2,3,4,5,6,7]}]", &funcs));
+  EXPECT_EQ(g_reqs, 0);
+  EXPECT_EQ(g_violations, 1);
+  EXPECT_EQ(g_violation_reason, "invalid: message too large");
+}
+
+TEST_F(NostrFuncLimitTest, WithoutLimitCallback_ReportsFailure)
+{
+  limits.max_filters   = 1;
+  funcs.limit_exceeded = nullptr;
+
+  EXPECT_FALSE(nostr_event_handler("[\"REQ\",\"sub1\",{\"kinds\":[1]},{\"kinds\":[2]}]", &funcs));
+  EXPECT_EQ(g_reqs, 0);
+}
+
+TEST_F(NostrFuncLimitTest, NoLimits_Unrestricted)
+{
+  funcs.limits     = nullptr;
+  std::string json = build_event(64);
+
+  EXPECT_TRUE(nostr_event_handler(json.c_str(), &funcs));
+  EXPECT_TRUE(nostr_event_handler("[\"REQ\",\"sub1\",{\"kinds\":[1]},{\"kinds\":[2]},{\"kinds\":[3]}]", &funcs));
+  EXPECT_EQ(g_events, 1);
+  EXPECT_EQ(g_reqs, 1);
+  EXPECT_EQ(g_violations, 0);
+}
+
+// ============================================================================
+// NIP-11 tests
+// ============================================================================
+TEST(NostrNip11Test, AdvertisesLimitation)
+{
+  NostrRelayLimits limits = {65536, 20, 16, 64, 0};
+  NostrRelayInfo   info;
+  memset(&info, 0, sizeof(info));
+  info.name       = "relay";
+  info.limitation = &limits;
+
+  char buffer[1024];
+  ASSERT_TRUE(nostr_nip11_response(&info, sizeof(buffer), buffer));
+  EXPECT_STREQ(buffer,
+               "{\"name\":\"relay\",\"limitation\":{\"max_message_length\":65536,\"max_subscriptions\":20,"
+               "\"max_filters\":16,\"max_subid_length\":64}}");
+}
+
+TEST(NostrNip11Test, OmitsLimitationWhenUnset)
+{
+  NostrRelayInfo info;
+  memset(&info, 0, sizeof(info));
+  info.name = "relay";
+
+  char buffer[1024];
+  ASSERT_TRUE(nostr_nip11_response(&info, sizeof(buffer), buffer));
+  EXPECT_STREQ(buffer, "{\"name\":\"relay\"}");
+}
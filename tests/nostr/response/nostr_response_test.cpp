@@ -38,6 +38,37 @@ bool nostr_response_event(
   char*                   buffer,
   size_t                  capacity);
 
+size_t nostr_response_event_object(
+  const NostrEventEntity* event,
+  char*                   buffer,
+  size_t                  capacity);
+
+bool nostr_response_event_raw(
+  const char* subscription_id,
+  const char* event_json,
+  size_t      event_json_len,
+  char*       buffer,
+  size_t      capacity);
+
+// Stored event record header (see record_types.h)
+typedef struct {
+  uint8_t  id[32];
+  uint8_t  pubkey[32];
+  uint8_t  sig[64];
+  int64_t  created_at;
+  uint32_t kind;
+  uint32_t flags;
+  uint16_t content_length;
+  uint16_t tags_length;
+} EventRecord;
+
+size_t nostr_response_event_record(
+  const char*    subscription_id,
+  const uint8_t* record,
+  uint16_t       record_length,
+  char*          buffer,
+  size_t         capacity);
+
 bool nostr_response_eose(
   const char* subscription_id,
   char*       buffer,
@@ -283,6 +314,95 @@ TEST_F(NostrResponseTest, Event_SimpleEvent) {
   EXPECT_TRUE(strstr(buffer, "}]") != nullptr);
 }
 
+TEST_F(NostrResponseTest, EventRaw_ForwardsObjectVerbatim) {
+  const char* message = "[\"EVENT\",{\"kind\":24133,\"content\":\"x\"}]";
+  const char* object  = message + 9;
+  size_t      len     = strlen(object) - 1;  // Drop the closing bracket of the EVENT message
+
+  bool result = nostr_response_event_raw("nip46", object, len, buffer, sizeof(buffer));
+  EXPECT_TRUE(result);
+  EXPECT_STREQ(buffer, "[\"EVENT\",\"nip46\",{\"kind\":24133,\"content\":\"x\"}]");
+}
+
+TEST_F(NostrResponseTest, EventObject_MatchesEventResponse) {
+  strcpy(event.id, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+  strcpy(event.pubkey, "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb");
+  event.kind = 1;
+  event.created_at = 1704067200;
+  strcpy(event.tags[0].key, "t");
+  strcpy(event.tags[0].values[0], "nostr");
+  event.tags[0].item_count = 1;
+  event.tag_count = 1;
+  strcpy(event.content, "line\nbreak");
+  strcpy(event.sig, "cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc");
+
+  char   object[1024];
+  size_t len = nostr_response_event_object(&event, object, sizeof(object));
+  ASSERT_GT(len, 0u);
+  EXPECT_EQ(len, strlen(object));
+  EXPECT_EQ(object[0], '{');
+  EXPECT_EQ(object[len - 1], '}');
+
+  // Framing the object must give the same bytes as serializing the entity directly
+  char direct[1024];
+  ASSERT_TRUE(nostr_response_event("sub1", &event, direct, sizeof(direct)));
+  ASSERT_TRUE(nostr_response_event_raw("sub1", object, len, buffer, sizeof(buffer)));
+  EXPECT_STREQ(buffer, direct);
+
+  char small[32];
+  EXPECT_EQ(nostr_response_event_object(&event, small, sizeof(small)), 0u);
+}
+
+TEST_F(NostrResponseTest, EventRecord_MatchesEventResponse) {
+  strcpy(event.id, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+  strcpy(event.pubkey, "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb");
+  event.kind = 1;
+  event.created_at = 1704067200;
+  strcpy(event.tags[0].key, "t");
+  strcpy(event.tags[0].values[0], "nostr");
+  event.tags[0].item_count = 1;
+  event.tag_count = 1;
+  strcpy(event.content, "line\nbreak \"quoted\"");
+  strcpy(event.sig, "cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc");
+
+  // The same event as stored: raw id/pubkey/sig, raw content, serialized tags
+  const char    content[] = "line\nbreak \"quoted\"";
+  const uint8_t tags[]    = {1, 0, 1, 1, 't', 5, 0, 'n', 'o', 's', 't', 'r'};
+  uint8_t       record[512];
+  EventRecord*  rec = (EventRecord*)record;
+  memset(record, 0, sizeof(record));
+  memset(rec->id, 0xaa, sizeof(rec->id));
+  memset(rec->pubkey, 0xbb, sizeof(rec->pubkey));
+  memset(rec->sig, 0xcc, sizeof(rec->sig));
+  rec->created_at     = 1704067200;
+  rec->kind           = 1;
+  rec->content_length = sizeof(content) - 1;
+  rec->tags_length    = sizeof(tags);
+  memcpy(record + sizeof(EventRecord), content, rec->content_length);
+  memcpy(record + sizeof(EventRecord) + rec->content_length, tags, sizeof(tags));
+  uint16_t record_length = (uint16_t)(sizeof(EventRecord) + rec->content_length + sizeof(tags));
+
+  char direct[1024];
+  ASSERT_TRUE(nostr_response_event("sub1", &event, direct, sizeof(direct)));
+
+  size_t len = nostr_response_event_record("sub1", record, record_length, buffer, sizeof(buffer));
+  EXPECT_EQ(len, strlen(direct));
+  EXPECT_STREQ(buffer, direct);
+
+  // Needs room for the terminator as well
+  char small[1024];
+  EXPECT_EQ(nostr_response_event_record("sub1", record, record_length, small, len + 1), len);
+  EXPECT_EQ(nostr_response_event_record("sub1", record, record_length, small, len), 0u);
+}
+
+TEST_F(NostrResponseTest, EventRaw_BufferTooSmall) {
+  char        small[16];
+  const char* object = "{\"kind\":24133,\"content\":\"hello\"}";
+
+  bool result = nostr_response_event_raw("nip46", object, strlen(object), small, sizeof(small));
+  EXPECT_FALSE(result);
+}
+
 TEST_F(NostrResponseTest, Event_WithTags) {
   strcpy(event.id, "1111111111111111111111111111111111111111111111111111111111111111");
   strcpy(event.pubkey, "2222222222222222222222222222222222222222222222222222222222222222");
@@ -0,0 +1,618 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+extern "C" {
+
+#define NOSTR_REQ_SUBSCRIPTION_ID_LENGTH 64
+#define NOSTR_FANOUT_NIL 0xFFFFFFFFu
+
+typedef enum {
+  NOSTR_SLOW_CONSUMER_DROP_OLDEST = 0,
+  NOSTR_SLOW_CONSUMER_CLOSE       = 1,
+  NOSTR_SLOW_CONSUMER_DISCONNECT  = 2,
+} NostrSlowConsumerPolicy;
+
+typedef enum {
+  NOSTR_FANOUT_FRAME_EVENT  = 0,
+  NOSTR_FANOUT_FRAME_NOTICE = 1,
+  NOSTR_FANOUT_FRAME_CLOSED = 2,
+  NOSTR_FANOUT_FRAME_REPLY  = 3,
+} NostrFanoutFrameType;
+
+typedef enum {
+  NOSTR_FANOUT_QUEUED     = 0,
+  NOSTR_FANOUT_FULL       = 1,
+  NOSTR_FANOUT_DROPPED    = 2,
+  NOSTR_FANOUT_CLOSE      = 3,
+  NOSTR_FANOUT_DISCONNECT = 4,
+} NostrFanoutPushResult;
+
+typedef enum {
+  NOSTR_FANOUT_SENT    = 0,
+  NOSTR_FANOUT_BLOCKED = 1,
+  NOSTR_FANOUT_SKIPPED = 2,
+} NostrFanoutSendResult;
+
+typedef struct {
+  int32_t  client_fd;
+  uint32_t event;
+  uint8_t  type;
+  char     subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+} NostrFanoutDelivery;
+
+typedef struct {
+  size_t   offset;
+  size_t   length;
+  uint32_t pending;
+  uint32_t dummy;
+} NostrFanoutEvent;
+
+typedef struct {
+  uint32_t queued;
+  uint32_t resume;
+  uint32_t blocked_pass;
+  uint8_t  noticed;
+  uint8_t  dropping;
+  uint8_t  dummy[2];
+} NostrFanoutConnection;
+
+typedef struct {
+  NostrFanoutDelivery* deliveries;
+  size_t               capacity;
+  size_t               head;
+  size_t               count;
+
+  NostrFanoutEvent* events;
+  size_t            events_head;
+  size_t            events_count;
+  uint32_t          open_event;
+  uint32_t          pass;
+
+  char*  arena;
+  size_t arena_capacity;
+  size_t arena_head;
+  size_t arena_tail;
+  size_t open_tail;
+
+  NostrFanoutConnection*  connections;
+  size_t                  connections_capacity;
+  size_t                  max_per_connection;
+  NostrSlowConsumerPolicy policy;
+  uint32_t                dummy;
+
+  uint64_t enqueued;
+  uint64_t delivered;
+  uint64_t blocked;
+  uint64_t dropped;
+  uint64_t notices;
+  uint64_t closed;
+  uint64_t disconnected;
+} NostrFanoutQueue;
+
+typedef NostrFanoutSendResult (*NostrFanoutSendCallback)(
+  int32_t              client_fd,
+  NostrFanoutFrameType type,
+  const char*          subscription_id,
+  const char*          event_json,
+  size_t               event_json_len,
+  uint32_t*            resume,
+  void*                user_data);
+
+typedef void (*NostrFanoutActionCallback)(
+  NostrFanoutPushResult action,
+  int32_t               client_fd,
+  const char*           subscription_id,
+  void*                 user_data);
+
+bool                  nostr_fanout_init(NostrFanoutQueue* queue, size_t max_deliveries, size_t arena_bytes);
+void                  nostr_fanout_destroy(NostrFanoutQueue* queue);
+void                  nostr_fanout_set_policy(NostrFanoutQueue* queue, NostrSlowConsumerPolicy policy, size_t max_per_connection);
+bool                  nostr_fanout_begin(NostrFanoutQueue* queue, const char* event_json, size_t event_json_len);
+NostrFanoutPushResult nostr_fanout_push(NostrFanoutQueue* queue, int32_t client_fd, const char* subscription_id);
+void                  nostr_fanout_end(NostrFanoutQueue* queue);
+NostrFanoutPushResult nostr_fanout_push_reply(NostrFanoutQueue* queue, int32_t client_fd, const char* message, size_t message_len, uint32_t written);
+size_t                nostr_fanout_drain(NostrFanoutQueue* queue, size_t budget, NostrFanoutSendCallback send, void* user_data);
+bool                  nostr_fanout_shed_oldest(NostrFanoutQueue* queue, NostrFanoutActionCallback on_action, void* user_data);
+bool                  nostr_fanout_in_flight(const NostrFanoutQueue* queue, int32_t client_fd);
+bool                  nostr_fanout_pending(const NostrFanoutQueue* queue, int32_t client_fd);
+void                  nostr_fanout_remove_connection(NostrFanoutQueue* queue, int32_t client_fd);
+
+}  // extern "C"
+
+// ============================================================================
+// Stalled-reader harness
+//
+// Each fake socket accepts at most `window` bytes until refilled (SIZE_MAX =
+// never blocks). Frames are rendered as "E sub payload\n", "N\n", "C sub\n",
+// "R message\n"
+// so a torn or interleaved frame shows up in the received stream.
+// ============================================================================
+struct FakeSocket {
+  size_t      window = SIZE_MAX;
+  std::string received;
+};
+
+struct FakeNetwork {
+  std::map<int32_t, FakeSocket> sockets;
+  size_t                        attempts = 0;
+
+  std::vector<std::string> frames(int32_t fd)
+  {
+    std::vector<std::string> out;
+    std::string&             stream = sockets[fd].received;
+    size_t                   start  = 0;
+    for (size_t i = 0; i < stream.size(); i++) {
+      if (stream[i] == '\n') {
+        out.push_back(stream.substr(start, i - start));
+        start = i + 1;
+      }
+    }
+    return out;
+  }
+};
+
+static std::string render_frame(NostrFanoutFrameType type, const char* subscription_id, const char* event_json, size_t event_json_len)
+{
+  if (type == NOSTR_FANOUT_FRAME_NOTICE) {
+    return "N\n";
+  }
+  if (type == NOSTR_FANOUT_FRAME_CLOSED) {
+    return std::string("C ") + subscription_id + "\n";
+  }
+  if (type == NOSTR_FANOUT_FRAME_REPLY) {
+    return "R " + std::string(event_json, event_json_len) + "\n";
+  }
+  return std::string("E ") + subscription_id + " " + std::string(event_json, event_json_len) + "\n";
+}
+
+static NostrFanoutSendResult fake_send(
+  int32_t              client_fd,
+  NostrFanoutFrameType type,
+  const char*          subscription_id,
+  const char*          event_json,
+  size_t               event_json_len,
+  uint32_t*            resume,
+  void*                user_data)
+{
+  auto*       net    = static_cast<FakeNetwork*>(user_data);
+  FakeSocket& socket = net->sockets[client_fd];
+  std::string frame  = render_frame(type, subscription_id, event_json, event_json_len);
+  net->attempts++;
+
+  size_t remaining = frame.size() - *resume;
+  size_t written   = std::min(remaining, socket.window);
+  if (written == 0) {
+    return NOSTR_FANOUT_BLOCKED;
+  }
+
+  socket.received.append(frame, *resume, written);
+  if (socket.window != SIZE_MAX) {
+    socket.window -= written;
+  }
+  *resume += (uint32_t)written;
+  return written == remaining ? NOSTR_FANOUT_SENT : NOSTR_FANOUT_BLOCKED;
+}
+
+class NostrFanoutTest : public ::testing::Test {
+protected:
+  void SetUp() override { memset(&queue, 0, sizeof(queue)); }
+
+  void TearDown() override { nostr_fanout_destroy(&queue); }
+
+  bool queueEvent(const std::string& json, std::initializer_list<int32_t> fds, const char* subscription_id = "sub")
+  {
+    if (!nostr_fanout_begin(&queue, json.data(), json.size())) {
+      return false;
+    }
+    bool ok = true;
+    for (int32_t fd : fds) {
+      ok = nostr_fanout_push(&queue, fd, subscription_id) == NOSTR_FANOUT_QUEUED && ok;
+    }
+    nostr_fanout_end(&queue);
+    return ok;
+  }
+
+  size_t drain(size_t budget)
+  {
+    return nostr_fanout_drain(&queue, budget, fake_send, &net);
+  }
+
+  std::vector<std::string> sent(int32_t fd) { return net.frames(fd); }
+
+  NostrFanoutQueue queue;
+  FakeNetwork      net;
+};
+
+// ============================================================================
+// Ordering and budget
+// ============================================================================
+TEST_F(NostrFanoutTest, DrainRespectsBudgetAndOrder)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 16, 1024));
+
+  ASSERT_TRUE(queueEvent("{\"n\":1}", {10, 11, 12}));
+  ASSERT_TRUE(queueEvent("{\"n\":2}", {10}));
+  EXPECT_EQ(queue.count, 4u);
+
+  EXPECT_EQ(drain(2), 2u);
+  EXPECT_EQ(sent(10), std::vector<std::string>({"E sub {\"n\":1}"}));
+  EXPECT_EQ(sent(11), std::vector<std::string>({"E sub {\"n\":1}"}));
+
+  EXPECT_EQ(drain(2), 2u);
+  EXPECT_EQ(sent(12), std::vector<std::string>({"E sub {\"n\":1}"}));
+  EXPECT_EQ(sent(10), std::vector<std::string>({"E sub {\"n\":1}", "E sub {\"n\":2}"}));
+
+  EXPECT_EQ(drain(2), 0u);
+  EXPECT_EQ(queue.events_count, 0u);
+  EXPECT_EQ(queue.enqueued, 4u);
+  EXPECT_EQ(queue.delivered, 4u);
+}
+
+TEST_F(NostrFanoutTest, ZeroBudgetDrainsEverything)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 16, 1024));
+
+  ASSERT_TRUE(queueEvent("{}", {1, 2, 3, 4, 5}));
+  EXPECT_EQ(drain(0), 5u);
+  EXPECT_EQ(queue.count, 0u);
+}
+
+TEST_F(NostrFanoutTest, EventWithoutDeliveriesIsReleased)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 16, 1024));
+
+  ASSERT_TRUE(queueEvent("{\"n\":1}", {7}));
+  size_t tail = queue.arena_tail;
+
+  ASSERT_TRUE(queueEvent("{\"unmatched\":true}", {}));
+  EXPECT_EQ(queue.events_count, 1u);
+  EXPECT_EQ(queue.arena_tail, tail);
+}
+
+// ============================================================================
+// Bounds
+// ============================================================================
+TEST_F(NostrFanoutTest, FullDeliveryRingRejectsPush)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 2, 1024));
+
+  ASSERT_TRUE(nostr_fanout_begin(&queue, "{}", 2));
+  EXPECT_EQ(nostr_fanout_push(&queue, 1, "sub"), NOSTR_FANOUT_QUEUED);
+  EXPECT_EQ(nostr_fanout_push(&queue, 2, "sub"), NOSTR_FANOUT_QUEUED);
+  EXPECT_EQ(nostr_fanout_push(&queue, 3, "sub"), NOSTR_FANOUT_FULL);
+
+  // Draining a slice while the event is still open frees room and keeps its payload
+  EXPECT_EQ(drain(1), 1u);
+  EXPECT_EQ(nostr_fanout_push(&queue, 3, "sub"), NOSTR_FANOUT_QUEUED);
+  nostr_fanout_end(&queue);
+
+  EXPECT_EQ(drain(0), 2u);
+  EXPECT_EQ(sent(3), std::vector<std::string>({"E sub {}"}));
+  EXPECT_EQ(queue.events_count, 0u);
+}
+
+TEST_F(NostrFanoutTest, ArenaWrapsAndRejectsWhenFull)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 16, 32));
+
+  std::string a(12, 'a');
+  std::string b(12, 'b');
+  std::string c(12, 'c');
+  ASSERT_TRUE(queueEvent(a, {1}));
+  ASSERT_TRUE(queueEvent(b, {1}));
+  EXPECT_FALSE(queueEvent(c, {1}));  // 8 bytes left at the end, none at the start
+
+  // Releasing the first payload lets the next one wrap to the start
+  EXPECT_EQ(drain(1), 1u);
+  ASSERT_TRUE(queueEvent(c, {1}));
+  EXPECT_EQ(queue.events[(queue.events_head + 1) % queue.capacity].offset, 0u);
+
+  EXPECT_EQ(drain(0), 2u);
+  EXPECT_EQ(sent(1), std::vector<std::string>({"E sub " + a, "E sub " + b, "E sub " + c}));
+}
+
+TEST_F(NostrFanoutTest, RejectsOversizedSubscriptionId)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 4, 64));
+
+  std::string id(NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1, 'x');
+  ASSERT_TRUE(nostr_fanout_begin(&queue, "{}", 2));
+  EXPECT_EQ(nostr_fanout_push(&queue, 1, id.c_str()), NOSTR_FANOUT_DROPPED);
+  nostr_fanout_end(&queue);
+  EXPECT_EQ(queue.events_count, 0u);
+}
+
+// ============================================================================
+// Stalled readers
+// ============================================================================
+TEST_F(NostrFanoutTest, StalledReaderDoesNotHoldUpOthers)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 64, 4096));
+  net.sockets[1].window = 0;  // Never reads
+
+  for (int i = 0; i < 5; i++) {
+    ASSERT_TRUE(queueEvent("{\"n\":" + std::to_string(i) + "}", {1, 2}));
+  }
+
+  EXPECT_EQ(drain(0), 5u);
+  EXPECT_EQ(sent(2).size(), 5u);
+  EXPECT_TRUE(sent(1).empty());
+  EXPECT_EQ(queue.connections[1].queued, 5u);
+  EXPECT_EQ(queue.blocked, 1u);  // Skipped for the rest of the pass after one attempt
+  EXPECT_EQ(queue.count, 5u);
+
+  // The reader catches up and gets everything, in order
+  net.sockets[1].window = SIZE_MAX;
+  EXPECT_EQ(drain(0), 5u);
+  std::vector<std::string> frames = sent(1);
+  ASSERT_EQ(frames.size(), 5u);
+  for (int i = 0; i < 5; i++) {
+    EXPECT_EQ(frames[i], "E sub {\"n\":" + std::to_string(i) + "}");
+  }
+  EXPECT_EQ(queue.events_count, 0u);
+}
+
+TEST_F(NostrFanoutTest, ShortWritesResumeWithoutTearingFrames)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 64, 4096));
+
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(queueEvent("{\"payload\":\"" + std::string(20, (char)('a' + i)) + "\"}", {1}));
+  }
+
+  // Seven bytes per drain: every frame takes several partial writes
+  size_t drains = 0;
+  while (queue.count > 0 && drains < 100) {
+    net.sockets[1].window = 7;
+    drain(0);
+    drains++;
+    if (queue.count > 0 && queue.connections[1].resume > 0) {
+      EXPECT_TRUE(nostr_fanout_in_flight(&queue, 1));
+    }
+  }
+
+  std::vector<std::string> frames = sent(1);
+  ASSERT_EQ(frames.size(), 4u);
+  for (int i = 0; i < 4; i++) {
+    EXPECT_EQ(frames[i], "E sub {\"payload\":\"" + std::string(20, (char)('a' + i)) + "\"}");
+  }
+  EXPECT_FALSE(nostr_fanout_in_flight(&queue, 1));
+  EXPECT_EQ(queue.delivered, 4u);
+}
+
+TEST_F(NostrFanoutTest, DropOldestKeepsNewestAndNoticesOnce)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 64, 4096));
+  nostr_fanout_set_policy(&queue, NOSTR_SLOW_CONSUMER_DROP_OLDEST, 4);
+  net.sockets[1].window = 0;
+
+  for (int i = 0; i < 10; i++) {
+    ASSERT_TRUE(queueEvent("{\"n\":" + std::to_string(i) + "}", {1, 2}));
+    drain(0);
+  }
+
+  EXPECT_LE(queue.connections[1].queued, 5u);  // Budget plus the NOTICE
+  EXPECT_EQ(queue.notices, 1u);
+  EXPECT_GT(queue.dropped, 0u);
+  EXPECT_EQ(sent(2).size(), 10u);  // Healthy reader loses nothing
+
+  net.sockets[1].window = SIZE_MAX;
+  drain(0);
+  std::vector<std::string> frames = sent(1);
+  ASSERT_FALSE(frames.empty());
+  EXPECT_EQ(frames.size() + queue.dropped, 11u);
+  EXPECT_EQ(frames.back(), "E sub {\"n\":9}");
+  EXPECT_EQ(std::count(frames.begin(), frames.end(), "N"), 1);
+
+  // Events that survive are still in publish order
+  int last = -1;
+  for (const std::string& frame : frames) {
+    if (frame != "N") {
+      int n = std::stoi(frame.substr(frame.find(':') + 1));
+      EXPECT_GT(n, last);
+      last = n;
+    }
+  }
+}
+
+TEST_F(NostrFanoutTest, DropOldestNeverTearsPartialFrame)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 64, 4096));
+  nostr_fanout_set_policy(&queue, NOSTR_SLOW_CONSUMER_DROP_OLDEST, 2);
+
+  ASSERT_TRUE(queueEvent("{\"n\":0}", {1}));
+  net.sockets[1].window = 3;
+  drain(0);
+  ASSERT_TRUE(nostr_fanout_in_flight(&queue, 1));
+
+  for (int i = 1; i < 6; i++) {
+    ASSERT_TRUE(queueEvent("{\"n\":" + std::to_string(i) + "}", {1}));
+  }
+
+  net.sockets[1].window = SIZE_MAX;
+  drain(0);
+  std::vector<std::string> frames = sent(1);
+  ASSERT_FALSE(frames.empty());
+  EXPECT_EQ(frames.front(), "E sub {\"n\":0}");
+  EXPECT_EQ(frames.back(), "E sub {\"n\":5}");
+}
+
+TEST_F(NostrFanoutTest, ClosePolicyCancelsSubscriptionAndQueuesClosed)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 64, 4096));
+  nostr_fanout_set_policy(&queue, NOSTR_SLOW_CONSUMER_CLOSE, 3);
+  net.sockets[1].window = 0;
+
+  for (int i = 0; i < 3; i++) {
+    ASSERT_TRUE(queueEvent("{\"n\":" + std::to_string(i) + "}", {1}, "firehose"));
+  }
+
+  ASSERT_TRUE(nostr_fanout_begin(&queue, "{\"n\":3}", 7));
+  EXPECT_EQ(nostr_fanout_push(&queue, 1, "firehose"), NOSTR_FANOUT_CLOSE);
+  nostr_fanout_end(&queue);
+
+  EXPECT_EQ(queue.closed, 1u);
+  EXPECT_EQ(queue.connections[1].queued, 1u);  // Only the CLOSED frame
+  EXPECT_EQ(queue.events_count, 0u);           // Cancelled payloads were released
+
+  net.sockets[1].window = SIZE_MAX;
+  drain(0);
+  EXPECT_EQ(sent(1), std::vector<std::string>({"C firehose"}));
+}
+
+TEST_F(NostrFanoutTest, DisconnectPolicyDropsConnectionUntilRemoved)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 64, 4096));
+  nostr_fanout_set_policy(&queue, NOSTR_SLOW_CONSUMER_DISCONNECT, 2);
+  net.sockets[1].window = 0;
+
+  ASSERT_TRUE(queueEvent("{\"n\":0}", {1, 2}));
+  ASSERT_TRUE(queueEvent("{\"n\":1}", {1, 2}));
+  drain(0);  // fd 2 keeps up, fd 1 does not
+
+  ASSERT_TRUE(nostr_fanout_begin(&queue, "{\"n\":2}", 7));
+  EXPECT_EQ(nostr_fanout_push(&queue, 1, "sub"), NOSTR_FANOUT_DISCONNECT);
+  EXPECT_EQ(nostr_fanout_push(&queue, 1, "sub"), NOSTR_FANOUT_DROPPED);
+  EXPECT_EQ(nostr_fanout_push(&queue, 2, "sub"), NOSTR_FANOUT_QUEUED);
+  nostr_fanout_end(&queue);
+
+  EXPECT_EQ(queue.disconnected, 1u);
+  EXPECT_EQ(queue.connections[1].queued, 0u);
+
+  drain(0);
+  EXPECT_EQ(sent(2).size(), 3u);
+  EXPECT_TRUE(sent(1).empty());
+
+  // A new client reusing the fd starts clean
+  nostr_fanout_remove_connection(&queue, 1);
+  net.sockets[1].window = SIZE_MAX;
+  ASSERT_TRUE(queueEvent("{\"n\":3}", {1}));
+  drain(0);
+  EXPECT_EQ(sent(1), std::vector<std::string>({"E sub {\"n\":3}"}));
+}
+
+static void record_action(NostrFanoutPushResult action, int32_t client_fd, const char* subscription_id, void* user_data)
+{
+  auto* actions = static_cast<std::vector<std::string>*>(user_data);
+  actions->push_back(std::to_string((int)action) + ":" + std::to_string(client_fd) + ":" + subscription_id);
+}
+
+TEST_F(NostrFanoutTest, ShedOldestFreesArenaHeldByStalledReader)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 64, 32));
+  net.sockets[1].window = 0;
+
+  std::string a(12, 'a');
+  std::string b(12, 'b');
+  ASSERT_TRUE(queueEvent(a, {1, 2}));
+  ASSERT_TRUE(queueEvent(b, {1, 2}));
+  drain(0);
+  ASSERT_FALSE(nostr_fanout_begin(&queue, "cccccccccccc", 12));
+
+  std::vector<std::string> actions;
+  EXPECT_TRUE(nostr_fanout_shed_oldest(&queue, record_action, &actions));
+  EXPECT_TRUE(actions.empty());  // Drop-oldest needs nothing from the caller
+  EXPECT_EQ(queue.dropped, 1u);
+  ASSERT_TRUE(nostr_fanout_begin(&queue, "cccccccccccc", 12));
+  nostr_fanout_end(&queue);
+
+  // Under the close policy the caller is told which subscription to remove
+  nostr_fanout_set_policy(&queue, NOSTR_SLOW_CONSUMER_CLOSE, 0);
+  EXPECT_TRUE(nostr_fanout_shed_oldest(&queue, record_action, &actions));
+  EXPECT_EQ(actions, std::vector<std::string>({"3:1:sub"}));
+  EXPECT_EQ(queue.closed, 1u);
+}
+
+// ============================================================================
+// Protocol replies
+// ============================================================================
+TEST_F(NostrFanoutTest, ReplyWaitsBehindPartialFrame)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 64, 4096));
+
+  ASSERT_TRUE(queueEvent("{\"n\":0}", {1}));
+  net.sockets[1].window = 3;
+  drain(0);
+  ASSERT_TRUE(nostr_fanout_in_flight(&queue, 1));
+
+  std::string ok = "[\"OK\",\"id\",true,\"\"]";
+  EXPECT_EQ(nostr_fanout_push_reply(&queue, 1, ok.data(), ok.size(), 0), NOSTR_FANOUT_QUEUED);
+  EXPECT_TRUE(nostr_fanout_in_flight(&queue, 1));  // Still resumes the event frame
+  EXPECT_TRUE(nostr_fanout_pending(&queue, 1));
+
+  net.sockets[1].window = SIZE_MAX;
+  drain(0);
+  EXPECT_EQ(sent(1), std::vector<std::string>({"E sub {\"n\":0}", "R " + ok}));
+  EXPECT_FALSE(nostr_fanout_pending(&queue, 1));
+  EXPECT_EQ(queue.events_count, 0u);
+}
+
+TEST_F(NostrFanoutTest, ReplyResumesAfterDirectShortWrite)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 64, 4096));
+
+  // The first bytes of "R [\"EOSE\",\"sub\"]\n" went out directly
+  std::string eose = "[\"EOSE\",\"sub\"]";
+  net.sockets[1].received = "R [";
+  EXPECT_EQ(nostr_fanout_push_reply(&queue, 1, eose.data(), eose.size(), 3), NOSTR_FANOUT_QUEUED);
+  EXPECT_TRUE(nostr_fanout_in_flight(&queue, 1));
+
+  drain(0);
+  EXPECT_EQ(sent(1), std::vector<std::string>({"R " + eose}));
+  EXPECT_FALSE(nostr_fanout_in_flight(&queue, 1));
+}
+
+TEST_F(NostrFanoutTest, ReplyOverBudgetDropsEventsNotReplies)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 64, 4096));
+  nostr_fanout_set_policy(&queue, NOSTR_SLOW_CONSUMER_DROP_OLDEST, 4);
+  net.sockets[1].window = 0;
+
+  for (int i = 0; i < 4; i++) {
+    ASSERT_TRUE(queueEvent("{\"n\":" + std::to_string(i) + "}", {1}));
+  }
+  EXPECT_EQ(nostr_fanout_push_reply(&queue, 1, "first", 5, 0), NOSTR_FANOUT_QUEUED);
+  EXPECT_GT(queue.dropped, 0u);
+
+  net.sockets[1].window = SIZE_MAX;
+  drain(0);
+  std::vector<std::string> frames = sent(1);
+  ASSERT_FALSE(frames.empty());
+  EXPECT_EQ(frames.back(), "R first");
+
+  // Nothing but replies left to shed: the connection goes
+  net.sockets[1].window = 0;
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(nostr_fanout_push_reply(&queue, 1, "again", 5, 0), NOSTR_FANOUT_QUEUED);
+  }
+  EXPECT_EQ(nostr_fanout_push_reply(&queue, 1, "again", 5, 0), NOSTR_FANOUT_DISCONNECT);
+  EXPECT_EQ(queue.connections[1].queued, 0u);
+  EXPECT_EQ(queue.disconnected, 1u);
+}
+
+TEST_F(NostrFanoutTest, FullQueueShedsConnectionHoldingReply)
+{
+  ASSERT_TRUE(nostr_fanout_init(&queue, 4, 4096));
+  nostr_fanout_set_policy(&queue, NOSTR_SLOW_CONSUMER_CLOSE, 0);
+  net.sockets[1].window = 0;
+
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(nostr_fanout_push_reply(&queue, 1, "reply", 5, 0), NOSTR_FANOUT_QUEUED);
+  }
+  EXPECT_EQ(nostr_fanout_push_reply(&queue, 2, "reply", 5, 0), NOSTR_FANOUT_FULL);
+
+  std::vector<std::string> actions;
+  EXPECT_TRUE(nostr_fanout_shed_oldest(&queue, record_action, &actions));
+  EXPECT_EQ(actions, std::vector<std::string>({"4:1:"}));
+  EXPECT_EQ(queue.closed, 0u);
+
+  EXPECT_EQ(nostr_fanout_push_reply(&queue, 2, "reply", 5, 0), NOSTR_FANOUT_QUEUED);
+  drain(0);
+  EXPECT_EQ(sent(2), std::vector<std::string>({"R reply"}));
+}
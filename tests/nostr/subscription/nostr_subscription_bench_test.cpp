@@ -0,0 +1,573 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+extern "C" {
+
+// Filter types
+#define NOSTR_FILTER_MAX_IDS 256
+#define NOSTR_FILTER_MAX_AUTHORS 256
+#define NOSTR_FILTER_MAX_KINDS 64
+#define NOSTR_FILTER_MAX_TAGS 26
+#define NOSTR_FILTER_MAX_TAG_VALUES 256
+#define NOSTR_FILTER_MAX_LONG_TAG_VALUES 16
+#define NOSTR_FILTER_LONG_TAG_VALUE_LENGTH 64
+#define NOSTR_FILTER_KIND_BITMAP_BITS 65536
+#define NOSTR_MATCH_EVENT_MAX_TAGS (2 * 1024)
+#define NOSTR_FILTER_PROGRAM_LENGTH (4 + NOSTR_FILTER_MAX_TAGS)
+#define NOSTR_FILTER_AUTHORS_HASH_SLOTS 512
+
+typedef struct {
+  uint8_t op;
+  uint8_t operand;
+} NostrFilterInstruction;
+
+typedef struct {
+  uint8_t value[32];
+  size_t  prefix_len;
+} NostrFilterId;
+
+typedef struct {
+  uint8_t value[32];
+  size_t  prefix_len;
+} NostrFilterPubkey;
+
+typedef struct {
+  uint8_t length;
+  uint8_t value[NOSTR_FILTER_LONG_TAG_VALUE_LENGTH];
+} NostrFilterLongTagValue;
+
+typedef struct {
+  char                    name;
+  uint8_t                 values[NOSTR_FILTER_MAX_TAG_VALUES][32];
+  size_t                  values_count;
+  NostrFilterLongTagValue long_values[NOSTR_FILTER_MAX_LONG_TAG_VALUES];
+  size_t                  long_values_count;
+} NostrFilterTag;
+
+typedef struct {
+  NostrFilterId          ids[NOSTR_FILTER_MAX_IDS];
+  size_t                 ids_count;
+  NostrFilterPubkey      authors[NOSTR_FILTER_MAX_AUTHORS];
+  size_t                 authors_count;
+  uint32_t               kinds[NOSTR_FILTER_MAX_KINDS];
+  size_t                 kinds_count;
+  NostrFilterTag         tags[NOSTR_FILTER_MAX_TAGS];
+  size_t                 tags_count;
+  int64_t                since;
+  int64_t                until;
+  uint32_t               limit;
+  int32_t                has_limit;
+  int32_t                compiled;
+  size_t                 ids_full_count;
+  size_t                 authors_full_count;
+  uint64_t               kinds_bitmap[NOSTR_FILTER_KIND_BITMAP_BITS / 64];
+  NostrFilterInstruction program[NOSTR_FILTER_PROGRAM_LENGTH];
+  size_t                 program_length;
+  uint16_t               authors_hash[NOSTR_FILTER_AUTHORS_HASH_SLOTS];
+} NostrFilter;
+
+typedef struct {
+  char        name;
+  uint8_t     length;
+  uint8_t     value[32];
+  const char* raw;
+} NostrMatchEventTag;
+
+typedef struct {
+  uint8_t            id[32];
+  uint8_t            pubkey[32];
+  int32_t            id_valid;
+  int32_t            pubkey_valid;
+  uint32_t           kind;
+  int64_t            created_at;
+  size_t             tags_count;
+  NostrMatchEventTag tags[NOSTR_MATCH_EVENT_MAX_TAGS];
+} NostrMatchEvent;
+
+// REQ / CLOSE types
+#define NOSTR_REQ_SUBSCRIPTION_ID_LENGTH 64
+#define NOSTR_REQ_MAX_FILTERS 16
+
+typedef struct {
+  char        subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+  NostrFilter filters[NOSTR_REQ_MAX_FILTERS];
+  size_t      filters_count;
+} NostrReqMessage;
+
+typedef struct {
+  char subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+} NostrCloseMessage;
+
+// Event types
+#define NOSTR_EVENT_TAG_LENGTH (2 * 1024)
+#define NOSTR_EVENT_TAG_VALUE_COUNT 16
+#define NOSTR_EVENT_TAG_VALUE_LENGTH 512
+#define NOSTR_EVENT_CONTENT_LENGTH (1 * 1024 * 1024)
+
+typedef struct {
+  char   key[64];
+  char   values[NOSTR_EVENT_TAG_VALUE_COUNT][NOSTR_EVENT_TAG_VALUE_LENGTH];
+  size_t item_count;
+} NostrTagEntity;
+
+typedef struct {
+  char           id[65];
+  char           dummy1[7];
+  char           pubkey[65];
+  char           dummy2[7];
+  uint32_t       kind;
+  uint32_t       tag_count;
+  uint64_t       created_at;
+  NostrTagEntity tags[NOSTR_EVENT_TAG_LENGTH];
+  char           content[NOSTR_EVENT_CONTENT_LENGTH];
+  char           sig[129];
+  char           dummy3[7];
+} NostrEventEntity;
+
+typedef struct {
+  char            id[65];
+  char            dummy[7];
+  const char*     json;
+  size_t          json_len;
+  NostrMatchEvent match;
+} NostrEphemeralEvent;
+
+// Subscription types
+#define NOSTR_SUBSCRIPTION_MAX_COUNT 16384
+#define NOSTR_SUBSCRIPTION_NIL 0xFFFFFFFFu
+
+typedef struct {
+  int32_t            active;
+  int32_t            client_fd;
+  char               subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+  const NostrFilter* filters[NOSTR_REQ_MAX_FILTERS];
+  uint32_t           filter_links[NOSTR_REQ_MAX_FILTERS];
+  size_t             filters_count;
+  uint32_t           slot;
+  uint32_t           conn_prev;
+  uint32_t           conn_next;
+  uint32_t           hash_next;
+} NostrSubscription;
+
+typedef struct {
+  uint32_t head;
+  uint32_t count;
+} NostrSubscriptionConnection;
+
+typedef struct {
+  NostrSubscription**          chunks;
+  size_t                       chunks_count;
+  size_t                       count;
+  uint32_t                     free_head;
+  uint32_t                     epoch;
+  uint32_t*                    buckets;
+  size_t                       buckets_capacity;
+  NostrSubscriptionConnection* connections;
+  size_t                       connections_capacity;
+  size_t                       max_count;
+  size_t                       max_per_connection;
+  void*                        registry;
+  void*                        index;
+  uint32_t*                    sub_epoch;
+} NostrSubscriptionManager;
+
+typedef void (*NostrSubscriptionMatchCallback)(const NostrSubscription* subscription, void* user_data);
+
+// Nostr callbacks
+typedef bool (*PNostrEventCallback)(const NostrEventEntity* event);
+typedef bool (*PNostrEphemeralCallback)(const NostrEphemeralEvent* event);
+typedef bool (*PNostrReqCallback)(const NostrReqMessage* req);
+typedef bool (*PNostrCloseCallback)(const NostrCloseMessage* close_msg);
+typedef void (*PNostrLimitCallback)(const void* violation);
+
+typedef struct {
+  PNostrEventCallback     event;
+  PNostrReqCallback       req;
+  PNostrCloseCallback     close;
+  PNostrEphemeralCallback ephemeral;
+  const void*             limits;
+  PNostrLimitCallback     limit_exceeded;
+} NostrFuncs;
+
+bool nostr_event_handler(const char* json, NostrFuncs* nostr_funcs);
+
+bool               nostr_subscription_manager_init(NostrSubscriptionManager* manager);
+void               nostr_subscription_manager_destroy(NostrSubscriptionManager* manager);
+NostrSubscription* nostr_subscription_add(NostrSubscriptionManager* manager, int32_t client_fd, const NostrReqMessage* req);
+size_t nostr_subscription_find_matching(NostrSubscriptionManager* manager, const NostrEventEntity* event, NostrSubscriptionMatchCallback callback, void* user_data);
+size_t nostr_subscription_find_matching_binary(NostrSubscriptionManager* manager, const NostrMatchEvent* match_event, NostrSubscriptionMatchCallback callback, void* user_data);
+
+void nostr_filter_compile(NostrFilter* filter);
+void nostr_match_event_init(NostrMatchEvent* match_event, const NostrEventEntity* event);
+bool nostr_filter_matches_binary(const NostrFilter* filter, const NostrMatchEvent* match_event);
+bool nostr_filter_matches_generic(const NostrFilter* filter, const NostrMatchEvent* match_event);
+
+bool nostr_response_event(const char* subscription_id, const NostrEventEntity* event, char* buffer, size_t capacity);
+bool nostr_response_event_raw(const char* subscription_id, const char* event_json, size_t event_json_len, char* buffer, size_t capacity);
+
+}  // extern "C"
+
+// ============================================================================
+// Shared bench state (callbacks are plain function pointers)
+//
+// Timed runs are DISABLED_ so the unit suite stays fast; run them with
+// --gtest_also_run_disabled_tests. Their functional checks also run at a
+// small size as ordinary tests.
+// ============================================================================
+static NostrSubscriptionManager g_bench_manager;
+static char                     g_bench_frame[65536];
+static size_t                   g_bench_delivered = 0;
+
+static const NostrEventEntity*    g_bench_entity    = nullptr;
+static const NostrEphemeralEvent* g_bench_ephemeral = nullptr;
+
+static void deliver_entity(const NostrSubscription* sub, void*)
+{
+  if (nostr_response_event(sub->subscription_id, g_bench_entity, g_bench_frame, sizeof(g_bench_frame))) {
+    g_bench_delivered++;
+  }
+}
+
+static void deliver_raw(const NostrSubscription* sub, void*)
+{
+  if (nostr_response_event_raw(sub->subscription_id, g_bench_ephemeral->json, g_bench_ephemeral->json_len,
+                               g_bench_frame, sizeof(g_bench_frame))) {
+    g_bench_delivered++;
+  }
+}
+
+static bool on_event_full_path(const NostrEventEntity* event)
+{
+  g_bench_entity = event;
+  nostr_subscription_find_matching(&g_bench_manager, event, deliver_entity, nullptr);
+  return true;
+}
+
+static bool on_ephemeral_fast_path(const NostrEphemeralEvent* event)
+{
+  g_bench_ephemeral = event;
+  nostr_subscription_find_matching_binary(&g_bench_manager, &event->match, deliver_raw, nullptr);
+  return true;
+}
+
+static bool on_req(const NostrReqMessage*) { return true; }
+static bool on_close(const NostrCloseMessage*) { return true; }
+
+class NostrSubscriptionBenchTest : public ::testing::Test {
+protected:
+  static constexpr int kSigners    = 256;
+  static constexpr int kRoundTrips = 2000;
+
+  void SetUp() override
+  {
+    memset(&g_bench_manager, 0, sizeof(g_bench_manager));
+    ASSERT_TRUE(nostr_subscription_manager_init(&g_bench_manager));
+    g_bench_delivered = 0;
+  }
+
+  void TearDown() override
+  {
+    nostr_subscription_manager_destroy(&g_bench_manager);
+  }
+
+  static void pubkey_hex(int index, char* out)
+  {
+    snprintf(out, 65, "%064x", index + 1);
+  }
+
+  // NIP-46: every signer/app subscribes to kind 24133 addressed to its own pubkey
+  void add_nip46_subscriptions(int count)
+  {
+    static char            req_json[512];
+    static NostrReqMessage req;
+    for (int i = 0; i < count; i++) {
+      char pk[65];
+      pubkey_hex(i, pk);
+      snprintf(req_json, sizeof(req_json), "[\"REQ\",\"nip46-%d\",{\"kinds\":[24133],\"#p\":[\"%s\"]}]", i, pk);
+
+      memset(&req, 0, sizeof(req));
+      ASSERT_TRUE(parse_req(req_json, &req));
+      ASSERT_NE(nostr_subscription_add(&g_bench_manager, 1000 + i, &req), nullptr);
+    }
+  }
+
+  // Route REQ parsing through the handler so filters are built exactly as in the relay
+  static bool parse_req(const char* json, NostrReqMessage* out)
+  {
+    static NostrReqMessage* target = nullptr;
+    target                         = out;
+    NostrFuncs funcs;
+    funcs.event     = nullptr;
+    funcs.req       = [](const NostrReqMessage* req) -> bool {
+      memcpy(target, req, sizeof(NostrReqMessage));
+      return true;
+    };
+    funcs.close          = on_close;
+    funcs.ephemeral      = nullptr;
+    funcs.limits         = nullptr;
+    funcs.limit_exceeded = nullptr;
+    return nostr_event_handler(json, &funcs);
+  }
+
+  static void build_nip46_event(char* out, size_t capacity, int seq, int from, int to)
+  {
+    char from_pk[65];
+    char to_pk[65];
+    pubkey_hex(from, from_pk);
+    pubkey_hex(to, to_pk);
+    snprintf(out, capacity,
+             "[\"EVENT\",{\"id\":\"%064x\",\"pubkey\":\"%s\",\"created_at\":1700000000,\"kind\":24133,"
+             "\"tags\":[[\"p\",\"%s\"]],\"content\":\"AqH7Yb1c3NkZXNjcmlwdGlvbiBvZiB0aGUgbmlwNDYgcmVxdWVzdA==?iv=YWJjZGVmZ2hpamtsbW5vcA==\","
+             "\"sig\":\"%0128x\"}]",
+             seq + 1, from_pk, to_pk, seq + 1);
+  }
+
+  // Run round trips (app -> signer request, signer -> app response) and return per-trip latency in us
+  std::vector<double> run_round_trips(NostrFuncs* funcs, int round_trips, int signers)
+  {
+    std::vector<double> latencies;
+    latencies.reserve(round_trips);
+
+    // The payload buffer is modified by the handler caller in the relay; keep a private copy
+    static char request[4096];
+    static char response[4096];
+
+    for (int i = 0; i < round_trips; i++) {
+      int app    = i % signers;
+      int signer = (i * 7 + 3) % signers;
+      build_nip46_event(request, sizeof(request), i * 2, app, signer);
+      build_nip46_event(response, sizeof(response), i * 2 + 1, signer, app);
+
+      auto start = std::chrono::high_resolution_clock::now();
+      EXPECT_TRUE(nostr_event_handler(request, funcs));
+      EXPECT_TRUE(nostr_event_handler(response, funcs));
+      auto end = std::chrono::high_resolution_clock::now();
+
+      latencies.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    return latencies;
+  }
+
+  static void report(const char* label, const std::vector<double>& lat)
+  {
+    double sum = 0;
+    for (double v : lat) {
+      sum += v;
+    }
+    printf("\n  [BENCH] %s: %zu round trips, mean %.1f us, p50 %.1f us, p99 %.1f us\n",
+           label, lat.size(), sum / lat.size(), lat[lat.size() / 2], lat[(lat.size() * 99) / 100]);
+  }
+
+
+  // Handlers for the storable-event path and the ephemeral fast path
+  static void nip46_paths(NostrFuncs* full_path, NostrFuncs* fast_path)
+  {
+    full_path->event          = on_event_full_path;
+    full_path->req            = on_req;
+    full_path->close          = on_close;
+    full_path->ephemeral      = nullptr;
+    full_path->limits         = nullptr;
+    full_path->limit_exceeded = nullptr;
+
+    *fast_path           = *full_path;
+    fast_path->ephemeral = on_ephemeral_fast_path;
+  }
+
+  // Filter and event mix modeled on a typical client: home feeds over
+  // followed authors, mentions, thread replies, profiles, hashtags, global
+  // and DMs; events are mostly notes, with replies, reactions, mentions and
+  // hashtags
+  static void build_matcher_mix(std::vector<NostrFilter>& filters, std::vector<NostrMatchEvent>& events)
+  {
+    static constexpr int   kPubkeys = 1000;
+    static char            req_json[16384];
+    static NostrReqMessage req;
+
+    uint32_t seed = 12345;
+    auto     next = [&seed]() {
+      seed = seed * 1103515245u + 12345u;
+      return (seed >> 8) & 0xFFFFFF;
+    };
+
+    for (size_t i = 0; i < filters.size(); i++) {
+      char pk[65];
+      pubkey_hex(next() % kPubkeys, pk);
+
+      int mix = i % 20;
+      int pos = 0;
+      if (mix < 6) {
+        pos = snprintf(req_json, sizeof(req_json), "[\"REQ\",\"home\",{\"kinds\":[1,6],\"authors\":[");
+        int follows = 50 + next() % 150;
+        for (int f = 0; f < follows; f++) {
+          pubkey_hex(next() % kPubkeys, pk);
+          pos += snprintf(req_json + pos, sizeof(req_json) - pos, "%s\"%s\"", f > 0 ? "," : "", pk);
+        }
+        snprintf(req_json + pos, sizeof(req_json) - pos, "],\"since\":1700000000}]");
+      } else if (mix < 10) {
+        snprintf(req_json, sizeof(req_json), "[\"REQ\",\"mentions\",{\"kinds\":[1,6,7,9735],\"#p\":[\"%s\"]}]", pk);
+      } else if (mix < 13) {
+        snprintf(req_json, sizeof(req_json), "[\"REQ\",\"thread\",{\"kinds\":[1],\"#e\":[\"%064zx\"]}]", next() % events.size() + 1);
+      } else if (mix < 15) {
+        snprintf(req_json, sizeof(req_json), "[\"REQ\",\"profile\",{\"kinds\":[0,3],\"authors\":[\"%s\"]}]", pk);
+      } else if (mix < 17) {
+        snprintf(req_json, sizeof(req_json), "[\"REQ\",\"tag\",{\"kinds\":[1],\"#t\":[\"nostr\",\"t%u\"]}]", next() % 16);
+      } else if (mix < 19) {
+        snprintf(req_json, sizeof(req_json), "[\"REQ\",\"global\",{\"kinds\":[1],\"since\":1700000500}]");
+      } else {
+        char peer[65];
+        pubkey_hex(next() % kPubkeys, peer);
+        snprintf(req_json, sizeof(req_json), "[\"REQ\",\"dm\",{\"kinds\":[4],\"authors\":[\"%s\"],\"#p\":[\"%s\"]}]", peer, pk);
+      }
+
+      EXPECT_TRUE(parse_req(req_json, &req));
+      memcpy(&filters[i], &req.filters[0], sizeof(NostrFilter));
+      nostr_filter_compile(&filters[i]);
+    }
+
+    // Events: mostly notes, with replies, reactions, mentions and hashtags
+    static const uint32_t   kinds[] = {1, 1, 1, 1, 6, 7, 7, 0, 4, 9735};
+    static NostrEventEntity entity;
+    for (size_t i = 0; i < events.size(); i++) {
+      memset(&entity, 0, offsetof(NostrEventEntity, tags));
+      snprintf(entity.id, sizeof(entity.id), "%064zx", i + 1);
+      pubkey_hex(next() % kPubkeys, entity.pubkey);
+      entity.kind       = kinds[next() % 10];
+      entity.created_at = 1700000000 + next() % 1000;
+
+      uint32_t tag_count = 0;
+      snprintf(entity.tags[tag_count].key, 64, "e");
+      snprintf(entity.tags[tag_count].values[0], 512, "%064zx", next() % events.size() + 1);
+      entity.tags[tag_count++].item_count = 1;
+      snprintf(entity.tags[tag_count].key, 64, "p");
+      pubkey_hex(next() % kPubkeys, entity.tags[tag_count].values[0]);
+      entity.tags[tag_count++].item_count = 1;
+      snprintf(entity.tags[tag_count].key, 64, "t");
+      snprintf(entity.tags[tag_count].values[0], 512, "t%u", next() % 16);
+      entity.tags[tag_count++].item_count = 1;
+      entity.tag_count = tag_count;
+
+      nostr_match_event_init(&events[i], &entity);
+    }
+  }
+
+  // Matches of every (event, filter) pair; ns per pair
+  static double run_matcher(bool (*matcher)(const NostrFilter*, const NostrMatchEvent*), const std::vector<NostrFilter>& filters,
+                            const std::vector<NostrMatchEvent>& events, size_t* matched)
+  {
+    *matched   = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const NostrMatchEvent& event : events) {
+      for (const NostrFilter& filter : filters) {
+        *matched += matcher(&filter, &event) ? 1 : 0;
+      }
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count() / ((double)events.size() * filters.size());
+  }
+};
+
+// ============================================================================
+// NIP-46 legs reach exactly their addressee on both paths
+// ============================================================================
+TEST_F(NostrSubscriptionBenchTest, Nip46PathsDeliverEachLegOnce)
+{
+  static constexpr int kPairs = 8;
+  static constexpr int kTrips = 32;
+  add_nip46_subscriptions(kPairs);
+
+  NostrFuncs full_path;
+  NostrFuncs fast_path;
+  nip46_paths(&full_path, &fast_path);
+
+  g_bench_delivered = 0;
+  run_round_trips(&full_path, kTrips, kPairs);
+  EXPECT_EQ(g_bench_delivered, (size_t)kTrips * 2);
+
+  g_bench_delivered = 0;
+  run_round_trips(&fast_path, kTrips, kPairs);
+  EXPECT_EQ(g_bench_delivered, (size_t)kTrips * 2);
+}
+
+// ============================================================================
+// NIP-46 round trip: storable-event path vs ephemeral fast path
+// ============================================================================
+TEST_F(NostrSubscriptionBenchTest, DISABLED_Nip46RoundTripLatency)
+{
+  add_nip46_subscriptions(kSigners);
+
+  NostrFuncs full_path;
+  NostrFuncs fast_path;
+  nip46_paths(&full_path, &fast_path);
+
+  g_bench_delivered        = 0;
+  std::vector<double> full = run_round_trips(&full_path, kRoundTrips, kSigners);
+  size_t full_delivered    = g_bench_delivered;
+
+  g_bench_delivered        = 0;
+  std::vector<double> fast = run_round_trips(&fast_path, kRoundTrips, kSigners);
+  size_t fast_delivered    = g_bench_delivered;
+
+  // Each leg is addressed to exactly one subscriber
+  EXPECT_EQ(full_delivered, (size_t)kRoundTrips * 2);
+  EXPECT_EQ(fast_delivered, (size_t)kRoundTrips * 2);
+
+  char label[96];
+  snprintf(label, sizeof(label), "NIP-46 full entity path (%d subs)", kSigners);
+  report(label, full);
+  snprintf(label, sizeof(label), "NIP-46 ephemeral fast path (%d subs)", kSigners);
+  report(label, fast);
+}
+
+// ============================================================================
+// Filter matcher: the compiled predicate program agrees with the generic
+// field-by-field check
+// ============================================================================
+TEST_F(NostrSubscriptionBenchTest, CompiledProgramAgreesWithGenericMatcher)
+{
+  static std::vector<NostrFilter>     filters(20);  // One of each kind in the mix
+  static std::vector<NostrMatchEvent> events(200);
+  build_matcher_mix(filters, events);
+
+  for (const NostrMatchEvent& event : events) {
+    for (const NostrFilter& filter : filters) {
+      ASSERT_EQ(nostr_filter_matches_binary(&filter, &event), nostr_filter_matches_generic(&filter, &event));
+    }
+  }
+
+  size_t matched = 0;
+  run_matcher(nostr_filter_matches_binary, filters, events, &matched);
+  EXPECT_GT(matched, 0u);
+}
+
+// ============================================================================
+// Filter matcher: compiled predicate program vs generic field-by-field check
+// ============================================================================
+TEST_F(NostrSubscriptionBenchTest, DISABLED_FilterMatcherThroughput)
+{
+  static constexpr int kFilters = 512;
+  static constexpr int kEvents  = 1000;
+
+  static std::vector<NostrFilter>     filters(kFilters);
+  static std::vector<NostrMatchEvent> events(kEvents);
+  build_matcher_mix(filters, events);
+
+  size_t generic_matched = 0;
+  size_t program_matched = 0;
+  double generic_ns      = run_matcher(nostr_filter_matches_generic, filters, events, &generic_matched);
+  double program_ns      = run_matcher(nostr_filter_matches_binary, filters, events, &program_matched);
+
+  EXPECT_EQ(program_matched, generic_matched);
+  EXPECT_GT(program_matched, 0u);
+
+  printf("\n  [BENCH] Filter matcher (%d filters x %d events, %zu matches): generic %.1f ns, program %.1f ns (%.2fx)\n",
+         kFilters, kEvents, program_matched, generic_ns, program_ns, generic_ns / program_ns);
+}
@@ -1,7 +1,11 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <string>
+#include <vector>
 
 extern "C" {
 
@@ -33,8 +37,33 @@ typedef struct jsmn_parser {
 #define NOSTR_FILTER_MAX_KINDS 64
 #define NOSTR_FILTER_MAX_TAGS 26
 #define NOSTR_FILTER_MAX_TAG_VALUES 256
+#define NOSTR_FILTER_MAX_LONG_TAG_VALUES 16
+#define NOSTR_FILTER_LONG_TAG_VALUE_LENGTH 64
 #define NOSTR_FILTER_ID_LENGTH 32
 #define NOSTR_FILTER_PUBKEY_LENGTH 32
+#define NOSTR_FILTER_KIND_BITMAP_BITS 65536
+#define NOSTR_MATCH_EVENT_MAX_TAGS (2 * 1024)
+#define NOSTR_FILTER_PROGRAM_LENGTH (4 + NOSTR_FILTER_MAX_TAGS)
+#define NOSTR_FILTER_AUTHORS_HASH_SLOTS 512
+
+enum {
+  NOSTR_FILTER_OP_KIND_ONE    = 0,
+  NOSTR_FILTER_OP_KIND_BITMAP = 1,
+  NOSTR_FILTER_OP_SINCE       = 2,
+  NOSTR_FILTER_OP_UNTIL       = 3,
+  NOSTR_FILTER_OP_RANGE       = 4,
+  NOSTR_FILTER_OP_ID_ONE      = 5,
+  NOSTR_FILTER_OP_ID_SET      = 6,
+  NOSTR_FILTER_OP_AUTHOR_ONE  = 7,
+  NOSTR_FILTER_OP_AUTHOR_HASH = 8,
+  NOSTR_FILTER_OP_TAG_ONE     = 9,
+  NOSTR_FILTER_OP_TAG_SET     = 10,
+};
+
+typedef struct {
+  uint8_t op;
+  uint8_t operand;
+} NostrFilterInstruction;
 
 typedef struct {
   uint8_t value[NOSTR_FILTER_ID_LENGTH];
@@ -47,9 +76,16 @@ typedef struct {
 } NostrFilterPubkey;
 
 typedef struct {
-  char    name;
-  uint8_t values[NOSTR_FILTER_MAX_TAG_VALUES][32];
-  size_t  values_count;
+  uint8_t length;
+  uint8_t value[NOSTR_FILTER_LONG_TAG_VALUE_LENGTH];
+} NostrFilterLongTagValue;
+
+typedef struct {
+  char                    name;
+  uint8_t                 values[NOSTR_FILTER_MAX_TAG_VALUES][32];
+  size_t                  values_count;
+  NostrFilterLongTagValue long_values[NOSTR_FILTER_MAX_LONG_TAG_VALUES];
+  size_t                  long_values_count;
 } NostrFilterTag;
 
 typedef struct {
@@ -64,8 +100,34 @@ typedef struct {
   int64_t since;
   int64_t until;
   uint32_t limit;
+  int32_t  has_limit;
+  int32_t  compiled;
+  size_t   ids_full_count;
+  size_t   authors_full_count;
+  uint64_t kinds_bitmap[NOSTR_FILTER_KIND_BITMAP_BITS / 64];
+  NostrFilterInstruction program[NOSTR_FILTER_PROGRAM_LENGTH];
+  size_t                 program_length;
+  uint16_t               authors_hash[NOSTR_FILTER_AUTHORS_HASH_SLOTS];
 } NostrFilter;
 
+typedef struct {
+  char        name;
+  uint8_t     length;
+  uint8_t     value[32];
+  const char* raw;
+} NostrMatchEventTag;
+
+typedef struct {
+  uint8_t            id[32];
+  uint8_t            pubkey[32];
+  int32_t            id_valid;
+  int32_t            pubkey_valid;
+  uint32_t           kind;
+  int64_t            created_at;
+  size_t             tags_count;
+  NostrMatchEventTag tags[NOSTR_MATCH_EVENT_MAX_TAGS];
+} NostrMatchEvent;
+
 // REQ types
 #define NOSTR_REQ_SUBSCRIPTION_ID_LENGTH 64
 #define NOSTR_REQ_MAX_FILTERS 16
@@ -110,19 +172,55 @@ typedef struct {
 } NostrEventEntity;
 
 // Subscription types
-#define NOSTR_SUBSCRIPTION_MAX_COUNT 256
+#define NOSTR_SUBSCRIPTION_MAX_COUNT 16384
+#define NOSTR_SUBSCRIPTION_NIL 0xFFFFFFFFu
 
 typedef struct {
-  bool         active;
-  int32_t      client_fd;
-  char         subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
-  NostrFilter  filters[NOSTR_REQ_MAX_FILTERS];
-  size_t       filters_count;
+  bool               active;
+  int32_t            client_fd;
+  char               subscription_id[NOSTR_REQ_SUBSCRIPTION_ID_LENGTH + 1];
+  const NostrFilter* filters[NOSTR_REQ_MAX_FILTERS];
+  uint32_t           filter_links[NOSTR_REQ_MAX_FILTERS];
+  size_t             filters_count;
+  uint32_t           slot;
+  uint32_t           conn_prev;
+  uint32_t           conn_next;
+  uint32_t           hash_next;
 } NostrSubscription;
 
 typedef struct {
-  NostrSubscription* subscriptions;
-  size_t             count;
+  uint32_t head;
+  uint32_t count;
+} NostrSubscriptionConnection;
+
+typedef struct {
+  void*    entries;
+  size_t   max_entries;
+  uint32_t entries_free;
+  uint32_t links_free;
+  void*    buckets;
+  size_t   buckets_capacity;
+  void*    links;
+  void*    scratch;
+  size_t   count;
+  size_t   links_count;
+} NostrFilterRegistry;
+
+typedef struct {
+  NostrSubscription**          chunks;
+  size_t                       chunks_count;
+  size_t                       count;
+  uint32_t                     free_head;
+  uint32_t                     epoch;
+  uint32_t*                    buckets;
+  size_t                       buckets_capacity;
+  NostrSubscriptionConnection* connections;
+  size_t                       connections_capacity;
+  size_t                       max_count;
+  size_t                       max_per_connection;
+  void*                        registry;
+  void*                        index;
+  uint32_t*                    sub_epoch;
 } NostrSubscriptionManager;
 
 // JSON function pointers
@@ -155,6 +253,10 @@ int jsmn_parse(jsmn_parser* parser, const char* json, const size_t json_len, jsm
 void nostr_filter_init(NostrFilter* filter);
 bool nostr_filter_parse(const JsonFuncs* funcs, const char* json, const jsmntok_t* token, const size_t token_count, NostrFilter* filter);
 bool nostr_filter_matches(const NostrFilter* filter, const NostrEventEntity* event);
+void nostr_filter_compile(NostrFilter* filter);
+void nostr_match_event_init(NostrMatchEvent* match_event, const NostrEventEntity* event);
+bool nostr_filter_matches_binary(const NostrFilter* filter, const NostrMatchEvent* match_event);
+bool nostr_filter_matches_generic(const NostrFilter* filter, const NostrMatchEvent* match_event);
 void nostr_filter_clear(NostrFilter* filter);
 
 // REQ functions
@@ -169,13 +271,20 @@ void nostr_close_clear(NostrCloseMessage* close_msg);
 
 // Subscription functions
 bool nostr_subscription_manager_init(NostrSubscriptionManager* manager);
+bool nostr_subscription_manager_init_with_limits(NostrSubscriptionManager* manager, size_t max_count, size_t max_per_connection);
 void nostr_subscription_manager_destroy(NostrSubscriptionManager* manager);
 NostrSubscription* nostr_subscription_add(NostrSubscriptionManager* manager, int32_t client_fd, const NostrReqMessage* req);
 bool nostr_subscription_remove(NostrSubscriptionManager* manager, int32_t client_fd, const char* subscription_id);
 size_t nostr_subscription_remove_client(NostrSubscriptionManager* manager, int32_t client_fd);
+size_t nostr_subscription_count_client(const NostrSubscriptionManager* manager, int32_t client_fd);
 NostrSubscription* nostr_subscription_find(NostrSubscriptionManager* manager, int32_t client_fd, const char* subscription_id);
 bool nostr_subscription_matches_event(const NostrSubscription* subscription, const NostrEventEntity* event);
 
+bool nostr_subscription_may_match(const NostrSubscriptionManager* manager, const NostrMatchEvent* match_event);
+
+typedef void (*NostrSubscriptionMatchCallback)(const NostrSubscription* subscription, void* user_data);
+size_t nostr_subscription_find_matching(NostrSubscriptionManager* manager, const NostrEventEntity* event, NostrSubscriptionMatchCallback callback, void* user_data);
+
 }  // extern "C"
 
 class NostrSubscriptionTest : public ::testing::Test {
@@ -200,6 +309,47 @@ protected:
     return jsmn_parse(&parser, json, strlen(json), tokens, 256);
   }
 
+  NostrSubscription* addReq(int32_t client_fd, const char* json) {
+    int count = parseJson(json);
+    nostr_req_init(&req);
+    if (!nostr_req_parse(&funcs, json, tokens, count, &req)) {
+      return nullptr;
+    }
+    return nostr_subscription_add(&manager, client_fd, &req);
+  }
+
+  void setEvent(uint32_t kind, const char* tag_key, const char* tag_value) {
+    memset(&event, 0, sizeof(event));
+    strcpy(event.id, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+    strcpy(event.pubkey, "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb");
+    event.kind       = kind;
+    event.created_at = 1700000000;
+    if (tag_key != nullptr) {
+      strcpy(event.tags[0].key, tag_key);
+      strcpy(event.tags[0].values[0], tag_value);
+      event.tags[0].item_count = 1;
+      event.tag_count          = 1;
+    }
+  }
+
+  static void collect(const NostrSubscription* subscription, void* user_data) {
+    static_cast<std::vector<std::string>*>(user_data)->push_back(subscription->subscription_id);
+  }
+
+  bool mayMatch() {
+    NostrMatchEvent match_event;
+    nostr_match_event_init(&match_event, &event);
+    return nostr_subscription_may_match(&manager, &match_event);
+  }
+
+  std::vector<std::string> findMatching() {
+    std::vector<std::string> ids;
+    size_t count = nostr_subscription_find_matching(&manager, &event, collect, &ids);
+    EXPECT_EQ(count, ids.size());
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  }
+
   JsonFuncs funcs;
   NostrFilter filter;
   NostrReqMessage req;
@@ -420,6 +570,230 @@ TEST_F(NostrSubscriptionTest, FilterMatches_UntilFilter_NoMatch) {
   EXPECT_FALSE(result);
 }
 
+// ============================================================================
+// Compiled Filter Match Tests
+// ============================================================================
+TEST_F(NostrSubscriptionTest, FilterCompile_SortsIdsAndBuildsKindBitmap) {
+  const char* json =
+    "{\"ids\":[\"cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc\","
+    "\"aabb\","
+    "\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\"],"
+    "\"kinds\":[7,1,30023]}";
+  int count = parseJson(json);
+  ASSERT_GT(count, 0);
+  ASSERT_TRUE(nostr_filter_parse(&funcs, json, tokens, count, &filter));
+
+  nostr_filter_compile(&filter);
+  EXPECT_TRUE(filter.compiled);
+  EXPECT_EQ(filter.ids_full_count, 2u);
+  EXPECT_EQ(filter.ids[0].value[0], 0xaa);
+  EXPECT_EQ(filter.ids[1].value[0], 0xcc);
+  EXPECT_EQ(filter.ids[2].prefix_len, 2u);
+  EXPECT_TRUE((filter.kinds_bitmap[1 >> 6] >> 1) & 1);
+  EXPECT_TRUE((filter.kinds_bitmap[30023 >> 6] >> (30023 & 63)) & 1);
+  EXPECT_FALSE((filter.kinds_bitmap[0] >> 4) & 1);
+}
+
+TEST_F(NostrSubscriptionTest, FilterMatchesBinary_IdsFullAndPrefix) {
+  const char* json =
+    "{\"ids\":[\"cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc\",\"aabb\"]}";
+  int count = parseJson(json);
+  ASSERT_TRUE(nostr_filter_parse(&funcs, json, tokens, count, &filter));
+  nostr_filter_compile(&filter);
+
+  static NostrMatchEvent match_event;
+  strcpy(event.id, "cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc");
+  strcpy(event.pubkey, "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb");
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_TRUE(nostr_filter_matches_binary(&filter, &match_event));
+
+  strcpy(event.id, "aabb000000000000000000000000000000000000000000000000000000000000");
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_TRUE(nostr_filter_matches_binary(&filter, &match_event));
+
+  strcpy(event.id, "dddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddd");
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_FALSE(nostr_filter_matches_binary(&filter, &match_event));
+}
+
+TEST_F(NostrSubscriptionTest, FilterMatchesBinary_AuthorsAndKinds) {
+  const char* json =
+    "{\"authors\":[\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\","
+    "\"1111111111111111111111111111111111111111111111111111111111111111\"],\"kinds\":[1,6]}";
+  int count = parseJson(json);
+  ASSERT_TRUE(nostr_filter_parse(&funcs, json, tokens, count, &filter));
+  nostr_filter_compile(&filter);
+
+  static NostrMatchEvent match_event;
+  strcpy(event.id, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+  strcpy(event.pubkey, "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb");
+  event.kind = 6;
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_TRUE(nostr_filter_matches_binary(&filter, &match_event));
+
+  event.kind = 7;
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_FALSE(nostr_filter_matches_binary(&filter, &match_event));
+
+  event.kind = 1;
+  strcpy(event.pubkey, "2222222222222222222222222222222222222222222222222222222222222222");
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_FALSE(nostr_filter_matches_binary(&filter, &match_event));
+}
+
+TEST_F(NostrSubscriptionTest, FilterMatchesBinary_TagFirstValue) {
+  const char* json =
+    "{\"#e\":[\"eeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeee\"],\"#t\":[\"zeta\",\"nostr\"]}";
+  int count = parseJson(json);
+  ASSERT_TRUE(nostr_filter_parse(&funcs, json, tokens, count, &filter));
+  nostr_filter_compile(&filter);
+
+  strcpy(event.id, "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+  strcpy(event.pubkey, "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb");
+  strcpy(event.tags[0].key, "e");
+  strcpy(event.tags[0].values[0], "eeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeee");
+  event.tags[0].item_count = 1;
+  strcpy(event.tags[1].key, "t");
+  strcpy(event.tags[1].values[0], "nostr");
+  event.tags[1].item_count = 1;
+  event.tag_count = 2;
+
+  static NostrMatchEvent match_event;
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_EQ(match_event.tags_count, 2u);
+  EXPECT_TRUE(nostr_filter_matches_binary(&filter, &match_event));
+  EXPECT_TRUE(nostr_filter_matches(&filter, &event));
+
+  strcpy(event.tags[1].values[0], "nost");
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_FALSE(nostr_filter_matches_binary(&filter, &match_event));
+}
+
+TEST_F(NostrSubscriptionTest, FilterMatchesBinary_LongTagValuesComparedInFull) {
+  // Both values share their first 32 bytes
+  const char* json = "{\"#d\":[\"0123456789abcdef0123456789abcdef-first\"]}";
+  int count = parseJson(json);
+  ASSERT_TRUE(nostr_filter_parse(&funcs, json, tokens, count, &filter));
+  nostr_filter_compile(&filter);
+  ASSERT_EQ(filter.tags[0].values_count, 0u);
+  ASSERT_EQ(filter.tags[0].long_values_count, 1u);
+
+  static NostrMatchEvent match_event;
+  setEvent(30000, "d", "0123456789abcdef0123456789abcdef-first");
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_TRUE(nostr_filter_matches_binary(&filter, &match_event));
+
+  setEvent(30000, "d", "0123456789abcdef0123456789abcdef-other");
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_FALSE(nostr_filter_matches_binary(&filter, &match_event));
+
+  setEvent(30000, "d", "0123456789abcdef0123456789abcdef");
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_FALSE(nostr_filter_matches_binary(&filter, &match_event));
+
+  setEvent(30000, "d", "0123456789abcdef0123456789abcdef-first-and-more");
+  nostr_match_event_init(&match_event, &event);
+  EXPECT_FALSE(nostr_filter_matches_binary(&filter, &match_event));
+
+  // Through the subscription index too
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  ASSERT_NE(addReq(1, "[\"REQ\",\"long\",{\"#d\":[\"0123456789abcdef0123456789abcdef-first\"]}]"), nullptr);
+  setEvent(30000, "d", "0123456789abcdef0123456789abcdef-other");
+  EXPECT_TRUE(findMatching().empty());
+  setEvent(30000, "d", "0123456789abcdef0123456789abcdef-first");
+  EXPECT_EQ(findMatching(), std::vector<std::string>{"long"});
+}
+
+TEST_F(NostrSubscriptionTest, FilterCompile_ProgramOrdersBySelectivity) {
+  const char* json =
+    "{\"#t\":[\"a\",\"b\",\"c\"],\"#p\":[\"1111111111111111111111111111111111111111111111111111111111111111\"],"
+    "\"authors\":[\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\",\"cc\"],"
+    "\"until\":1800000000,\"since\":1600000000,\"kinds\":[1]}";
+  int count = parseJson(json);
+  ASSERT_TRUE(nostr_filter_parse(&funcs, json, tokens, count, &filter));
+  nostr_filter_compile(&filter);
+
+  ASSERT_EQ(filter.program_length, 5u);
+  EXPECT_EQ(filter.program[0].op, NOSTR_FILTER_OP_KIND_ONE);
+  EXPECT_EQ(filter.program[1].op, NOSTR_FILTER_OP_RANGE);
+  EXPECT_EQ(filter.program[2].op, NOSTR_FILTER_OP_AUTHOR_HASH);
+  EXPECT_EQ(filter.program[3].op, NOSTR_FILTER_OP_TAG_ONE);
+  EXPECT_EQ(filter.tags[filter.program[3].operand].name, 'p');
+  EXPECT_EQ(filter.program[4].op, NOSTR_FILTER_OP_TAG_SET);
+  EXPECT_EQ(filter.tags[filter.program[4].operand].name, 't');
+
+  // Empty filter compiles to an empty program that accepts everything
+  nostr_filter_init(&filter);
+  nostr_filter_compile(&filter);
+  EXPECT_EQ(filter.program_length, 0u);
+}
+
+TEST_F(NostrSubscriptionTest, FilterMatchesBinary_ProgramAgreesWithGeneric) {
+  static const char* filters[] = {
+    "{\"kinds\":[1]}",
+    "{\"kinds\":[1,6,7],\"since\":1700000000}",
+    "{\"kinds\":[70000]}",
+    "{\"until\":1700000000}",
+    "{\"ids\":[\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa\"]}",
+    "{\"ids\":[\"aaaa\",\"cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc\"]}",
+    "{\"authors\":[\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\"]}",
+    "{\"authors\":[\"1111111111111111111111111111111111111111111111111111111111111111\","
+    "\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\"],\"kinds\":[1]}",
+    "{\"authors\":[\"bb\"]}",
+    "{\"#t\":[\"nostr\"]}",
+    "{\"#t\":[\"nostr\",\"zap\"],\"kinds\":[1],\"since\":1600000000,\"until\":1800000000}",
+    "{\"#e\":[\"eeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeee\"],\"#t\":[\"nostr\"]}",
+  };
+  static const uint32_t kinds[]   = {1, 6, 7, 70000};
+  static const uint64_t times[]   = {1500000000, 1700000000, 1900000000};
+  static const char*    pubkeys[] = {
+    "bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb",
+    "1111111111111111111111111111111111111111111111111111111111111111",
+    "2222222222222222222222222222222222222222222222222222222222222222",
+  };
+  static const char* tag_values[] = {"nostr", "zap", "other"};
+
+  static std::vector<NostrMatchEvent> events;
+  static std::vector<std::string>     labels;
+  events.clear();
+  labels.clear();
+  for (uint32_t kind : kinds) {
+    for (uint64_t created_at : times) {
+      for (const char* pubkey : pubkeys) {
+        for (const char* tag_value : tag_values) {
+          setEvent(kind, "t", tag_value);
+          strcpy(event.pubkey, pubkey);
+          strcpy(event.tags[1].key, "e");
+          strcpy(event.tags[1].values[0], "eeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeeee");
+          event.tags[1].item_count = 1;
+          event.tag_count          = 2;
+          event.created_at         = created_at;
+
+          events.emplace_back();
+          nostr_match_event_init(&events.back(), &event);
+          labels.push_back("kind=" + std::to_string(kind) + " created_at=" + std::to_string(created_at) +
+                           " pubkey=" + pubkey + " t=" + tag_value);
+        }
+      }
+    }
+  }
+
+  static NostrFilter compiled;
+  size_t             matched = 0;
+  for (const char* json : filters) {
+    int count = parseJson(json);
+    ASSERT_TRUE(nostr_filter_parse(&funcs, json, tokens, count, &compiled));
+    nostr_filter_compile(&compiled);
+
+    for (size_t i = 0; i < events.size(); i++) {
+      bool expected = nostr_filter_matches_generic(&compiled, &events[i]);
+      EXPECT_EQ(nostr_filter_matches_binary(&compiled, &events[i]), expected) << json << " " << labels[i];
+      matched += expected ? 1 : 0;
+    }
+  }
+  EXPECT_GT(matched, 0u);
+}
+
 // ============================================================================
 // REQ Parse Tests
 // ============================================================================
@@ -504,7 +878,9 @@ TEST_F(NostrSubscriptionTest, CloseParse_TooFewElements) {
 TEST_F(NostrSubscriptionTest, SubscriptionManager_Init) {
   nostr_subscription_manager_init(&manager);
   EXPECT_EQ(manager.count, 0u);
-  EXPECT_FALSE(manager.subscriptions[0].active);
+  EXPECT_EQ(manager.chunks_count, 0u);  // Slab chunks are allocated on demand
+  EXPECT_EQ(nostr_subscription_find(&manager, 42, "test-sub"), nullptr);
+  EXPECT_EQ(nostr_subscription_count_client(&manager, 42), 0u);
 }
 
 TEST_F(NostrSubscriptionTest, SubscriptionManager_AddAndFind) {
@@ -575,7 +951,7 @@ TEST_F(NostrSubscriptionTest, SubscriptionManager_UpdateExisting) {
   int count1 = parseJson(json1);
   nostr_req_parse(&funcs, json1, tokens, count1, &req);
   NostrSubscription* sub1 = nostr_subscription_add(&manager, 42, &req);
-  EXPECT_EQ(sub1->filters[0].kinds[0], 1u);
+  EXPECT_EQ(sub1->filters[0]->kinds[0], 1u);
 
   // Update with same subscription_id
   const char* json2 = "[\"REQ\",\"test-sub\",{\"kinds\":[4]}]";
@@ -585,7 +961,92 @@ TEST_F(NostrSubscriptionTest, SubscriptionManager_UpdateExisting) {
 
   EXPECT_EQ(sub1, sub2);  // Same pointer
   EXPECT_EQ(manager.count, 1u);  // Still only 1
-  EXPECT_EQ(sub2->filters[0].kinds[0], 4u);  // Updated
+  EXPECT_EQ(sub2->filters[0]->kinds[0], 4u);  // Updated
+}
+
+TEST_F(NostrSubscriptionTest, SubscriptionManager_PerConnectionCap) {
+  ASSERT_TRUE(nostr_subscription_manager_init_with_limits(&manager, 64, 2));
+
+  EXPECT_NE(addReq(42, "[\"REQ\",\"sub1\",{\"kinds\":[1]}]"), nullptr);
+  EXPECT_NE(addReq(42, "[\"REQ\",\"sub2\",{\"kinds\":[1]}]"), nullptr);
+  EXPECT_EQ(addReq(42, "[\"REQ\",\"sub3\",{\"kinds\":[1]}]"), nullptr);
+
+  // Replacing an existing subscription does not count against the cap
+  EXPECT_NE(addReq(42, "[\"REQ\",\"sub2\",{\"kinds\":[7]}]"), nullptr);
+
+  // Other connections have their own budget
+  EXPECT_NE(addReq(43, "[\"REQ\",\"sub3\",{\"kinds\":[1]}]"), nullptr);
+  EXPECT_EQ(nostr_subscription_count_client(&manager, 42), 2u);
+  EXPECT_EQ(nostr_subscription_count_client(&manager, 43), 1u);
+  EXPECT_EQ(manager.count, 3u);
+}
+
+TEST_F(NostrSubscriptionTest, SubscriptionManager_GlobalCap) {
+  ASSERT_TRUE(nostr_subscription_manager_init_with_limits(&manager, 3, 0));
+
+  EXPECT_NE(addReq(1, "[\"REQ\",\"a\",{\"kinds\":[1]}]"), nullptr);
+  EXPECT_NE(addReq(2, "[\"REQ\",\"a\",{\"kinds\":[1]}]"), nullptr);
+  EXPECT_NE(addReq(3, "[\"REQ\",\"a\",{\"kinds\":[1]}]"), nullptr);
+  EXPECT_EQ(addReq(4, "[\"REQ\",\"a\",{\"kinds\":[1]}]"), nullptr);
+
+  EXPECT_TRUE(nostr_subscription_remove(&manager, 2, "a"));
+  EXPECT_NE(addReq(4, "[\"REQ\",\"a\",{\"kinds\":[1]}]"), nullptr);
+  EXPECT_EQ(manager.count, 3u);
+}
+
+TEST_F(NostrSubscriptionTest, SubscriptionManager_RemoveClientKeepsOthers) {
+  nostr_subscription_manager_init(&manager);
+
+  addReq(42, "[\"REQ\",\"a\",{\"kinds\":[1]}]");
+  addReq(43, "[\"REQ\",\"a\",{\"kinds\":[1]}]");
+  addReq(42, "[\"REQ\",\"b\",{\"kinds\":[1]}]");
+  addReq(43, "[\"REQ\",\"b\",{\"kinds\":[1]}]");
+  addReq(42, "[\"REQ\",\"c\",{\"kinds\":[1]}]");
+
+  // Remove from the middle of the connection list first
+  EXPECT_TRUE(nostr_subscription_remove(&manager, 42, "b"));
+  EXPECT_EQ(nostr_subscription_remove_client(&manager, 42), 2u);
+  EXPECT_EQ(nostr_subscription_count_client(&manager, 42), 0u);
+  EXPECT_EQ(nostr_subscription_remove_client(&manager, 42), 0u);
+
+  EXPECT_NE(nostr_subscription_find(&manager, 43, "a"), nullptr);
+  EXPECT_NE(nostr_subscription_find(&manager, 43, "b"), nullptr);
+  EXPECT_EQ(manager.count, 2u);
+
+  setEvent(1, nullptr, nullptr);
+  EXPECT_EQ(findMatching().size(), 2u);
+}
+
+TEST_F(NostrSubscriptionTest, SubscriptionManager_SlotReuseAndGrowth) {
+  nostr_subscription_manager_init(&manager);
+
+  // Spans several slab chunks and grows the per-fd table past its initial size
+  char json[64];
+  for (int i = 0; i < 200; i++) {
+    snprintf(json, sizeof(json), "[\"REQ\",\"s%d\",{\"kinds\":[%d]}]", i, i);
+    ASSERT_NE(addReq(4000 + i, json), nullptr);
+  }
+  EXPECT_EQ(manager.count, 200u);
+  EXPECT_GE(manager.chunks_count, 4u);
+
+  size_t chunks = manager.chunks_count;
+  for (int i = 0; i < 200; i += 2) {
+    EXPECT_EQ(nostr_subscription_remove_client(&manager, 4000 + i), 1u);
+  }
+  for (int i = 0; i < 200; i += 2) {
+    snprintf(json, sizeof(json), "[\"REQ\",\"s%d\",{\"kinds\":[%d]}]", i, i);
+    ASSERT_NE(addReq(4000 + i, json), nullptr);
+  }
+  EXPECT_EQ(manager.chunks_count, chunks);  // Freed slots were reused
+
+  NostrSubscription* sub = nostr_subscription_find(&manager, 4150, "s150");
+  ASSERT_NE(sub, nullptr);
+  EXPECT_EQ(sub->filters[0]->kinds[0], 150u);
+
+  setEvent(150, nullptr, nullptr);
+  std::vector<std::string> ids = findMatching();
+  ASSERT_EQ(ids.size(), 1u);
+  EXPECT_EQ(ids[0], "s150");
 }
 
 TEST_F(NostrSubscriptionTest, SubscriptionMatchesEvent_Match) {
@@ -618,3 +1079,270 @@ TEST_F(NostrSubscriptionTest, SubscriptionMatchesEvent_NoMatch) {
   bool matches = nostr_subscription_matches_event(sub, &event);
   EXPECT_FALSE(matches);
 }
+
+// ============================================================================
+// Inverted Index Matching Tests
+// ============================================================================
+TEST_F(NostrSubscriptionTest, FindMatching_OnlyIndexedKeysMatch) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  ASSERT_NE(addReq(1, "[\"REQ\",\"kind1\",{\"kinds\":[1]}]"), nullptr);
+  ASSERT_NE(addReq(1, "[\"REQ\",\"kind4\",{\"kinds\":[4]}]"), nullptr);
+  ASSERT_NE(addReq(2, "[\"REQ\",\"author\",{\"authors\":[\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\"]}]"), nullptr);
+  ASSERT_NE(addReq(2, "[\"REQ\",\"other\",{\"authors\":[\"cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc\"]}]"), nullptr);
+
+  setEvent(1, nullptr, nullptr);
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"author", "kind1"}));
+}
+
+TEST_F(NostrSubscriptionTest, FindMatching_AllFieldsStillVerified) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  // Posted under the author key, but the kind must still match
+  ASSERT_NE(addReq(1, "[\"REQ\",\"s\",{\"kinds\":[4],\"authors\":[\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\"]}]"), nullptr);
+
+  setEvent(1, nullptr, nullptr);
+  EXPECT_TRUE(findMatching().empty());
+
+  setEvent(4, nullptr, nullptr);
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"s"}));
+}
+
+TEST_F(NostrSubscriptionTest, FindMatching_TagKey) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  ASSERT_NE(addReq(1, "[\"REQ\",\"nostr\",{\"#t\":[\"nostr\"]}]"), nullptr);
+  ASSERT_NE(addReq(1, "[\"REQ\",\"bitcoin\",{\"#t\":[\"bitcoin\"]}]"), nullptr);
+
+  setEvent(1, "t", "nostr");
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"nostr"}));
+}
+
+TEST_F(NostrSubscriptionTest, FindMatching_ResidualFilters) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  ASSERT_NE(addReq(1, "[\"REQ\",\"since\",{\"since\":1600000000}]"), nullptr);
+  ASSERT_NE(addReq(1, "[\"REQ\",\"future\",{\"since\":1800000000}]"), nullptr);
+  // Prefix ids cannot be keyed, so the filter falls back to the residual list
+  ASSERT_NE(addReq(1, "[\"REQ\",\"prefix\",{\"ids\":[\"aaaa\"]}]"), nullptr);
+
+  setEvent(1, nullptr, nullptr);
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"prefix", "since"}));
+}
+
+TEST_F(NostrSubscriptionTest, FindMatching_DeliversSubscriptionOnce) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  ASSERT_NE(addReq(1, "[\"REQ\",\"s\",{\"kinds\":[1]},{\"authors\":[\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\"]},{}]"), nullptr);
+
+  setEvent(1, nullptr, nullptr);
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"s"}));
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"s"}));
+}
+
+TEST_F(NostrSubscriptionTest, FindMatching_UpdateAndRemoveRepost) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  ASSERT_NE(addReq(1, "[\"REQ\",\"s\",{\"kinds\":[1]}]"), nullptr);
+  ASSERT_NE(addReq(1, "[\"REQ\",\"s\",{\"kinds\":[4]}]"), nullptr);
+
+  setEvent(1, nullptr, nullptr);
+  EXPECT_TRUE(findMatching().empty());
+
+  setEvent(4, nullptr, nullptr);
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"s"}));
+
+  ASSERT_TRUE(nostr_subscription_remove(&manager, 1, "s"));
+  EXPECT_TRUE(findMatching().empty());
+}
+
+TEST_F(NostrSubscriptionTest, FindMatching_ManyAuthorsGrowIndex) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+
+  // 64 subscriptions x 200 authors overflows the initial key table and posting pool
+  std::string authors;
+  for (int s = 0; s < 64; s++) {
+    authors.clear();
+    for (int a = 0; a < 200; a++) {
+      char pk[65];
+      snprintf(pk, sizeof(pk), "%064x", s * 1000 + a + 1);
+      authors += std::string(a > 0 ? "," : "") + "\"" + pk + "\"";
+    }
+    std::string json = "[\"REQ\",\"s" + std::to_string(s) + "\",{\"authors\":[" + authors + "]}]";
+    jsmntok_t   big_tokens[512];
+    jsmn_parser parser;
+    jsmn_init(&parser);
+    int count = jsmn_parse(&parser, json.c_str(), json.size(), big_tokens, 512);
+    ASSERT_GT(count, 0);
+    nostr_req_init(&req);
+    ASSERT_TRUE(nostr_req_parse(&funcs, json.c_str(), big_tokens, count, &req));
+    ASSERT_NE(nostr_subscription_add(&manager, 1, &req), nullptr);
+  }
+
+  setEvent(1, nullptr, nullptr);
+  snprintf(event.pubkey, sizeof(event.pubkey), "%064x", 42 * 1000 + 150 + 1);
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"s42"}));
+}
+
+// ============================================================================
+// Shared Filter Tests
+// ============================================================================
+static const NostrFilterRegistry* registryOf(const NostrSubscriptionManager* manager) {
+  return static_cast<const NostrFilterRegistry*>(manager->registry);
+}
+
+TEST_F(NostrSubscriptionTest, SharedFilters_EquivalentFiltersShareOneEntry) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  NostrSubscription* a = addReq(1, "[\"REQ\",\"a\",{\"kinds\":[1,4],\"authors\":[\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\"]}]");
+  // Same constraints in another order, with duplicates
+  NostrSubscription* b = addReq(2, "[\"REQ\",\"b\",{\"authors\":[\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\",\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\"],\"kinds\":[4,1,1]}]");
+  // limit only bounds stored-event queries, so it is not part of the identity
+  NostrSubscription* c = addReq(3, "[\"REQ\",\"c\",{\"kinds\":[1,4],\"authors\":[\"bbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbbb\"],\"limit\":10}]");
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  ASSERT_NE(c, nullptr);
+
+  EXPECT_EQ(a->filters[0], b->filters[0]);
+  EXPECT_EQ(a->filters[0], c->filters[0]);
+  EXPECT_EQ(registryOf(&manager)->count, 1u);
+  EXPECT_EQ(registryOf(&manager)->links_count, 3u);
+  EXPECT_EQ(b->filters[0]->kinds_count, 2u);
+
+  setEvent(4, nullptr, nullptr);
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"a", "b", "c"}));
+}
+
+TEST_F(NostrSubscriptionTest, SharedFilters_TagOrderIsCanonical) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  NostrSubscription* a = addReq(1, "[\"REQ\",\"a\",{\"#t\":[\"nostr\",\"bitcoin\"],\"#r\":[\"wss://relay\"]}]");
+  NostrSubscription* b = addReq(2, "[\"REQ\",\"b\",{\"#r\":[\"wss://relay\"],\"#t\":[\"bitcoin\",\"nostr\",\"nostr\"]}]");
+  NostrSubscription* c = addReq(3, "[\"REQ\",\"c\",{\"#t\":[\"nostr\"],\"#r\":[\"wss://relay\"]}]");
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  ASSERT_NE(c, nullptr);
+
+  EXPECT_EQ(a->filters[0], b->filters[0]);
+  EXPECT_NE(a->filters[0], c->filters[0]);
+  EXPECT_EQ(registryOf(&manager)->count, 2u);
+}
+
+TEST_F(NostrSubscriptionTest, SharedFilters_DistinctFiltersStaySeparate) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  NostrSubscription* a = addReq(1, "[\"REQ\",\"a\",{\"kinds\":[1]}]");
+  NostrSubscription* b = addReq(1, "[\"REQ\",\"b\",{\"kinds\":[1],\"since\":1800000000}]");
+  NostrSubscription* c = addReq(1, "[\"REQ\",\"c\",{\"ids\":[\"aaaa\"]}]");
+  NostrSubscription* d = addReq(1, "[\"REQ\",\"d\",{\"ids\":[\"aaaaaa\"]}]");
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(b, nullptr);
+  ASSERT_NE(c, nullptr);
+  ASSERT_NE(d, nullptr);
+
+  EXPECT_NE(a->filters[0], b->filters[0]);
+  EXPECT_NE(c->filters[0], d->filters[0]);
+  EXPECT_EQ(registryOf(&manager)->count, 4u);
+
+  setEvent(1, nullptr, nullptr);
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"a", "c", "d"}));
+}
+
+TEST_F(NostrSubscriptionTest, SharedFilters_LastSubscriberFreesEntry) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  ASSERT_NE(addReq(1, "[\"REQ\",\"a\",{\"kinds\":[1]}]"), nullptr);
+  ASSERT_NE(addReq(2, "[\"REQ\",\"b\",{\"kinds\":[1]},{\"kinds\":[1]}]"), nullptr);
+  EXPECT_EQ(registryOf(&manager)->count, 1u);
+  EXPECT_EQ(registryOf(&manager)->links_count, 3u);
+
+  // Replacing with the same filter keeps the entry
+  ASSERT_NE(addReq(1, "[\"REQ\",\"a\",{\"kinds\":[1]}]"), nullptr);
+  EXPECT_EQ(registryOf(&manager)->count, 1u);
+
+  setEvent(1, nullptr, nullptr);
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"a", "b"}));
+
+  ASSERT_TRUE(nostr_subscription_remove(&manager, 1, "a"));
+  EXPECT_EQ(registryOf(&manager)->count, 1u);
+  EXPECT_EQ(findMatching(), (std::vector<std::string>{"b"}));
+
+  EXPECT_EQ(nostr_subscription_remove_client(&manager, 2), 1u);
+  EXPECT_EQ(registryOf(&manager)->count, 0u);
+  EXPECT_EQ(registryOf(&manager)->links_count, 0u);
+  EXPECT_TRUE(findMatching().empty());
+}
+
+// ============================================================================
+// Pre-filter Tests
+// ============================================================================
+TEST_F(NostrSubscriptionTest, PreFilter_NoSubscriptionsSkipsEverything) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+
+  setEvent(1, "t", "nostr");
+  EXPECT_FALSE(mayMatch());
+}
+
+TEST_F(NostrSubscriptionTest, PreFilter_TracksReqAndClose) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  ASSERT_NE(addReq(1, "[\"REQ\",\"author\",{\"authors\":[\"cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc\"]}]"), nullptr);
+  ASSERT_NE(addReq(1, "[\"REQ\",\"tag\",{\"#t\":[\"nostr\"]}]"), nullptr);
+
+  setEvent(1, nullptr, nullptr);
+  EXPECT_FALSE(mayMatch());
+  EXPECT_TRUE(findMatching().empty());
+
+  setEvent(1, "t", "nostr");
+  EXPECT_TRUE(mayMatch());
+
+  setEvent(1, nullptr, nullptr);
+  strcpy(event.pubkey, "cccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccccc");
+  EXPECT_TRUE(mayMatch());
+
+  // Kind-only filters are keyed by kind
+  ASSERT_NE(addReq(2, "[\"REQ\",\"kind\",{\"kinds\":[7]}]"), nullptr);
+  setEvent(7, nullptr, nullptr);
+  EXPECT_TRUE(mayMatch());
+
+  ASSERT_TRUE(nostr_subscription_remove(&manager, 2, "kind"));
+  EXPECT_FALSE(mayMatch());
+
+  setEvent(1, "t", "nostr");
+  ASSERT_TRUE(nostr_subscription_remove(&manager, 1, "tag"));
+  EXPECT_FALSE(mayMatch());
+}
+
+TEST_F(NostrSubscriptionTest, PreFilter_ResidualFilterDisablesSkip) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+  ASSERT_NE(addReq(1, "[\"REQ\",\"kind\",{\"kinds\":[7]}]"), nullptr);
+  ASSERT_NE(addReq(1, "[\"REQ\",\"time\",{\"since\":1800000000}]"), nullptr);
+
+  setEvent(1, nullptr, nullptr);
+  EXPECT_TRUE(mayMatch());
+  EXPECT_TRUE(findMatching().empty());
+
+  ASSERT_TRUE(nostr_subscription_remove(&manager, 1, "time"));
+  EXPECT_FALSE(mayMatch());
+}
+
+TEST_F(NostrSubscriptionTest, PreFilter_NeverRejectsMatchingEvents) {
+  ASSERT_TRUE(nostr_subscription_manager_init(&manager));
+
+  // 256 keys over 16 subscriptions; removing half of them must not clear
+  // counters that a live key shares
+  for (int s = 0; s < 16; s++) {
+    char json[512];
+    int  pos = snprintf(json, sizeof(json), "[\"REQ\",\"s%d\",{\"#t\":[", s);
+    for (int t = 0; t < 16; t++) {
+      pos += snprintf(json + pos, sizeof(json) - pos, "%s\"topic%d\"", t > 0 ? "," : "", s * 16 + t);
+    }
+    snprintf(json + pos, sizeof(json) - pos, "]}]");
+    ASSERT_NE(addReq(1, json), nullptr);
+  }
+  for (int s = 0; s < 16; s += 2) {
+    char id[16];
+    snprintf(id, sizeof(id), "s%d", s);
+    ASSERT_TRUE(nostr_subscription_remove(&manager, 1, id));
+  }
+
+  for (int i = 0; i < 256; i++) {
+    char topic[16];
+    snprintf(topic, sizeof(topic), "topic%d", i);
+    setEvent(1, "t", topic);
+    bool live = (i / 16) % 2 == 1;
+    if (live) {
+      ASSERT_TRUE(mayMatch()) << topic;
+    }
+    ASSERT_EQ(findMatching().size(), live ? 1u : 0u) << topic;
+  }
+}